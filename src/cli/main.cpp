@@ -63,6 +63,7 @@ static struct option long_opts[] = {
 	{"rate", required_argument, NULL, 'r'},
 	{"outfile", required_argument, NULL, 'o'},
 	{"interpolation", required_argument, NULL, 'I'},
+	{"seed", required_argument, NULL, 'R'},
 	{"version", 0, NULL, 'v'},
 	{"verbose", optional_argument, NULL, 'V'},
 	{"help", 0, NULL, 'h'},
@@ -134,6 +135,7 @@ int main(int argc, char *argv[])
 		short bits = 16;
 		int rate = 44100;
 		short interpolation = 0;
+		unsigned seed = 0;
 #ifdef H2CORE_HAVE_JACKSESSION
 		QString sessionId;
 #endif
@@ -169,6 +171,9 @@ int main(int argc, char *argv[])
 			case 'b':
 				bits = strtol(optarg, NULL, 10);
 				break;
+			case 'R':
+				seed = strtoul(optarg, NULL, 10);
+				break;
 			case 'v':
 				showVersionOpt = true;
 				break;
@@ -345,6 +350,9 @@ int main(int argc, char *argv[])
 			case 4:
 					sampler->setInterpolateMode( Sampler::HERMITE );
 					break;
+			case 5:
+					sampler->setInterpolateMode( Sampler::SINC );
+					break;
 			case 0:
 			default:
 					sampler->setInterpolateMode( Sampler::LINEAR );
@@ -354,6 +362,10 @@ int main(int argc, char *argv[])
 
 		signal(SIGINT, signal_handler);
 
+		if ( seed ) {
+			pHydrogen->setRandomSeed( seed );
+		}
+
 		bool ExportMode = false;
 		if ( ! outFilename.isEmpty() ) {
 			pHydrogen->startExportSong ( outFilename, rate, bits );
@@ -385,8 +397,8 @@ int main(int argc, char *argv[])
 					show_playlist ( pHydrogen, pPlaylist->getActiveSongNumber() );
 				}
 				break;
-			case EVENT_NONE: /* Sleep if there is no more events */
-				Sleeper::msleep ( 100 );
+			case EVENT_NONE: /* Sleep until the next event */
+				pQueue->wait_event( 100 );
 				break;
 			}
 		}
@@ -454,7 +466,9 @@ void showUsage()
 	cout << "   -k, --kit drumkit_name - Load a drumkit at startup" << endl;
 	cout << "   -i, --install FILE - install a drumkit (*.h2drumkit)" << endl;
 	cout << "   -I, --interpolate INT - Interpolation" << endl;
-	cout << "       (0:linear [default],1:cosine,2:third,3:cubic,4:hermite)" << endl;
+	cout << "       (0:linear [default],1:cosine,2:third,3:cubic,4:hermite,5:sinc)" << endl;
+	cout << "   -R, --seed SEED - Seed the humanize and random pitch values" << endl;
+	cout << "       (the same seed renders the same file, the song seed by default)" << endl;
 
 #ifdef H2CORE_HAVE_JACKSESSION
 	cout << "   -S, --jacksessionid ID - Start a JackSessionHandler session" << endl;
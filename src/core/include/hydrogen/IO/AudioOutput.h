@@ -62,6 +62,17 @@ public:
 	bool has_track_outs() {
 		return __track_out_enabled;
 	}
+	/// Number of per-track outputs, indexed like the song instruments
+	virtual int getNumTracks() {
+		return 0;
+	}
+	/// Per-track output buffers, NULL if the track has none
+	virtual float* getTrackOut_L( unsigned /*nTrack*/ ) {
+		return NULL;
+	}
+	virtual float* getTrackOut_R( unsigned /*nTrack*/ ) {
+		return NULL;
+	}
 
 protected:
 	bool __track_out_enabled;	///< True if is capable of per-track audio output
@@ -201,6 +201,12 @@ public:
 	bool m_bUseMetronome;		///< Use metronome?
 	float m_fMetronomeVolume;	///< Metronome volume FIXME: remove this volume!!
 	unsigned m_nMaxNotes;		///< max notes
+	unsigned m_nRenderThreads;	///< threads rendering the notes, 1 to render them on the audio thread only
+	unsigned m_nExportSegments;	///< song segments an export renders side by side, 1 to render the song in one pass, see SegmentRenderer
+	unsigned m_nExportLeadIn;	///< milliseconds an export segment replays before its start, so the notes started earlier ring into it
+	bool m_bCompactSamples;		///< hold the samples of every drumkit as 16 bit integers, see Sample::load
+	unsigned m_nSampleCacheSize;	///< megabytes of decoded samples kept on disk, 0 to turn the disk cache off, see SampleCache
+	unsigned m_nLogDrainInterval;	///< milliseconds between two writes of the queued log messages
 	unsigned m_nBufferSize;		///< Audio buffer size
 	unsigned m_nSampleRate;		///< Audio sample rate
 
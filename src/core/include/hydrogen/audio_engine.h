@@ -27,6 +27,7 @@
 #include <hydrogen/object.h>
 #include <hydrogen/sampler/Sampler.h>
 #include <hydrogen/synth/Synth.h>
+#include <hydrogen/basics/note_pool.h>
 
 #include <pthread.h>
 #include <string>
@@ -72,14 +73,26 @@ public:
 	 */
 	void lock( const char* file, unsigned int line, const char* function );
 	bool try_lock( const char* file, unsigned int line, const char* function ); /// Return true on success (locked).
+	/**
+	 * Lock, waiting at most nMicroseconds for the holder to unlock. The audio
+	 * thread uses it to ride out the short edits of the other threads instead
+	 * of giving up its period at once.
+	 * \return true on success (locked)
+	 */
+	bool timed_lock( unsigned nMicroseconds, const char* file, unsigned int line, const char* function );
 	void unlock();
 
 	Sampler* get_sampler();
 	Synth* get_synth();
+	/// Notes recycled by the audio thread, use it with the engine locked.
+	NotePool* get_note_pool();
+	/// Change the polyphony of the sampler and the room of the note pool, with the engine locked.
+	void set_max_notes( int nMaxNotes );
 
 private:
 	static AudioEngine* __instance;
 
+	NotePool* __note_pool;
 	Sampler* __sampler;
 	Synth* __synth;
 
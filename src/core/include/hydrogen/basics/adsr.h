@@ -89,6 +89,17 @@ class ADSR : private Object
 		 * \param step the increment to be added to __ticks
 		 */
 		float get_value( float step );
+		/**
+		 * compute the values of the next frames, the same way successive
+		 * get_value() calls would, segment by segment instead of frame by frame.
+		 * SUSTAIN and IDLE are filled in one go.
+		 * \param values the buffer to write the values to
+		 * \param nframes the number of values to compute
+		 * \param step the increment to be added to __ticks for each frame
+		 */
+		void get_values( float* values, int nframes, float step );
+		/** return true if the envelope is over */
+		bool is_idle() const;
 		/**
 		 * sets state to RELEASE,
 		 * returns 0 if the state is IDLE,
@@ -96,6 +107,13 @@ class ADSR : private Object
 		 * set state to RELEASE, save __release_value and return it.
 		 * */
 		float release();
+		/**
+		 * sets state to RELEASE with a new release length,
+		 * starting from the current value, even if already releasing.
+		 * used to quickly silence a stolen voice
+		 * \param length the release tick duration
+		 */
+		void fade_out( float length );
 
 	private:
 		float __attack;		///< Attack tick count
@@ -114,6 +132,24 @@ class ADSR : private Object
 		float __ticks;          ///< current tick count
 		float __value;          ///< current value
 		float __release_value;  ///< value when the release state was entered
+
+		/**
+		 * compute the frames of the current segment that fit into values,
+		 * the per segment coefficients being computed once
+		 * \param values the buffer to write the values to
+		 * \param nframes the size of values
+		 * \param step the increment to be added to __ticks for each frame
+		 * \param length the tick count of the segment
+		 * \param curve the exponential table lookup to apply
+		 * \param from the curve input at the start of the segment
+		 * \param to the curve input at the end of the segment
+		 * \param scale the factor to apply to the curve output
+		 * \param offset the value to add to the scaled curve output
+		 * \param end set to true if the end of the segment has been reached
+		 * \return the number of values written
+		 */
+		int __segment( float* values, int nframes, float step, float length, float ( *curve )( float ),
+		               float from, float to, float scale, float offset, bool* end );
 };
 
 // DEFINITIONS
@@ -158,6 +194,11 @@ inline float ADSR::get_release()
 	return __release;
 }
 
+inline bool ADSR::is_idle() const
+{
+	return __state == IDLE;
+}
+
 };
 
 #endif // H2C_ADRS_H
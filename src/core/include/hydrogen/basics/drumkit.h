@@ -148,6 +148,22 @@ class Drumkit : public H2Core::Object
 		void set_license( const QString& license );
 		/** __license accessor */
 		const QString& get_license() const;
+		/**
+		 * __stream_head setter
+		 * \param frames the new value for __stream_head
+		 */
+		void set_stream_head( int frames );
+		/** __stream_head accessor */
+		int get_stream_head() const;
+		/**
+		 * __compact_samples setter
+		 * \param compact the new value for __compact_samples
+		 */
+		void set_compact_samples( bool compact );
+		/** __compact_samples accessor */
+		bool get_compact_samples() const;
+		/** return true if the samples are to be held as 16 bit integers, as asked by the drumkit or the preferences */
+		bool samples_compact() const;
 		/** return true if the samples are loaded */
 		const bool samples_loaded() const;
 
@@ -159,6 +175,8 @@ class Drumkit : public H2Core::Object
 		QString __author;               ///< drumkit author
 		QString __info;                 ///< drumkit free text
 		QString __license;              ///< drumkit license description
+		int __stream_head;              ///< frames of each sample held in memory, the rest being streamed, 0 to hold them all
+		bool __compact_samples;         ///< true to hold the samples as 16 bit integers, see Sample::load
 		bool __samples_loaded;          ///< true if the instrument samples are loaded
 		InstrumentList* __instruments;  ///< the list of instruments
 		/*
@@ -231,6 +249,26 @@ inline const QString& Drumkit::get_license() const
 	return __license;
 }
 
+inline void Drumkit::set_stream_head( int frames )
+{
+	__stream_head = frames;
+}
+
+inline int Drumkit::get_stream_head() const
+{
+	return __stream_head;
+}
+
+inline void Drumkit::set_compact_samples( bool compact )
+{
+	__compact_samples = compact;
+}
+
+inline bool Drumkit::get_compact_samples() const
+{
+	return __compact_samples;
+}
+
 inline const bool Drumkit::samples_loaded() const
 {
 	return __samples_loaded;
@@ -38,6 +38,8 @@ class XMLNode;
 class ADSR;
 class Drumkit;
 class InstrumentLayer;
+class Sample;
+class SampleLoader;
 
 /**
 Instrument class
@@ -81,11 +83,31 @@ class Instrument : public H2Core::Object
 		 * \param is_live is it performed while playing
 		 */
 		void load_from( Drumkit* drumkit, Instrument* instrument, bool is_live = true );
+		/**
+		 * loads instrument from a given instrument into a `live` Instrument object, the samples being already loaded.
+		 * nothing is locked, the caller locks the audio engine if it is performed while playing
+		 * \param drumkit the drumkit the instrument belongs to
+		 * \param instrument to load members from
+		 * \param samples the MAX_LAYERS samples queued by queue_samples, they belong to the layers afterwards
+		 * \param old_layers where to store the MAX_LAYERS replaced layers, for the caller to delete them
+		 * once the audio engine is unlocked. They are deleted at once if NULL.
+		 */
+		void load_from( Drumkit* drumkit, Instrument* instrument, Sample** samples, InstrumentLayer** old_layers = 0 );
+		/**
+		 * create the samples of the layers of an instrument within a drumkit and queue them to be loaded
+		 * \param drumkit the drumkit the instrument belongs to
+		 * \param instrument the instrument to load samples from
+		 * \param loader the loader to queue the samples in
+		 * \param samples where to store the MAX_LAYERS samples, NULL where there is nothing to load
+		 */
+		static void queue_samples( Drumkit* drumkit, Instrument* instrument, SampleLoader* loader, Sample** samples );
 
 		/**
 		 * load samples data
+		 * \param head_frames see Sample::load
+		 * \param compact see Sample::load
 		 */
-		void load_samples();
+		void load_samples( int head_frames=0, bool compact=false );
 		/*
 		 * unload instrument samples
 		 */
@@ -494,13 +516,15 @@ inline bool Instrument::is_soloed() const
 
 inline void Instrument::enqueue()
 {
-	__queued++;
+	// atomic, the segments of an export play the same instruments
+	__sync_add_and_fetch( &__queued, 1 );
 }
 
 inline void Instrument::dequeue()
 {
-	assert( __queued > 0 );
-	__queued--;
+	int nQueued = __sync_sub_and_fetch( &__queued, 1 );
+	assert( nQueued >= 0 );
+	( void )nQueued;
 }
 
 inline bool Instrument::is_queued() const
@@ -83,8 +83,10 @@ class InstrumentLayer : public H2Core::Object
 
 		/**
 		 * load the sample data
+		 * \param head_frames see Sample::load
+		 * \param compact see Sample::load
 		 */
-		void load_sample();
+		void load_sample( int head_frames=0, bool compact=false );
 		/*
 		 * unload sample and replace it with an empty one
 		 */
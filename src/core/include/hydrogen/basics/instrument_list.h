@@ -123,8 +123,10 @@ class InstrumentList : public H2Core::Object
 
 		/*
 		 * load instrument samples
+		 * \param head_frames see Sample::load
+		 * \param compact see Sample::load
 		 */
-		void load_samples();
+		void load_samples( int head_frames=0, bool compact=false );
 		/*
 		 * unload instrument samples
 		 */
@@ -73,14 +73,16 @@ class Note : public H2Core::Object
 		 * \param pan_r right pan
 		 * \param length it's length
 		 * \param pitch it's pitch
+		 * \param adsr if set, destroyed envelope storage the instrument envelope is copied into, instrument must not be NULL
 		 */
-		Note( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch );
+		Note( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch, ADSR* adsr=0 );
 
 		/**
 		 * copy constructor with an optional parameter
 		 * \param instrument, if set will be used as note instrument
+		 * \param adsr if set, destroyed envelope storage the instrument envelope is copied into, the note instrument must not be NULL
 		 */
-		Note( Note* other, Instrument* instrument=0 );
+		Note( Note* other, Instrument* instrument=0, ADSR* adsr=0 );
 		/** destructor */
 		~Note();
 
@@ -221,6 +223,12 @@ class Note : public H2Core::Object
 		float get_notekey_pitch() const;
 		//* returns octave*12+key+pitch */
 		float get_total_pitch() const;
+		/**
+		 * return the frequency ratio of a pitch, 2^(pitch/12),
+		 * only recomputed when pitch differs from the previous call
+		 * \param pitch the pitch in semitones
+		 */
+		float get_pitch_ratio( float pitch );
 
 		/** return a string representation of key-actove */
 		QString key_to_string();
@@ -270,6 +278,8 @@ class Note : public H2Core::Object
 		void compute_lr_values( float* val_l, float* val_r );
 
 	private:
+		friend class NotePool;      ///< recycles the envelope of released notes
+
 		Instrument* __instrument;   ///< the instrument to be played by this note
 		int __instrument_id;        ///< the id of the instrument played by this note
 		int __position;             ///< note position inside the pattern
@@ -290,6 +300,8 @@ class Note : public H2Core::Object
 		float __bpfb_r;             ///< right band pass filter buffer
 		float __lpfb_l;             ///< left low pass filter buffer
 		float __lpfb_r;             ///< right low pass filter buffer
+		float __ratio_pitch;        ///< pitch __ratio has been computed for
+		float __ratio;              ///< frequency ratio of __ratio_pitch
 		int __pattern_idx;          ///< index of the pattern holding this note for undo actions
 		int __midi_msg;             ///< TODO
 		bool __note_off;            ///< note type on|off
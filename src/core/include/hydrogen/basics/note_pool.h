@@ -0,0 +1,123 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_NOTE_POOL_H
+#define H2C_NOTE_POOL_H
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+class ADSR;
+class Note;
+class Instrument;
+
+/**
+ * NotePool keeps the notes the audio engine is done with, so the
+ * following ones can be constructed in place, envelope included,
+ * without going through the heap.
+ * <br>It is not thread safe, it has to be used from the audio thread
+ * or with the audio engine locked.
+ */
+class NotePool : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * constructor
+		 * \param capacity the number of released notes kept for recycling, they are preallocated
+		 */
+		NotePool( int capacity );
+		/** destructor, deletes the released notes */
+		~NotePool();
+
+		/**
+		 * same as new Note( instrument, position, velocity, pan_l, pan_r, length, pitch ),
+		 * using a released note if any
+		 */
+		Note* acquire( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch );
+		/**
+		 * same as new Note( other, instrument ), using a released note if any
+		 */
+		Note* acquire( Note* other, Instrument* instrument=0 );
+		/**
+		 * give a note back instead of deleting it, it is deleted if the pool is full.
+		 * any heap allocated note can be released, not only the acquired ones.
+		 * \param note the note to recycle, may be NULL
+		 */
+		void release( Note* note );
+
+		/**
+		 * change the number of released notes kept for recycling, the added
+		 * room is preallocated and the surplus released notes are deleted.
+		 * It allocates, call it with the audio engine locked, not from the audio thread.
+		 * \param capacity the new capacity
+		 */
+		void set_capacity( int capacity );
+		/** return the number of released notes kept for recycling */
+		int get_capacity() const;
+		/** return the number of notes ready to be recycled */
+		int get_free() const;
+		/** return the number of notes acquired while the pool was empty, they came from the heap.
+		 * The notes other code copies with new are not counted. */
+		int get_allocations() const;
+		/** return the number of notes released while the pool was full, they went back to the heap */
+		int get_deletions() const;
+
+	private:
+		Note** __free;          ///< the released notes, __free_count first ones are used
+		int __free_count;       ///< number of released notes
+		int __capacity;         ///< size of __free
+		int __allocations;      ///< notes allocated by acquire()
+		int __deletions;        ///< notes deleted by release()
+
+		/** destroy a released note and return its envelope storage, NULL if it has none */
+		static ADSR* __recycle( Note* note );
+};
+
+// DEFINITIONS
+inline int NotePool::get_capacity() const
+{
+	return __capacity;
+}
+
+inline int NotePool::get_free() const
+{
+	return __free_count;
+}
+
+inline int NotePool::get_allocations() const
+{
+	return __allocations;
+}
+
+inline int NotePool::get_deletions() const
+{
+	return __deletions;
+}
+
+};
+
+#endif // H2C_NOTE_POOL_H
+
+/* vim: set softtabstop=4 expandtab: */
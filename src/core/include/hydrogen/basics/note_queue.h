@@ -0,0 +1,132 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_NOTE_QUEUE_H
+#define H2C_NOTE_QUEUE_H
+
+#include <hydrogen/object.h>
+
+#define NOTE_QUEUE_BUCKETS 1024
+
+namespace H2Core
+{
+
+class Note;
+class NotePool;
+
+/**
+ * NoteQueue holds the notes waiting to be played, in a timing wheel with
+ * one bucket per tick starting at the earliest queued tick.
+ * <br>Pushing a note is O(1) but for the notes of the same tick, kept in
+ * humanize delay order. The notes due within a period are popped at once,
+ * clearing the queue costs one step per bucket.
+ * <br>Notes further than NOTE_QUEUE_BUCKETS ticks ahead wait aside until
+ * the wheel reaches them. It is not thread safe, it has to be used from
+ * the audio thread or with the audio engine locked.
+ */
+class NoteQueue : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * constructor
+		 * \param capacity the number of notes which can be queued without allocating
+		 */
+		NoteQueue( int capacity );
+		/** destructor, the queued notes are not deleted */
+		~NoteQueue();
+
+		/**
+		 * make room for a number of notes, it allocates
+		 * \param capacity the number of notes which can be queued without allocating
+		 */
+		void reserve( int capacity );
+
+		/**
+		 * queue a note
+		 * \param note the note, played at its position plus its humanize delay
+		 */
+		void push( Note* note );
+		/**
+		 * pop the notes starting before a given frame, in time order
+		 * \param end_frame the frame the notes have to start before, humanize delay included
+		 * \param tick_size the size of a tick in frames
+		 * \param notes where the popped notes are written
+		 * \param max the size of notes
+		 * \return the number of popped notes, max if there may be more
+		 */
+		int pop_due( long long end_frame, float tick_size, Note** notes, int max );
+		/**
+		 * empty the queue, dequeuing the notes from their instrument
+		 * \param pool where the notes are released
+		 */
+		void clear( NotePool* pool );
+
+		/** return true if no note is queued */
+		bool empty() const;
+		/** return the number of queued notes */
+		int size() const;
+
+	private:
+		/// a queued note, linked to the next one of its bucket
+		struct Node {
+			Note* note;
+			int next;
+		};
+
+		Node* __nodes;                          ///< the nodes, __free links the unused ones
+		int __capacity;                         ///< size of __nodes
+		int __free;                             ///< first unused node, -1 if none
+		int __heads[ NOTE_QUEUE_BUCKETS ];      ///< first node of each bucket, -1 if empty
+		int __base;                             ///< tick of the first bucket
+		int __last;                             ///< tick of the last bucket holding notes
+		int __bucket_count;                     ///< notes in the buckets
+		int __later;                            ///< first node of the notes too far ahead for the wheel
+		int __later_count;                      ///< notes in __later
+		int __max_advance;                      ///< largest negative humanize delay queued, in frames
+
+		/** get an unused node, allocating when none is left */
+		int __node();
+		/** make __nodes capacity long, linking the new nodes as unused */
+		void __grow( int capacity );
+		/** add a node to the bucket of its tick, in humanize delay order */
+		void __insert( int node );
+		/** move the notes from __later the wheel reaches */
+		void __reach_later();
+};
+
+// DEFINITIONS
+inline bool NoteQueue::empty() const
+{
+	return __bucket_count + __later_count == 0;
+}
+
+inline int NoteQueue::size() const
+{
+	return __bucket_count + __later_count;
+}
+
+};
+
+#endif // H2C_NOTE_QUEUE_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -24,6 +24,7 @@
 #define H2C_PATTERN_H
 
 #include <set>
+#include <vector>
 
 #include <hydrogen/object.h>
 #include <hydrogen/basics/note.h>
@@ -135,6 +136,21 @@ class Pattern : public H2Core::Object
 		 * \param note the note to be removed
 		 */
 		void remove_note( Note* note );
+		/**
+		 * get the notes at a given position for playback, from a flat position
+		 * ordered copy of __notes rebuilt after edits, only with the audio engine locked
+		 * \param position the position of the notes
+		 * \param count where the number of notes found is written
+		 * \return the first of count consecutive notes
+		 */
+		Note* const* get_notes_at( int position, int* count );
+		/**
+		 * get the position of the first note after a given one, from the playback copy
+		 * of __notes, only with the audio engine locked
+		 * \param position the position to search after
+		 * \return -1 if there is no note after position
+		 */
+		int get_next_note_position( int position );
 
 		/**
 		 * check if this pattern contains a note referencing the given instrument
@@ -187,6 +203,12 @@ class Pattern : public H2Core::Object
 		notes_t __notes;                                        ///< a multimap (hash with possible multiple values for one key) of note
 		virtual_patterns_t __virtual_patterns;                  ///< a list of patterns directly referenced by this one
 		virtual_patterns_t __flattened_virtual_patterns;        ///< the complete list of virtual patterns
+		std::vector<int> __playback_positions;                  ///< the positions of __notes, in order
+		std::vector<Note*> __playback_notes;                    ///< the notes of __notes, in the same order
+		bool __playback_changed;                                ///< __notes changed since the playback copy was built
+
+		/** rebuild the playback copy of __notes if it changed, without allocating */
+		void __playback_update();
 
 		/**
 		 * save the pattern within the given XMLNode
@@ -274,6 +296,12 @@ inline const Pattern::virtual_patterns_t* Pattern::get_flattened_virtual_pattern
 inline void Pattern::insert_note( Note* note, int position )
 {
 	__notes.insert( std::make_pair( ( position==-1 ? note->get_position() : position ), note ) );
+	// the audio thread rebuilds the playback copy, it must not allocate
+	if ( __playback_notes.capacity() < __notes.size() ) {
+		__playback_positions.reserve( 2 * __notes.size() );
+		__playback_notes.reserve( 2 * __notes.size() );
+	}
+	__playback_changed = true;
 }
 
 inline bool Pattern::virtual_patterns_empty() const
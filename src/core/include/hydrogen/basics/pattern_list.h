@@ -107,6 +107,11 @@ class PatternList : public H2Core::Object
 		 * empty the pattern list
 		 */
 		void clear();
+		/**
+		 * replace the patterns, without checking for duplicates
+		 * \param patterns the new patterns, each one only once
+		 */
+		void assign( const std::vector<Pattern*>& patterns );
 		/**
 		 * mark all patterns as old
 		 */
@@ -155,6 +160,11 @@ inline void PatternList::clear()
 	__patterns.clear();
 }
 
+inline void PatternList::assign( const std::vector<Pattern*>& patterns )
+{
+	__patterns = patterns;
+}
+
 };
 
 #endif // H2C_PATTERN_LIST_H
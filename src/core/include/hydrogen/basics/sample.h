@@ -27,6 +27,7 @@
 #include <sndfile.h>
 
 #include <hydrogen/object.h>
+#include <hydrogen/basics/sample_cache.h>
 
 namespace H2Core
 {
@@ -125,8 +126,8 @@ class Sample : public H2Core::Object
 		 * \param filepath the path to the sample
 		 * \param frames the number of frames per channel in the sample
 		 * \param sample_rate the sample rate of the sample
-		 * \param data_l the left channel array of data
-		 * \param data_l the right channel array of data
+		 * \param data_l the left channel array of data, allocated by alloc_data
+		 * \param data_l the right channel array of data, allocated by alloc_data, may be data_l for a mono sample
 		 */
 		Sample( const QString& filepath, int frames=0, int sample_rate=0, float* data_l=0, float* data_r=0 );
 		/** copy constructor */
@@ -145,8 +146,10 @@ class Sample : public H2Core::Object
 		/**
 		 * load a sample from a file
 		 * \param filepath the file to load audio data from
+		 * \param head_frames see load( int, bool )
+		 * \param compact see load( int, bool )
 		 */
-		static Sample* load( const QString& filepath );
+		static Sample* load( const QString& filepath, int head_frames=0, bool compact=false );
 		/**
 		 * load a sample from a file and apply the transformations to the sample data
 		 * \param filepath the file to load audio data from
@@ -159,8 +162,17 @@ class Sample : public H2Core::Object
 
 		/**
 		 * load sample data
+		 * \param head_frames if not 0 and the file is longer, only its
+		 * first head_frames frames are loaded, the rest being streamed
+		 * from the file by the SampleStreamer while the sample plays.
+		 * the data is shared with the other samples of the same file
+		 * through the SampleCache until the sample is modified
+		 * \param compact if true, the frames are held as 16 bit integers,
+		 * see get_pcm_l, halving the memory of the float frames. the
+		 * sampler converts them while rendering, modifying the sample
+		 * turns them back into floats
 		 */
-		void load();
+		void load( int head_frames=0, bool compact=false );
 		/**
 		 * unload sample data
 		 */
@@ -200,8 +212,10 @@ class Sample : public H2Core::Object
 		 */
 		bool exec_rubberband_cli( const Rubberband& rb );
 
-		/** return true if both data channels are null pointers */
+		/** return true if the sample holds no frame, float or compact */
 		bool is_empty() const;
+		/** return true if only the first frames of the sample are in memory */
+		bool is_streamed() const;
 		/** __filepath accessor */
 		const QString get_filepath() const;
 		/** return filename part of __filepath */
@@ -227,10 +241,56 @@ class Sample : public H2Core::Object
 
 		/** return data size */
 		int get_size() const;
-		/** __data_l accessor */
+		/** __data_frames accessor, the frames held by __data_l and __data_r */
+		int get_data_frames() const;
+		/** __data_l accessor, NULL if the sample is compact */
 		float* get_data_l() const;
-		/** __data_r accessor */
+		/** __data_r accessor, NULL if the sample is compact */
 		float* get_data_r() const;
+		/** __pcm_l accessor, the frames scaled by SAMPLE_PCM16_SCALE, NULL if the sample is not compact */
+		const short* get_pcm_l() const;
+		/** __pcm_r accessor */
+		const short* get_pcm_r() const;
+		/** return true if the frames are held as 16 bit integers, see load( int, bool ) */
+		bool is_compact() const;
+		/**
+		 * return the left value of a frame in memory, float or compact
+		 * \param frame the frame index, less than get_data_frames()
+		 */
+		float get_frame_l( int frame ) const;
+		/**
+		 * return the right value of a frame in memory, float or compact
+		 * \param frame the frame index, less than get_data_frames()
+		 */
+		float get_frame_r( int frame ) const;
+		/** return true if both channels share the same frames, as loaded from a mono file */
+		bool is_mono() const;
+
+		/**
+		 * allocate the frames of a channel, aligned on SAMPLE_ALIGNMENT bytes and
+		 * surrounded by SAMPLE_GUARD_FRAMES silent frames on each side, so that
+		 * the interpolators can read the frames around any position without
+		 * checking the bounds
+		 * \param frames the number of frames
+		 * \return the first frame, to free with free_data
+		 */
+		static float* alloc_data( int frames );
+		/**
+		 * free frames allocated by alloc_data
+		 * \param data the first frame, may be NULL
+		 */
+		static void free_data( float* data );
+		/**
+		 * allocate the 16 bit frames of a compact channel, laid out as alloc_data does
+		 * \param frames the number of frames
+		 * \return the first frame, to free with free_pcm
+		 */
+		static short* alloc_pcm( int frames );
+		/**
+		 * free frames allocated by alloc_pcm
+		 * \param data the first frame, may be NULL
+		 */
+		static void free_pcm( short* data );
 		/**
 		 * __is_modified setter
 		 * \parama value the new value for __is_modified
@@ -257,9 +317,13 @@ class Sample : public H2Core::Object
 	private:
 		QString __filepath;                     ///< filepath of the sample
 		int __frames;                           ///< number of frames in this sample
+		int __data_frames;                      ///< number of frames in memory, less than __frames if the sample is streamed
 		int __sample_rate;                      ///< samplerate for this sample
 		float* __data_l;                        ///< left channel data
 		float* __data_r;                        ///< right channel data
+		short* __pcm_l;                         ///< left channel data of a compact sample
+		short* __pcm_r;                         ///< right channel data of a compact sample
+		SampleCache::Entry* __cached;           ///< the shared data of a loaded file, NULL when the sample owns its data
 		bool __is_modified;                     ///< true if sample is modified
 		PanEnvelope __pan_envelope;             ///< pan envelope vector
 		VelocityEnvelope __velocity_envelope;   ///< velocity envelope vector
@@ -267,22 +331,30 @@ class Sample : public H2Core::Object
 		Rubberband __rubberband;                ///< set of rubberband parameters
 		/** loop modes string */
 		static const char* __loop_modes[];
+
+		/** free or give back to the cache the data, the frame counts are left unchanged */
+		void __release_data();
+		/** copy the data shared through the cache, or by both channels, as floats before modifying it */
+		void __own_data();
 };
 
 // DEFINITIONS
 
 inline void Sample::unload()
 {
-	if( __data_l ) delete __data_l;
-	if( __data_r ) delete __data_r;
-	__frames = __sample_rate = 0;
-	__data_l = __data_r = 0;
+	__release_data();
+	__frames = __data_frames = __sample_rate = 0;
 	// __is_modified = false; leave this unchanged as pan, velocity, loop and rubberband are kept unchanged
 }
 
 inline bool Sample::is_empty() const
 {
-	return ( __data_l==__data_r==0 );
+	return ( __data_l==0 && __data_r==0 && __pcm_l==0 );
+}
+
+inline bool Sample::is_streamed() const
+{
+	return ( __data_frames < __frames );
 }
 
 inline const QString Sample::get_filepath() const
@@ -323,7 +395,12 @@ inline double Sample::get_sample_duration() const
 
 inline int Sample::get_size() const
 {
-	return __frames * sizeof( float ) * 2;
+	return __data_frames * ( is_compact() ? sizeof( short ) : sizeof( float ) ) * ( is_mono() ? 1 : 2 );
+}
+
+inline int Sample::get_data_frames() const
+{
+	return __data_frames;
 }
 
 inline float* Sample::get_data_l() const
@@ -336,6 +413,36 @@ inline float* Sample::get_data_r() const
 	return __data_r;
 }
 
+inline const short* Sample::get_pcm_l() const
+{
+	return __pcm_l;
+}
+
+inline const short* Sample::get_pcm_r() const
+{
+	return __pcm_r;
+}
+
+inline bool Sample::is_compact() const
+{
+	return ( __pcm_l!=0 );
+}
+
+inline float Sample::get_frame_l( int frame ) const
+{
+	return __data_l ? __data_l[frame] : __pcm_l[frame] * SAMPLE_PCM16_SCALE;
+}
+
+inline float Sample::get_frame_r( int frame ) const
+{
+	return __data_r ? __data_r[frame] : __pcm_r[frame] * SAMPLE_PCM16_SCALE;
+}
+
+inline bool Sample::is_mono() const
+{
+	return ( __data_l==__data_r && __data_l!=0 ) || ( __pcm_l==__pcm_r && __pcm_l!=0 );
+}
+
 inline void Sample::set_is_modified( bool is_modified )
 {
 	__is_modified = is_modified;
@@ -0,0 +1,163 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_CACHE_H
+#define H2C_SAMPLE_CACHE_H
+
+#include <hydrogen/object.h>
+
+#include <map>
+#include <pthread.h>
+
+namespace H2Core
+{
+
+/**
+ * Process wide cache of the decoded sample data.
+ * <br>The samples loading the same file share one read only copy of its
+ * frames, counted by references, whatever the drumkit or the song they
+ * belong to. An entry is keyed by the file path, its modification time and
+ * size, the number of frames held in memory and their format, see Sample::load.
+ * <br>The frames decoded from the compressed formats are also written to
+ * the user cache directory, so that the next run reads them back instead
+ * of decoding them again. Only the samples fully held in memory go there,
+ * decoding the head of a streamed sample is quick enough. The disk cache
+ * is bounded, the least recently used files go first, see set_disk_limit.
+ * <br>Acquiring and releasing entries lock, they must not be done by the
+ * realtime threads.
+ */
+class SampleCache : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** decoded frames shared by the samples of a file */
+		struct Entry {
+			QString key;            ///< file path, memory frames, format, modification time and size
+			float* data_l;          ///< left frames, see Sample::alloc_data, NULL if compact
+			float* data_r;          ///< right frames, data_l for a mono file
+			short* pcm_l;           ///< left 16 bit frames of a compact entry, see Sample::alloc_pcm, NULL otherwise
+			short* pcm_r;           ///< right 16 bit frames, pcm_l for a mono file
+			int frames;             ///< frames of the file
+			int data_frames;        ///< frames in memory, less than frames for a streamed sample
+			int sample_rate;        ///< sample rate of the file
+			int refs;               ///< samples using the entry
+		};
+
+		/** create the cache instance */
+		static void create_instance();
+		/** return the cache instance */
+		static SampleCache* get_instance() { assert( __instance ); return __instance; }
+		/** destructor */
+		~SampleCache();
+
+		/**
+		 * return the decoded frames of a file, decoding it if no sample uses it yet
+		 * \param filepath the file to decode
+		 * \param head_frames frames to keep in memory, all of them if 0, see Sample::load
+		 * \param compact true to keep the frames as 16 bit integers, see Sample::load
+		 * \return the entry to give back with release(), NULL if the file can't be decoded
+		 */
+		Entry* acquire( const QString& filepath, int head_frames, bool compact=false );
+		/**
+		 * take one more reference on an entry, for a sample copy
+		 * \param entry an entry already acquired
+		 * \return entry
+		 */
+		Entry* share( Entry* entry );
+		/**
+		 * give an entry back, its frames are freed with its last reference
+		 * \param entry the entry returned by acquire or share
+		 */
+		void release( Entry* entry );
+
+		/** return the number of files decoded in memory */
+		int get_size();
+		/** return the number of bytes held in memory */
+		long long get_bytes();
+
+		/**
+		 * bound the disk cache, removing its least recently used files above the limit
+		 * \param bytes the bytes the disk cache may hold, 0 turns it off and clears it
+		 */
+		void set_disk_limit( long long bytes );
+		/** return the bytes the disk cache may hold */
+		long long get_disk_limit();
+		/** return the bytes held by the disk cache */
+		static long long get_disk_bytes();
+
+	private:
+		static SampleCache* __instance;         ///< the cache instance
+		std::map<QString, Entry*> __entries;    ///< the entries by key
+		pthread_mutex_t __mutex;                ///< protects __entries and the references
+		long long __disk_limit;                 ///< bytes the disk cache may hold, 0 if off
+		pthread_mutex_t __disk_mutex;           ///< protects __disk_limit, serializes the disk cache evictions
+
+		/** constructor */
+		SampleCache();
+
+		/**
+		 * decode a file, or read back its frames from the disk cache
+		 * \param filepath the file to decode
+		 * \param head_frames frames to keep in memory, all of them if 0
+		 * \param modified the file modification time
+		 * \param size the file size, a rewrite within the same second changes it
+		 * \return a new entry of float frames without reference, NULL on error
+		 */
+		Entry* __decode( const QString& filepath, int head_frames, long long modified, long long size );
+		/**
+		 * return the file holding the decoded frames of a file in the disk cache
+		 * \param filepath the file decoded
+		 */
+		static QString __disk_path( const QString& filepath );
+		/**
+		 * read back decoded frames from the disk cache
+		 * \param filepath the file decoded
+		 * \param modified the file modification time, frames cached from another version are ignored
+		 * \param size the file size, frames cached from another version are ignored
+		 * \return a new entry without reference, NULL if the frames are not cached
+		 */
+		Entry* __read_disk( const QString& filepath, long long modified, long long size );
+		/**
+		 * write decoded frames to the disk cache
+		 * \param filepath the file decoded
+		 * \param modified the file modification time
+		 * \param size the file size
+		 * \param entry the decoded frames
+		 */
+		void __write_disk( const QString& filepath, long long modified, long long size, Entry* entry );
+		/**
+		 * remove the least recently used files of the disk cache until it holds at most limit bytes
+		 * \param limit the bytes to keep
+		 */
+		void __evict_disk( long long limit );
+		/** replace the float frames of an entry by rounded 16 bit frames */
+		static void __compact( Entry* entry );
+		/** free an entry and its frames */
+		static void __free( Entry* entry );
+};
+
+};
+
+#endif // H2C_SAMPLE_CACHE_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,136 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_LOADER_H
+#define H2C_SAMPLE_LOADER_H
+
+#include <hydrogen/object.h>
+
+#include <vector>
+#include <pthread.h>
+
+namespace H2Core
+{
+
+class Sample;
+
+/**
+ * Decodes a batch of samples in parallel, one thread per core.
+ * <br>The samples are added with their file path set, then start() hands
+ * them to the workers which call Sample::load on each of them. A sample
+ * which could not be decoded is left empty, see Sample::is_empty.
+ * <br>Progress is reported as EVENT_PROGRESS percents if asked for, and
+ * cancel() can be called from any thread to give up the remaining samples.
+ */
+class SampleLoader : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * constructor
+		 * \param progress_events true to push EVENT_PROGRESS while loading
+		 */
+		SampleLoader( bool progress_events=false );
+		/** cancel and wait for the workers */
+		~SampleLoader();
+
+		/**
+		 * queue a sample, must not be called while loading
+		 * \param sample the sample to load, still owned by the caller
+		 * \param head_frames see Sample::load( int, bool )
+		 * \param compact see Sample::load( int, bool )
+		 */
+		void add( Sample* sample, int head_frames=0, bool compact=false );
+		/** return the number of queued samples */
+		int get_size() const;
+
+		/** start the workers and return without waiting for them */
+		void start();
+		/**
+		 * wait for the workers to be done
+		 * \return false if the load was cancelled
+		 */
+		bool wait();
+		/**
+		 * load the samples and wait for them, start() then wait()
+		 * \return false if the load was cancelled
+		 */
+		bool run();
+		/** give up the samples not loaded yet, can be called from any thread */
+		void cancel();
+
+		/** return true while the workers are loading */
+		bool is_loading() const;
+		/** return true if the load was cancelled */
+		bool is_cancelled() const;
+		/** return the percentage of samples loaded */
+		int get_progress() const;
+
+	private:
+		/** a queued sample */
+		struct Job {
+			Sample* sample;         ///< the sample to load
+			int head_frames;        ///< frames loaded in memory
+			bool compact;           ///< frames held as 16 bit integers
+		};
+
+		std::vector<Job> __jobs;            ///< the queued samples
+		std::vector<pthread_t> __workers;   ///< the running workers
+		bool __progress_events;             ///< push EVENT_PROGRESS
+		volatile int __next;                ///< next job to hand out
+		volatile int __done;                ///< jobs done
+		volatile int __running;             ///< workers not done yet
+		volatile int __percent;             ///< last percentage pushed
+		volatile bool __cancel;             ///< set to give up the remaining jobs
+
+		/** worker thread main loop */
+		static void* __worker_main( void* param );
+};
+
+// DEFINITIONS
+
+inline int SampleLoader::get_size() const
+{
+	return __jobs.size();
+}
+
+inline bool SampleLoader::is_loading() const
+{
+	return __running > 0;
+}
+
+inline bool SampleLoader::is_cancelled() const
+{
+	return __cancel;
+}
+
+inline int SampleLoader::get_progress() const
+{
+	return __jobs.empty() ? 100 : __done * 100 / ( int )__jobs.size();
+}
+
+};
+
+#endif // H2C_SAMPLE_LOADER_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -106,6 +106,7 @@ class Song : public H2Core::Object
 		}
 		void set_pattern_list( PatternList* pattern_list ) {
 			__pattern_list = pattern_list;
+			patterns_changed();
 		}
 
 		std::vector<PatternList*>* get_pattern_group_vector() {
@@ -113,6 +114,20 @@ class Song : public H2Core::Object
 		}
 		void set_pattern_group_vector( std::vector<PatternList*>* vect ) {
 			__pattern_group_sequence = vect;
+			patterns_changed();
+		}
+
+		/**
+		 * to be called with the audio engine locked once the columns, the virtual
+		 * patterns or the pattern lengths changed, it tells the audio thread its
+		 * timeline of the song is stale until Hydrogen::updateSongTimeline()
+		 */
+		void patterns_changed() {
+			__pattern_generation = ++__last_pattern_generation;
+		}
+		/** return a number changed by each patterns_changed() call, never shared by two songs */
+		unsigned get_pattern_generation() const {
+			return __pattern_generation;
 		}
 
 		static Song* load( const QString& sFilename );
@@ -177,6 +192,14 @@ class Song : public H2Core::Object
 		}
 		void set_swing_factor( float factor );
 
+		/// seed of the humanize and random pitch values, 0 for a new one each time the song is loaded
+		unsigned get_random_seed() {
+			return __random_seed;
+		}
+		void set_random_seed( unsigned seed ) {
+			__random_seed = seed;
+		}
+
 		SongMode get_mode() {
 			return __song_mode;
 		}
@@ -199,6 +222,9 @@ class Song : public H2Core::Object
 		float __humanize_time_value;
 		float __humanize_velocity_value;
 		float __swing_factor;
+		unsigned __random_seed;
+		unsigned __pattern_generation;				///< see patterns_changed()
+		static unsigned __last_pattern_generation;		///< last generation given to a song
 
 		SongMode __song_mode;
 };
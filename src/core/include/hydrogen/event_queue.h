@@ -25,9 +25,12 @@
 
 #include <hydrogen/object.h>
 #include <hydrogen/basics/note.h>
+#include <hydrogen/helpers/mpsc_queue.h>
 #include <cassert>
+#include <pthread.h>
 
-#define MAX_EVENTS 1024
+#define MAX_EVENTS 1024		///< must be a power of 2
+#define MAX_NOTE_EDITS 1024	///< must be a power of 2
 
 namespace H2Core
 {
@@ -62,6 +65,10 @@ public:
 ///
 /// Event queue: is the way the engine talks to the GUI
 ///
+/// Any thread can push events, the audio thread included: pushing neither
+/// locks nor allocates. A single thread pops them.
+/// When the queue is full, the new events are dropped and counted.
+///
 class EventQueue : public H2Core::Object
 {
 	H2_OBJECT
@@ -70,9 +77,32 @@ public:
 	static EventQueue* get_instance() { assert(__instance); return __instance; }
 	~EventQueue();
 
+	/**
+	 * queue an event, drop it if the queue is full
+	 * \param type the event type
+	 * \param nValue the event value
+	 */
 	void push_event( EventType type, int nValue );
+	/** return the oldest event, or an EVENT_NONE event if the queue is empty */
 	Event pop_event();
+	/**
+	 * pop up to nMax events at once
+	 * \param pEvents where the events are written, in push order
+	 * \param nMax size of pEvents
+	 * \return the number of events written
+	 */
+	int pop_events( Event* pEvents, int nMax );
+	/**
+	 * block until an event has been pushed or the timeout expired
+	 * \param nTimeoutMs the timeout in milliseconds
+	 * \return true if the queue is not empty
+	 */
+	bool wait_event( int nTimeoutMs );
+	/** return the number of events dropped because the queue was full */
+	unsigned get_overflows() const;
 
+		/// A pattern edit made while recording, see SE_addNoteAction.
+		/// The note at m_column / m_row is toggled, b_noteExist replaces it instead.
 		struct AddMidiNoteVector
 		{
 				int m_column;       //position
@@ -88,17 +118,55 @@ public:
 				bool b_isInstrumentMode;
 				bool b_noteExist;
 		};
-		std::vector<AddMidiNoteVector> m_addMidiNoteVector;
+
+	/**
+	 * queue a note edit for the GUI undo stack, drop it if the queue is full.
+	 * Pushing neither locks nor allocates, it can be done from the audio thread.
+	 * \param noteEdit the note edit
+	 */
+	void push_note_edit( const AddMidiNoteVector& noteEdit );
+	/**
+	 * pop up to nMax note edits at once
+	 * \param pNoteEdits where the note edits are written, in push order
+	 * \param nMax size of pNoteEdits
+	 * \return the number of note edits written
+	 */
+	int pop_note_edits( AddMidiNoteVector* pNoteEdits, int nMax );
+	/** return the number of note edits dropped because the queue was full */
+	unsigned get_note_edit_overflows() const;
 
 private:
 	EventQueue();
 	static EventQueue *__instance;
 
-	int __read_index;
-	int __write_index;
-	Event __events_buffer[ MAX_EVENTS ];
+	MpscQueue<Event, MAX_EVENTS> __events;
+	MpscQueue<AddMidiNoteVector, MAX_NOTE_EDITS> __note_edits;
+	volatile int __waiting;			///< a consumer is in wait_event()
+
+	pthread_mutex_t __wait_mutex;
+	pthread_cond_t __wait_cond;
 };
 
+inline unsigned EventQueue::get_overflows() const
+{
+	return __events.get_overflows();
+}
+
+inline void EventQueue::push_note_edit( const AddMidiNoteVector& noteEdit )
+{
+	__note_edits.push( noteEdit );
+}
+
+inline int EventQueue::pop_note_edits( AddMidiNoteVector* pNoteEdits, int nMax )
+{
+	return __note_edits.pop( pNoteEdits, nMax );
+}
+
+inline unsigned EventQueue::get_note_edit_overflows() const
+{
+	return __note_edits.get_overflows();
+}
+
 };
 
 #endif
@@ -32,12 +32,18 @@
 
 #define MAX_BUFFER_SIZE         8192
 
+#define RENDER_GROUPS           16      // instrument groups the sampler mixes in a fixed order, the most render threads
+
 #define MIDI_OUT_NOTE_MIN       0
 #define MIDI_OUT_NOTE_MAX       127
 #define MIDI_OUT_CHANNEL_MIN    -1
 #define MIDI_OUT_CHANNEL_MAX    15
 
 #define SAMPLE_CHANNELS         2
+#define SAMPLE_ALIGNMENT        64      // bytes, alignment of the sample frames, a cache line
+#define SAMPLE_GUARD_FRAMES     16      // silent frames on each side of the sample frames
+#define SAMPLE_PCM16_SCALE      ( 1.0f / 32768.0f )     // float value of a unit of the 16 bit compact sample frames
+#define SAMPLE_CACHE_DISK_SIZE  512     // megabytes, default size of the decoded samples disk cache
 
 #define TWOPI                   6.28318530717958647692
 
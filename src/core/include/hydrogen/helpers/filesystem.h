@@ -79,6 +79,8 @@ class Filesystem : public H2Core::Object
 		static QString cache_dir();
 		/** returns user repository cache path */
 		static QString repositories_cache_dir();
+		/** returns user decoded samples cache path */
+		static QString samples_cache_dir();
 		/** returns system demos path */
 		static QString demos_dir();
 		/** returns system xsd path */
@@ -0,0 +1,162 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_MPSC_QUEUE_H
+#define H2C_MPSC_QUEUE_H
+
+#define MPSC_QUEUE_CACHE_LINE 64
+
+namespace H2Core
+{
+
+/**
+ * MpscQueue is a bounded lock-free queue, any number of threads can push
+ * items, a single thread pops them.
+ * <br>Pushing neither locks nor allocates, it can be done from the audio thread.
+ * When the queue is full, the pushed items are dropped and counted.
+ * \param T the item type, it is copied in and out
+ * \param SIZE the capacity, must be a power of 2
+ */
+template<class T, unsigned SIZE>
+class MpscQueue
+{
+	public:
+		/** constructor */
+		MpscQueue();
+
+		/**
+		 * queue a copy of an item
+		 * \param item the item to queue
+		 * \return false if the queue was full and the item dropped
+		 */
+		bool push( const T& item );
+		/**
+		 * pop up to nMax items at once, only from the consumer thread
+		 * \param items where the items are written, in push order
+		 * \param nMax size of items
+		 * \return the number of items written
+		 */
+		int pop( T* items, int nMax );
+		/** return true if there is no item to pop, only from the consumer thread */
+		bool empty() const;
+		/** return the number of items dropped because the queue was full */
+		unsigned get_overflows() const;
+
+	private:
+		/// a slot of the ring buffer
+		struct Cell {
+			volatile unsigned sequence;	///< index the slot is ready to be written at, index + 1 once written
+			T item;
+		};
+
+		// the producers and the consumer indices live on their own cache lines
+		char __pad0[ MPSC_QUEUE_CACHE_LINE ];
+		volatile unsigned __write_index;	///< next index to write, shared by the producers
+		char __pad1[ MPSC_QUEUE_CACHE_LINE - sizeof( unsigned ) ];
+		volatile unsigned __read_index;		///< next index to read, only used by the consumer
+		char __pad2[ MPSC_QUEUE_CACHE_LINE - sizeof( unsigned ) ];
+		volatile unsigned __overflows;		///< items dropped
+		Cell __cells[ SIZE ];
+};
+
+// DEFINITIONS
+template<class T, unsigned SIZE>
+MpscQueue<T, SIZE>::MpscQueue()
+	: __write_index( 0 )
+	, __read_index( 0 )
+	, __overflows( 0 )
+{
+	for ( unsigned i = 0; i < SIZE; ++i ) {
+		__cells[ i ].sequence = i;
+	}
+}
+
+template<class T, unsigned SIZE>
+bool MpscQueue<T, SIZE>::push( const T& item )
+{
+	// a producer claims an index by moving __write_index forward,
+	// the slot sequence tells whether the consumer is done with it
+	Cell* pCell;
+	unsigned nIndex = __write_index;
+	for (;;) {
+		pCell = &__cells[ nIndex & ( SIZE - 1 ) ];
+		unsigned nSequence = __sync_fetch_and_add( &pCell->sequence, 0 );
+		int nDiff = ( int )( nSequence - nIndex );
+		if ( nDiff == 0 ) {
+			unsigned nPrevious = __sync_val_compare_and_swap( &__write_index, nIndex, nIndex + 1 );
+			if ( nPrevious == nIndex ) {
+				break;
+			}
+			nIndex = nPrevious;
+		} else if ( nDiff < 0 ) {
+			// full, the slot still holds an item SIZE older
+			__sync_fetch_and_add( &__overflows, 1 );
+			return false;
+		} else {
+			nIndex = __write_index;
+		}
+	}
+
+	pCell->item = item;
+	// publishes the item
+	__sync_synchronize();
+	pCell->sequence = nIndex + 1;
+	return true;
+}
+
+template<class T, unsigned SIZE>
+int MpscQueue<T, SIZE>::pop( T* items, int nMax )
+{
+	int nItems = 0;
+	while ( nItems < nMax ) {
+		Cell* pCell = &__cells[ __read_index & ( SIZE - 1 ) ];
+		unsigned nSequence = __sync_fetch_and_add( &pCell->sequence, 0 );
+		if ( ( int )( nSequence - ( __read_index + 1 ) ) < 0 ) {
+			break;	// empty, or the next item is still being written
+		}
+		items[ nItems++ ] = pCell->item;
+		// gives the slot back to the producers, one lap later
+		__sync_synchronize();
+		pCell->sequence = __read_index + SIZE;
+		__read_index++;
+	}
+	return nItems;
+}
+
+template<class T, unsigned SIZE>
+inline bool MpscQueue<T, SIZE>::empty() const
+{
+	__sync_synchronize();
+	return __cells[ __read_index & ( SIZE - 1 ) ].sequence != __read_index + 1;
+}
+
+template<class T, unsigned SIZE>
+inline unsigned MpscQueue<T, SIZE>::get_overflows() const
+{
+	return __overflows;
+}
+
+};
+
+#endif // H2C_MPSC_QUEUE_H
+
+/* vim: set softtabstop=4 expandtab: */
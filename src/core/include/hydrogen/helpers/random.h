@@ -0,0 +1,153 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_RANDOM_H
+#define H2C_RANDOM_H
+
+#include <stdint.h>
+#include <cmath>
+
+namespace H2Core
+{
+
+/**
+ * Random is a xoshiro128+ pseudo random number generator.
+ * <br>The engine owns one, seeded from the song, so that a render can be
+ * reproduced. Drawing neither locks nor allocates, it can be done from
+ * the audio thread.
+ */
+class Random
+{
+	public:
+		/**
+		 * constructor
+		 * \param seed the seed, see seed()
+		 */
+		Random( uint32_t seed = 0 );
+
+		/**
+		 * restart the sequence, the same seed gives the same sequence
+		 * \param seed the seed, expanded into the generator state
+		 */
+		void seed( uint32_t seed );
+		/** return the next 32 random bits */
+		uint32_t next();
+		/** return a uniform value in ]0,1] */
+		float uniform();
+		/**
+		 * return a gaussian value
+		 * \param z the standard deviation, the mean is 0
+		 */
+		float gaussian( float z );
+		/**
+		 * fill an array with gaussian values, the Box-Muller transform
+		 * runs over the whole array once the uniform values are drawn
+		 * \param values where the values are written
+		 * \param n the number of values
+		 * \param z the standard deviation, the mean is 0
+		 */
+		void gaussians( float* values, int n, float z );
+
+	private:
+		uint32_t __state[ 4 ];
+};
+
+// DEFINITIONS
+
+inline Random::Random( uint32_t seed )
+{
+	this->seed( seed );
+}
+
+inline void Random::seed( uint32_t seed )
+{
+	// splitmix64, never gives the all zero state
+	uint64_t x = seed;
+	for ( int i = 0; i < 4; i += 2 ) {
+		uint64_t z = ( x += 0x9E3779B97F4A7C15ULL );
+		z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+		z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+		z = z ^ ( z >> 31 );
+		__state[ i ] = ( uint32_t )z;
+		__state[ i + 1 ] = ( uint32_t )( z >> 32 );
+	}
+}
+
+inline uint32_t Random::next()
+{
+	uint32_t result = __state[ 0 ] + __state[ 3 ];
+	uint32_t t = __state[ 1 ] << 9;
+	__state[ 2 ] ^= __state[ 0 ];
+	__state[ 3 ] ^= __state[ 1 ];
+	__state[ 1 ] ^= __state[ 2 ];
+	__state[ 0 ] ^= __state[ 3 ];
+	__state[ 2 ] ^= t;
+	__state[ 3 ] = ( __state[ 3 ] << 11 ) | ( __state[ 3 ] >> 21 );
+	return result;
+}
+
+inline float Random::uniform()
+{
+	// the 24 upper bits, the lower ones of xoshiro128+ are weaker
+	return ( ( next() >> 8 ) + 1 ) * ( 1.0f / 16777216.0f );
+}
+
+inline float Random::gaussian( float z )
+{
+	float value;
+	gaussians( &value, 1, z );
+	return value;
+}
+
+inline void Random::gaussians( float* values, int n, float z )
+{
+	int nPairs = ( n + 1 ) / 2;
+	float u1[ 64 ], u2[ 64 ];
+	while ( nPairs > 0 ) {
+		int nBlock = nPairs < 64 ? nPairs : 64;
+		for ( int i = 0; i < nBlock; ++i ) {
+			u1[ i ] = uniform();
+			u2[ i ] = uniform();
+		}
+		// no branch nor dependency left, the compiler can vectorize
+		int nValues = n < 2 * nBlock ? n : 2 * nBlock;
+		for ( int i = 0; i < nValues / 2; ++i ) {
+			float r = z * sqrtf( -2.0f * logf( u1[ i ] ) );
+			values[ 2 * i ] = r * cosf( 6.2831853f * u2[ i ] );
+			values[ 2 * i + 1 ] = r * sinf( 6.2831853f * u2[ i ] );
+		}
+		if ( nValues & 1 ) {
+			int i = nValues / 2;
+			values[ 2 * i ] = z * sqrtf( -2.0f * logf( u1[ i ] ) ) * cosf( 6.2831853f * u2[ i ] );
+		}
+		values += nValues;
+		n -= nValues;
+		nPairs -= nBlock;
+	}
+}
+
+};
+
+#endif // H2C_RANDOM_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,164 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SNAPSHOT_H
+#define H2C_SNAPSHOT_H
+
+#include <hydrogen/helpers/mpsc_queue.h>
+#include <pthread.h>
+
+#define SNAPSHOT_RETIRED 8
+
+namespace H2Core
+{
+
+/**
+ * Snapshot hands a value built by non realtime threads over to the audio thread
+ * without the engine lock, read-copy-update style.
+ * <br>Writers copy the published value, edit the copy and publish it in place
+ * of the old one. They serialize on their own lock, which the audio thread
+ * never takes. The audio thread takes the published value, leaving none, and
+ * retires it once done; retired values are deleted by the next writer, so
+ * neither taking nor retiring locks or frees memory.
+ * \param T the value type, deleted with delete
+ */
+template<class T>
+class Snapshot
+{
+	public:
+		/** constructor, nothing is published */
+		Snapshot();
+		/** destructor, deletes the published and the retired values */
+		~Snapshot();
+
+		/** writers and non realtime readers lock around peek() and publish() */
+		void lock();
+		/** release the writers lock */
+		void unlock();
+		/** return the published value, NULL if none, only while locked */
+		const T* peek() const;
+		/**
+		 * publish a value in place of the one peeked, only while locked
+		 * \param expected the value returned by peek(), deleted on success
+		 * \param value the value to publish, may be NULL, owned by the snapshot on success
+		 * \return false if the audio thread took expected in the meantime,
+		 * value is then left to the caller which should build it again from peek()
+		 */
+		bool publish( const T* expected, T* value );
+
+		/** take the published value, NULL if none, only from the audio thread */
+		T* take();
+		/**
+		 * give a taken value back, only from the audio thread
+		 * \param value the value returned by take()
+		 */
+		void retire( T* value );
+
+	private:
+		/** delete the retired values, while locked */
+		void __reclaim();
+
+		pthread_mutex_t __mutex;		///< serializes the writers
+		T* volatile __value;			///< the published value
+		MpscQueue<T*, SNAPSHOT_RETIRED> __retired;	///< values the audio thread is done with
+};
+
+// DEFINITIONS
+template<class T>
+Snapshot<T>::Snapshot()
+	: __value( 0 )
+{
+	pthread_mutex_init( &__mutex, 0 );
+}
+
+template<class T>
+Snapshot<T>::~Snapshot()
+{
+	__reclaim();
+	delete __value;
+	pthread_mutex_destroy( &__mutex );
+}
+
+template<class T>
+inline void Snapshot<T>::lock()
+{
+	pthread_mutex_lock( &__mutex );
+}
+
+template<class T>
+inline void Snapshot<T>::unlock()
+{
+	pthread_mutex_unlock( &__mutex );
+}
+
+template<class T>
+inline const T* Snapshot<T>::peek() const
+{
+	return __value;
+}
+
+template<class T>
+bool Snapshot<T>::publish( const T* expected, T* value )
+{
+	__reclaim();
+	// only the audio thread can have changed __value since peek(), to NULL
+	if ( !__sync_bool_compare_and_swap( &__value, const_cast<T*>( expected ), value ) ) {
+		return false;
+	}
+	delete expected;
+	return true;
+}
+
+template<class T>
+inline T* Snapshot<T>::take()
+{
+	T* value = __value;
+	if ( value == 0 ) {
+		return 0;
+	}
+	return __sync_lock_test_and_set( &__value, ( T* )0 );
+}
+
+template<class T>
+inline void Snapshot<T>::retire( T* value )
+{
+	if ( value != 0 ) {
+		// a writer reclaims before each publish, at most two values wait here
+		__retired.push( value );
+	}
+}
+
+template<class T>
+void Snapshot<T>::__reclaim()
+{
+	T* values[ SNAPSHOT_RETIRED ];
+	int nValues = __retired.pop( values, SNAPSHOT_RETIRED );
+	for ( int i = 0; i < nValues; ++i ) {
+		delete values[ i ];
+	}
+}
+
+};
+
+#endif // H2C_SNAPSHOT_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -34,6 +34,8 @@
 #include <hydrogen/basics/drumkit.h>
 #include <cassert>
 
+#include <QtCore/QStringList>
+
 // Engine states  (It's ok to use ==, <, and > when testing)
 #define STATE_UNINITIALIZED	1     // Not even the constructors have been called.
 #define STATE_INITIALIZED	2     // Not ready, but most pointers are now valid or NULL
@@ -41,11 +43,11 @@
 #define STATE_READY		4     // Ready to process audio
 #define STATE_PLAYING		5     // Currently playing a sequence.
 
-inline int randomValue( int max );
-
 namespace H2Core
 {
 
+class SampleLoader;
+
 ///
 /// Hydrogen Audio Engine.
 ///
@@ -82,7 +84,13 @@ public:
 
 	void removeSong();
 
+	/// Play a note live, and record it if asked. It is queued for the audio thread, without the engine lock.
 	void addRealtimeNote ( int instrument, float velocity, float pan_L=1.0, float pan_R=1.0, float pitch=0.0, bool noteoff=false, bool forcePlay=false, int msg1=0 );
+	/**
+	 * Play and record a note addRealtimeNote() queued, with the engine locked
+	 * \param realtimeTick the realtime tick position when the note was played
+	 */
+	void playRealtimeNote( int instrument, float velocity, float pan_L, float pan_R, float pitch, bool noteoff, bool forcePlay, int msg1, unsigned long realtimeTick );
 
 	float getMasterPeak_L();
 	void setMasterPeak_L( float value );
@@ -103,7 +111,16 @@ public:
 	PatternList * getCurrentPatternList();
 	void setCurrentPatternList( PatternList * pPatternList );
 
-	PatternList * getNextPatterns();
+	/// Return true if the pattern is queued to play next (Pattern mode only)
+	bool isNextPattern( Pattern* pPattern );
+
+	/**
+	 * Index the song columns again for the audio thread, to be called
+	 * once the columns or the length of their patterns changed
+	 */
+	void updateSongTimeline();
+	/// Return the song size in ticks, as last indexed
+	long getSongSizeInTicks();
 
 	int getPatternPos();
 	void setPatternPos( int pos );
@@ -111,10 +128,37 @@ public:
 	void triggerRelocateDuringPlay();
 
 	long getTickForPosition( int );
+	/**
+	 * Return the song column playing at a tick, the reverse of getTickForPosition()
+	 * \param nTick the tick
+	 * \param bLoopMode true to wrap the ticks past the end of the song
+	 * \param pPatternStartTick where the start tick of the column is written
+	 * \return the column, -1 past the end of the song
+	 */
+	int getPosForTick( unsigned long nTick, bool bLoopMode, int* pPatternStartTick );
+
+	/**
+	 * Run the sequencer over the current song without playing it, the
+	 * notes it queues are copied instead. Used by the tests to check the
+	 * sequencer against the way it used to walk the song.
+	 * \param nFrames the frames to sequence from the start of the song
+	 * \param nPeriod the frames of each audio period
+	 * \param pNotes where copies of the queued notes are added, in play order
+	 */
+	void sequenceSong( unsigned nFrames, unsigned nPeriod, std::vector<Note*>* pNotes );
 
 		void restartDrivers();
 
-	void startExportSong( const QString& filename, int rate, int depth  );
+	/**
+	 * Export the song to a file, rendered offline as fast as the
+	 * disk writer thread can go rather than at the pace of an audio driver
+	 * \param filename the master mix file, none if empty
+	 * \param trackFilenames the stem file of each song instrument, empty
+	 * entries are not exported. The stems carry the track output signal
+	 * and are written in the same pass as the master mix.
+	 */
+	void startExportSong( const QString& filename, int rate, int depth,
+	                      const QStringList& trackFilenames = QStringList() );
 		void stopExportSong( bool reconnectOldDriver );
 
 	AudioOutput* getAudioOutput();
@@ -126,7 +170,31 @@ public:
 	float getProcessTime();
 	float getMaxProcessTime();
 
+	/**
+	 * load a drumkit into the song, startDrumkitLoad() then finishDrumkitLoad()
+	 * \return 0 on success, -1 if the load was cancelled or another one is running
+	 */
 	int loadDrumkit( Drumkit *drumkitInfo );
+	/**
+	 * start decoding the samples of a drumkit on every core, the song
+	 * is left untouched, EVENT_PROGRESS reports the percentage decoded
+	 * \param drumkitInfo the drumkit, must live until finishDrumkitLoad() returns
+	 * \return 0 if the load started, -1 if another drumkit is still loading
+	 */
+	int startDrumkitLoad( Drumkit *drumkitInfo );
+	/// return true while the samples of the drumkit being loaded are decoded
+	bool isDrumkitLoading();
+	/// return the percentage of the samples of the drumkit being loaded which are decoded
+	int getDrumkitLoadProgress();
+	/// give up the drumkit being loaded, the song keeps its instruments
+	void cancelDrumkitLoad();
+	/**
+	 * wait for the samples of the drumkit being loaded, then swap the song
+	 * instruments to the drumkit ones in one go, the audio engine never
+	 * plays a partly loaded drumkit
+	 * \return 0 on success, -1 if the load was cancelled or none was started
+	 */
+	int finishDrumkitLoad();
 
 	/// delete an instrument. If `conditional` is true, and there are patterns that
 	/// use this instrument, it's not deleted anyway
@@ -161,6 +229,23 @@ public:
 	void onTapTempoAccelEvent();
 	void setTapTempo( float fInterval );
 	void setBPM( float fBPM );
+	/**
+	 * Stretch the rubberband samples of the song again for the given
+	 * tempo. Loads the samples on the calling thread, the audio engine
+	 * is only locked to swap each of them in.
+	 */
+	void recalculateRubberband( float fBpm );
+	/**
+	 * Seed the humanize and random pitch values over the song seed, so
+	 * that the renders can be reproduced
+	 * \param nSeed the seed, 0 to use the song one again
+	 */
+	void setRandomSeed( unsigned nSeed );
+	/**
+	 * Change the polyphony, resizing the notes the audio thread recycles
+	 * \param nMaxNotes the number of voices
+	 */
+	void setMaxNotes( int nMaxNotes );
 
 	void restartLadspaFX();
 		void setSelectedPatternNumberWithoutGuiEvent( int nPat );
@@ -269,6 +354,10 @@ private:
 
 	std::list<Instrument*> __instrument_death_row; /// Deleting instruments too soon leads to potential crashes.
 
+	Drumkit* m_pLoadingDrumkit;             ///< the drumkit startDrumkitLoad() is loading
+	SampleLoader* m_pDrumkitLoader;         ///< decodes the samples of m_pLoadingDrumkit
+	std::vector<Sample*> m_drumkitSamples;  ///< MAX_LAYERS samples per instrument of m_pLoadingDrumkit
+
 
 	/// Private constructor
 	Hydrogen();
@@ -28,6 +28,10 @@
 #include <pthread.h>
 
 #include "hydrogen/config.h"
+#include <hydrogen/helpers/mpsc_queue.h>
+
+#define LOG_RECORDS 1024        ///< realtime log records capacity, must be a power of 2
+#define LOG_RECORD_ARGS 4       ///< maximum number of arguments of a realtime log record
 
 class QString;
 class QStringList;
@@ -53,6 +57,19 @@ class Logger {
 		/** mesage queue type */
 		typedef std::list<QString> queue_t;
 
+		/**
+		 * a preformatted binary log record, it is formatted by the logger thread.
+		 * the strings must be static, string literals or __FUNCTION__.
+		 */
+		struct record_t {
+			unsigned level;                     ///< the log level
+			const char* class_name;             ///< the name of the calling class, may be 0
+			const char* func_name;              ///< the name of the calling function/method
+			const char* format;                 ///< the message, %1 to %4 are replaced by the arguments
+			int nargs;                          ///< number of arguments
+			double args[ LOG_RECORD_ARGS ];     ///< the arguments
+		};
+
 		/**
 		 * create the logger instance if not exists, set the log level and return the instance
 		 * \param msk the logging level bitmask
@@ -100,6 +117,21 @@ class Logger {
 		 * \param msg the message to log
 		 */
 		void log( unsigned level, const QString& class_name, const char* func_name, const QString& msg );
+		/**
+		 * the realtime safe log function, it neither locks nor allocates.
+		 * the record is dropped if the records queue is full.
+		 * \param record the record to log
+		 */
+		void log( const record_t& record )          { __records.push( record ); }
+		/** return the number of realtime log records dropped because the queue was full */
+		unsigned records_lost() const               { return __records.get_overflows(); }
+		/**
+		 * set the time the logger thread waits between two queue drains
+		 * \param ms the interval in milliseconds, raised to 1 as the thread would spin without any wait
+		 */
+		void set_drain_interval( unsigned ms )      { __drain_interval = ms < 1 ? 1 : ms; }
+		/** return the time the logger thread waits between two queue drains, in milliseconds */
+		unsigned drain_interval() const             { return __drain_interval; }
 		/**
 		 * needed for beeing able to access logger internal
 		 * \param param is a pointer to the logger instance
@@ -112,12 +144,28 @@ class Logger {
 		bool __running;                 ///< set to true when the logger thread is running
 		pthread_mutex_t __mutex;        ///< lock for adding or removing elements only
 		queue_t __msg_queue;            ///< the message queue
+		MpscQueue<record_t, LOG_RECORDS> __records; ///< the realtime log records queue
+		volatile unsigned __drain_interval; ///< milliseconds between two queue drains
 		static unsigned __bit_msk;      ///< the bitmask of log_level_t
 		static const char* __levels[];  ///< levels strings
 
 		/** constructor */
 		Logger();
 
+		/**
+		 * build the console line of a message
+		 * \param level used to output the corresponding level string
+		 * \param class_name the name of the calling class
+		 * \param func_name the name of the calling function/method
+		 * \param msg the message
+		 */
+		static QString format( unsigned level, const QString& class_name, const char* func_name, const QString& msg );
+		/**
+		 * build the console line of a realtime log record
+		 * \param record the record to format
+		 */
+		static QString format( const record_t& record );
+
 #ifndef HAVE_SSCANF
 		/**
 		 * convert an hex string to an integer.
@@ -129,6 +177,43 @@ class Logger {
 #endif // HAVE_SSCANF
 };
 
+/**
+ * RtLog builds a Logger::record_t on the stack and logs it when destroyed,
+ * the RT log macros use it as QString( format ).arg( ... ) would be used:
+ * <br>ERRORLOG_RT( "pos %1 out of %2" ).arg( nPos ).arg( nSize );
+ */
+class RtLog {
+	public:
+		/**
+		 * constructor
+		 * \param logger the logger to log to, 0 to drop the record
+		 * \param level the log level
+		 * \param class_name the name of the calling class, may be 0
+		 * \param func_name the name of the calling function/method
+		 * \param format the message, a string literal
+		 */
+		RtLog( Logger* logger, unsigned level, const char* class_name, const char* func_name, const char* format ) : __logger( logger ) {
+			__record.level = level;
+			__record.class_name = class_name;
+			__record.func_name = func_name;
+			__record.format = format;
+			__record.nargs = 0;
+		}
+		/** destructor, logs the record */
+		~RtLog()                                    { if ( __logger ) __logger->log( __record ); }
+		/**
+		 * add an argument, the extra ones are ignored
+		 * \param value the argument
+		 */
+		RtLog& arg( double value ) {
+			if ( __record.nargs < LOG_RECORD_ARGS ) __record.args[ __record.nargs++ ] = value;
+			return *this;
+		}
+	private:
+		Logger* __logger;               ///< where the record goes
+		Logger::record_t __record;      ///< the record being built
+};
+
 };
 
 #endif // H2C_LOGGER_H
@@ -112,6 +112,11 @@ class Object {
 #define __LOG_STATIC(   lvl, msg )  if( H2Core::Logger::get_instance()->should_log( (lvl) ) )   { H2Core::Logger::get_instance()->log( (lvl), 0, __PRETTY_FUNCTION__, msg ); }
 #define __LOG( logger,  lvl, msg )  if( (logger)->should_log( (lvl) ) )                 { (logger)->log( (lvl), 0, 0, msg ); }
 
+// REALTIME LOG MACROS, they neither lock nor allocate, fmt must be a string literal, append .arg( number ) for %1 to %4.
+// A single expression rather than an if, so that they are safe in an if/else, RtLog drops the record when given no logger
+#define __RTLOG_METHOD( lvl, fmt )  H2Core::RtLog( __logger->should_log( (lvl) ) ? __logger : 0, (lvl), class_name(), __FUNCTION__, fmt )
+#define __RTLOG_STATIC( lvl, fmt )  H2Core::RtLog( H2Core::Logger::get_instance()->should_log( (lvl) ) ? H2Core::Logger::get_instance() : 0, (lvl), 0, __PRETTY_FUNCTION__, fmt )
+
 // Object instance method logging macros
 #define DEBUGLOG(x)     __LOG_METHOD( H2Core::Logger::Debug,   (x) );
 #define INFOLOG(x)      __LOG_METHOD( H2Core::Logger::Info,    (x) );
@@ -136,6 +141,17 @@ class Object {
 #define ___WARNINGLOG(x) __LOG_STATIC(H2Core::Logger::Warning,  (x) );
 #define ___ERRORLOG(x)  __LOG_STATIC( H2Core::Logger::Error,    (x) );
 
+// realtime logging macros, for the audio thread, no trailing ';' so that .arg() can follow
+#define DEBUGLOG_RT(fmt)        __RTLOG_METHOD( H2Core::Logger::Debug,   fmt )
+#define INFOLOG_RT(fmt)         __RTLOG_METHOD( H2Core::Logger::Info,    fmt )
+#define WARNINGLOG_RT(fmt)      __RTLOG_METHOD( H2Core::Logger::Warning, fmt )
+#define ERRORLOG_RT(fmt)        __RTLOG_METHOD( H2Core::Logger::Error,   fmt )
+
+#define ___DEBUGLOG_RT(fmt)     __RTLOG_STATIC( H2Core::Logger::Debug,   fmt )
+#define ___INFOLOG_RT(fmt)      __RTLOG_STATIC( H2Core::Logger::Info,    fmt )
+#define ___WARNINGLOG_RT(fmt)   __RTLOG_STATIC( H2Core::Logger::Warning, fmt )
+#define ___ERRORLOG_RT(fmt)     __RTLOG_STATIC( H2Core::Logger::Error,   fmt )
+
 };
 
 #endif // H2C_OBJECT_H
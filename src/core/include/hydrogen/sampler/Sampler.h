@@ -26,6 +26,8 @@
 
 #include <hydrogen/object.h>
 #include <hydrogen/globals.h>
+#include <hydrogen/sampler/render_kernels.h>
+#include <hydrogen/sampler/sample_streamer.h>
 
 #include <inttypes.h>
 #include <vector>
@@ -39,6 +41,10 @@ class Song;
 class Sample;
 class Instrument;
 class AudioOutput;
+class PolyphaseFilter;
+class RenderThreadPool;
+class NotePool;
+class SegmentRenderer;
 
 ///
 /// Waveform based sampler.
@@ -50,12 +56,16 @@ public:
 	float *__main_out_L;	///< sampler main out (left channel)
 	float *__main_out_R;	///< sampler main out (right channel)
 
-	Sampler();
+	/**
+	 * constructor
+	 * \param pNotePool where the ended notes go
+	 */
+	Sampler( NotePool* pNotePool );
 	~Sampler();
 
 	void process( uint32_t nFrames, Song* pSong );
 
-	/// Start playing a note
+	/// Start playing a note, the sampler takes its ownership, note off notes included
 	void note_on( Note *note );
 
 	/// Stop playing a note.
@@ -65,12 +75,53 @@ public:
 	void stop_playing_notes( Instrument *instr = NULL );
 
 	int get_playing_notes_number() {
-		return __playing_notes_queue.size();
+		return __voice_count;
 	}
 
+	/**
+	 * size the voice pool, the oldest voices being stolen once more than
+	 * nMaxNotes notes are playing. Must not be called while process() runs.
+	 * \param nMaxNotes the polyphony
+	 */
+	void set_max_notes( int nMaxNotes );
+
 	void preview_sample( Sample* sample, int length );
 	void preview_instrument( Instrument* instr );
 
+	/**
+	 * set the number of threads rendering the notes, the audio thread included.
+	 * The output does not depend on it. Must not be called while process() runs.
+	 * \param nThreads 1 to render every note on the audio thread, at most RENDER_GROUPS
+	 */
+	void set_render_threads( int nThreads );
+	/** return the number of threads rendering the notes, the audio thread included */
+	int get_render_threads() const;
+
+	/**
+	 * set if the streamed samples wait for the disk instead of playing
+	 * the frames not read yet as silence, for the offline renders
+	 * \param bWait true to wait
+	 */
+	void set_stream_wait( bool bWait );
+	/** return the number of times a streamed sample missed frames so far */
+	unsigned get_stream_underruns() const;
+
+	/**
+	 * render for an output of its own instead of the engine audio driver,
+	 * as the segments of an export do. The notes are timed by its transport,
+	 * the effect sends, the midi output and the instrument peaks are left
+	 * alone. Must not be called while process() runs.
+	 * \param pOutput the output, NULL for the engine audio driver
+	 */
+	void set_output( AudioOutput* pOutput );
+
+	/**
+	 * record the notes and the periods instead of rendering them, for the
+	 * first pass of a segmented export. The sampler plays nothing meanwhile.
+	 * \param pCapture where they are recorded, NULL to render again
+	 */
+	void set_capture( SegmentRenderer* pCapture );
+
 	void setPlayingNotelength( Instrument* instrument, unsigned long ticks, unsigned long noteOnTick );
 	bool is_instrument_playing( Instrument* pInstr );
 
@@ -78,7 +129,8 @@ public:
 							   COSINE,
 							   THIRD,
 							   CUBIC,
-							   HERMITE };
+							   HERMITE,
+							   SINC };
 
 		void setInterpolateMode( InterpolateMode mode ){
 				 __interpolateMode = mode;
@@ -87,13 +139,95 @@ public:
 		InterpolateMode getInterpolateMode(){ return __interpolateMode; }
 
 private:
-	std::vector<Note*> __playing_notes_queue;
-	std::vector<Note*> __queuedNoteOffs;
+	/// A playing note.
+	struct Voice {
+		Note* note;		///< the note, owned by the sampler
+		unsigned serial;	///< note_on() order, the lowest one is the oldest voice
+		bool stolen;		///< fading out to make room for a newer note
+		int group;		///< render group of the note during the current process cycle
+		unsigned result;	///< __render_note() result of the current process cycle
+		SampleStreamer::Stream* stream;	///< reads the sample past its head, NULL unless the sample is streamed
+	};
+
+	Voice* __voices;	///< the playing notes, the first __voice_count are used
+	int __voice_count;	///< number of playing notes
+	int __voice_capacity;	///< size of __voices, twice the polyphony so stolen voices can fade out
+	int __max_notes;	///< polyphony, voices which are not stolen
+	int __active_voices;	///< playing voices which are not stolen
+	unsigned __voice_serial;	///< serial of the next voice
+	Note** __note_offs;	///< ended notes waiting for their midi note off, __voice_capacity long
+	int __note_off_count;	///< number of notes in __note_offs
+	NotePool* __note_pool;	///< where the ended notes go
 
 	/// Instrument used for the preview feature.
 	Instrument* __preview_instrument;
 
-	unsigned __render_note( Note* pNote, unsigned nBufferSize, Song* pSong );
+	/// Where the notes of the instruments whose index modulo RENDER_GROUPS is the group are mixed.
+	struct RenderGroup {
+		float *main_out_L;	///< where the notes are mixed (left channel)
+		float *main_out_R;	///< where the notes are mixed (right channel)
+		float *fx_L[ MAX_FX ];	///< effect sends (left channel), NULL to mix into the effects buffers
+		float *fx_R[ MAX_FX ];	///< effect sends (right channel), NULL to mix into the effects buffers
+		bool fx_used[ MAX_FX ];	///< the effect sends written during the current process cycle
+		int notes;		///< notes rendered during the current process cycle
+		std::vector<Note*> midi_notes;	///< started notes, sent to the midi output once rendering is over
+	};
+
+	/// Buffers the notes are rendered with, one set per rendering thread.
+	struct RenderContext {
+		RenderGroup* group;	///< group of the note being rendered
+		float *envelope;	///< envelope of the note being rendered
+		float *scratch_L;	///< enveloped and filtered note frames (left channel)
+		float *scratch_R;	///< enveloped and filtered note frames (right channel)
+		float *resampled_L;	///< interpolated frames of the pitched note being rendered (left channel)
+		float *resampled_R;	///< interpolated frames of the pitched note being rendered (right channel)
+		float *stream_L;	///< frames of the streamed sample being rendered (left channel)
+		float *stream_R;	///< frames of the streamed sample being rendered (right channel)
+	};
+
+	const RenderKernels::Table* __kernels;	///< block kernels used by the render paths
+	PolyphaseFilter* __polyphase;	///< windowed sinc kernels used by the SINC interpolate mode
+	RenderThreadPool* __render_pool;	///< threads helping the audio thread, NULL if it renders alone
+	std::vector<RenderContext*> __contexts;	///< one per rendering thread
+	RenderGroup __groups[ RENDER_GROUPS ];	///< mixed in order, the first one into __main_out
+	int __render_threads;	///< threads rendering the current process cycle
+	uint32_t __render_frames;	///< frames to render during the current process cycle
+	Song* __render_song;	///< song given to the current process cycle
+	SampleStreamer* __streamer;	///< reads the streamed samples past their head
+	unsigned __stream_underruns;	///< stream underruns already reported
+	AudioOutput* __output;	///< output rendered for, NULL for the engine audio driver
+	SegmentRenderer* __capture;	///< where the notes are recorded instead of played, NULL to play them
+
+	/// Return the output rendered for.
+	AudioOutput* __audio_output() const;
+
+	RenderContext* __create_context();
+	void __delete_context( RenderContext* pContext );
+	/// Fade out the oldest voice which is not stolen yet.
+	void __steal_voice();
+	/// Remove a voice, the last one taking its place, and give its note and stream back.
+	void __remove_voice( int nVoice );
+	/// Render the groups assigned to a thread, see RenderThreadPool::Job.
+	static void __render_job( void* arg, int nThread );
+	/// Return the buffers a note send to an effect has to be mixed into.
+	void __fx_buffers( RenderContext* pContext, int nFX, float* pFX_L, float* pFX_R, float** pBuf_L, float** pBuf_R );
+
+	unsigned __render_note( Voice* pVoice, unsigned nBufferSize, Song* pSong, RenderContext* pContext );
+
+	/**
+	 * return the frames of a sample, from the sample itself unless some
+	 * are past the head of a streamed sample, or the sample is compact
+	 * and its frames are converted to floats
+	 * \param pSample the sample
+	 * \param pStream the voice stream, NULL if it could not get one
+	 * \param nFirst the first frame needed
+	 * \param nLast the frame after the last one needed
+	 * \param pContext where the streamed or converted frames are copied
+	 * \param ppData_L set to the left frames
+	 * \param ppData_R set to the right frames
+	 * \return the sample frame (*ppData_L)[0] is
+	 */
+	int __read_sample( Sample* pSample, SampleStreamer::Stream* pStream, int nFirst, int nLast, RenderContext* pContext, const float** ppData_L, const float** ppData_R );
 
 		InterpolateMode __interpolateMode;
 
@@ -199,6 +333,7 @@ private:
 
 	int __render_note_no_resample(
 		Sample *pSample,
+		SampleStreamer::Stream* pStream,
 		Note *pNote,
 		int nBufferSize,
 		int nInitialSilence,
@@ -206,11 +341,13 @@ private:
 		float cost_R,
 		float cost_track_L,
 			float cost_track_R,
-		Song* pSong
+		Song* pSong,
+		RenderContext* pContext
 	);
 
 	int __render_note_resample(
 		Sample *pSample,
+		SampleStreamer::Stream* pStream,
 		Note *pNote,
 		int nBufferSize,
 		int nInitialSilence,
@@ -219,8 +356,24 @@ private:
 		float cost_track_L,
 		float cost_track_R,
 			float fLayerPitch,
-		Song* pSong
+		Song* pSong,
+		RenderContext* pContext
 	);
+
+	/**
+	 * interpolate the frames of a pitched note, the mode being a template
+	 * parameter the interpolation is chosen once per block, not per frame
+	 * \param pData_L the left frames to read from
+	 * \param pData_R the right frames to read from
+	 * \param nSampleFrames the number of frames from pData_L and pData_R on, up to the sample end
+	 * \param fSamplePos the position of the first frame to interpolate, from pData_L and pData_R
+	 * \param fStep the number of sample frames per output frame
+	 * \param nFrames the number of frames to interpolate
+	 * \param pOut_L where to write the left frames
+	 * \param pOut_R where to write the right frames
+	 */
+	template<InterpolateMode mode>
+	void __resample( const float* pData_L, const float* pData_R, int nSampleFrames, double fSamplePos, float fStep, int nFrames, float* pOut_L, float* pOut_R );
 };
 
 } // namespace
@@ -0,0 +1,104 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_POLYPHASE_FILTER_H
+#define H2C_POLYPHASE_FILTER_H
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+/**
+ * Band limited interpolation using precomputed Blackman windowed sinc kernels.
+ * <br>Each bank holds the kernel sampled at PHASES+1 fractional positions, so the
+ * render loop only has to blend two neighbouring phases and sum TAPS products.
+ * <br>Banks differ by their cutoff frequency, to avoid aliasing when a sample
+ * is played faster than its original rate.
+ */
+class PolyphaseFilter : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** kernel dimensions */
+		enum {
+			TAPS = 16,          ///< frames used for each output frame, from position-7 to position+8
+			PHASES = 256,       ///< fractional positions per frame
+			BANKS = 4           ///< cutoff frequencies
+		};
+
+		/** build the kernel tables */
+		PolyphaseFilter();
+		/** destructor */
+		~PolyphaseFilter();
+
+		/**
+		 * return the kernel bank to use for a given resampling step,
+		 * (PHASES+1)*TAPS coefficients, phase by phase
+		 * \param step the number of source frames per output frame
+		 */
+		const float* get_bank( float step ) const;
+
+		/**
+		 * interpolate a stereo frame
+		 * \param bank the kernel bank returned by get_bank
+		 * \param data_l left source frames, frames position-7 to position+8 must be readable
+		 * \param data_r right source frames, frames position-7 to position+8 must be readable
+		 * \param position the integer part of the source position
+		 * \param fraction the fractional part of the source position [0;1[
+		 * \param val_l where to write the left value
+		 * \param val_r where to write the right value
+		 */
+		static void interpolate( const float* bank, const float* data_l, const float* data_r,
+		                         int position, double fraction, float* val_l, float* val_r );
+
+	private:
+		float* __banks;         ///< BANKS kernel banks, one after the other
+};
+
+// DEFINITIONS
+inline void PolyphaseFilter::interpolate( const float* bank, const float* data_l, const float* data_r,
+                                          int position, double fraction, float* val_l, float* val_r )
+{
+	double fPhase = fraction * PHASES;
+	int nPhase = ( int )fPhase;
+	float fBlend = fPhase - nPhase;
+	const float* k0 = bank + nPhase * TAPS;
+	const float* k1 = k0 + TAPS;
+	const float* src_l = data_l + position - ( TAPS / 2 - 1 );
+	const float* src_r = data_r + position - ( TAPS / 2 - 1 );
+	float l = 0;
+	float r = 0;
+	for ( int i = 0; i < TAPS; i++ ) {
+		float c = k0[ i ] + fBlend * ( k1[ i ] - k0[ i ] );
+		l += c * src_l[ i ];
+		r += c * src_r[ i ];
+	}
+	*val_l = l;
+	*val_r = r;
+}
+
+};
+
+#endif // H2C_POLYPHASE_FILTER_H
+
+/* vim: set softtabstop=4 expandtab: */
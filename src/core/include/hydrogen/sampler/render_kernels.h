@@ -0,0 +1,117 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_RENDER_KERNELS_H
+#define H2C_RENDER_KERNELS_H
+
+namespace H2Core
+{
+
+/**
+ * Block processing kernels used by the sampler render paths.
+ * <br>Every kernel exists as a scalar reference implementation and, where the
+ * host allows it, as SSE, AVX or NEON variants selected at runtime.
+ * <br>The vector variants perform exactly the same IEEE operations in the same
+ * order per frame as the scalar one, so their output is bit-identical.
+ */
+class RenderKernels
+{
+	public:
+		/** available instruction sets */
+		enum Isa {
+			SCALAR=0,
+			SSE,
+			AVX,
+			NEON,
+			ISA_COUNT
+		};
+
+		/**
+		 * apply an envelope to a stereo span and mix it into the outputs
+		 * <br>for each frame : v = src * env; track += v * cost_track; v *= cost; peak = max( peak, v ); out += v
+		 * \param src_l left source frames
+		 * \param src_r right source frames
+		 * \param env envelope values, NULL if the source is already enveloped
+		 * \param frames the number of frames to process
+		 * \param cost_l left main gain
+		 * \param cost_r right main gain
+		 * \param cost_track_l left track output gain
+		 * \param cost_track_r right track output gain
+		 * \param track_l left track output, may be NULL
+		 * \param track_r right track output, may be NULL
+		 * \param out_l left main output
+		 * \param out_r right main output
+		 * \param peak_l left running peak, updated in place
+		 * \param peak_r right running peak, updated in place
+		 */
+		typedef void ( *RenderBlock )( const float* src_l, const float* src_r, const float* env, int frames,
+		                               float cost_l, float cost_r, float cost_track_l, float cost_track_r,
+		                               float* track_l, float* track_r, float* out_l, float* out_r,
+		                               float* peak_l, float* peak_r );
+		/**
+		 * mix a stereo span into a stereo destination : dst += src * gain
+		 * \param src_l left source frames
+		 * \param src_r right source frames
+		 * \param frames the number of frames to process
+		 * \param gain_l left gain
+		 * \param gain_r right gain
+		 * \param dst_l left destination
+		 * \param dst_r right destination
+		 */
+		typedef void ( *MixBlock )( const float* src_l, const float* src_r, int frames,
+		                            float gain_l, float gain_r, float* dst_l, float* dst_r );
+
+		/**
+		 * convert a span of 16 bit compact sample frames to floats : dst = src * SAMPLE_PCM16_SCALE
+		 * \param src_l left source frames
+		 * \param src_r right source frames
+		 * \param frames the number of frames to convert
+		 * \param dst_l left destination
+		 * \param dst_r right destination
+		 */
+		typedef void ( *ConvertBlock )( const short* src_l, const short* src_r, int frames,
+		                                float* dst_l, float* dst_r );
+
+		/** a set of kernels built for one instruction set */
+		struct Table {
+			Isa isa;                        ///< instruction set used
+			const char* name;               ///< human readable name
+			RenderBlock render_block;       ///< see RenderBlock
+			MixBlock mix_block;             ///< see MixBlock
+			ConvertBlock convert_block;     ///< see ConvertBlock
+		};
+
+		/**
+		 * return the kernels built for the given instruction set,
+		 * NULL if not compiled in or not supported by the running cpu
+		 * \param isa the instruction set
+		 */
+		static const Table* table( Isa isa );
+		/** return the fastest kernels supported by the running cpu */
+		static const Table* best();
+};
+
+};
+
+#endif // H2C_RENDER_KERNELS_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,105 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_RENDER_THREAD_POOL_H
+#define H2C_RENDER_THREAD_POOL_H
+
+#include <hydrogen/object.h>
+
+#include <pthread.h>
+#include <semaphore.h>
+
+namespace H2Core
+{
+
+/**
+ * A fixed set of realtime threads running the same job in parallel.
+ * <br>The calling thread takes part in each run as thread 0, the workers
+ * being numbered from 1 to get_threads()-1. run() returns once every thread
+ * is done, so the caller can then reduce the partial results in a fixed order.
+ * <br>The caller, the audio thread, never takes a lock: it posts the workers
+ * semaphores, which does not block, and spins on an atomic counter until they
+ * are done. It sleeps on a semaphore posted by the last worker only when a
+ * worker is late, preempted or waiting for a core. No lock is shared with the
+ * workers, so none of them can hold the caller up while it is descheduled.
+ */
+class RenderThreadPool : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * the work done by each thread
+		 * \param arg the argument given to run()
+		 * \param thread the thread number, [0;get_threads()[
+		 */
+		typedef void ( *Job )( void* arg, int thread );
+
+		/**
+		 * start the workers
+		 * \param threads the number of threads taking part in a run, the caller included
+		 */
+		RenderThreadPool( int threads );
+		/** stop and join the workers */
+		~RenderThreadPool();
+
+		/** return the number of threads taking part in a run, the caller included */
+		int get_threads() const;
+
+		/**
+		 * run job on every thread and wait for all of them to be done
+		 * \param job the work to do
+		 * \param arg the argument to pass to job
+		 */
+		void run( Job job, void* arg );
+
+	private:
+		/** worker thread arguments */
+		struct Worker {
+			RenderThreadPool* pool;     ///< the pool the worker belongs to
+			int thread;                 ///< thread number given to the jobs
+			pthread_t id;               ///< posix thread
+			sem_t start;                ///< posted when a run starts or the pool stops
+		};
+
+		int __threads;                  ///< threads taking part in a run, the caller included
+		Worker* __workers;              ///< the __threads-1 workers
+		sem_t __done;                   ///< posted by the last worker once the caller waits for it
+		volatile int __pending;         ///< workers still running the current job, plus WAITING once the caller sleeps
+		volatile bool __quit;           ///< set when the workers have to exit
+		Job __job;                      ///< the current job
+		void* __arg;                    ///< the current job argument
+
+		/** worker thread main loop */
+		static void* __worker_main( void* param );
+};
+
+// DEFINITIONS
+inline int RenderThreadPool::get_threads() const
+{
+	return __threads;
+}
+
+};
+
+#endif // H2C_RENDER_THREAD_POOL_H
+
+/* vim: set softtabstop=4 expandtab: */
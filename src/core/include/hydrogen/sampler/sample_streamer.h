@@ -0,0 +1,158 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef H2C_SAMPLE_STREAMER_H
+#define H2C_SAMPLE_STREAMER_H
+
+#include <hydrogen/object.h>
+
+#include <vector>
+#include <pthread.h>
+#include <sndfile.h>
+
+namespace H2Core
+{
+
+class Sample;
+
+/**
+ * Reads the frames of the streamed samples which are not held in memory.
+ * <br>A streamed sample only holds its first frames, the head, see
+ * Sample::load. Each voice playing one takes a stream, a ring of frames
+ * a background thread keeps filling from the file while the voice plays
+ * the head, then reads the ring. Opening, reading and closing a stream
+ * neither lock nor allocate, they can be done from the render threads.
+ * <br>The frames missing when a voice reads them are played as silence
+ * and counted as underruns.
+ */
+class SampleStreamer : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/** the frames of a streamed sample read for a voice */
+		struct Stream {
+			/** the stream states, only the reader moves a stream out of OPENING or CLOSING */
+			enum State {
+				FREE = 0,       ///< not used by any voice
+				TAKEN,          ///< being set up by the voice which took it
+				OPENING,        ///< taken by a voice, the reader has to open the file
+				STREAMING,      ///< the reader fills the ring
+				CLOSING         ///< released by its voice, the reader has to close the file
+			};
+			volatile int state;         ///< one of State
+			QString filepath;           ///< the file of the sample, cleared by the reader
+			int frames;                 ///< frames of the sample, head included
+			volatile int written;       ///< frames read from the file, from the sample start
+			volatile int needed;        ///< first frame the voice still needs, the ring never overwrites it
+			volatile bool failed;       ///< the file could not be read, written won't grow any more
+			SNDFILE* file;              ///< read by the reader
+			int channels;               ///< channels of the file
+			float* ring_l;              ///< left frames, allocated by the reader at the first use
+			float* ring_r;              ///< right frames, allocated by the reader at the first use
+		};
+
+		/** frames held by each stream ring, a power of two */
+		static const int RING_FRAMES = 32768;
+
+		/** start the reader */
+		SampleStreamer();
+		/** stop the reader, close every file */
+		~SampleStreamer();
+
+		/**
+		 * make sure there are enough streams for every voice, must not be
+		 * called while a render thread uses the streamer
+		 * \param streams the number of streams
+		 */
+		void reserve( int streams );
+
+		/**
+		 * take a free stream to play a streamed sample
+		 * \param sample the sample, its head is played while the reader fills the ring
+		 * \return the stream, NULL if they are all used
+		 */
+		Stream* open( Sample* sample );
+		/**
+		 * give a stream back, its file is closed by the reader
+		 * \param stream the stream returned by open
+		 */
+		void close( Stream* stream );
+		/**
+		 * copy the frames of a stream past its head, the frames before
+		 * the first one are given up, the reader reuses their room
+		 * \param stream the stream returned by open
+		 * \param frame the first frame, from the sample start, not within the head
+		 * \param count the number of frames
+		 * \param out_l where to write the left frames
+		 * \param out_r where to write the right frames
+		 */
+		void read( Stream* stream, int frame, int count, float* out_l, float* out_r );
+		/** make the reader check the streams, without waiting for it */
+		void wake();
+
+		/**
+		 * set if read waits for the reader instead of playing the
+		 * missing frames as silence, for the offline renders
+		 * \param wait true to wait
+		 */
+		void set_wait( bool wait );
+		/** return the number of reads which missed frames so far */
+		unsigned get_underruns() const;
+
+	private:
+		std::vector<Stream*> __streams;     ///< the streams, they never move once created
+		pthread_t __reader;                 ///< the reader thread
+		pthread_mutex_t __mutex;            ///< protects __streams and __quit
+		pthread_cond_t __wake;              ///< signaled when the reader has something to do
+		bool __quit;                        ///< set when the reader has to exit
+		volatile bool __wait;               ///< read waits for the missing frames
+		volatile unsigned __underruns;      ///< reads which missed frames
+
+		/**
+		 * open, fill or close a stream
+		 * \param stream the stream
+		 * \param buffer where the interleaved file frames are read
+		 * \return true if the stream still has frames to read right now
+		 */
+		bool __service( Stream* stream, std::vector<float>& buffer );
+		/** reader thread main loop */
+		static void* __reader_main( void* param );
+};
+
+// DEFINITIONS
+
+inline void SampleStreamer::set_wait( bool wait )
+{
+	__wait = wait;
+}
+
+inline unsigned SampleStreamer::get_underruns() const
+{
+	return __underruns;
+}
+
+};
+
+#endif // H2C_SAMPLE_STREAMER_H
+
+/* vim: set softtabstop=4 expandtab: */
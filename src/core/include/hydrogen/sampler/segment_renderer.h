@@ -0,0 +1,186 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SEGMENT_RENDERER_H
+#define H2C_SEGMENT_RENDERER_H
+
+#include <hydrogen/object.h>
+#include <hydrogen/sampler/Sampler.h>
+
+#include <inttypes.h>
+#include <vector>
+#include <pthread.h>
+
+namespace H2Core
+{
+
+class Note;
+class Song;
+
+/**
+ * Renders an exported song in segments, side by side.
+ * <br>The song is captured first: the engine runs the sequencer as for a
+ * serial export, drawing the same random values, and its sampler records
+ * the notes and the periods instead of rendering them, see
+ * Sampler::set_capture. The notes are then timed in frames of the
+ * exported file.
+ * <br>start() splits the periods in segments, each one rendered by a
+ * thread and a Sampler of its own. A segment replays the notes from a
+ * lead-in before its first period, so the voices started earlier ring
+ * into it, and only writes its own periods. The segments fill disjoint
+ * parts of the same buffers, they join where the periods do.
+ * <br>The whole song is held in memory, as floats.
+ */
+class SegmentRenderer : public H2Core::Object
+{
+		H2_OBJECT
+	public:
+		/**
+		 * constructor
+		 * \param sample_rate the sample rate of the export
+		 * \param stems true for each song instrument whose track output is exported
+		 */
+		SegmentRenderer( unsigned sample_rate, const std::vector<bool>& stems );
+		/** wait for the segments, delete the captured notes and the rendered frames */
+		~SegmentRenderer();
+
+		/**
+		 * record a note, called by Sampler::note_on() while capturing
+		 * \param note the note, the renderer takes its ownership
+		 * \param frame_pos the transport frame of the period being captured
+		 * \param tick_size the transport frames per tick
+		 */
+		void capture_note( Note* note, long long frame_pos, float tick_size );
+		/**
+		 * record a period, called by Sampler::process() while capturing
+		 * \param frames the period size
+		 */
+		void capture_period( uint32_t frames );
+		/** return the number of frames captured */
+		long long get_frames() const;
+
+		/**
+		 * start rendering the captured periods and return without waiting
+		 * \param segments the number of segments, each one has a thread
+		 * \param lead_in the frames replayed before a segment and dropped, at least
+		 * \param song the song the notes come from, left untouched while rendering
+		 * \param mode the interpolation of the pitched notes
+		 */
+		void start( int segments, unsigned lead_in, Song* song, Sampler::InterpolateMode mode );
+		/** wait for the segments to be rendered */
+		void wait();
+		/** return true while segments are rendered */
+		bool is_rendering() const;
+		/** return the percentage of frames rendered, the lead-ins excluded */
+		int get_progress() const;
+
+		/** return the rendered song, left channel, get_frames() long */
+		const float* get_out_l() const;
+		/** return the rendered song, right channel, get_frames() long */
+		const float* get_out_r() const;
+		/** return the rendered track output of an instrument, left channel, NULL if it is not exported */
+		const float* get_track_out_l( unsigned track ) const;
+		/** return the rendered track output of an instrument, right channel, NULL if it is not exported */
+		const float* get_track_out_r( unsigned track ) const;
+
+	private:
+		/** a note given to the sampler while capturing */
+		struct CapturedNote {
+			Note* note;                 ///< timed in frames of the export
+			unsigned period;            ///< the period note_on() was called in
+			/** order of the periods, the notes are captured in it */
+			static bool before( const CapturedNote& a, const CapturedNote& b ) {
+				return a.period < b.period;
+			}
+		};
+		/** a part of the song rendered by a thread */
+		struct Segment {
+			SegmentRenderer* renderer;  ///< the renderer the segment belongs to
+			unsigned lead_in_period;    ///< first period replayed
+			unsigned first_period;      ///< first period written
+			unsigned end_period;        ///< period after the last one written
+			pthread_t thread;           ///< posix thread
+		};
+
+		unsigned __sample_rate;                 ///< sample rate of the export
+		std::vector<bool> __stems;              ///< the instruments whose track output is exported
+		std::vector<uint32_t> __periods;        ///< the captured period sizes
+		std::vector<long long> __period_starts; ///< the frame each captured period starts at
+		std::vector<CapturedNote> __notes;      ///< the captured notes, in note_on() order
+		long long __frames;                     ///< frames captured
+		float* __out_l;                         ///< the rendered song, left channel
+		float* __out_r;                         ///< the rendered song, right channel
+		std::vector<float*> __track_out_l;      ///< the rendered track outputs, left channel
+		std::vector<float*> __track_out_r;      ///< the rendered track outputs, right channel
+		Song* __song;                           ///< the song being rendered
+		Sampler::InterpolateMode __mode;        ///< interpolation of the pitched notes
+		std::vector<Segment> __segments;        ///< the segments being rendered
+		volatile int __running;                 ///< segments not rendered yet
+		volatile long __rendered;               ///< frames written so far
+
+		/** segment thread main */
+		static void* __segment_main( void* param );
+		/** render a segment, on its thread */
+		void __render( Segment* segment );
+};
+
+// DEFINITIONS
+inline long long SegmentRenderer::get_frames() const
+{
+	return __frames;
+}
+
+inline bool SegmentRenderer::is_rendering() const
+{
+	return __running > 0;
+}
+
+inline int SegmentRenderer::get_progress() const
+{
+	return __frames ? ( int )( __rendered * 100LL / __frames ) : 100;
+}
+
+inline const float* SegmentRenderer::get_out_l() const
+{
+	return __out_l;
+}
+
+inline const float* SegmentRenderer::get_out_r() const
+{
+	return __out_r;
+}
+
+inline const float* SegmentRenderer::get_track_out_l( unsigned track ) const
+{
+	return track < __track_out_l.size() ? __track_out_l[ track ] : 0;
+}
+
+inline const float* SegmentRenderer::get_track_out_r( unsigned track ) const
+{
+	return track < __track_out_r.size() ? __track_out_r[ track ] : 0;
+}
+
+};
+
+#endif // H2C_SEGMENT_RENDERER_H
+
+/* vim: set softtabstop=4 expandtab: */
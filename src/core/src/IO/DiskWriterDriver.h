@@ -26,6 +26,9 @@
 #include <sndfile.h>
 
 #include <inttypes.h>
+#include <vector>
+
+#include <QtCore/QStringList>
 
 #include <hydrogen/IO/AudioOutput.h>
 #include <hydrogen/object.h>
@@ -45,13 +48,22 @@ class DiskWriterDriver : public AudioOutput
 
 		unsigned m_nSampleRate;
 		QString m_sFilename;
+		QStringList m_trackFilenames;	///< stem of each song instrument, empty if not exported
+		std::vector<float*> m_trackOut_L;
+		std::vector<float*> m_trackOut_R;
 		unsigned m_nBufferSize;
 		int m_nSampleDepth;
 		audioProcessCallback m_processCallback;
 		float* m_pOut_L;
 		float* m_pOut_R;
 
-		DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate, const QString& sFilename, int nSampleDepth );
+		/**
+		 * \param sFilename the master mix file, none if empty
+		 * \param trackFilenames the stem file of each song instrument, rendered
+		 * from the track outputs in the same pass as the master mix
+		 */
+		DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate, const QString& sFilename, int nSampleDepth,
+		                  const QStringList& trackFilenames = QStringList() );
 		~DiskWriterDriver();
 
 		int init( unsigned nBufferSize );
@@ -75,6 +87,16 @@ class DiskWriterDriver : public AudioOutput
 			return m_pOut_R;
 		}
 
+		int getNumTracks() {
+			return m_trackOut_L.size();
+		}
+		float* getTrackOut_L( unsigned nTrack ) {
+			return nTrack < m_trackOut_L.size() ? m_trackOut_L[ nTrack ] : NULL;
+		}
+		float* getTrackOut_R( unsigned nTrack ) {
+			return nTrack < m_trackOut_R.size() ? m_trackOut_R[ nTrack ] : NULL;
+		}
+
 		virtual void play();
 		virtual void stop();
 		virtual void locate( unsigned long nFrame );
@@ -0,0 +1,107 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#ifndef SOUND_FILE_WRITER_H
+#define SOUND_FILE_WRITER_H
+
+#include <sndfile.h>
+#include <pthread.h>
+
+#include <hydrogen/object.h>
+
+#define SOUND_FILE_WRITER_PERIODS 4
+
+namespace H2Core
+{
+
+///
+/// Sound file written by its own thread. The periods go through a ring of
+/// SOUND_FILE_WRITER_PERIODS preallocated buffers, the thread clamps,
+/// interleaves and encodes them while the engine renders the next ones.
+///
+class SoundFileWriter : public H2Core::Object
+{
+	H2_OBJECT
+	public:
+		/**
+		 * libsndfile format for a file name extension and a sample depth
+		 * \param sFilename the file name, its extension selects the container
+		 * \param nSampleDepth 8, 16, 24 or 32 bits, ignored for ogg
+		 */
+		static int format( const QString& sFilename, int nSampleDepth );
+
+		/**
+		 * open the file and start the writer thread
+		 * \param sFilename the file to write
+		 * \param nSampleRate the sample rate of the file
+		 * \param nSampleDepth the sample depth of the file
+		 * \param nBufferSize the largest period passed to write()
+		 */
+		SoundFileWriter( const QString& sFilename, unsigned nSampleRate, int nSampleDepth, unsigned nBufferSize );
+		/** write the pending period and close the file */
+		~SoundFileWriter();
+
+		/** return true if the file could be opened */
+		bool is_open() const;
+		/**
+		 * copy a stereo period into the ring, waits while the ring is full
+		 * \param pData_L the left channel
+		 * \param pData_R the right channel
+		 * \param nFrames the number of frames, at most the buffer size
+		 */
+		void write( const float* pData_L, const float* pData_R, unsigned nFrames );
+
+	private:
+		/** a period of the ring */
+		struct Period {
+			float* data_L;
+			float* data_R;
+			unsigned frames;
+		};
+
+		QString __filename;         ///< the file name, for the logs
+		SNDFILE* __file;            ///< the libsndfile handle, NULL if not open
+		unsigned __buffer_size;     ///< frames a period can hold
+		Period __ring[ SOUND_FILE_WRITER_PERIODS ];
+		float* __interleaved;       ///< the period being encoded, owned by the thread
+		int __head;                 ///< next period to fill, owned by write()
+		int __tail;                 ///< next period to encode, owned by the thread
+		int __count;                ///< periods filled and not encoded yet
+		bool __closing;             ///< set once the last period was queued
+		pthread_t __writer_thread;
+		pthread_mutex_t __mutex;    ///< protects __count and __closing
+		pthread_cond_t __cond;      ///< signals a change of __count or __closing
+
+		static void* __run( void* param );
+};
+
+// DEFINITIONS
+
+inline bool SoundFileWriter::is_open() const
+{
+	return __file != NULL;
+}
+
+};
+
+#endif
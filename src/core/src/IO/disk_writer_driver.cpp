@@ -19,134 +19,44 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  *
  */
-#include <unistd.h>
 #include "DiskWriterDriver.h"
+#include "SoundFileWriter.h"
 
 #include <hydrogen/Preferences.h>
+#include <hydrogen/audio_engine.h>
 #include <hydrogen/event_queue.h>
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/fx/Effects.h>
+#include <hydrogen/sampler/Sampler.h>
+#include <hydrogen/sampler/segment_renderer.h>
 
 #include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
 
-#ifdef WIN32
-#include <windows.h>
-/*
- * In Windows the unistd function sleep( seconds ) is not available.
- * Treat sleep( SECONDS ) as a macro that uses SleepEx.
- * Convert seconds to milliseconds for the first argument of SleepEx.
- * Use false for the second argument of SleepEx.
- * This way SleepEx always returns 0, after the specified time has passed.
- */
-#define sleep( SECONDS ) SleepEx( SECONDS * 1000, false )
-#endif
-
 namespace H2Core
 {
 
 pthread_t diskWriterDriverThread;
 
-void* diskWriterDriver_thread( void* param )
-{
-
-		Object* __object = ( Object* )param;
-	DiskWriterDriver *pDriver = ( DiskWriterDriver* )param;
-		EventQueue::get_instance()->push_event( EVENT_PROGRESS, 0 );
-		pDriver->setBpm( Hydrogen::get_instance()->getSong()->__bpm );
-		pDriver->audioEngine_process_checkBPMChanged();
-	__INFOLOG( "DiskWriterDriver thread start" );
-
-	// always rolling, no user interaction
-	pDriver->m_transport.m_status = TransportInfo::ROLLING;
-
-	SF_INFO soundInfo;
-	soundInfo.samplerate = pDriver->m_nSampleRate;
-//	soundInfo.frames = -1;//getNFrames();		///\todo: da terminare
-	soundInfo.channels = 2;
-	//default format
-	int sfformat = 0x010000; //wav format (default)
-	int bits = 0x0002; //16 bit PCM (default)
-	//sf_format switch
-	if( pDriver->m_sFilename.endsWith(".aiff") || pDriver->m_sFilename.endsWith(".AIFF") ){
-		sfformat =  0x020000; //Apple/SGI AIFF format (big endian)
-	}
-	if( pDriver->m_sFilename.endsWith(".flac") || pDriver->m_sFilename.endsWith(".FLAC") ){
-		sfformat =  0x170000; //FLAC lossless file format
-	}
-	if( ( pDriver->m_nSampleDepth == 8 ) && ( pDriver->m_sFilename.endsWith(".aiff") || pDriver->m_sFilename.endsWith(".AIFF") ) ){
-		bits = 0x0001; //Signed 8 bit data works with aiff
-	}
-	if( ( pDriver->m_nSampleDepth == 8 ) && ( pDriver->m_sFilename.endsWith(".wav") || pDriver->m_sFilename.endsWith(".WAV") ) ){
-		bits = 0x0005; //Unsigned 8 bit data needed for Microsoft WAV format
-	}
-	if( pDriver->m_nSampleDepth == 16 ){
-		bits = 0x0002; //Signed 16 bit data
-	}
-	if( pDriver->m_nSampleDepth == 24 ){
-		bits = 0x0003; //Signed 24 bit data
-	}
-	if( pDriver->m_nSampleDepth == 32 ){
-		bits = 0x0004; ////Signed 32 bit data
-	}
-
-	soundInfo.format =  sfformat|bits;
-
-//	#ifdef HAVE_OGGVORBIS
-
-	//ogg vorbis option
-	if( pDriver->m_sFilename.endsWith( ".ogg" ) | pDriver->m_sFilename.endsWith( ".OGG" ) )
-		soundInfo.format = SF_FORMAT_OGG | SF_FORMAT_VORBIS;
-
-//	#endif
-
-
-///formats
-//          SF_FORMAT_WAV          = 0x010000,     /* Microsoft WAV format (little endian). */
-//          SF_FORMAT_AIFF         = 0x020000,     /* Apple/SGI AIFF format (big endian). */
-//          SF_FORMAT_AU           = 0x030000,     /* Sun/NeXT AU format (big endian). */
-//          SF_FORMAT_RAW          = 0x040000,     /* RAW PCM data. */
-//          SF_FORMAT_PAF          = 0x050000,     /* Ensoniq PARIS file format. */
-//          SF_FORMAT_SVX          = 0x060000,     /* Amiga IFF / SVX8 / SV16 format. */
-//          SF_FORMAT_NIST         = 0x070000,     /* Sphere NIST format. */
-//          SF_FORMAT_VOC          = 0x080000,     /* VOC files. */
-//          SF_FORMAT_IRCAM        = 0x0A0000,     /* Berkeley/IRCAM/CARL */
-//          SF_FORMAT_W64          = 0x0B0000,     /* Sonic Foundry's 64 bit RIFF/WAV */
-//          SF_FORMAT_MAT4         = 0x0C0000,     /* Matlab (tm) V4.2 / GNU Octave 2.0 */
-//          SF_FORMAT_MAT5         = 0x0D0000,     /* Matlab (tm) V5.0 / GNU Octave 2.1 */
-//          SF_FORMAT_PVF          = 0x0E0000,     /* Portable Voice Format */
-//          SF_FORMAT_XI           = 0x0F0000,     /* Fasttracker 2 Extended Instrument */
-//          SF_FORMAT_HTK          = 0x100000,     /* HMM Tool Kit format */
-//          SF_FORMAT_SDS          = 0x110000,     /* Midi Sample Dump Standard */
-//          SF_FORMAT_AVR          = 0x120000,     /* Audio Visual Research */
-//          SF_FORMAT_WAVEX        = 0x130000,     /* MS WAVE with WAVEFORMATEX */
-//          SF_FORMAT_SD2          = 0x160000,     /* Sound Designer 2 */
-//          SF_FORMAT_FLAC         = 0x170000,     /* FLAC lossless file format */
-//          SF_FORMAT_CAF          = 0x180000,     /* Core Audio File format */
-//	    SF_FORMAT_OGG
-///bits
-//          SF_FORMAT_PCM_S8       = 0x0001,       /* Signed 8 bit data */
-//          SF_FORMAT_PCM_16       = 0x0002,       /* Signed 16 bit data */
-//          SF_FORMAT_PCM_24       = 0x0003,       /* Signed 24 bit data */
-//          SF_FORMAT_PCM_32       = 0x0004,       /* Signed 32 bit data */
-///used for ogg
-//          SF_FORMAT_VORBIS
-
-	if ( !sf_format_check( &soundInfo ) ) {
-		__ERRORLOG( "Error in soundInfo" );
-		return 0;
-	}
-
-
-	SNDFILE* m_file = sf_open( pDriver->m_sFilename.toLocal8Bit(), SFM_WRITE, &soundInfo );
-
-	float *pData = new float[ pDriver->m_nBufferSize * 2 ];	// always stereo
-
-	float *pData_L = pDriver->m_pOut_L;
-	float *pData_R = pDriver->m_pOut_R;
-
+/// ms between two progress events while the segments render
+#define SEGMENT_PROGRESS_INTERVAL 100
+/// progress reached once a segmented export is captured
+#define CAPTURE_PROGRESS 10
 
+/**
+ * Run the engine over the song columns, in the periods of the export.
+ * \param pMaster where the master mix goes, NULL to drop it
+ * \param pStems where the stems go, NULL to drop them
+ * \param nProgress progress reached at the last column, it is not sent
+ */
+static void diskWriterDriver_renderColumns( DiskWriterDriver* pDriver, SoundFileWriter* pMaster,
+                                            std::vector<SoundFileWriter*>* pStems, int nProgress )
+{
 		Hydrogen* engine = Hydrogen::get_instance();
 
 	std::vector<PatternList*> *pPatternColumns = Hydrogen::get_instance()->getSong()->get_pattern_group_vector();
@@ -181,11 +91,10 @@ void* diskWriterDriver_thread( void* param )
 						pDriver->audioEngine_process_checkBPMChanged();
 						engine->setPatternPos(patternposition);
 
-						// delay needed time to calculate all rubberband samples
+						// stretch the rubberband samples before rendering the pattern,
+						// there is no realtime deadline to wait for
 						if( Preferences::get_instance()->getRubberBandBatchMode() && validBpm != oldBPM ){
-								EventQueue::get_instance()->push_event( EVENT_RECALCULATERUBBERBAND, -1);
-								int sleepTime = Preferences::get_instance()->getRubberBandCalcTime()+1;
-								while ((sleepTime = sleep(sleepTime)) > 0);
+								engine->recalculateRubberband( validBpm );
 						}
 						oldBPM = validBpm;
 
@@ -216,42 +125,149 @@ void* diskWriterDriver_thread( void* param )
 						frameNumber += usedBuffer;
 						int ret = pDriver->m_processCallback( usedBuffer, NULL );
 
-						for ( unsigned i = 0; i < usedBuffer; i++ ) {
-								if(pData_L[i] > 1){
-										pData[i * 2] = 1;
-								}
-								else if(pData_L[i] < -1){
-										pData[i * 2] = -1;
-								}else
-								{
-										pData[i * 2] = pData_L[i];
-								}
-
-								if(pData_R[i] > 1){
-										pData[i * 2 + 1] = 1;
-								}
-								else if(pData_R[i] < -1){
-										pData[i * 2 + 1] = -1;
-								}else
-								{
-										pData[i * 2 + 1] = pData_R[i];
+						for ( unsigned nTrack = 0; pStems && nTrack < pStems->size(); ++nTrack ) {
+								if ( ( *pStems )[ nTrack ] ) {
+										( *pStems )[ nTrack ]->write( pDriver->m_trackOut_L[ nTrack ], pDriver->m_trackOut_R[ nTrack ], usedBuffer );
 								}
 						}
-						int res = sf_writef_float( m_file, pData, usedBuffer );
-						if ( res != ( int )usedBuffer ) {
-								__ERRORLOG( "Error during sf_write_float" );
+
+						if ( pMaster ) {
+								pMaster->write( pDriver->m_pOut_L, pDriver->m_pOut_R, usedBuffer );
 						}
 				}
 
 				// this progress bar methode is not exact but ok enough to give users a usable visible progress feedback
-				float fPercent = ( float )(patternposition +1) / ( float )nColumns * 100.0;
-				EventQueue::get_instance()->push_event( EVENT_PROGRESS, ( int )fPercent );
+				// 100% is only sent once the files are complete
+				float fPercent = ( float )(patternposition +1) / ( float )nColumns * nProgress;
+				if ( patternposition + 1 < nColumns ) {
+						EventQueue::get_instance()->push_event( EVENT_PROGRESS, ( int )fPercent );
+				}
+		}
+}
+
+/// True if the export can be rendered in segments: the effects and the
+/// rubberband stretching of the timeline depend on the song before them.
+static bool diskWriterDriver_canRenderSegments()
+{
+	Preferences* pPref = Preferences::get_instance();
+	if ( pPref->m_nExportSegments < 2 ) {
+		return false;
+	}
+	if ( pPref->getUseTimelineBpm() && pPref->getRubberBandBatchMode() ) {
+		___INFOLOG( "rubberband batch mode, the song is rendered in one pass" );
+		return false;
+	}
+#ifdef H2CORE_HAVE_LADSPA
+	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+		LadspaFX* pFX = Effects::get_instance()->getLadspaFX( nFX );
+		if ( pFX && pFX->isEnabled() ) {
+			___INFOLOG( "effects in use, the song is rendered in one pass" );
+			return false;
+		}
+	}
+#endif
+	return true;
+}
+
+/**
+ * Render the song in segments side by side, see SegmentRenderer. The
+ * engine captures the song first, then the segments are written in order.
+ */
+static void diskWriterDriver_renderSegments( DiskWriterDriver* pDriver, SoundFileWriter* pMaster,
+                                             std::vector<SoundFileWriter*>& stems )
+{
+	Preferences* pPref = Preferences::get_instance();
+	Song* pSong = Hydrogen::get_instance()->getSong();
+	Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
+
+	std::vector<bool> tracks;
+	for ( unsigned nTrack = 0; nTrack < stems.size(); ++nTrack ) {
+		tracks.push_back( stems[ nTrack ] != NULL );
+	}
+	SegmentRenderer renderer( pDriver->m_nSampleRate, tracks );
+
+	// the sequencer runs as for a serial export and draws the same random
+	// values, the sampler records the notes instead of rendering them
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	pSampler->set_capture( &renderer );
+	AudioEngine::get_instance()->unlock();
+	diskWriterDriver_renderColumns( pDriver, NULL, NULL, CAPTURE_PROGRESS );
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	pSampler->set_capture( NULL );
+	AudioEngine::get_instance()->unlock();
+	EventQueue::get_instance()->push_event( EVENT_PROGRESS, CAPTURE_PROGRESS );
+
+	unsigned nLeadIn = ( unsigned )( ( long long )pPref->m_nExportLeadIn * pDriver->m_nSampleRate / 1000 );
+	renderer.start( pPref->m_nExportSegments, nLeadIn, pSong, pSampler->getInterpolateMode() );
+	while ( renderer.is_rendering() ) {
+		usleep( SEGMENT_PROGRESS_INTERVAL * 1000 );
+		int nPercent = CAPTURE_PROGRESS + renderer.get_progress() * ( 99 - CAPTURE_PROGRESS ) / 100;
+		EventQueue::get_instance()->push_event( EVENT_PROGRESS, nPercent );
+	}
+	renderer.wait();
+
+	// the segments end where the next ones start, they are written back to back
+	for ( long long nFrame = 0; nFrame < renderer.get_frames(); nFrame += pDriver->m_nBufferSize ) {
+		unsigned nFrames = ( unsigned )std::min( ( long long )pDriver->m_nBufferSize, renderer.get_frames() - nFrame );
+		if ( pMaster ) {
+			pMaster->write( renderer.get_out_l() + nFrame, renderer.get_out_r() + nFrame, nFrames );
+		}
+		for ( unsigned nTrack = 0; nTrack < stems.size(); ++nTrack ) {
+			if ( stems[ nTrack ] ) {
+				stems[ nTrack ]->write( renderer.get_track_out_l( nTrack ) + nFrame,
+				                        renderer.get_track_out_r( nTrack ) + nFrame, nFrames );
+			}
+		}
+	}
+}
+
+
+void* diskWriterDriver_thread( void* param )
+{
+
+		Object* __object = ( Object* )param;
+	DiskWriterDriver *pDriver = ( DiskWriterDriver* )param;
+		EventQueue::get_instance()->push_event( EVENT_PROGRESS, 0 );
+		pDriver->setBpm( Hydrogen::get_instance()->getSong()->__bpm );
+		pDriver->audioEngine_process_checkBPMChanged();
+	__INFOLOG( "DiskWriterDriver thread start" );
+
+	// always rolling, no user interaction
+	pDriver->m_transport.m_status = TransportInfo::ROLLING;
+
+	// the files are clamped, interleaved and encoded by their writer
+	// threads while this one renders
+	SoundFileWriter* pMaster = NULL;
+	if ( !pDriver->m_sFilename.isEmpty() ) {
+		pMaster = new SoundFileWriter( pDriver->m_sFilename, pDriver->m_nSampleRate,
+		                               pDriver->m_nSampleDepth, pDriver->m_nBufferSize );
+		if ( !pMaster->is_open() ) {
+			delete pMaster;
+			return 0;
 		}
+	}
 
-	delete[] pData;
-	pData = NULL;
+	// the stems come from the track outputs of the same pass
+	std::vector<SoundFileWriter*> stems( pDriver->m_trackFilenames.size(), ( SoundFileWriter* )NULL );
+	for ( unsigned nTrack = 0; nTrack < stems.size(); ++nTrack ) {
+		if ( !pDriver->m_trackFilenames[ nTrack ].isEmpty() ) {
+			stems[ nTrack ] = new SoundFileWriter( pDriver->m_trackFilenames[ nTrack ], pDriver->m_nSampleRate,
+			                                       pDriver->m_nSampleDepth, pDriver->m_nBufferSize );
+		}
+	}
 
-	sf_close( m_file );
+	if ( diskWriterDriver_canRenderSegments() ) {
+		diskWriterDriver_renderSegments( pDriver, pMaster, stems );
+	} else {
+		diskWriterDriver_renderColumns( pDriver, pMaster, &stems, 100 );
+	}
+
+	// wait for the writer threads to encode the last periods
+	delete pMaster;
+	for ( unsigned nTrack = 0; nTrack < stems.size(); ++nTrack ) {
+		delete stems[ nTrack ];
+	}
+	EventQueue::get_instance()->push_event( EVENT_PROGRESS, 100 );
 
 	__INFOLOG( "DiskWriterDriver thread end" );
 
@@ -264,10 +280,12 @@ void* diskWriterDriver_thread( void* param )
 
 const char* DiskWriterDriver::__class_name = "DiskWriterDriver";
 
-DiskWriterDriver::DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate, const QString& sFilename, int nSampleDepth )
+DiskWriterDriver::DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate, const QString& sFilename, int nSampleDepth,
+                                    const QStringList& trackFilenames )
 		: AudioOutput( __class_name )
 		, m_nSampleRate( nSamplerate )
 		, m_sFilename( sFilename )
+		, m_trackFilenames( trackFilenames )
 		, m_nSampleDepth ( nSampleDepth )
 		, m_processCallback( processCallback )
 {
@@ -291,6 +309,15 @@ int DiskWriterDriver::init( unsigned nBufferSize )
 	m_pOut_L = new float[nBufferSize];
 	m_pOut_R = new float[nBufferSize];
 
+	// track outputs for the instruments with a stem, the others render
+	// to the master mix only
+	for ( int nTrack = 0; nTrack < m_trackFilenames.size(); ++nTrack ) {
+		bool bStem = !m_trackFilenames[ nTrack ].isEmpty();
+		m_trackOut_L.push_back( bStem ? new float[nBufferSize] : NULL );
+		m_trackOut_R.push_back( bStem ? new float[nBufferSize] : NULL );
+		__track_out_enabled = __track_out_enabled || bStem;
+	}
+
 	return 0;
 }
 
@@ -325,6 +352,14 @@ void DiskWriterDriver::disconnect()
 	delete[] m_pOut_R;
 	m_pOut_R = NULL;
 
+	for ( unsigned nTrack = 0; nTrack < m_trackOut_L.size(); ++nTrack ) {
+		delete[] m_trackOut_L[ nTrack ];
+		delete[] m_trackOut_R[ nTrack ];
+	}
+	m_trackOut_L.clear();
+	m_trackOut_R.clear();
+	__track_out_enabled = false;
+
 }
 
 
@@ -341,7 +341,8 @@ void MidiInput::handleNoteOffMessage( const MidiMessage& msg, bool CymbalChoke )
 		{
 			if ( pSong->get_instrument_list()->size() < nInstrument +1 )
 				return;
-			Note *offnote = new Note( pInstr,
+			AudioEngine::get_instance()->lock( RIGHT_HERE );
+			Note *offnote = AudioEngine::get_instance()->get_note_pool()->acquire( pInstr,
 						0.0,
 						0.0,
 						0.0,
@@ -349,8 +350,9 @@ void MidiInput::handleNoteOffMessage( const MidiMessage& msg, bool CymbalChoke )
 						-1,
 						0 );
 			offnote->set_note_off( true );
+			// the sampler releases note off notes
 			AudioEngine::get_instance()->get_sampler()->note_on( offnote );
-			delete offnote;
+			AudioEngine::get_instance()->unlock();
 		}
 		if(Preferences::get_instance()->getRecordEvents())
 			AudioEngine::get_instance()->get_sampler()->setPlayingNotelength( pInstr, notelength * fStep, __noteOnTick );
@@ -0,0 +1,188 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include "SoundFileWriter.h"
+
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* SoundFileWriter::__class_name = "SoundFileWriter";
+
+int SoundFileWriter::format( const QString& sFilename, int nSampleDepth )
+{
+	QString sName = sFilename.toLower();
+	if ( sName.endsWith( ".ogg" ) ) {
+		return SF_FORMAT_OGG | SF_FORMAT_VORBIS;
+	}
+
+	int nFormat = SF_FORMAT_WAV;
+	if ( sName.endsWith( ".aiff" ) ) {
+		nFormat = SF_FORMAT_AIFF;	// big endian
+	} else if ( sName.endsWith( ".flac" ) ) {
+		nFormat = SF_FORMAT_FLAC;
+	}
+
+	int nBits = SF_FORMAT_PCM_16;
+	switch ( nSampleDepth ) {
+	case 8:
+		// unsigned 8 bit data needed for Microsoft WAV format, signed works with aiff
+		nBits = nFormat == SF_FORMAT_WAV ? SF_FORMAT_PCM_U8 : SF_FORMAT_PCM_S8;
+		break;
+	case 24:
+		nBits = SF_FORMAT_PCM_24;
+		break;
+	case 32:
+		nBits = SF_FORMAT_PCM_32;
+		break;
+	}
+	return nFormat | nBits;
+}
+
+SoundFileWriter::SoundFileWriter( const QString& sFilename, unsigned nSampleRate, int nSampleDepth, unsigned nBufferSize )
+		: Object( __class_name )
+		, __filename( sFilename )
+		, __file( NULL )
+		, __buffer_size( nBufferSize )
+		, __interleaved( NULL )
+		, __head( 0 )
+		, __tail( 0 )
+		, __count( 0 )
+		, __closing( false )
+{
+	SF_INFO soundInfo;
+	soundInfo.samplerate = nSampleRate;
+	soundInfo.channels = 2;	// always stereo
+	soundInfo.format = format( sFilename, nSampleDepth );
+	if ( !sf_format_check( &soundInfo ) ) {
+		ERRORLOG( QString( "Error in soundInfo of %1" ).arg( sFilename ) );
+		return;
+	}
+	__file = sf_open( sFilename.toLocal8Bit(), SFM_WRITE, &soundInfo );
+	if ( !__file ) {
+		ERRORLOG( QString( "Error opening %1: %2" ).arg( sFilename ).arg( sf_strerror( NULL ) ) );
+		return;
+	}
+
+	for ( int i = 0; i < SOUND_FILE_WRITER_PERIODS; ++i ) {
+		__ring[ i ].data_L = new float[ nBufferSize ];
+		__ring[ i ].data_R = new float[ nBufferSize ];
+		__ring[ i ].frames = 0;
+	}
+	__interleaved = new float[ nBufferSize * 2 ];
+	pthread_mutex_init( &__mutex, NULL );
+	pthread_cond_init( &__cond, NULL );
+	pthread_create( &__writer_thread, NULL, __run, this );
+}
+
+SoundFileWriter::~SoundFileWriter()
+{
+	if ( !__file ) {
+		return;
+	}
+	pthread_mutex_lock( &__mutex );
+	__closing = true;
+	pthread_cond_broadcast( &__cond );
+	pthread_mutex_unlock( &__mutex );
+	pthread_join( __writer_thread, NULL );
+
+	pthread_cond_destroy( &__cond );
+	pthread_mutex_destroy( &__mutex );
+	for ( int i = 0; i < SOUND_FILE_WRITER_PERIODS; ++i ) {
+		delete[] __ring[ i ].data_L;
+		delete[] __ring[ i ].data_R;
+	}
+	delete[] __interleaved;
+	sf_close( __file );
+}
+
+void SoundFileWriter::write( const float* pData_L, const float* pData_R, unsigned nFrames )
+{
+	if ( !__file ) {
+		return;
+	}
+	pthread_mutex_lock( &__mutex );
+	while ( __count == SOUND_FILE_WRITER_PERIODS ) {
+		pthread_cond_wait( &__cond, &__mutex );
+	}
+	pthread_mutex_unlock( &__mutex );
+
+	// the thread does not touch the periods past __count
+	Period* pPeriod = &__ring[ __head ];
+	memcpy( pPeriod->data_L, pData_L, nFrames * sizeof( float ) );
+	memcpy( pPeriod->data_R, pData_R, nFrames * sizeof( float ) );
+	pPeriod->frames = nFrames;
+	__head = ( __head + 1 ) % SOUND_FILE_WRITER_PERIODS;
+
+	pthread_mutex_lock( &__mutex );
+	__count++;
+	pthread_cond_broadcast( &__cond );
+	pthread_mutex_unlock( &__mutex );
+}
+
+void* SoundFileWriter::__run( void* param )
+{
+	SoundFileWriter* pWriter = ( SoundFileWriter* )param;
+	float* pData = pWriter->__interleaved;
+
+	pthread_mutex_lock( &pWriter->__mutex );
+	while ( true ) {
+		while ( pWriter->__count == 0 && !pWriter->__closing ) {
+			pthread_cond_wait( &pWriter->__cond, &pWriter->__mutex );
+		}
+		if ( pWriter->__count == 0 ) {
+			break;
+		}
+		pthread_mutex_unlock( &pWriter->__mutex );
+
+		Period* pPeriod = &pWriter->__ring[ pWriter->__tail ];
+		unsigned nFrames = pPeriod->frames;
+		for ( unsigned i = 0; i < nFrames; ++i ) {
+			float fL = pPeriod->data_L[ i ];
+			float fR = pPeriod->data_R[ i ];
+			pData[ i * 2 ] = fL > 1 ? 1 : ( fL < -1 ? -1 : fL );
+			pData[ i * 2 + 1 ] = fR > 1 ? 1 : ( fR < -1 ? -1 : fR );
+		}
+		pWriter->__tail = ( pWriter->__tail + 1 ) % SOUND_FILE_WRITER_PERIODS;
+
+		// the period can be filled again while this one is encoded
+		pthread_mutex_lock( &pWriter->__mutex );
+		pWriter->__count--;
+		pthread_cond_broadcast( &pWriter->__cond );
+		pthread_mutex_unlock( &pWriter->__mutex );
+
+		sf_count_t res = sf_writef_float( pWriter->__file, pData, nFrames );
+		if ( res != ( sf_count_t )nFrames ) {
+			ERRORLOG( QString( "Error during sf_writef_float on %1" ).arg( pWriter->__filename ) );
+		}
+
+		pthread_mutex_lock( &pWriter->__mutex );
+	}
+	pthread_mutex_unlock( &pWriter->__mutex );
+	return NULL;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
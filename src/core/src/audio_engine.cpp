@@ -26,7 +26,11 @@
 #include <hydrogen/sampler/Sampler.h>
 
 #include <hydrogen/hydrogen.h>	// TODO: remove this line as soon as possible
+#include <hydrogen/Preferences.h>
 #include <cassert>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
 
 namespace H2Core
 {
@@ -43,8 +47,15 @@ void AudioEngine::create_instance()
 	}
 }
 
+/// room for the playing voices and the notes queued ahead of them
+static int note_pool_capacity( int nMaxNotes )
+{
+	return 4 * nMaxNotes;
+}
+
 AudioEngine::AudioEngine()
 		: Object( __class_name )
+		, __note_pool( NULL )
 		, __sampler( NULL )
 		, __synth( NULL )
 {
@@ -53,7 +64,8 @@ AudioEngine::AudioEngine()
 
 	pthread_mutex_init( &__engine_mutex, NULL );
 
-	__sampler = new Sampler;
+	__note_pool = new NotePool( note_pool_capacity( Preferences::get_instance()->m_nMaxNotes ) );
+	__sampler = new Sampler( __note_pool );
 	__synth = new Synth;
 
 #ifdef H2CORE_HAVE_LADSPA
@@ -74,6 +86,7 @@ AudioEngine::~AudioEngine()
 //	delete Sequencer::get_instance();
 	delete __sampler;
 	delete __synth;
+	delete __note_pool;
 }
 
 
@@ -93,6 +106,21 @@ Synth* AudioEngine::get_synth()
 	return __synth;
 }
 
+
+
+NotePool* AudioEngine::get_note_pool()
+{
+	assert(__note_pool);
+	return __note_pool;
+}
+
+void AudioEngine::set_max_notes( int nMaxNotes )
+{
+	__sampler->set_max_notes( nMaxNotes );
+	// the audio thread would take the notes from the heap past the old room
+	__note_pool->set_capacity( note_pool_capacity( nMaxNotes ) );
+}
+
 void AudioEngine::lock( const char* file, unsigned int line, const char* function )
 {
 	pthread_mutex_lock( &__engine_mutex );
@@ -118,6 +146,42 @@ bool AudioEngine::try_lock( const char* file, unsigned int line, const char* fun
 
 
 
+bool AudioEngine::timed_lock( unsigned nMicroseconds, const char* file, unsigned int line, const char* function )
+{
+	if ( pthread_mutex_trylock( &__engine_mutex ) != 0 ) {
+#if defined( _POSIX_TIMEOUTS ) && _POSIX_TIMEOUTS > 0
+		timespec deadline;
+		clock_gettime( CLOCK_REALTIME, &deadline );
+		deadline.tv_nsec += ( long )( nMicroseconds % 1000000 ) * 1000;
+		deadline.tv_sec += nMicroseconds / 1000000 + deadline.tv_nsec / 1000000000;
+		deadline.tv_nsec %= 1000000000;
+		if ( pthread_mutex_timedlock( &__engine_mutex, &deadline ) != 0 ) {
+			return false;
+		}
+#else
+		// no timed lock there, poll it
+		timeval start, now;
+		gettimeofday( &start, NULL );
+		for (;;) {
+			usleep( 100 );
+			if ( pthread_mutex_trylock( &__engine_mutex ) == 0 ) {
+				break;
+			}
+			gettimeofday( &now, NULL );
+			if ( ( now.tv_sec - start.tv_sec ) * 1000000 + ( now.tv_usec - start.tv_usec ) >= ( long )nMicroseconds ) {
+				return false;
+			}
+		}
+#endif
+	}
+	__locker.file = file;
+	__locker.line = line;
+	__locker.function = function;
+	return true;
+}
+
+
+
 void AudioEngine::unlock()
 {
 	// Leave "__locker" dirty.
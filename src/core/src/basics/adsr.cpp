@@ -22,6 +22,8 @@
 
 #include <hydrogen/basics/adsr.h>
 
+#include <algorithm>
+
 #include "exponential_tables.h"
 
 namespace H2Core
@@ -63,55 +65,90 @@ ADSR::~ADSR() { }
 
 float ADSR::get_value( float step )
 {
-	switch ( __state ) {
-	case ATTACK:
-		if ( __attack == 0 ) {
-			__value = 1.0;
-		} else {
-			__value = convex_exponant( linear_interpolation( 0.0, 1.0, ( __ticks * 1.0 / __attack ) ) );
-		}
-		__ticks += step;
-		if ( __ticks > __attack ) {
-			__state = DECAY;
-			__ticks = 0;
-		}
-		break;
-
-	case DECAY:
-		if ( __decay == 0 ) {
-			__value = __sustain;
-		} else {
-			__value = concave_exponant( linear_interpolation( 1.0, 0.0, ( __ticks * 1.0 / __decay ) ) ) * (1 - __sustain) + __sustain;
-		}
-		__ticks += step;
-		if ( __ticks > __decay ) {
-			__state = SUSTAIN;
-			__ticks = 0;
-		}
-		break;
-
-	case SUSTAIN:
-		__value = __sustain;
-		break;
+	float value;
+	get_values( &value, 1, step );
+	return value;
+}
 
-	case RELEASE:
-		if ( __release < 256 ) {
-			__release = 256;
-		}
-		__value = concave_exponant( linear_interpolation( 1.0, 0.0, ( __ticks * 1.0 / __release ) ) ) * __release_value;
+int ADSR::__segment( float* values, int nframes, float step, float length, float ( *curve )( float ),
+                     float from, float to, float scale, float offset, bool* end )
+{
+	*end = false;
+	if ( nframes <= 0 ) {
+		return 0;
+	}
+
+	// __ticks is increased after each frame, the segment ends once it gets over length
+	if ( length == 0 ) {
+		__value = to * scale + offset;
+		values[ 0 ] = __value;
 		__ticks += step;
-		if ( __ticks > __release ) {
-			__state = IDLE;
-			__ticks = 0;
+		*end = ( __ticks > length );
+		return 1;
+	}
+
+	float fTicks = __ticks;
+	double fInvLength = 1.0 / length;
+	int n = 0;
+	while ( n < nframes ) {
+		values[ n++ ] = curve( linear_interpolation( from, to, fTicks * fInvLength ) ) * scale + offset;
+		fTicks += step;
+		if ( fTicks > length ) {
+			*end = true;
+			break;
 		}
-		break;
-
-	case IDLE:
-	default:
-		__value = 0;
-	};
+	}
+	__value = values[ n - 1 ];
+	__ticks = fTicks;
+	return n;
+}
 
-	return __value;
+void ADSR::get_values( float* values, int nframes, float step )
+{
+	int n = 0;
+	bool bEnd;
+	while ( n < nframes ) {
+		switch ( __state ) {
+		case ATTACK:
+			n += __segment( values + n, nframes - n, step, __attack, convex_exponant, 0.0, 1.0, 1.0, 0.0, &bEnd );
+			if ( bEnd ) {
+				__state = DECAY;
+				__ticks = 0;
+			}
+			break;
+
+		case DECAY:
+			n += __segment( values + n, nframes - n, step, __decay, concave_exponant, 1.0, 0.0, 1 - __sustain, __sustain, &bEnd );
+			if ( bEnd ) {
+				__state = SUSTAIN;
+				__ticks = 0;
+			}
+			break;
+
+		case SUSTAIN:
+			__value = __sustain;
+			std::fill( values + n, values + nframes, __value );
+			n = nframes;
+			break;
+
+		case RELEASE:
+			if ( __release < 256 ) {
+				__release = 256;
+			}
+			n += __segment( values + n, nframes - n, step, __release, concave_exponant, 1.0, 0.0, __release_value, 0.0, &bEnd );
+			if ( bEnd ) {
+				__state = IDLE;
+				__ticks = 0;
+			}
+			break;
+
+		case IDLE:
+		default:
+			__value = 0;
+			std::fill( values + n, values + nframes, __value );
+			n = nframes;
+		};
+	}
 }
 
 void ADSR::attack()
@@ -130,6 +167,15 @@ float ADSR::release()
 	return __release_value;
 }
 
+void ADSR::fade_out( float length )
+{
+	if ( __state == IDLE ) return;
+	__release_value = __value;
+	__release = length;
+	__state = RELEASE;
+	__ticks = 0;
+}
+
 };
 
 /* vim: set softtabstop=4 expandtab: */
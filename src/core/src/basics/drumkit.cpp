@@ -34,6 +34,7 @@
 #endif
 #endif
 
+#include <hydrogen/Preferences.h>
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_list.h>
@@ -48,7 +49,7 @@ namespace H2Core
 
 const char* Drumkit::__class_name = "Drumkit";
 
-Drumkit::Drumkit() : Object( __class_name ), __samples_loaded( false ), __instruments( 0 ) { }
+Drumkit::Drumkit() : Object( __class_name ), __stream_head( 0 ), __compact_samples( false ), __samples_loaded( false ), __instruments( 0 ) { }
 
 Drumkit::Drumkit( Drumkit* other ) :
 	Object( __class_name ),
@@ -57,6 +58,8 @@ Drumkit::Drumkit( Drumkit* other ) :
 	__author( other->get_author() ),
 	__info( other->get_info() ),
 	__license( other->get_license() ),
+	__stream_head( other->get_stream_head() ),
+	__compact_samples( other->get_compact_samples() ),
 	__samples_loaded( other->samples_loaded() )
 {
 	__instruments = new InstrumentList( other->get_instruments() );
@@ -113,6 +116,8 @@ Drumkit* Drumkit::load_from( XMLNode* node, const QString& dk_path )
 	drumkit->__author = node->read_string( "author", "undefined author" );
 	drumkit->__info = node->read_string( "info", "No information available." );
 	drumkit->__license = node->read_string( "license", "undefined license" );
+	drumkit->__stream_head = node->read_int( "streamHead", 0, true, false );
+	drumkit->__compact_samples = node->read_bool( "compactSamples", false, true, false );
 	XMLNode instruments_node = node->firstChildElement( "instrumentList" );
 	if ( instruments_node.isNull() ) {
 		WARNINGLOG( "instrumentList node not found" );
@@ -127,11 +132,16 @@ void Drumkit::load_samples( )
 {
 	INFOLOG( QString( "Loading drumkit %1 instrument samples" ).arg( __name ) );
 	if( !__samples_loaded ) {
-		__instruments->load_samples();
+		__instruments->load_samples( __stream_head, samples_compact() );
 		__samples_loaded = true;
 	}
 }
 
+bool Drumkit::samples_compact() const
+{
+	return __compact_samples || Preferences::get_instance()->m_bCompactSamples;
+}
+
 void Drumkit::unload_samples( )
 {
 	INFOLOG( QString( "Unloading drumkit %1 instrument samples" ).arg( __name ) );
@@ -193,6 +203,9 @@ void Drumkit::save_to( XMLNode* node )
 	node->write_string( "author", __author );
 	node->write_string( "info", __info );
 	node->write_string( "license", __license );
+	// older versions would not validate the drumkit
+	if ( __stream_head > 0 ) node->write_int( "streamHead", __stream_head );
+	if ( __compact_samples ) node->write_bool( "compactSamples", __compact_samples );
 	__instruments->save_to( node );
 }
 
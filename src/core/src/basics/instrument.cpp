@@ -34,6 +34,7 @@
 #include <hydrogen/basics/drumkit.h>
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/sample_loader.h>
 
 namespace H2Core
 {
@@ -129,38 +130,62 @@ Instrument* Instrument::load_instrument( const QString& drumkit_name, const QStr
 }
 
 void Instrument::load_from( Drumkit* drumkit, Instrument* instrument, bool is_live )
+{
+	Sample* samples[ MAX_LAYERS ];
+	SampleLoader loader;
+	queue_samples( drumkit, instrument, &loader, samples );
+	loader.run();
+
+	// the replaced layers are freed once the audio engine is unlocked
+	InstrumentLayer* old_layers[ MAX_LAYERS ];
+	if ( is_live )
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+	load_from( drumkit, instrument, samples, old_layers );
+	if ( is_live )
+		AudioEngine::get_instance()->unlock();
+	for ( int i=0; i<MAX_LAYERS; i++ ) {
+		delete old_layers[i];
+	}
+}
+
+void Instrument::queue_samples( Drumkit* drumkit, Instrument* instrument, SampleLoader* loader, Sample** samples )
+{
+	for ( int i=0; i<MAX_LAYERS; i++ ) {
+		InstrumentLayer* src_layer = instrument->get_layer( i );
+		samples[i] = 0;
+		if( src_layer==0 ) continue;
+		QString sample_path =  drumkit->get_path() + "/" + src_layer->get_sample()->get_filename();
+		if( !Filesystem::file_readable( sample_path ) ) {
+			_ERRORLOG( QString( "Unable to read %1" ).arg( sample_path ) );
+			continue;
+		}
+		samples[i] = new Sample( sample_path );
+		loader->add( samples[i], drumkit->get_stream_head(), drumkit->samples_compact() );
+	}
+}
+
+void Instrument::load_from( Drumkit* drumkit, Instrument* instrument, Sample** samples, InstrumentLayer** old_layers )
 {
 	for ( int i=0; i<MAX_LAYERS; i++ ) {
 		InstrumentLayer* src_layer = instrument->get_layer( i );
 		InstrumentLayer* my_layer = this->get_layer( i );
+		Sample* sample = samples[i];
 		if( src_layer==0 ) {
-			if ( is_live )
-				AudioEngine::get_instance()->lock( RIGHT_HERE );
 			this->set_layer( NULL, i );
-			if ( is_live )
-				AudioEngine::get_instance()->unlock();
+			delete sample;
+		} else if ( sample==0 || sample->is_empty() ) {
+			_ERRORLOG( QString( "Error loading sample %1. Creating a new empty layer." ).arg( src_layer->get_sample()->get_filename() ) );
+			this->set_layer( NULL, i );
+			delete sample;
 		} else {
-			QString sample_path =  drumkit->get_path() + "/" + src_layer->get_sample()->get_filename();
-			Sample* sample = Sample::load( sample_path );
-			if ( sample==0 ) {
-				_ERRORLOG( QString( "Error loading sample %1. Creating a new empty layer." ).arg( sample_path ) );
-				if ( is_live )
-					AudioEngine::get_instance()->lock( RIGHT_HERE );
-				this->set_layer( NULL, i );
-				if ( is_live )
-					AudioEngine::get_instance()->unlock();
-			} else {
-				if ( is_live )
-					AudioEngine::get_instance()->lock( RIGHT_HERE );
-				this->set_layer( new InstrumentLayer( src_layer, sample ), i );
-				if ( is_live )
-					AudioEngine::get_instance()->unlock();
-			}
+			this->set_layer( new InstrumentLayer( src_layer, sample ), i );
+		}
+		if ( old_layers ) {
+			old_layers[i] = my_layer;
+		} else {
+			delete my_layer;
 		}
-		delete my_layer;
 	}
-	if ( is_live )
-		AudioEngine::get_instance()->lock( RIGHT_HERE );
 
 	this->set_id( instrument->get_id() );
 	this->set_name( instrument->get_name() );
@@ -182,8 +207,6 @@ void Instrument::load_from( Drumkit* drumkit, Instrument* instrument, bool is_li
 	this->set_hihat( instrument->is_hihat() );
 	this->set_lower_cc( instrument->get_lower_cc() );
 	this->set_higher_cc( instrument->get_higher_cc() );
-	if ( is_live )
-		AudioEngine::get_instance()->unlock();
 }
 
 void Instrument::load_from( const QString& dk_name, const QString& instrument_name, bool is_live )
@@ -244,11 +267,11 @@ Instrument* Instrument::load_from( XMLNode* node, const QString& dk_path, const
 	return instrument;
 }
 
-void Instrument::load_samples()
+void Instrument::load_samples( int head_frames, bool compact )
 {
 	for ( int i=0; i<MAX_LAYERS; i++ ) {
 		InstrumentLayer* layer = get_layer( i );
-		if( layer ) layer->load_sample( );
+		if( layer ) layer->load_sample( head_frames, compact );
 	}
 }
 
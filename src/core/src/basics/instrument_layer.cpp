@@ -63,9 +63,9 @@ InstrumentLayer::~InstrumentLayer()
 	__sample = 0;
 }
 
-void InstrumentLayer::load_sample()
+void InstrumentLayer::load_sample( int head_frames, bool compact )
 {
-	if( __sample ) __sample->load();
+	if( __sample ) __sample->load( head_frames, compact );
 }
 
 void InstrumentLayer::unload_sample()
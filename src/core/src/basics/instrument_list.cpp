@@ -24,6 +24,8 @@
 
 #include <hydrogen/helpers/xml.h>
 #include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/sample_loader.h>
 
 namespace H2Core
 {
@@ -49,11 +51,17 @@ InstrumentList::~InstrumentList()
 	}
 }
 
-void InstrumentList::load_samples()
+void InstrumentList::load_samples( int head_frames, bool compact )
 {
+	// the samples of every instrument are decoded together, spread over the cores
+	SampleLoader loader;
 	for( int i=0; i<__instruments.size(); i++ ) {
-		__instruments[i]->load_samples();
+		for ( int j=0; j<MAX_LAYERS; j++ ) {
+			InstrumentLayer* layer = __instruments[i]->get_layer( j );
+			if( layer && layer->get_sample() ) loader.add( layer->get_sample(), head_frames, compact );
+		}
 	}
+	loader.run();
 }
 
 void InstrumentList::unload_samples()
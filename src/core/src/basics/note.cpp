@@ -23,6 +23,8 @@
 #include <hydrogen/basics/note.h>
 
 #include <cassert>
+#include <cmath>
+#include <new>
 
 #include <hydrogen/helpers/xml.h>
 
@@ -36,7 +38,7 @@ namespace H2Core
 const char* Note::__class_name = "Note";
 const char* Note::__key_str[] = { "C", "Cs", "D", "Ef", "E", "F", "Fs", "G", "Af", "A", "Bf", "B" };
 
-Note::Note( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch )
+Note::Note( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch, ADSR* adsr )
 	: Object( __class_name ),
 	  __instrument( instrument ),
 	  __instrument_id( 0 ),
@@ -58,13 +60,15 @@ Note::Note( Instrument* instrument, int position, float velocity, float pan_l, f
 	  __bpfb_r( 0.0 ),
 	  __lpfb_l( 0.0 ),
 	  __lpfb_r( 0.0 ),
+	  __ratio_pitch( 0.0 ),
+	  __ratio( 1.0 ),
 	  __pattern_idx( 0 ),
 	  __midi_msg( -1 ),
 	  __note_off( false ),
 	  __just_recorded( false )
 {
 	if ( __instrument != 0 ) {
-		__adsr = __instrument->copy_adsr();
+		__adsr = adsr ? new ( adsr ) ADSR( __instrument->get_adsr() ) : __instrument->copy_adsr();
 		__instrument_id = __instrument->get_id();
 	}
 
@@ -72,7 +76,7 @@ Note::Note( Instrument* instrument, int position, float velocity, float pan_l, f
 	set_pan_r(pan_r);
 }
 
-Note::Note( Note* other, Instrument* instrument )
+Note::Note( Note* other, Instrument* instrument, ADSR* adsr )
 	: Object( __class_name ),
 	  __instrument( other->get_instrument() ),
 	  __instrument_id( 0 ),
@@ -94,6 +98,8 @@ Note::Note( Note* other, Instrument* instrument )
 	  __bpfb_r( other->get_bpfb_r() ),
 	  __lpfb_l( other->get_lpfb_l() ),
 	  __lpfb_r( other->get_lpfb_r() ),
+	  __ratio_pitch( 0.0 ),
+	  __ratio( 1.0 ),
 	  __pattern_idx( other->get_pattern_idx() ),
 	  __midi_msg( other->get_midi_msg() ),
 	  __note_off( other->get_note_off() ),
@@ -101,7 +107,7 @@ Note::Note( Note* other, Instrument* instrument )
 {
 	if ( instrument != 0 ) __instrument = instrument;
 	if ( __instrument != 0 ) {
-		__adsr = __instrument->copy_adsr();
+		__adsr = adsr ? new ( adsr ) ADSR( __instrument->get_adsr() ) : __instrument->copy_adsr();
 		__instrument_id = __instrument->get_id();
 	}
 }
@@ -139,6 +145,16 @@ void Note::set_pan_r( float pan )
 	__pan_r = check_boundary( pan, PAN_MIN, PAN_MAX );
 }
 
+float Note::get_pitch_ratio( float pitch )
+{
+	if ( pitch != __ratio_pitch ) {
+		//	constant^12 = 2, so constant = 2^(1/12) = 1.059463.
+		__ratio = pow( 1.0594630943593, ( double )pitch );
+		__ratio_pitch = pitch;
+	}
+	return __ratio;
+}
+
 void Note::map_instrument( InstrumentList* instruments )
 {
 	assert( instruments );
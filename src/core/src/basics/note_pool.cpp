@@ -0,0 +1,139 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/note_pool.h>
+
+#include <hydrogen/basics/adsr.h>
+#include <hydrogen/basics/note.h>
+
+#include <new>
+
+namespace H2Core
+{
+
+const char* NotePool::__class_name = "NotePool";
+
+NotePool::NotePool( int capacity ) : Object( __class_name ),
+	__free( 0 ),
+	__free_count( 0 ),
+	__capacity( capacity < 0 ? 0 : capacity ),
+	__allocations( 0 ),
+	__deletions( 0 )
+{
+	__free = new Note*[ __capacity ];
+	for ( int i = 0; i < __capacity; i++ ) {
+		Note* pNote = new Note( 0, 0, 0.0, 0.5, 0.5, -1, 0.0 );
+		pNote->__adsr = new ADSR();
+		__free[ __free_count++ ] = pNote;
+	}
+}
+
+NotePool::~NotePool()
+{
+	for ( int i = 0; i < __free_count; i++ ) {
+		delete __free[ i ];
+	}
+	delete[] __free;
+}
+
+void NotePool::set_capacity( int capacity )
+{
+	if ( capacity < 0 ) {
+		capacity = 0;
+	}
+	while ( __free_count > capacity ) {
+		delete __free[ --__free_count ];
+	}
+	Note** pFree = new Note*[ capacity ];
+	for ( int i = 0; i < __free_count; i++ ) {
+		pFree[ i ] = __free[ i ];
+	}
+	delete[] __free;
+	__free = pFree;
+
+	// preallocated like in the constructor, the notes in use come back later
+	int nAdded = capacity - __capacity;
+	__capacity = capacity;
+	for ( int i = 0; i < nAdded && __free_count < __capacity; i++ ) {
+		Note* pNote = new Note( 0, 0, 0.0, 0.5, 0.5, -1, 0.0 );
+		pNote->__adsr = new ADSR();
+		__free[ __free_count++ ] = pNote;
+	}
+}
+
+ADSR* NotePool::__recycle( Note* note )
+{
+	ADSR* pADSR = note->__adsr;
+	note->__adsr = 0;
+	note->~Note();
+	if ( pADSR ) {
+		pADSR->~ADSR();
+	}
+	return pADSR;
+}
+
+Note* NotePool::acquire( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch )
+{
+	if ( __free_count == 0 ) {
+		__allocations++;
+		return new Note( instrument, position, velocity, pan_l, pan_r, length, pitch );
+	}
+	Note* pNote = __free[ --__free_count ];
+	ADSR* pADSR = __recycle( pNote );
+	if ( pADSR && !instrument ) {
+		::operator delete( pADSR );
+		pADSR = 0;
+	}
+	return new ( pNote ) Note( instrument, position, velocity, pan_l, pan_r, length, pitch, pADSR );
+}
+
+Note* NotePool::acquire( Note* other, Instrument* instrument )
+{
+	if ( __free_count == 0 ) {
+		__allocations++;
+		return new Note( other, instrument );
+	}
+	Note* pNote = __free[ --__free_count ];
+	ADSR* pADSR = __recycle( pNote );
+	if ( pADSR && !instrument && !other->get_instrument() ) {
+		::operator delete( pADSR );
+		pADSR = 0;
+	}
+	return new ( pNote ) Note( other, instrument, pADSR );
+}
+
+void NotePool::release( Note* note )
+{
+	if ( note == 0 ) {
+		return;
+	}
+	if ( __free_count == __capacity ) {
+		__deletions++;
+		delete note;
+		return;
+	}
+	__free[ __free_count++ ] = note;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,229 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/note_queue.h>
+
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_pool.h>
+
+#include <cstring>
+
+namespace H2Core
+{
+
+const char* NoteQueue::__class_name = "NoteQueue";
+
+NoteQueue::NoteQueue( int capacity ) : Object( __class_name ),
+	__nodes( 0 ),
+	__capacity( capacity < 1 ? 1 : capacity ),
+	__free( 0 ),
+	__base( 0 ),
+	__last( 0 ),
+	__bucket_count( 0 ),
+	__later( -1 ),
+	__later_count( 0 ),
+	__max_advance( 0 )
+{
+	__nodes = new Node[ __capacity ];
+	for ( int i = 0; i < __capacity; i++ ) {
+		__nodes[ i ].next = i + 1 < __capacity ? i + 1 : -1;
+	}
+	for ( int i = 0; i < NOTE_QUEUE_BUCKETS; i++ ) {
+		__heads[ i ] = -1;
+	}
+}
+
+NoteQueue::~NoteQueue()
+{
+	delete[] __nodes;
+}
+
+void NoteQueue::reserve( int capacity )
+{
+	if ( capacity > __capacity ) {
+		__grow( capacity );
+	}
+}
+
+void NoteQueue::__grow( int capacity )
+{
+	Node* pNodes = new Node[ capacity ];
+	memcpy( pNodes, __nodes, __capacity * sizeof( Node ) );
+	// the new nodes go in front of the unused ones
+	for ( int i = __capacity; i < capacity; i++ ) {
+		pNodes[ i ].next = i + 1 < capacity ? i + 1 : __free;
+	}
+	delete[] __nodes;
+	__nodes = pNodes;
+	__free = __capacity;
+	__capacity = capacity;
+}
+
+int NoteQueue::__node()
+{
+	if ( __free == -1 ) {
+		// more notes than the note pool holds
+		__grow( 2 * __capacity );
+	}
+	int nNode = __free;
+	__free = __nodes[ nNode ].next;
+	return nNode;
+}
+
+void NoteQueue::__insert( int node )
+{
+	Note* pNote = __nodes[ node ].note;
+	int nTick = pNote->get_position();
+	if ( __bucket_count == 0 ) {
+		__base = __last = nTick;
+	} else if ( nTick < __base ) {
+		// the wheel turns back if it can, otherwise the note is late
+		// and due at once, it waits in the first bucket
+		if ( __last - nTick < NOTE_QUEUE_BUCKETS ) {
+			__base = nTick;
+		} else {
+			nTick = __base;
+		}
+	} else if ( nTick > __last ) {
+		__last = nTick;
+	}
+	int* pLink = &__heads[ nTick & ( NOTE_QUEUE_BUCKETS - 1 ) ];
+	while ( *pLink != -1 && __nodes[ *pLink ].note->get_humanize_delay() <= pNote->get_humanize_delay() ) {
+		pLink = &__nodes[ *pLink ].next;
+	}
+	__nodes[ node ].next = *pLink;
+	*pLink = node;
+	__bucket_count++;
+}
+
+void NoteQueue::push( Note* note )
+{
+	if ( empty() ) {
+		__base = note->get_position();
+		__max_advance = 0;
+	}
+	if ( -note->get_humanize_delay() > __max_advance ) {
+		__max_advance = -note->get_humanize_delay();
+	}
+
+	int nNode = __node();
+	__nodes[ nNode ].note = note;
+	if ( note->get_position() - __base >= NOTE_QUEUE_BUCKETS ) {
+		__nodes[ nNode ].next = __later;
+		__later = nNode;
+		__later_count++;
+	} else {
+		__insert( nNode );
+	}
+}
+
+void NoteQueue::__reach_later()
+{
+	if ( __bucket_count == 0 ) {
+		// nothing in the wheel, start it at the earliest late note
+		__base = __nodes[ __later ].note->get_position();
+		for ( int nNode = __nodes[ __later ].next; nNode != -1; nNode = __nodes[ nNode ].next ) {
+			if ( __nodes[ nNode ].note->get_position() < __base ) {
+				__base = __nodes[ nNode ].note->get_position();
+			}
+		}
+	}
+	int* pLink = &__later;
+	while ( *pLink != -1 ) {
+		int nNode = *pLink;
+		if ( __nodes[ nNode ].note->get_position() - __base < NOTE_QUEUE_BUCKETS ) {
+			*pLink = __nodes[ nNode ].next;
+			__later_count--;
+			__insert( nNode );
+		} else {
+			pLink = &__nodes[ nNode ].next;
+		}
+	}
+}
+
+int NoteQueue::pop_due( long long end_frame, float tick_size, Note** notes, int max )
+{
+	if ( __later_count != 0 ) {
+		__reach_later();
+	}
+
+	int nNotes = 0;
+	for ( int nTick = __base; nTick - __base < NOTE_QUEUE_BUCKETS && __bucket_count != 0; nTick++ ) {
+		// no note of this tick or a later one can start before end_frame,
+		// the first bucket also holds the notes queued late
+		if ( nTick != __base && ( long long )( nTick * tick_size ) - __max_advance >= end_frame ) {
+			break;
+		}
+		int* pLink = &__heads[ nTick & ( NOTE_QUEUE_BUCKETS - 1 ) ];
+		while ( *pLink != -1 ) {
+			int nNode = *pLink;
+			Note* pNote = __nodes[ nNode ].note;
+			// only a negative humanize delay moves the note start,
+			// the sampler handles the positive ones
+			long long nStart = ( long long )( pNote->get_position() * tick_size );
+			if ( pNote->get_humanize_delay() < 0 ) {
+				nStart += pNote->get_humanize_delay();
+			}
+			if ( nStart >= end_frame ) {
+				pLink = &__nodes[ nNode ].next;
+				continue;
+			}
+			if ( nNotes == max ) {
+				return nNotes;
+			}
+			notes[ nNotes++ ] = pNote;
+			*pLink = __nodes[ nNode ].next;
+			__nodes[ nNode ].next = __free;
+			__free = nNode;
+			__bucket_count--;
+		}
+	}
+
+	// the wheel starts at the first bucket still holding notes
+	while ( __bucket_count != 0 && __heads[ __base & ( NOTE_QUEUE_BUCKETS - 1 ) ] == -1 ) {
+		__base++;
+	}
+	return nNotes;
+}
+
+void NoteQueue::clear( NotePool* pool )
+{
+	for ( int i = 0; i < NOTE_QUEUE_BUCKETS + 1; i++ ) {
+		int* pHead = i < NOTE_QUEUE_BUCKETS ? &__heads[ i ] : &__later;
+		while ( *pHead != -1 ) {
+			int nNode = *pHead;
+			Note* pNote = __nodes[ nNode ].note;
+			pNote->get_instrument()->dequeue();
+			pool->release( pNote );
+			*pHead = __nodes[ nNode ].next;
+			__nodes[ nNode ].next = __free;
+			__free = nNode;
+		}
+	}
+	__bucket_count = 0;
+	__later_count = 0;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
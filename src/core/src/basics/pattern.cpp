@@ -23,6 +23,7 @@
 #include <hydrogen/basics/pattern.h>
 
 #include <cassert>
+#include <algorithm>
 
 #include <hydrogen/basics/note.h>
 #include <hydrogen/basics/pattern_list.h>
@@ -43,6 +44,7 @@ Pattern::Pattern( const QString& name, const QString& info, const QString& categ
 	, __name( name )
 	, __info( info )
 	, __category( category )
+	, __playback_changed( true )
 {
 }
 
@@ -52,10 +54,13 @@ Pattern::Pattern( Pattern* other )
 	, __name( other->get_name() )
 	, __info( other->get_info() )
 	, __category( other->get_category() )
+	, __playback_changed( true )
 {
 	FOREACH_NOTE_CST_IT_BEGIN_END( other->get_notes(),it ) {
 		__notes.insert( std::make_pair( it->first, new Note( it->second ) ) );
 	}
+	__playback_positions.reserve( __notes.size() );
+	__playback_notes.reserve( __notes.size() );
 }
 
 Pattern::~Pattern()
@@ -200,11 +205,47 @@ void Pattern::remove_note( Note* note )
 	for( notes_it_t it=__notes.begin(); it!=__notes.end(); ++it ) {
 		if( it->second==note ) {
 			__notes.erase( it );
+			__playback_changed = true;
 			break;
 		}
 	}
 }
 
+Note* const* Pattern::get_notes_at( int position, int* count )
+{
+	__playback_update();
+	std::vector<int>::const_iterator first = std::lower_bound( __playback_positions.begin(), __playback_positions.end(), position );
+	std::vector<int>::const_iterator last = first;
+	while ( last != __playback_positions.end() && *last == position ) {
+		++last;
+	}
+	*count = last - first;
+	if ( *count == 0 ) return 0;
+	return &__playback_notes[ first - __playback_positions.begin() ];
+}
+
+int Pattern::get_next_note_position( int position )
+{
+	__playback_update();
+	std::vector<int>::const_iterator next = std::upper_bound( __playback_positions.begin(), __playback_positions.end(), position );
+	if ( next == __playback_positions.end() ) return -1;
+	return *next;
+}
+
+void Pattern::__playback_update()
+{
+	// editors also erase from __notes directly, the size tells
+	if ( !__playback_changed && __playback_notes.size() == __notes.size() ) return;
+	__playback_positions.clear();
+	__playback_notes.clear();
+	// never over the capacity reserved by insert_note
+	for( notes_cst_it_t it=__notes.begin(); it!=__notes.end(); it++ ) {
+		__playback_positions.push_back( it->first );
+		__playback_notes.push_back( it->second );
+	}
+	__playback_changed = false;
+}
+
 bool Pattern::references( Instrument* instr )
 {
 	for( notes_cst_it_t it=__notes.begin(); it!=__notes.end(); it++ ) {
@@ -231,6 +272,7 @@ void Pattern::purge_instrument( Instrument* instr )
 			}
 			slate.push_back( note );
 			__notes.erase( it++ );
+			__playback_changed = true;
 		} else {
             ++it;
         }
@@ -22,7 +22,8 @@
 
 #include <hydrogen/basics/sample.h>
 
-#include <limits>
+#include <cstdlib>
+#include <new>
 
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/Preferences.h>
@@ -47,9 +48,13 @@ static RubberBand::RubberBandStretcher::Options compute_rubberband_options( cons
 Sample::Sample( const QString& filepath,  int frames, int sample_rate, float* data_l, float* data_r ) : Object( __class_name ),
 	__filepath( filepath ),
 	__frames( frames ),
+	__data_frames( frames ),
 	__sample_rate( sample_rate ),
 	__data_l( data_l ),
 	__data_r( data_r ),
+	__pcm_l( 0 ),
+	__pcm_r( 0 ),
+	__cached( 0 ),
 	__is_modified( false )
 {
 	/*
@@ -65,17 +70,34 @@ Sample::Sample( const QString& filepath,  int frames, int sample_rate, float* da
 Sample::Sample( Sample* other ): Object( __class_name ),
 	__filepath( other->get_filepath() ),
 	__frames( other->get_frames() ),
+	__data_frames( other->get_data_frames() ),
 	__sample_rate( other->get_sample_rate() ),
 	__data_l( 0 ),
 	__data_r( 0 ),
+	__pcm_l( 0 ),
+	__pcm_r( 0 ),
+	__cached( 0 ),
 	__is_modified( other->get_is_modified() ),
 	__loops( other->__loops ),
 	__rubberband( other->__rubberband )
 {
-	__data_l = new float[__frames];
-	__data_r = new float[__frames];
-	memcpy( __data_l, other->get_data_l(), __frames );
-	memcpy( __data_r, other->get_data_r(), __frames );
+	// a streamed sample copy streams the same file
+	if ( other->__cached ) {
+		__cached = SampleCache::get_instance()->share( other->__cached );
+		__data_l = other->get_data_l();
+		__data_r = other->get_data_r();
+		__pcm_l = other->__pcm_l;
+		__pcm_r = other->__pcm_r;
+	} else if ( other->get_data_l() ) {
+		__data_l = alloc_data( __data_frames );
+		memcpy( __data_l, other->get_data_l(), __data_frames * sizeof( float ) );
+		if ( other->is_mono() ) {
+			__data_r = __data_l;
+		} else {
+			__data_r = alloc_data( __data_frames );
+			memcpy( __data_r, other->get_data_r(), __data_frames * sizeof( float ) );
+		}
+	}
 	EnvelopePoint pt;
 	PanEnvelope* pan = other->get_pan_envelope();
 	for( int i=0; i<pan->size(); i++ ) __pan_envelope.push_back( pan->at( i ) );
@@ -86,18 +108,92 @@ Sample::Sample( Sample* other ): Object( __class_name ),
 
 Sample::~Sample()
 {
-	if( __data_l!=0 ) delete[] __data_l;
-	if( __data_r!=0 ) delete[] __data_r;
+	__release_data();
+}
+
+void Sample::__release_data()
+{
+	if( __cached ) {
+		SampleCache::get_instance()->release( __cached );
+		__cached = 0;
+	} else {
+		if( __data_r!=__data_l ) free_data( __data_r );
+		free_data( __data_l );
+	}
+	__data_l = __data_r = 0;
+	__pcm_l = __pcm_r = 0;
+}
+
+void Sample::__own_data()
+{
+	if( !__cached && !is_mono() ) return;
+	float* data_l = alloc_data( __data_frames );
+	float* data_r = alloc_data( __data_frames );
+	if( is_compact() ) {
+		for( int i=0; i<__data_frames; i++ ) {
+			data_l[i] = get_frame_l( i );
+			data_r[i] = get_frame_r( i );
+		}
+	} else {
+		memcpy( data_l, __data_l, __data_frames * sizeof( float ) );
+		memcpy( data_r, __data_r, __data_frames * sizeof( float ) );
+	}
+	__release_data();
+	__data_l = data_l;
+	__data_r = data_r;
+}
+
+/** allocate aligned frames surrounded by silent guard frames, see Sample::alloc_data */
+static char* alloc_frames( int frames, size_t frame_bytes )
+{
+	// the block starts with the pointer to free, then the front guard frames
+	const size_t guard = SAMPLE_GUARD_FRAMES * frame_bytes;
+	size_t bytes = sizeof( void* ) + SAMPLE_ALIGNMENT + guard + frames * frame_bytes + guard;
+	char* block = ( char* )malloc( bytes );
+	if ( block==0 ) throw std::bad_alloc();
+	size_t first = ( size_t )( block + sizeof( void* ) + guard );
+	char* data = ( char* )( ( first + SAMPLE_ALIGNMENT - 1 ) & ~( size_t )( SAMPLE_ALIGNMENT - 1 ) );
+	( ( char** )( data - guard ) )[ -1 ] = block;
+	memset( data - guard, 0, guard );
+	memset( data + frames * frame_bytes, 0, guard );
+	return data;
 }
 
-Sample* Sample::load( const QString& filepath )
+/** free frames allocated by alloc_frames */
+static void free_frames( char* data, size_t frame_bytes )
+{
+	if ( data==0 ) return;
+	free( ( ( char** )( data - SAMPLE_GUARD_FRAMES * frame_bytes ) )[ -1 ] );
+}
+
+float* Sample::alloc_data( int frames )
+{
+	return ( float* )alloc_frames( frames, sizeof( float ) );
+}
+
+void Sample::free_data( float* data )
+{
+	free_frames( ( char* )data, sizeof( float ) );
+}
+
+short* Sample::alloc_pcm( int frames )
+{
+	return ( short* )alloc_frames( frames, sizeof( short ) );
+}
+
+void Sample::free_pcm( short* data )
+{
+	free_frames( ( char* )data, sizeof( short ) );
+}
+
+Sample* Sample::load( const QString& filepath, int head_frames, bool compact )
 {
 	if( !Filesystem::file_readable( filepath ) ) {
 		ERRORLOG( QString( "Unable to read %1" ).arg( filepath ) );
 		return 0;
 	}
 	Sample* sample = new Sample( filepath );
-	sample->load();
+	sample->load( head_frames, compact );
 	return sample;
 }
 
@@ -111,6 +207,12 @@ Sample* Sample::load( const QString& filepath, const Loops& loops, const Rubberb
 
 void Sample::apply( const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan )
 {
+	if( is_streamed() ) {
+		ERRORLOG( QString( "%1 is streamed, it can't be modified" ).arg( __filepath ) );
+		return;
+	}
+	// the transformations work on float frames
+	if( is_compact() ) __own_data();
 	apply_loops( loops );
 	apply_velocity( velocity );
 	apply_pan( pan );
@@ -121,46 +223,21 @@ void Sample::apply( const Loops& loops, const Rubberband& rubber, const Velocity
 #endif
 }
 
-void Sample::load()
+void Sample::load( int head_frames, bool compact )
 {
-	SF_INFO sound_info;
-	SNDFILE* file = sf_open( __filepath.toLocal8Bit(), SFM_READ, &sound_info );
-	if ( !file ) {
-		ERRORLOG( QString( "[Sample::load] Error loading file %1" ).arg( __filepath ) );
-		return;
-	}
-	if ( sound_info.channels > SAMPLE_CHANNELS ) {
-		WARNINGLOG( QString( "can't handle %1 channels, only 2 will be used" ).arg( sound_info.channels ) );
-		sound_info.channels = SAMPLE_CHANNELS;
-	}
-	if ( sound_info.frames > ( std::numeric_limits<int>::max()/sound_info.channels ) ) {
-		WARNINGLOG( QString( "sample frames count (%1) and channels (%2) are too much, truncate it." ).arg( sound_info.frames ).arg( sound_info.channels ) );
-		sound_info.frames = ( std::numeric_limits<int>::max()/sound_info.channels );
-	}
-
-	float* buffer = new float[ sound_info.frames * sound_info.channels ];
-	//memset( buffer, 0, sound_info.frames *sound_info.channels );
-	sf_count_t count = sf_read_float( file, buffer, sound_info.frames * sound_info.channels );
-	sf_close( file );
-	if( count==0 ) WARNINGLOG( QString( "%1 is an empty sample" ).arg( __filepath ) );
+	SampleCache::Entry* entry = SampleCache::get_instance()->acquire( __filepath, head_frames, compact );
+	if ( !entry ) return;
 
 	unload();
 
-	__data_l = new float[ sound_info.frames ];
-	__data_r = new float[ sound_info.frames ];
-	__frames = sound_info.frames;
-	__sample_rate = sound_info.samplerate;
-
-	if ( sound_info.channels == 1 ) {
-		memcpy( __data_l, buffer, __frames * sizeof( float ) );
-		memcpy( __data_r, buffer, __frames * sizeof( float ) );
-	} else if ( sound_info.channels == SAMPLE_CHANNELS ) {
-		for ( int i = 0; i < __frames; i++ ) {
-			__data_l[i] = buffer[i * SAMPLE_CHANNELS];
-			__data_r[i] = buffer[i * SAMPLE_CHANNELS + 1];
-		}
-	}
-	delete[] buffer;
+	__cached = entry;
+	__data_l = entry->data_l;
+	__data_r = entry->data_r;
+	__pcm_l = entry->pcm_l;
+	__pcm_r = entry->pcm_r;
+	__frames = entry->frames;
+	__data_frames = entry->data_frames;
+	__sample_rate = entry->sample_rate;
 }
 
 bool Sample::apply_loops( const Loops& lo )
@@ -193,8 +270,8 @@ bool Sample::apply_loops( const Loops& lo )
 	int loop_length =  lo.end_frame - lo.loop_frame;
 	int new_length = full_length + loop_length * lo.count;
 
-	float* new_data_l = new float[ new_length ];
-	float* new_data_r = new float[ new_length ];
+	float* new_data_l = alloc_data( new_length );
+	float* new_data_r = alloc_data( new_length );
 
 	// copy full_length frames to new_data
 	if ( lo.mode==Loops::REVERSE && ( lo.count==0 || full_loop ) ) {
@@ -237,11 +314,10 @@ bool Sample::apply_loops( const Loops& lo )
 		assert( x==new_length );
 	}
 	__loops = lo;
-	delete [] __data_l;
-	delete [] __data_r;
+	__release_data();
 	__data_l = new_data_l;
 	__data_r = new_data_r;
-	__frames = new_length;
+	__frames = __data_frames = new_length;
 	__is_modified = true;
 	return true;
 }
@@ -255,6 +331,7 @@ void Sample::apply_velocity( const VelocityEnvelope& v )
 	if( v.empty() && __velocity_envelope.empty() ) return;
 	__velocity_envelope.clear();
 	if ( v.size() > 0 ) {
+		__own_data();
 		float inv_resolution = __frames / 841.0F;
 		for ( int i = 1; i < v.size(); i++ ) {
 			float y = ( 91 - v[i - 1].value ) / 91.0F;
@@ -281,6 +358,7 @@ void Sample::apply_pan( const PanEnvelope& p )
 	if( p.empty() && __pan_envelope.empty() ) return;
 	__pan_envelope.clear();
 	if ( p.size() > 0 ) {
+		__own_data();
 		float inv_resolution = __frames / 841.0F;
 		for ( int i = 1; i < p.size(); i++ ) {
 			float y = ( 45 - p[i - 1].value ) / 45.0F;
@@ -412,17 +490,16 @@ void Sample::apply_rubberband( const Rubberband& rb )
 
 	// DEBUGLOG( QString( "%1 frames processed, %2 frames retrieved" ).arg( __frames ).arg( retrieved ) );
 	// final data buffers
-	delete [] __data_l;
-	delete [] __data_r;
-	__data_l = new float[ retrieved ];
-	__data_r = new float[ retrieved ];
+	__release_data();
+	__data_l = alloc_data( retrieved );
+	__data_r = alloc_data( retrieved );
 	memcpy( __data_l, out_data_l, retrieved*sizeof( float ) );
 	memcpy( __data_r, out_data_r, retrieved*sizeof( float ) );
 	delete [] out_data_l;
 	delete [] out_data_r;
 	// update sample
 	__rubberband = rb;
-	__frames = retrieved;
+	__frames = __data_frames = retrieved;
 	__is_modified = true;
 #endif
 }
@@ -483,7 +560,9 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
 //			_INFOLOG("remove outfile");
 		if( QFile( rubberResultPath ).remove() );
 //			_INFOLOG("remove rubberResultFile");
-		__frames = rubberbanded->get_frames();
+		rubberbanded->__own_data();
+		__release_data();
+		__frames = __data_frames = rubberbanded->get_frames();
 		__data_l = rubberbanded->get_data_l();
 		__data_r = rubberbanded->get_data_r();
 		rubberbanded->__data_l = 0;
@@ -506,10 +585,14 @@ Sample::Loops::LoopMode Sample::parse_loop_mode( const QString& string )
 
 bool Sample::write( const QString& path, int format )
 {
+	if( is_streamed() ) {
+		ERRORLOG( QString( "%1 is streamed, copy the file instead" ).arg( __filepath ) );
+		return false;
+	}
 	float* obuf = new float[ SAMPLE_CHANNELS * __frames ];
 	for ( int i = 0; i < __frames; ++i ) {
-		float value_l = __data_l[i];
-		float value_r = __data_r[i];
+		float value_l = get_frame_l( i );
+		float value_r = get_frame_r( i );
 		if ( value_l > 1.f ) value_l = 1.f;
 		else if ( value_l < -1.f ) value_l = -1.f;
 		else if ( value_r > 1.f ) value_r = 1.f;
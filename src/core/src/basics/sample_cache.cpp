@@ -0,0 +1,403 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <hydrogen/basics/sample_cache.h>
+
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/helpers/filesystem.h>
+
+#include <QDir>
+
+#include <cmath>
+#include <limits>
+#include <sndfile.h>
+#include <utime.h>
+
+namespace H2Core
+{
+
+/** first bytes of a disk cache file */
+static const char DISK_MAGIC[ 4 ] = { 'H', '2', 'S', 'C' };
+/** the files of the disk cache */
+static const char* DISK_FILTER = "*.h2sc";
+/** bumped when the disk cache layout changes */
+static const int DISK_VERSION = 3;
+
+/** what precedes the file path and the frames in a disk cache file */
+struct DiskHeader {
+	char magic[ 4 ];            ///< DISK_MAGIC
+	int version;                ///< DISK_VERSION
+	long long modified;         ///< modification time of the decoded file
+	long long size;             ///< size of the decoded file
+	int frames;                 ///< frames of each channel
+	int sample_rate;            ///< sample rate of the decoded file
+	int channels;               ///< 1 if only the left frames follow, the file being mono
+	int path_length;            ///< bytes of the utf8 file path following the header
+};
+
+/** round and clip float frames to 16 bit frames, see Sample::alloc_pcm */
+static short* to_pcm( const float* data, int frames )
+{
+	short* pcm = Sample::alloc_pcm( frames );
+	for ( int i = 0; i < frames; i++ ) {
+		float value = data[i] / SAMPLE_PCM16_SCALE;
+		if ( value > 32767.f ) value = 32767.f;
+		else if ( value < -32768.f ) value = -32768.f;
+		pcm[i] = ( short )lrintf( value );
+	}
+	return pcm;
+}
+
+SampleCache* SampleCache::__instance = NULL;
+const char* SampleCache::__class_name = "SampleCache";
+
+void SampleCache::create_instance()
+{
+	if ( __instance == 0 ) {
+		__instance = new SampleCache;
+	}
+}
+
+SampleCache::SampleCache() : Object( __class_name ), __disk_limit( SAMPLE_CACHE_DISK_SIZE * 1024LL * 1024LL )
+{
+	pthread_mutex_init( &__mutex, 0 );
+	pthread_mutex_init( &__disk_mutex, 0 );
+}
+
+SampleCache::~SampleCache()
+{
+	if ( !__entries.empty() ) {
+		WARNINGLOG( QString( "%1 files still in use" ).arg( __entries.size() ) );
+	}
+	pthread_mutex_destroy( &__disk_mutex );
+	pthread_mutex_destroy( &__mutex );
+	__instance = NULL;
+}
+
+SampleCache::Entry* SampleCache::acquire( const QString& filepath, int head_frames, bool compact )
+{
+	QFileInfo info( filepath );
+	long long modified = info.lastModified().toTime_t();
+	long long size = info.size();
+	QString key = QString( "%1|%2|%3|%4|%5" ).arg( filepath ).arg( head_frames ).arg( compact ? "pcm16" : "float" ).arg( modified ).arg( size );
+
+	pthread_mutex_lock( &__mutex );
+	std::map<QString, Entry*>::iterator it = __entries.find( key );
+	if ( it != __entries.end() ) {
+		Entry* entry = it->second;
+		entry->refs++;
+		pthread_mutex_unlock( &__mutex );
+		return entry;
+	}
+	pthread_mutex_unlock( &__mutex );
+
+	// decoded unlocked, the sample loader decodes several files at once
+	Entry* entry = __decode( filepath, head_frames, modified, size );
+	if ( entry == 0 ) {
+		return 0;
+	}
+	if ( compact ) {
+		__compact( entry );
+	}
+	entry->key = key;
+
+	pthread_mutex_lock( &__mutex );
+	it = __entries.find( key );
+	if ( it != __entries.end() ) {
+		// decoded meanwhile by another thread
+		__free( entry );
+		entry = it->second;
+	} else {
+		__entries[ key ] = entry;
+	}
+	entry->refs++;
+	pthread_mutex_unlock( &__mutex );
+	return entry;
+}
+
+SampleCache::Entry* SampleCache::share( Entry* entry )
+{
+	pthread_mutex_lock( &__mutex );
+	entry->refs++;
+	pthread_mutex_unlock( &__mutex );
+	return entry;
+}
+
+void SampleCache::release( Entry* entry )
+{
+	pthread_mutex_lock( &__mutex );
+	if ( --entry->refs > 0 ) {
+		entry = 0;
+	} else {
+		__entries.erase( entry->key );
+	}
+	pthread_mutex_unlock( &__mutex );
+	if ( entry ) {
+		__free( entry );
+	}
+}
+
+int SampleCache::get_size()
+{
+	pthread_mutex_lock( &__mutex );
+	int size = __entries.size();
+	pthread_mutex_unlock( &__mutex );
+	return size;
+}
+
+long long SampleCache::get_bytes()
+{
+	long long bytes = 0;
+	pthread_mutex_lock( &__mutex );
+	for ( std::map<QString, Entry*>::iterator it = __entries.begin(); it != __entries.end(); ++it ) {
+		Entry* entry = it->second;
+		if ( entry->pcm_l ) {
+			bytes += ( entry->pcm_r == entry->pcm_l ? 1 : 2 ) * ( long long )entry->data_frames * sizeof( short );
+		} else {
+			bytes += ( entry->data_r == entry->data_l ? 1 : 2 ) * ( long long )entry->data_frames * sizeof( float );
+		}
+	}
+	pthread_mutex_unlock( &__mutex );
+	return bytes;
+}
+
+void SampleCache::set_disk_limit( long long bytes )
+{
+	pthread_mutex_lock( &__disk_mutex );
+	__disk_limit = bytes;
+	pthread_mutex_unlock( &__disk_mutex );
+	__evict_disk( bytes );
+}
+
+long long SampleCache::get_disk_limit()
+{
+	pthread_mutex_lock( &__disk_mutex );
+	long long bytes = __disk_limit;
+	pthread_mutex_unlock( &__disk_mutex );
+	return bytes;
+}
+
+long long SampleCache::get_disk_bytes()
+{
+	long long bytes = 0;
+	QFileInfoList files = QDir( Filesystem::samples_cache_dir() ).entryInfoList( QStringList( DISK_FILTER ), QDir::Files );
+	for ( int i = 0; i < files.size(); i++ ) {
+		bytes += files[i].size();
+	}
+	return bytes;
+}
+
+SampleCache::Entry* SampleCache::__decode( const QString& filepath, int head_frames, long long modified, long long size )
+{
+	bool disk = get_disk_limit() > 0;
+	if ( head_frames == 0 && disk ) {
+		Entry* entry = __read_disk( filepath, modified, size );
+		if ( entry ) {
+			return entry;
+		}
+	}
+
+	SF_INFO sound_info;
+	SNDFILE* file = sf_open( filepath.toLocal8Bit(), SFM_READ, &sound_info );
+	if ( !file ) {
+		ERRORLOG( QString( "Error loading file %1" ).arg( filepath ) );
+		return 0;
+	}
+	if ( sound_info.channels > SAMPLE_CHANNELS ) {
+		WARNINGLOG( QString( "can't handle %1 channels, only 2 will be used" ).arg( sound_info.channels ) );
+	}
+	if ( sound_info.frames > ( std::numeric_limits<int>::max()/sound_info.channels ) ) {
+		WARNINGLOG( QString( "sample frames count (%1) and channels (%2) are too much, truncate it." ).arg( sound_info.frames ).arg( sound_info.channels ) );
+		sound_info.frames = ( std::numeric_limits<int>::max()/sound_info.channels );
+	}
+
+	// the frames past the head are streamed
+	int data_frames = sound_info.frames;
+	if ( head_frames > 0 && head_frames < data_frames ) {
+		data_frames = head_frames;
+	}
+
+	Entry* entry = new Entry;
+	entry->data_l = Sample::alloc_data( data_frames );
+	entry->pcm_l = entry->pcm_r = 0;
+	entry->frames = sound_info.frames;
+	entry->data_frames = data_frames;
+	entry->sample_rate = sound_info.samplerate;
+	entry->refs = 0;
+
+	sf_count_t count;
+	if ( sound_info.channels == 1 ) {
+		// both sides play the same frames
+		count = sf_readf_float( file, entry->data_l, data_frames );
+		memset( entry->data_l + count, 0, ( data_frames - count ) * sizeof( float ) );
+		entry->data_r = entry->data_l;
+	} else {
+		float* buffer = new float[ data_frames * sound_info.channels ];
+		count = sf_readf_float( file, buffer, data_frames );
+		memset( buffer + count * sound_info.channels, 0, ( data_frames - count ) * sound_info.channels * sizeof( float ) );
+		entry->data_r = Sample::alloc_data( data_frames );
+		for ( int i = 0; i < data_frames; i++ ) {
+			entry->data_l[i] = buffer[i * sound_info.channels];
+			entry->data_r[i] = buffer[i * sound_info.channels + 1];
+		}
+		delete[] buffer;
+	}
+	sf_close( file );
+	if( count==0 ) WARNINGLOG( QString( "%1 is an empty sample" ).arg( filepath ) );
+
+	// reading the raw frames back beats decoding them again
+	int type = sound_info.format & SF_FORMAT_TYPEMASK;
+	if ( head_frames == 0 && disk && ( type == SF_FORMAT_FLAC || type == SF_FORMAT_OGG ) ) {
+		__write_disk( filepath, modified, size, entry );
+	}
+	return entry;
+}
+
+QString SampleCache::__disk_path( const QString& filepath )
+{
+	return Filesystem::samples_cache_dir() + "/" + QString::number( qHash( filepath ), 16 ) + ".h2sc";
+}
+
+SampleCache::Entry* SampleCache::__read_disk( const QString& filepath, long long modified, long long size )
+{
+	QFile file( __disk_path( filepath ) );
+	if ( !file.open( QIODevice::ReadOnly ) ) {
+		return 0;
+	}
+	// another file may hash the same, or the file may have changed
+	DiskHeader header;
+	QByteArray path = filepath.toUtf8();
+	if ( file.read( ( char* )&header, sizeof( header ) ) != sizeof( header )
+		 || memcmp( header.magic, DISK_MAGIC, sizeof( DISK_MAGIC ) ) != 0
+		 || header.version != DISK_VERSION
+		 || header.modified != modified
+		 || header.size != size
+		 || header.path_length != path.size()
+		 || file.read( header.path_length ) != path
+		 || ( header.channels != 1 && header.channels != 2 )
+		 || file.size() != ( qint64 )( sizeof( header ) + header.path_length + header.channels * ( qint64 )header.frames * sizeof( float ) ) ) {
+		return 0;
+	}
+
+	Entry* entry = new Entry;
+	entry->data_l = Sample::alloc_data( header.frames );
+	entry->data_r = header.channels == 1 ? entry->data_l : Sample::alloc_data( header.frames );
+	entry->pcm_l = entry->pcm_r = 0;
+	entry->frames = header.frames;
+	entry->data_frames = header.frames;
+	entry->sample_rate = header.sample_rate;
+	entry->refs = 0;
+	qint64 bytes = ( qint64 )header.frames * sizeof( float );
+	if ( file.read( ( char* )entry->data_l, bytes ) != bytes
+		 || ( header.channels == 2 && file.read( ( char* )entry->data_r, bytes ) != bytes ) ) {
+		ERRORLOG( QString( "Error reading %1" ).arg( file.fileName() ) );
+		__free( entry );
+		return 0;
+	}
+	file.close();
+	// the modification time of the cache file orders the evictions
+	utime( file.fileName().toLocal8Bit(), 0 );
+	INFOLOG( QString( "%1 read from the disk cache" ).arg( filepath ) );
+	return entry;
+}
+
+void SampleCache::__write_disk( const QString& filepath, long long modified, long long size, Entry* entry )
+{
+	static int written = 0;
+	QString disk_path = __disk_path( filepath );
+	// written aside then renamed, two threads may decode the same file
+	QString tmp_path = QString( "%1.%2" ).arg( disk_path ).arg( __sync_fetch_and_add( &written, 1 ) );
+
+	DiskHeader header;
+	memcpy( header.magic, DISK_MAGIC, sizeof( DISK_MAGIC ) );
+	header.version = DISK_VERSION;
+	header.modified = modified;
+	header.size = size;
+	header.frames = entry->frames;
+	header.sample_rate = entry->sample_rate;
+	header.channels = entry->data_r == entry->data_l ? 1 : 2;
+	QByteArray path = filepath.toUtf8();
+	header.path_length = path.size();
+
+	QFile file( tmp_path );
+	if ( !file.open( QIODevice::WriteOnly ) ) {
+		WARNINGLOG( QString( "Unable to write %1" ).arg( tmp_path ) );
+		return;
+	}
+	qint64 bytes = ( qint64 )entry->frames * sizeof( float );
+	bool ok = file.write( ( const char* )&header, sizeof( header ) ) == sizeof( header )
+			  && file.write( path ) == path.size()
+			  && file.write( ( const char* )entry->data_l, bytes ) == bytes
+			  && ( header.channels == 1 || file.write( ( const char* )entry->data_r, bytes ) == bytes );
+	file.close();
+	if ( ok ) {
+		QFile::remove( disk_path );
+		QFile::rename( tmp_path, disk_path );
+	} else {
+		WARNINGLOG( QString( "Unable to write %1" ).arg( tmp_path ) );
+	}
+	// left over if another thread renamed its copy first
+	QFile::remove( tmp_path );
+
+	__evict_disk( get_disk_limit() );
+}
+
+void SampleCache::__evict_disk( long long limit )
+{
+	pthread_mutex_lock( &__disk_mutex );
+	// oldest first, reading a file back touches it
+	QFileInfoList files = QDir( Filesystem::samples_cache_dir() ).entryInfoList( QStringList( DISK_FILTER ), QDir::Files, QDir::Time | QDir::Reversed );
+	long long bytes = 0;
+	for ( int i = 0; i < files.size(); i++ ) {
+		bytes += files[i].size();
+	}
+	for ( int i = 0; i < files.size() && bytes > limit; i++ ) {
+		if ( QFile::remove( files[i].absoluteFilePath() ) ) {
+			bytes -= files[i].size();
+		}
+	}
+	pthread_mutex_unlock( &__disk_mutex );
+}
+
+void SampleCache::__compact( Entry* entry )
+{
+	// narrowed from the floats, libsndfile would scale the float files to their own peak
+	entry->pcm_l = to_pcm( entry->data_l, entry->data_frames );
+	entry->pcm_r = ( entry->data_r == entry->data_l ) ? entry->pcm_l : to_pcm( entry->data_r, entry->data_frames );
+	if ( entry->data_r != entry->data_l ) Sample::free_data( entry->data_r );
+	Sample::free_data( entry->data_l );
+	entry->data_l = entry->data_r = 0;
+}
+
+void SampleCache::__free( Entry* entry )
+{
+	if ( entry->data_r != entry->data_l ) Sample::free_data( entry->data_r );
+	Sample::free_data( entry->data_l );
+	if ( entry->pcm_r != entry->pcm_l ) Sample::free_pcm( entry->pcm_r );
+	Sample::free_pcm( entry->pcm_l );
+	delete entry;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,146 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <hydrogen/basics/sample_loader.h>
+
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/event_queue.h>
+
+#include <algorithm>
+
+namespace H2Core
+{
+
+const char* SampleLoader::__class_name = "SampleLoader";
+
+SampleLoader::SampleLoader( bool progress_events ) : Object( __class_name ),
+	__progress_events( progress_events ),
+	__next( 0 ),
+	__done( 0 ),
+	__running( 0 ),
+	__percent( -1 ),
+	__cancel( false )
+{
+}
+
+SampleLoader::~SampleLoader()
+{
+	cancel();
+	wait();
+}
+
+void SampleLoader::add( Sample* sample, int head_frames, bool compact )
+{
+	assert( __workers.empty() );
+	Job job;
+	job.sample = sample;
+	job.head_frames = head_frames;
+	job.compact = compact;
+	__jobs.push_back( job );
+}
+
+void SampleLoader::start()
+{
+	assert( __workers.empty() );
+	__next = 0;
+	__done = 0;
+	__percent = -1;
+	__cancel = false;
+	if ( __progress_events ) {
+		__percent = 0;
+		EventQueue::get_instance()->push_event( EVENT_PROGRESS, 0 );
+	}
+	if ( __jobs.empty() ) {
+		if ( __progress_events ) {
+			EventQueue::get_instance()->push_event( EVENT_PROGRESS, 100 );
+		}
+		return;
+	}
+
+	// decoding is mostly cpu bound, flac above all
+	int nThreads = std::min( QThread::idealThreadCount(), ( int )__jobs.size() );
+	if ( nThreads < 1 ) nThreads = 1;
+	INFOLOG( QString( "loading %1 samples on %2 threads" ).arg( __jobs.size() ).arg( nThreads ) );
+
+	__running = nThreads;
+	__workers.resize( nThreads );
+	for ( int i = 0; i < nThreads; i++ ) {
+		pthread_create( &__workers[ i ], 0, __worker_main, this );
+	}
+}
+
+bool SampleLoader::wait()
+{
+	for ( unsigned i = 0; i < __workers.size(); i++ ) {
+		pthread_join( __workers[ i ], 0 );
+	}
+	__workers.clear();
+	return !__cancel;
+}
+
+bool SampleLoader::run()
+{
+	start();
+	return wait();
+}
+
+void SampleLoader::cancel()
+{
+	__cancel = true;
+}
+
+void* SampleLoader::__worker_main( void* param )
+{
+	SampleLoader* pLoader = ( SampleLoader* )param;
+	int nJobs = pLoader->__jobs.size();
+
+	while ( !pLoader->__cancel ) {
+		int nJob = __sync_fetch_and_add( &pLoader->__next, 1 );
+		if ( nJob >= nJobs ) {
+			break;
+		}
+		Job& job = pLoader->__jobs[ nJob ];
+		job.sample->load( job.head_frames, job.compact );
+
+		int nDone = __sync_add_and_fetch( &pLoader->__done, 1 );
+		if ( pLoader->__progress_events ) {
+			// the worker raising the percentage pushes it
+			int nPercent = nDone * 100 / nJobs;
+			int nLast = pLoader->__percent;
+			while ( nPercent > nLast ) {
+				if ( __sync_bool_compare_and_swap( &pLoader->__percent, nLast, nPercent ) ) {
+					EventQueue::get_instance()->push_event( EVENT_PROGRESS, nPercent );
+					break;
+				}
+				nLast = pLoader->__percent;
+			}
+		}
+	}
+
+	__sync_sub_and_fetch( &pLoader->__running, 1 );
+	return 0;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
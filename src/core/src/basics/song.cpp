@@ -32,6 +32,8 @@
 #include <hydrogen/globals.h>
 #include <hydrogen/basics/song.h>
 #include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_loader.h>
+#include <hydrogen/basics/drumkit.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
@@ -52,6 +54,7 @@ namespace H2Core
 {
 
 const char* Song::__class_name = "Song";
+unsigned Song::__last_pattern_generation = 0;
 
 Song::Song( const QString& name, const QString& author, float bpm, float volume )
 	: Object( __class_name )
@@ -71,6 +74,8 @@ Song::Song( const QString& name, const QString& author, float bpm, float volume
 	, __humanize_time_value( 0.0 )
 	, __humanize_velocity_value( 0.0 )
 	, __swing_factor( 0.0 )
+	, __random_seed( 0 )
+	, __pattern_generation( ++__last_pattern_generation )
 	, __song_mode( PATTERN_MODE )
 {
 	INFOLOG( QString( "INIT '%1'" ).arg( __name ) );
@@ -405,6 +410,7 @@ Song* SongReader::readSong( const QString& filename )
 	float fHumanizeTimeValue = LocalFileMng::readXmlFloat( songNode, "humanize_time", 0.0 );
 	float fHumanizeVelocityValue = LocalFileMng::readXmlFloat( songNode, "humanize_velocity", 0.0 );
 	float fSwingFactor = LocalFileMng::readXmlFloat( songNode, "swing_factor", 0.0 );
+	unsigned nRandomSeed = LocalFileMng::readXmlInt( songNode, "random_seed", 0, false, false );
 
 	song = new Song( sName, sAuthor, fBpm, fVolume );
 	song->set_metronome_volume( fMetronomeVolume );
@@ -415,6 +421,7 @@ Song* SongReader::readSong( const QString& filename )
 	song->set_humanize_time_value( fHumanizeTimeValue );
 	song->set_humanize_velocity_value( fHumanizeVelocityValue );
 	song->set_swing_factor( fSwingFactor );
+	song->set_random_seed( nRandomSeed );
 
 	/*
 	song->m_bDelayFXEnabled = LocalFileMng::readXmlBool( songNode, "delayFXEnabled", false, false );
@@ -425,6 +432,12 @@ Song* SongReader::readSong( const QString& filename )
 
 	//  Instrument List
 	InstrumentList* instrumentList = new InstrumentList();
+	// the instruments mostly come from the same drumkit, its stream head and sample format are read once
+	QString sStreamHeadDrumkit;
+	int nStreamHead = 0;
+	bool bCompactSamples = Preferences::get_instance()->m_bCompactSamples;
+	// the unmodified samples are decoded together once every instrument is read
+	SampleLoader sampleLoader( true );
 
 	QDomNode instrumentListNode = songNode.firstChildElement( "instrumentList" );
 	if ( ( ! instrumentListNode.isNull()  ) ) {
@@ -499,6 +512,17 @@ Song* SongReader::readSong( const QString& filename )
 			if ( ( !sDrumkit.isEmpty() ) && ( sDrumkit != "-" ) ) {
 				drumkitPath = Filesystem::drumkit_path_search( sDrumkit );
 			}
+			if ( sDrumkit != sStreamHeadDrumkit ) {
+				sStreamHeadDrumkit = sDrumkit;
+				nStreamHead = 0;
+				bCompactSamples = Preferences::get_instance()->m_bCompactSamples;
+				Drumkit* pDrumkit = drumkitPath.isEmpty() ? NULL : Drumkit::load( drumkitPath );
+				if ( pDrumkit ) {
+					nStreamHead = pDrumkit->get_stream_head();
+					bCompactSamples = pDrumkit->samples_compact();
+					delete pDrumkit;
+				}
+			}
 
 
 			QDomNode filenameNode = instrumentNode.firstChildElement( "filename" );
@@ -568,7 +592,10 @@ Song* SongReader::readSong( const QString& filename )
 
 					Sample* pSample = NULL;
 					if ( !sIsModified ) {
-						pSample = Sample::load( sFilename );
+						if ( Filesystem::file_readable( sFilename ) ) {
+							pSample = new Sample( sFilename );
+							sampleLoader.add( pSample, nStreamHead, bCompactSamples );
+						}
 					} else {
 						Sample::EnvelopePoint pt;
 
@@ -612,6 +639,7 @@ Song* SongReader::readSong( const QString& filename )
 			instrumentList->add( pInstrument );
 			instrumentNode = ( QDomNode ) instrumentNode.nextSiblingElement( "instrument" );
 		}
+		sampleLoader.run();
 		if ( instrumentList_count == 0 ) {
 			WARNINGLOG( "0 instruments?" );
 		}
@@ -22,6 +22,9 @@
 
 #include <hydrogen/event_queue.h>
 
+#include <sys/time.h>
+#include <cerrno>
+
 namespace H2Core
 {
 
@@ -38,48 +41,79 @@ const char* EventQueue::__class_name = "EventQueue";
 
 EventQueue::EventQueue()
 		: Object( __class_name )
-		, __read_index( 0 )
-		, __write_index( 0 )
+		, __waiting( 0 )
 {
 	__instance = this;
 
-	for ( int i = 0; i < MAX_EVENTS; ++i ) {
-		__events_buffer[ i ].type = EVENT_NONE;
-		__events_buffer[ i ].value = 0;
-	}
+	pthread_mutex_init( &__wait_mutex, NULL );
+	pthread_cond_init( &__wait_cond, NULL );
 }
 
 
 EventQueue::~EventQueue()
 {
 //	infoLog( "DESTROY" );
+	pthread_cond_destroy( &__wait_cond );
+	pthread_mutex_destroy( &__wait_mutex );
 }
 
 
 void EventQueue::push_event( EventType type, int nValue )
 {
-	int nIndex = ++__write_index;
-	nIndex = nIndex % MAX_EVENTS;
-//	infoLog( "[pushEvent] " + toString( nIndex ) );
 	Event ev;
 	ev.type = type;
 	ev.value = nValue;
-	__events_buffer[ nIndex ] = ev;
+	if ( !__events.push( ev ) ) {
+		return;
+	}
+
+	if ( __sync_fetch_and_add( &__waiting, 0 ) ) {
+		// without the mutex, a wake up can be missed, wait_event() has a timeout anyway
+		pthread_cond_signal( &__wait_cond );
+	}
+}
+
+
+int EventQueue::pop_events( Event* pEvents, int nMax )
+{
+	return __events.pop( pEvents, nMax );
 }
 
 
 Event EventQueue::pop_event()
 {
-	if ( __read_index == __write_index ) {
-		Event ev;
+	Event ev;
+	if ( pop_events( &ev, 1 ) == 0 ) {
 		ev.type = EVENT_NONE;
 		ev.value = 0;
-		return ev;
 	}
-	int nIndex = ++__read_index;
-	nIndex = nIndex % MAX_EVENTS;
-//	infoLog( "[popEvent] " + toString( nIndex ) );
-	return __events_buffer[ nIndex ];
+	return ev;
+}
+
+
+bool EventQueue::wait_event( int nTimeoutMs )
+{
+	if ( !__events.empty() ) {
+		return true;
+	}
+
+	struct timeval now;
+	gettimeofday( &now, NULL );
+	struct timespec deadline;
+	long nNsec = now.tv_usec * 1000L + ( nTimeoutMs % 1000 ) * 1000000L;
+	deadline.tv_sec = now.tv_sec + nTimeoutMs / 1000 + nNsec / 1000000000L;
+	deadline.tv_nsec = nNsec % 1000000000L;
+
+	pthread_mutex_lock( &__wait_mutex );
+	__sync_lock_test_and_set( &__waiting, 1 );
+	int nRet = 0;
+	while ( __events.empty() && nRet != ETIMEDOUT ) {
+		nRet = pthread_cond_timedwait( &__wait_cond, &__wait_mutex, &deadline );
+	}
+	__sync_lock_test_and_set( &__waiting, 0 );
+	pthread_mutex_unlock( &__wait_mutex );
+
+	return !__events.empty();
 }
 
 };
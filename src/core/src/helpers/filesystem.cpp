@@ -21,6 +21,7 @@
 #define TMP             "/hydrogen"
 #define CACHE           "/cache"
 #define REPOSITORIES    "/repositories"
+#define SAMPLES         "/samples"
 
 
 // files
@@ -280,6 +281,7 @@ bool Filesystem::check_usr_paths()
 	if( !path_usable( usr_drumkits_dir() ) ) return false;
 	if( !path_usable( cache_dir() ) ) return false;
 	if( !path_usable( repositories_cache_dir() ) ) return false;
+	if( !path_usable( samples_cache_dir() ) ) return false;
 	INFOLOG( QString( "user path %1 is usable." ).arg( __usr_data_path ) );
 	return true;
 }
@@ -381,6 +383,10 @@ QString Filesystem::repositories_cache_dir()
 {
 	return __usr_data_path + CACHE + REPOSITORIES;
 }
+QString Filesystem::samples_cache_dir()
+{
+	return __usr_data_path + CACHE + SAMPLES;
+}
 QString Filesystem::demos_dir()
 {
 	return __sys_data_path + DEMOS;
@@ -517,6 +523,7 @@ void Filesystem::info()
 	INFOLOG( QString( "Playlists dir              : %1" ).arg( playlists_dir() ) );
 	INFOLOG( QString( "Cache dir                  : %1" ).arg( cache_dir() ) );
 	INFOLOG( QString( "Repositories cache dir     : %1" ).arg( cache_dir() ) );
+	INFOLOG( QString( "Samples cache dir          : %1" ).arg( samples_cache_dir() ) );
 	INFOLOG( QString( "User core cfg file         : %1" ).arg( usr_core_config() ) );
 	INFOLOG( QString( "User gui cfg file          : %1" ).arg( usr_gui_config() ) );
 }
@@ -33,6 +33,7 @@
 #include <cassert>
 #include <cstdio>
 #include <deque>
+#include <vector>
 #include <queue>
 #include <iostream>
 #include <ctime>
@@ -52,11 +53,16 @@
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
 #include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_loader.h>
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/pattern_list.h>
 #include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_queue.h>
 #include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/helpers/snapshot.h>
+#include <hydrogen/helpers/mpsc_queue.h>
+#include <hydrogen/helpers/random.h>
 #include <hydrogen/fx/LadspaFX.h>
 #include <hydrogen/fx/Effects.h>
 #include <hydrogen/IO/AudioOutput.h>
@@ -124,22 +130,31 @@ QMutex mutex_OutputPointer;     ///< Mutex for audio output pointer, allows mult
 MidiInput *m_pMidiDriver = NULL;	///< MIDI input
 MidiOutput *m_pMidiDriverOut = NULL;	///< MIDI output
 
-// overload the the > operator of Note objects for priority_queue
-struct compare_pNotes {
-	bool operator() (Note* pNote1, Note* pNote2) {
-		return (pNote1->get_humanize_delay()
-				+ pNote1->get_position() * m_pAudioDriver->m_transport.m_nTickSize)
-				>
-				(pNote2->get_humanize_delay()
-				 + pNote2->get_position() * m_pAudioDriver->m_transport.m_nTickSize);
-	}
-};
+NoteQueue* m_pSongNoteQueue;		///< Song Note FIFO
 
-/// Song Note FIFO
-std::priority_queue<Note*, std::deque<Note*>, compare_pNotes > m_songNoteQueue;
+Random m_random;				///< humanize and random pitch values, only drawn by the audio thread
+unsigned m_nRandomSeed = 0;		///< seed forced over the song one, 0 if none
 std::deque<Note*> m_midiNoteQueue;	///< Midi Note FIFO
 
-PatternList* m_pNextPatterns;		///< Next pattern (used only in Pattern mode)
+/// A note played live, as addRealtimeNote() got it
+struct RealtimeNote {
+	int instrument;
+	float velocity;
+	float pan_L;
+	float pan_R;
+	float pitch;
+	bool noteOff;
+	bool forcePlay;
+	int msg1;
+	unsigned long realtimeTick;	///< realtime tick position when it was played
+};
+#define MAX_REALTIME_NOTES 256
+/// Notes played live, queued without the engine lock, taken with the engine locked
+MpscQueue<RealtimeNote, MAX_REALTIME_NOTES> m_realtimeNotes;
+
+typedef std::vector<Pattern*> NextPatterns;
+/// Next patterns (used only in Pattern mode), edited without the engine lock
+Snapshot<NextPatterns>* m_pNextPatterns;
 bool m_bAppendNextPattern;		///< Add the next pattern to the list instead
 /// of replace.
 bool m_bDeleteNextPattern;		///< Delete the next pattern from the list.
@@ -170,8 +185,20 @@ int m_nPatternStartTick = -1;
 unsigned int m_nPatternTickPosition = 0;
 int m_nLookaheadFrames = 0;
 
-// used in findPatternInTick
-int m_nSongSizeInTicks = 0;
+/// Song columns indexed for the audio thread
+struct SongTimeline {
+	unsigned serial;				///< tells timelines apart, even at the same address
+	unsigned generation;			///< pattern generation of the song it was built from
+	std::vector<long> start_ticks;	///< start tick of each column followed by the song size
+	/// patterns playing in each column, virtual patterns flattened
+	std::vector< std::vector<Pattern*> > playing_patterns;
+};
+/// Timelines built by updateSongTimeline(), taken by the audio thread
+Snapshot<SongTimeline>* m_pSongTimelines;
+SongTimeline* m_pSongTimeline = NULL;	///< the timeline used by findPatternInTick
+unsigned m_nPlayingTimeline = 0;	///< serial of the timeline m_pPlayingPatterns comes from
+int m_nPlayingColumn = -1;			///< column m_pPlayingPatterns comes from
+long m_nSongSizeInTicks = 0;		///< size of m_pSongTimeline
 
 struct timeval m_currentTickTime;
 
@@ -188,7 +215,12 @@ void		audioEngine_removeSong();
 static void	audioEngine_noteOn( Note *note );
 //static void	audioEngine_noteOff( Note *note );
 int			audioEngine_process( uint32_t nframes, void *arg );
+int			audioEngine_renderOffline( uint32_t nframes, void *arg );
+inline int	audioEngine_process_render( uint32_t nframes );
+inline void audioEngine_takeSongTimeline();
 inline void audioEngine_clearNoteQueue();
+inline void audioEngine_playRealtimeNotes();
+inline void audioEngine_clearRealtimeNotes();
 inline void audioEngine_process_checkBPMChanged();
 inline void audioEngine_process_playNotes( unsigned long nframes );
 inline void audioEngine_process_transport();
@@ -198,6 +230,8 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames );
 inline void audioEngine_prepNoteQueue();
 
 inline int findPatternInTick( int tick, bool loopMode, int *patternStartTick );
+static inline long columnSize( PatternList* pColumn );
+void audioEngine_updateSongTimeline( Song* pSong );
 
 void		audioEngine_seek( long long nFrames, bool bLoopMode = false );
 
@@ -212,23 +246,18 @@ inline timeval currentTime2()
 	return now;
 }
 
-inline int randomValue( int max )
+/// Restart the random values of the song, a render gives the same values
+/// each time unless neither the song nor the command line set a seed
+void audioEngine_seedRandom( Song* pSong )
 {
-	return rand() % max;
-}
-
-inline float getGaussian( float z )
-{
-	// gaussian distribution -- dimss
-	float x1, x2, w;
-	do {
-		x1 = 2.0 * ( ( ( float ) rand() ) / RAND_MAX ) - 1.0;
-		x2 = 2.0 * ( ( ( float ) rand() ) / RAND_MAX ) - 1.0;
-		w = x1 * x1 + x2 * x2;
-	} while ( w >= 1.0 );
-
-	w = sqrtf( ( -2.0 * logf( w ) ) / w );
-	return x1 * w * z + 0.0; // tunable
+	unsigned nSeed = m_nRandomSeed;
+	if ( nSeed == 0 && pSong ) {
+		nSeed = pSong->get_random_seed();
+	}
+	if ( nSeed == 0 ) {
+		nSeed = time( NULL );
+	}
+	m_random.seed( nSeed );
 }
 
 void audioEngine_raiseError( unsigned nErrorCode )
@@ -258,7 +287,8 @@ void audioEngine_init()
 	}
 
 	m_pPlayingPatterns = new PatternList();
-	m_pNextPatterns = new PatternList();
+	m_pNextPatterns = new Snapshot<NextPatterns>();
+	m_pSongTimelines = new Snapshot<SongTimeline>();
 	m_nSongPos = -1;
 	m_nSelectedPatternNumber = 0;
 	m_nSelectedInstrumentNumber = 0;
@@ -288,6 +318,7 @@ void audioEngine_init()
 #endif
 	AudioEngine::create_instance();
 	Playlist::create_instance();
+	m_pSongNoteQueue = new NoteQueue( AudioEngine::get_instance()->get_note_pool()->get_capacity() );
 
 	EventQueue::get_instance()->push_event( EVENT_STATE, STATE_INITIALIZED );
 
@@ -300,20 +331,17 @@ void audioEngine_destroy()
 		___ERRORLOG( "Error the audio engine is not in INITIALIZED state" );
 		return;
 	}
-	AudioEngine::get_instance()->get_sampler()->stop_playing_notes();
-
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	___INFOLOG( "*** Hydrogen audio engine shutdown ***" );
 
+	// the voices go back to the note pool, which needs the engine locked
+	AudioEngine::get_instance()->get_sampler()->stop_playing_notes();
+
 	// delete all copied notes in the song notes queue
-	while ( !m_songNoteQueue.empty() ) {
-		m_songNoteQueue.top()->get_instrument()->dequeue();
-		delete m_songNoteQueue.top();
-		m_songNoteQueue.pop();
-	}
+	m_pSongNoteQueue->clear( AudioEngine::get_instance()->get_note_pool() );
 	// delete all copied notes in the midi notes queue
 	for ( unsigned i = 0; i < m_midiNoteQueue.size(); ++i ) {
-		delete m_midiNoteQueue[i];
+		AudioEngine::get_instance()->get_note_pool()->release( m_midiNoteQueue[i] );
 	}
 	m_midiNoteQueue.clear();
 
@@ -325,9 +353,17 @@ void audioEngine_destroy()
 	delete m_pPlayingPatterns;
 	m_pPlayingPatterns = NULL;
 
+	delete m_pSongNoteQueue;
+	m_pSongNoteQueue = NULL;
+
 	delete m_pNextPatterns;
 	m_pNextPatterns = NULL;
 
+	delete m_pSongTimelines;
+	m_pSongTimelines = NULL;
+	delete m_pSongTimeline;
+	m_pSongTimeline = NULL;
+
 	delete m_pMetronomeInstrument;
 	m_pMetronomeInstrument = NULL;
 
@@ -402,11 +438,7 @@ void audioEngine_stop( bool bLockEngine )
 	m_nPatternStartTick = -1;
 
 	// delete all copied notes in the song notes queue
-	while(!m_songNoteQueue.empty()){
-		m_songNoteQueue.top()->get_instrument()->dequeue();
-		delete m_songNoteQueue.top();
-		m_songNoteQueue.pop();
-	}
+	m_pSongNoteQueue->clear( AudioEngine::get_instance()->get_note_pool() );
 	/*	// delete all copied notes in the playing notes queue
   for (unsigned i = 0; i < m_playingNotesQueue.size(); ++i) {
    Note *note = m_playingNotesQueue[i];
@@ -417,7 +449,7 @@ void audioEngine_stop( bool bLockEngine )
 
 	// delete all copied notes in the midi notes queue
 	for ( unsigned i = 0; i < m_midiNoteQueue.size(); ++i ) {
-		delete m_midiNoteQueue[i];
+		AudioEngine::get_instance()->get_note_pool()->release( m_midiNoteQueue[i] );
 	}
 	m_midiNoteQueue.clear();
 
@@ -481,32 +513,24 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 		framepos = pHydrogen->getRealtimeFrames();
 	}
 
-	// reading from m_songNoteQueue
-	while ( !m_songNoteQueue.empty() ) {
-		Note *pNote = m_songNoteQueue.top();
-
-		// verifico se la nota rientra in questo ciclo
-		unsigned int noteStartInFrames =
-				(int)( pNote->get_position() * m_pAudioDriver->m_transport.m_nTickSize );
-
-		// if there is a negative Humanize delay, take into account so
-		// we don't miss the time slice.  ignore positive delay, or we
-		// might end the queue processing prematurely based on NoteQueue
-		// placement.  the sampler handles positive delay.
-		if (pNote->get_humanize_delay() < 0) {
-			noteStartInFrames += pNote->get_humanize_delay();
-		}
-
-		// m_nTotalFrames <= NotePos < m_nTotalFrames + bufferSize
-		bool isNoteStart = ( ( noteStartInFrames >= framepos )
-							 && ( noteStartInFrames < ( framepos + nframes ) ) );
-		bool isOldNote = noteStartInFrames < framepos;
+	// reading from m_pSongNoteQueue, the notes starting in this cycle
+	// or already late, a batch at a time
+	Note* notes[ 64 ];
+	// the velocity and pitch values of the batch, drawn at once
+	float gaussians[ 2 * 64 ];
+	int nNotes;
+	do {
+		nNotes = m_pSongNoteQueue->pop_due( ( long long )framepos + nframes,
+											m_pAudioDriver->m_transport.m_nTickSize,
+											notes, 64 );
+		m_random.gaussians( gaussians, 2 * nNotes, 0.2 );
+		for ( int nNote = 0; nNote < nNotes; ++nNote ) {
+			Note *pNote = notes[ nNote ];
 
-		if ( isNoteStart || isOldNote ) {
 			// Humanize - Velocity parameter
 
 			if ( pSong->get_humanize_velocity_value() != 0 ) {
-				float random = pSong->get_humanize_velocity_value() * getGaussian( 0.2 );
+				float random = pSong->get_humanize_velocity_value() * gaussians[ 2 * nNote ];
 				pNote->set_velocity(
 							pNote->get_velocity()
 							+ ( random
@@ -522,7 +546,7 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 			// Random Pitch ;)
 			const float fMaxPitchDeviation = 2.0;
 			pNote->set_pitch( pNote->get_pitch()
-							  + ( fMaxPitchDeviation * getGaussian( 0.2 )
+							  + ( fMaxPitchDeviation * gaussians[ 2 * nNote + 1 ]
 								  - fMaxPitchDeviation / 2.0 )
 							  * pNote->get_instrument()->get_random_pitch_factor() );
 
@@ -533,7 +557,7 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 					  */
 			Instrument * noteInstrument = pNote->get_instrument();
 			if ( noteInstrument->is_stop_notes() ){
-				Note *pOffNote = new Note( noteInstrument,
+				Note *pOffNote = AudioEngine::get_instance()->get_note_pool()->acquire( noteInstrument,
 										   0.0,
 										   0.0,
 										   0.0,
@@ -541,26 +565,19 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
 										   -1,
 										   0 );
 				pOffNote->set_note_off( true );
+				// the sampler releases note off notes
 				AudioEngine::get_instance()->get_sampler()->note_on( pOffNote );
-				delete pOffNote;
 			}
 
-			AudioEngine::get_instance()->get_sampler()->note_on( pNote );
-			m_songNoteQueue.pop(); // rimuovo la nota dalla lista di note
-			pNote->get_instrument()->dequeue();
+			noteInstrument->dequeue();
 			// raise noteOn event
-			int nInstrument = pSong->get_instrument_list()->index( pNote->get_instrument() );
-			if( pNote->get_note_off() ){
-				delete pNote;
-			}
+			int nInstrument = pSong->get_instrument_list()->index( noteInstrument );
+			// the sampler owns the note from now on
+			AudioEngine::get_instance()->get_sampler()->note_on( pNote );
 
 			EventQueue::get_instance()->push_event( EVENT_NOTEON, nInstrument );
-			continue;
-		} else {
-			// this note will not be played
-			break;
 		}
-	}
+	} while ( nNotes == 64 );
 }
 
 
@@ -574,14 +591,10 @@ void audioEngine_seek( long long nFrames, bool bLoopMode )
 	}
 
 	if ( nFrames < 0 ) {
-		___ERRORLOG( "nFrames < 0" );
+		___ERRORLOG_RT( "nFrames < 0" );
 	}
 
-	char tmp[200];
-	sprintf( tmp, "seek in %lld (old pos = %d)",
-			 nFrames,
-			 ( int )m_pAudioDriver->m_transport.m_nFrames );
-	___INFOLOG( tmp );
+	___INFOLOG_RT( "seek in %1 (old pos = %2)" ).arg( nFrames ).arg( m_pAudioDriver->m_transport.m_nFrames );
 
 	m_pAudioDriver->m_transport.m_nFrames = nFrames;
 
@@ -626,10 +639,9 @@ inline void audioEngine_process_transport()
 			}
 
 			if ( pSong->__bpm != m_pAudioDriver->m_transport.m_nBPM ) {
-				___INFOLOG(
-							QString( "song bpm: (%1) gets transport bpm: (%2)" )
+				___INFOLOG_RT( "song bpm: (%1) gets transport bpm: (%2)" )
 							.arg( pSong->__bpm )
-							.arg( m_pAudioDriver->m_transport.m_nBPM ) );
+							.arg( m_pAudioDriver->m_transport.m_nBPM );
 
 				pSong->__bpm = m_pAudioDriver->m_transport.m_nBPM;
 			}
@@ -659,22 +671,41 @@ void audioEngine_clearNoteQueue()
 	//___INFOLOG( "clear notes...");
 
 	// delete all copied notes in the song notes queue
-	while (!m_songNoteQueue.empty()) {
-		m_songNoteQueue.top()->get_instrument()->dequeue();
-		delete m_songNoteQueue.top();
-		m_songNoteQueue.pop();
-	}
+	m_pSongNoteQueue->clear( AudioEngine::get_instance()->get_note_pool() );
 
 	AudioEngine::get_instance()->get_sampler()->stop_playing_notes();
 
 	// delete all copied notes in the midi notes queue
 	for ( unsigned i = 0; i < m_midiNoteQueue.size(); ++i ) {
-		delete m_midiNoteQueue[i];
+		AudioEngine::get_instance()->get_note_pool()->release( m_midiNoteQueue[i] );
 	}
 	m_midiNoteQueue.clear();
 
 }
 
+/// Play the notes addRealtimeNote() queued, with the engine locked
+inline void audioEngine_playRealtimeNotes()
+{
+	RealtimeNote notes[ 32 ];
+	int nNotes;
+	while ( ( nNotes = m_realtimeNotes.pop( notes, 32 ) ) > 0 ) {
+		for ( int i = 0; i < nNotes; ++i ) {
+			const RealtimeNote& note = notes[ i ];
+			hydrogenInstance->playRealtimeNote( note.instrument, note.velocity,
+												note.pan_L, note.pan_R, note.pitch,
+												note.noteOff, note.forcePlay, note.msg1,
+												note.realtimeTick );
+		}
+	}
+}
+
+/// Drop the notes addRealtimeNote() queued, with the engine locked
+inline void audioEngine_clearRealtimeNotes()
+{
+	RealtimeNote notes[ 32 ];
+	while ( m_realtimeNotes.pop( notes, 32 ) > 0 ) {}
+}
+
 /// Clear all audio buffers
 inline void audioEngine_process_clearAudioBuffers( uint32_t nFrames )
 {
@@ -694,23 +725,20 @@ inline void audioEngine_process_clearAudioBuffers( uint32_t nFrames )
 		memset( m_pMainBuffer_R, 0, nFrames * sizeof( float ) );
 	}
 
-#ifdef H2CORE_HAVE_JACK
-	JackOutput* jo = dynamic_cast<JackOutput*>(m_pAudioDriver);
-	if( jo && jo->has_track_outs() ) {
+	if( m_pAudioDriver && m_pAudioDriver->has_track_outs() ) {
 		float* buf;
 		int k;
-		for( k=0 ; k<jo->getNumTracks() ; ++k ) {
-			buf = jo->getTrackOut_L(k);
+		for( k=0 ; k<m_pAudioDriver->getNumTracks() ; ++k ) {
+			buf = m_pAudioDriver->getTrackOut_L(k);
 			if( buf ) {
 				memset( buf, 0, nFrames * sizeof( float ) );
 			}
-			buf = jo->getTrackOut_R(k);
+			buf = m_pAudioDriver->getTrackOut_R(k);
 			if( buf ) {
 				memset( buf, 0, nFrames * sizeof( float ) );
 			}
 		}
 	}
-#endif
 
 	mx.unlock();
 
@@ -730,35 +758,28 @@ inline void audioEngine_process_clearAudioBuffers( uint32_t nFrames )
 #endif
 }
 
-/// Main audio processing function. Called by audio drivers.
-int audioEngine_process( uint32_t nframes, void* /*arg*/ )
+/// Switch to the timeline last built by updateSongTimeline(), if any
+inline void audioEngine_takeSongTimeline()
 {
-	timeval startTimeval = currentTime2();
-
-	audioEngine_process_clearAudioBuffers( nframes );
-
-	/*
-	 * The "try_lock" was introduced for Bug #164 (Deadlock after during
-	 * alsa driver shutdown). The try_lock *should* only fail in rare circumstances
-	 * (like shutting down drivers). In such cases, it seems to be ok to interrupt
-	 * audio processing.
-	 */
-
-	if(!AudioEngine::get_instance()->try_lock( RIGHT_HERE )){
-		return 0;
+	SongTimeline* pSongTimeline = m_pSongTimelines->take();
+	if ( pSongTimeline ) {
+		m_pSongTimelines->retire( m_pSongTimeline );
+		m_pSongTimeline = pSongTimeline;
+		m_nSongSizeInTicks = m_pSongTimeline->start_ticks.back();
 	}
+}
 
-	if ( m_audioEngineState < STATE_READY) {
-		AudioEngine::get_instance()->unlock();
-		return 0;
-	}
+/// Run the sequencer, the sampler, the synth and the FX over one period.
+/// Called with the engine locked, returns the audioEngine_updateNoteQueue
+/// result: -1 at the end of the song, 2 on a pattern change.
+inline int audioEngine_process_render( uint32_t nframes )
+{
+	audioEngine_takeSongTimeline();
 
 	if ( m_nBufferSize != nframes ) {
-		___INFOLOG(
-					QString( "Buffer size changed. Old size = %1, new size = %2" )
+		___INFOLOG_RT( "Buffer size changed. Old size = %1, new size = %2" )
 					.arg( m_nBufferSize )
-					.arg( nframes )
-					);
+					.arg( nframes );
 		m_nBufferSize = nframes;
 	}
 
@@ -766,35 +787,11 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	audioEngine_process_transport();
 	audioEngine_process_checkBPMChanged(); // pSong->__bpm decides tick size
 
-	bool sendPatternChange = false;
 	// always update note queue.. could come from pattern or realtime input
 	// (midi, keyboard)
 	int res2 = audioEngine_updateNoteQueue( nframes );
 	if ( res2 == -1 ) {	// end of song
-		___INFOLOG( "End of song received, calling engine_stop()" );
-		AudioEngine::get_instance()->unlock();
-		m_pAudioDriver->stop();
-		m_pAudioDriver->locate( 0 ); // locate 0, reposition from start of the song
-
-		if ( ( m_pAudioDriver->class_name() == DiskWriterDriver::class_name() )
-			 || ( m_pAudioDriver->class_name() == FakeDriver::class_name() )
-			 ) {
-			___INFOLOG( "End of song." );
-			return 1;	// kill the audio AudioDriver thread
-		}
-
-#ifdef H2CORE_HAVE_JACK
-		else if ( m_pAudioDriver->class_name() == JackOutput::class_name() )
-		{
-			// Do something clever :-s ... Jakob Lund
-			// Mainly to keep sync with Ardour.
-			static_cast<JackOutput*>(m_pAudioDriver)->locateInNCycles( 0 );
-		}
-#endif
-
-		return 0;
-	} else if ( res2 == 2 ) { // send pattern change
-		sendPatternChange = true;
+		return res2;
 	}
 
 	// play all notes
@@ -821,9 +818,6 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 		m_pMainBuffer_R[ i ] += out_R[ i ];
 	}
 
-	timeval renderTime_end = currentTime2();
-	timeval ladspaTime_start = renderTime_end;
-
 #ifdef H2CORE_HAVE_LADSPA
 	// Process LADSPA FX
 	if ( m_audioEngineState >= STATE_READY ) {
@@ -854,7 +848,6 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 		}
 	}
 #endif
-	timeval ladspaTime_end = currentTime2();
 
 	// update master peaks
 	float val_L, val_R;
@@ -877,13 +870,60 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 		m_pAudioDriver->m_transport.m_nFrames += nframes;
 	}
 
-	/* float fRenderTime = (renderTime_end.tv_sec - renderTime_start.tv_sec) * 1000.0
-		+ (renderTime_end.tv_usec - renderTime_start.tv_usec) / 1000.0;
-	*/
+	return res2;
+}
+
+/// Main audio processing function. Called by audio drivers.
+int audioEngine_process( uint32_t nframes, void* /*arg*/ )
+{
+	timeval startTimeval = currentTime2();
+
+	audioEngine_process_clearAudioBuffers( nframes );
+
+	/*
+	 * The lock is not waited for without end since Bug #164 (Deadlock after
+	 * during alsa driver shutdown). The other threads only hold it for short
+	 * edits, so it is waited for up to half a period: past that the driver is
+	 * likely shutting down, and the period is given up.
+	 */
+	unsigned nWait = ( unsigned )( 500000.0 * nframes / m_pAudioDriver->getSampleRate() );
+	if(!AudioEngine::get_instance()->timed_lock( nWait, RIGHT_HERE )){
+		___WARNINGLOG_RT( "Engine lock not obtained in time, period skipped" );
+		EventQueue::get_instance()->push_event( EVENT_XRUN, -1 );
+		return 0;
+	}
+
+	if ( m_audioEngineState < STATE_READY) {
+		AudioEngine::get_instance()->unlock();
+		return 0;
+	}
 
-	float fLadspaTime =
-			( ladspaTime_end.tv_sec - ladspaTime_start.tv_sec ) * 1000.0
-			+ ( ladspaTime_end.tv_usec - ladspaTime_start.tv_usec ) / 1000.0;
+	audioEngine_playRealtimeNotes();
+
+	int res2 = audioEngine_process_render( nframes );
+	if ( res2 == -1 ) {	// end of song
+		___INFOLOG_RT( "End of song received, calling engine_stop()" );
+		AudioEngine::get_instance()->unlock();
+		m_pAudioDriver->stop();
+		m_pAudioDriver->locate( 0 ); // locate 0, reposition from start of the song
+
+		if ( m_pAudioDriver->class_name() == FakeDriver::class_name() ) {
+			___INFOLOG_RT( "End of song." );
+			return 1;	// kill the audio AudioDriver thread
+		}
+
+#ifdef H2CORE_HAVE_JACK
+		else if ( m_pAudioDriver->class_name() == JackOutput::class_name() )
+		{
+			// Do something clever :-s ... Jakob Lund
+			// Mainly to keep sync with Ardour.
+			static_cast<JackOutput*>(m_pAudioDriver)->locateInNCycles( 0 );
+		}
+#endif
+
+		return 0;
+	}
+	bool sendPatternChange = ( res2 == 2 );
 
 	timeval finishTimeval = currentTime2();
 	m_fProcessTime =
@@ -895,14 +935,13 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 
 #ifdef CONFIG_DEBUG
 	if ( m_fProcessTime > m_fMaxProcessTime ) {
-		___WARNINGLOG( "" );
-		___WARNINGLOG( "----XRUN----" );
-		___WARNINGLOG( QString( "XRUN of %1 msec (%2 > %3)" )
+		___WARNINGLOG_RT( "" );
+		___WARNINGLOG_RT( "----XRUN----" );
+		___WARNINGLOG_RT( "XRUN of %1 msec (%2 > %3)" )
 					   .arg( ( m_fProcessTime - m_fMaxProcessTime ) )
-					   .arg( m_fProcessTime ).arg( m_fMaxProcessTime ) );
-		___WARNINGLOG( QString( "Ladspa process time = %1" ).arg( fLadspaTime ) );
-		___WARNINGLOG( "------------" );
-		___WARNINGLOG( "" );
+					   .arg( m_fProcessTime ).arg( m_fMaxProcessTime );
+		___WARNINGLOG_RT( "------------" );
+		___WARNINGLOG_RT( "" );
 		// raise xRun event
 		EventQueue::get_instance()->push_event( EVENT_XRUN, -1 );
 	}
@@ -917,6 +956,36 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	return 0;
 }
 
+/// Offline processing function. Called by the disk writer thread, which
+/// renders as fast as it can: there is no deadline to measure and the
+/// period is never skipped, a skipped period would end up as silence in
+/// the exported file. Returns 1 at the end of the song.
+int audioEngine_renderOffline( uint32_t nframes, void* /*arg*/ )
+{
+	audioEngine_process_clearAudioBuffers( nframes );
+
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+
+	if ( m_audioEngineState < STATE_READY) {
+		AudioEngine::get_instance()->unlock();
+		return 1;
+	}
+
+	int res2 = audioEngine_process_render( nframes );
+	AudioEngine::get_instance()->unlock();
+
+	if ( res2 == -1 ) {	// end of song
+		___INFOLOG_RT( "End of song." );
+		m_pAudioDriver->stop();
+		m_pAudioDriver->locate( 0 );
+		return 1;
+	}
+	if ( res2 == 2 ) {
+		EventQueue::get_instance()->push_event( EVENT_PATTERN_CHANGED, -1 );
+	}
+	return 0;
+}
+
 void audioEngine_setupLadspaFX( unsigned nBufferSize )
 {
 	//___INFOLOG( "buffersize=" + to_string(nBufferSize) );
@@ -989,6 +1058,8 @@ void audioEngine_setSong( Song *newSong )
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	assert( ! pHydrogen->getSong() );
 
+	audioEngine_seedRandom( newSong );
+
 	// setup LADSPA FX
 	audioEngine_setupLadspaFX( m_pAudioDriver->getBufferSize() );
 
@@ -999,6 +1070,7 @@ void audioEngine_setSong( Song *newSong )
 	if ( newSong->get_pattern_list()->size() > 0 ) {
 		m_pPlayingPatterns->add( newSong->get_pattern_list()->get( 0 ) );
 	}
+	m_nPlayingColumn = -1;
 
 	audioEngine_renameJackPorts();
 
@@ -1031,9 +1103,14 @@ void audioEngine_removeSong()
 	}
 
 	m_pPlayingPatterns->clear();
-	m_pNextPatterns->clear();
+	m_nPlayingColumn = -1;
+	m_pNextPatterns->lock();
+	m_pNextPatterns->publish( m_pNextPatterns->peek(), NULL );
+	m_pNextPatterns->unlock();
 
 	audioEngine_clearNoteQueue();
+	// the notes played live belong to the removed song
+	audioEngine_clearRealtimeNotes();
 
 	// change the current audio engine state
 	m_audioEngineState = STATE_PREPARED;
@@ -1103,7 +1180,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 		}
 
 
-		// midi events now get put into the m_songNoteQueue as well,
+		// midi events now get put into the m_pSongNoteQueue as well,
 		// based on their timestamp
 		while ( m_midiNoteQueue.size() > 0 ) {
 			Note *note = m_midiNoteQueue[0];
@@ -1112,14 +1189,20 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 				// printf ("tick=%d  pos=%d\n", tick, note->getPosition());
 				m_midiNoteQueue.pop_front();
 				note->get_instrument()->enqueue();
-				m_songNoteQueue.push( note );
+				m_pSongNoteQueue->push( note );
 			} else {
 				break;
 			}
 		}
 
 		if (  m_audioEngineState != STATE_PLAYING ) {
-			// only keep going if we're playing
+			// only keep going if we're playing, up to the next midi note
+			int nNextTick = tickNumber_end + 1;
+			if ( m_midiNoteQueue.size() > 0 ) {
+				nNextTick = std::min( nNextTick, std::max( tick + 1, ( int )m_midiNoteQueue[0]->get_position() ) );
+			}
+			nLastTick = nNextTick - 1;
+			tick = nNextTick;
 			continue;
 		}
 
@@ -1134,10 +1217,11 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 				&& Preferences::get_instance()->getRecordEvents()
 				&& Preferences::get_instance()->getDestructiveRecord()
 				&& Preferences::get_instance()->m_nRecPreDelete == 0;
+		int nPatternLength = MAX_NOTES;	///< of the patterns playing at this tick
 		if ( pSong->get_mode() == Song::SONG_MODE ) {
 			if ( pSong->get_pattern_group_vector()->size() == 0 ) {
 				// there's no song!!
-				___ERRORLOG( "no patterns in song." );
+				___ERRORLOG_RT( "no patterns in song." );
 				m_pAudioDriver->stop();
 				return -1;
 			}
@@ -1162,14 +1246,14 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 			//			PatternList *pPatternList =
 			//				 (*(pSong->getPatternGroupVector()))[m_nSongPos];
 			if ( m_nSongPos == -1 ) {
-				___INFOLOG( "song pos = -1" );
+				___INFOLOG_RT( "song pos = -1" );
 				if ( pSong->is_loop_enabled() == true ) {
 					m_nSongPos = findPatternInTick( 0,
 													true,
 													&m_nPatternStartTick );
 				} else {
 
-					___INFOLOG( "End of Song" );
+					___INFOLOG_RT( "End of Song" );
 
 					if( Hydrogen::get_instance()->getMidiOutput() != NULL ){
 						Hydrogen::get_instance()->getMidiOutput()->handleQueueAllNoteOff();
@@ -1178,18 +1262,34 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 					return -1;
 				}
 			}
-			PatternList *pPatternList = ( *( pSong->get_pattern_group_vector() ) )[m_nSongPos];
-			m_pPlayingPatterns->clear();
-			for ( int i=0; i< pPatternList->size(); ++i ) {
-				Pattern* pattern = pPatternList->get(i);
-				m_pPlayingPatterns->add( pattern );
-				pattern->extand_with_flattened_virtual_patterns( m_pPlayingPatterns );
+			if ( m_pSongTimeline
+				 && m_pSongTimeline->generation == pSong->get_pattern_generation() ) {
+				// the column is flattened already, only copied when it changes
+				if ( m_nPlayingTimeline != m_pSongTimeline->serial
+					 || m_nPlayingColumn != m_nSongPos ) {
+					m_pPlayingPatterns->assign( m_pSongTimeline->playing_patterns[ m_nSongPos ] );
+					m_nPlayingTimeline = m_pSongTimeline->serial;
+					m_nPlayingColumn = m_nSongPos;
+				}
+			} else {
+				PatternList *pPatternList = ( *( pSong->get_pattern_group_vector() ) )[m_nSongPos];
+				m_pPlayingPatterns->clear();
+				for ( int i=0; i< pPatternList->size(); ++i ) {
+					Pattern* pattern = pPatternList->get(i);
+					m_pPlayingPatterns->add( pattern );
+					pattern->extand_with_flattened_virtual_patterns( m_pPlayingPatterns );
+				}
+				m_nPlayingColumn = -1;
 			}
+			nPatternLength = columnSize( ( *( pSong->get_pattern_group_vector() ) )[m_nSongPos] );
 			// Set destructive record depending on punch area
 			doErase = doErase && Preferences::get_instance()->inPunchArea(m_nSongPos);
 		}
 		// PATTERN MODE
 		else if ( pSong->get_mode() == Song::PATTERN_MODE )	{
+			// the playing patterns no longer match a song column
+			m_nPlayingColumn = -1;
+
 			// per ora considero solo il primo pattern, se ce ne
 			// saranno piu' di uno bisognera' prendere quello piu'
 			// piccolo
@@ -1201,9 +1301,15 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 			if ( Preferences::get_instance()->patternModePlaysSelected() )
 			{
 				m_pPlayingPatterns->clear();
-				Pattern * pattern = pSong->get_pattern_list()->get(m_nSelectedPatternNumber);
-				m_pPlayingPatterns->add( pattern );
-				pattern->extand_with_flattened_virtual_patterns( m_pPlayingPatterns );
+				// read once, the selection may change under a pattern
+				// list that has since shrunk
+				int nSelected = m_nSelectedPatternNumber;
+				if ( nSelected >= 0
+					 && nSelected < ( int )pSong->get_pattern_list()->size() ) {
+					Pattern * pattern = pSong->get_pattern_list()->get( nSelected );
+					m_pPlayingPatterns->add( pattern );
+					pattern->extand_with_flattened_virtual_patterns( m_pPlayingPatterns );
+				}
 			}
 
 
@@ -1213,17 +1319,18 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 			}
 
 			if ( nPatternSize == 0 ) {
-				___ERRORLOG( "nPatternSize == 0" );
+				___ERRORLOG_RT( "nPatternSize == 0" );
 			}
 
 			if ( ( tick == m_nPatternStartTick + nPatternSize )
 				 || ( m_nPatternStartTick == -1 ) ) {
-				if ( m_pNextPatterns->size() > 0 ) {
+				NextPatterns* pNextPatterns = m_pNextPatterns->take();
+				if ( pNextPatterns ) {
 					Pattern * p;
 					for ( uint i = 0;
-						  i < m_pNextPatterns->size();
+						  i < pNextPatterns->size();
 						  i++ ) {
-						p = m_pNextPatterns->get( i );
+						p = ( *pNextPatterns )[ i ];
 						// 						___WARNINGLOG( QString( "Got pattern # %1" )
 						//							     .arg( i + 1 ) );
 						// if the pattern isn't playing
@@ -1232,7 +1339,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 							m_pPlayingPatterns->add( p );
 						}
 					}
-					m_pNextPatterns->clear();
+					m_pNextPatterns->retire( pNextPatterns );
 					bSendPatternChange = true;
 				}
 				if ( m_nPatternStartTick == -1 ) {
@@ -1247,6 +1354,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 			if ( m_nPatternTickPosition > nPatternSize ) {
 				m_nPatternTickPosition = tick % nPatternSize;
 			}
+			nPatternLength = nPatternSize;
 		}
 
 		// metronome
@@ -1270,7 +1378,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 				m_pMetronomeInstrument->set_volume(
 							Preferences::get_instance()->m_fMetronomeVolume
 							);
-				Note *pMetronomeNote = new Note( m_pMetronomeInstrument,
+				Note *pMetronomeNote = AudioEngine::get_instance()->get_note_pool()->acquire( m_pMetronomeInstrument,
 												 tick,
 												 fVelocity,
 												 0.5,
@@ -1279,7 +1387,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 												 fPitch
 												 );
 				m_pMetronomeInstrument->enqueue();
-				m_songNoteQueue.push( pMetronomeNote );
+				m_pSongNoteQueue->push( pMetronomeNote );
 			}
 		}
 
@@ -1290,11 +1398,12 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 				  ++nPat ) {
 				Pattern *pPattern = m_pPlayingPatterns->get( nPat );
 				assert( pPattern != NULL );
-				Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_notes();
+				int nNotes;
+				Note* const* notes = pPattern->get_notes_at( m_nPatternTickPosition, &nNotes );
 				// Delete notes before attempting to play them
 				if ( doErase ) {
-					FOREACH_NOTE_IT_BOUND(notes,it,m_nPatternTickPosition) {
-						Note* pNote = it->second;
+					for ( int nNote = 0; nNote < nNotes; ++nNote ) {
+						Note* pNote = notes[ nNote ];
 						assert( pNote != NULL );
 						if ( pNote->get_just_recorded() == false ) {
 							EventQueue::AddMidiNoteVector noteAction;
@@ -1310,14 +1419,14 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 							noteAction.b_isInstrumentMode = false;
 							noteAction.b_isMidi = false;
 							noteAction.b_noteExist = false;
-							EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+							EventQueue::get_instance()->push_note_edit( noteAction );
 						}
 					}
 				}
 
 				// Now play notes
-				FOREACH_NOTE_CST_IT_BOUND(notes,it,m_nPatternTickPosition) {
-					Note *pNote = it->second;
+				for ( int nNote = 0; nNote < nNotes; ++nNote ) {
+					Note *pNote = notes[ nNote ];
 					if ( pNote ) {
 						pNote->set_just_recorded( false );
 						int nOffset = 0;
@@ -1338,7 +1447,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 						// Humanize - Time parameter
 						if ( pSong->get_humanize_time_value() != 0 ) {
 							nOffset += ( int )(
-										getGaussian( 0.3 )
+										m_random.gaussian( 0.3 )
 										* pSong->get_humanize_time_value()
 										* nMaxTimeHumanize
 										);
@@ -1352,19 +1461,38 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 						if((tick == 0) && (nOffset < 0)) {
 							nOffset = 0;
 						}
-						Note *pCopiedNote = new Note( pNote );
+						Note *pCopiedNote = AudioEngine::get_instance()->get_note_pool()->acquire( pNote );
 						pCopiedNote->set_position( tick );
 
 						// humanize time
 						pCopiedNote->set_humanize_delay( nOffset );
 						pNote->get_instrument()->enqueue();
-						m_songNoteQueue.push( pCopiedNote );
+						m_pSongNoteQueue->push( pCopiedNote );
 						//pCopiedNote->dumpInfo();
 					}
 				}
 			}
 		}
-		++tick;
+
+		// jump straight to the next tick holding an event: the next
+		// pattern start, metronome beat, note or midi note. The ticks in
+		// between only move the pattern position.
+		int nPosition = m_nPatternTickPosition;
+		int nNextTick = tick + std::max( 1, nPatternLength - nPosition );
+		nNextTick = std::min( nNextTick, tick + 48 - nPosition % 48 );
+		for ( unsigned nPat = 0; nPat < m_pPlayingPatterns->size(); ++nPat ) {
+			int nNotePosition = m_pPlayingPatterns->get( nPat )->get_next_note_position( nPosition );
+			if ( nNotePosition != -1 ) {
+				nNextTick = std::min( nNextTick, tick + nNotePosition - nPosition );
+			}
+		}
+		if ( m_midiNoteQueue.size() > 0 ) {
+			nNextTick = std::min( nNextTick, std::max( tick + 1, ( int )m_midiNoteQueue[0]->get_position() ) );
+		}
+		nNextTick = std::min( nNextTick, tickNumber_end + 1 );
+		m_nPatternTickPosition += nNextTick - 1 - tick;
+		nLastTick = nNextTick - 1;
+		tick = nNextTick;
 	}
 
 
@@ -1375,6 +1503,17 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
 	return 0;
 }
 
+/// size of a song column, in ticks
+static inline long columnSize( PatternList* pColumn )
+{
+	// tengo in considerazione solo il primo pattern. I
+	// pattern nel gruppo devono avere la stessa lunghezza.
+	if ( pColumn->size() != 0 ) {
+		return pColumn->get( 0 )->get_length();
+	}
+	return MAX_NOTES;
+}
+
 /// restituisce l'indice relativo al patternGroup in base al tick
 inline int findPatternInTick( int nTick, bool bLoopMode, int *pPatternStartTick )
 {
@@ -1382,50 +1521,38 @@ inline int findPatternInTick( int nTick, bool bLoopMode, int *pPatternStartTick
 	Song* pSong = pHydrogen->getSong();
 	assert( pSong );
 
-	int nTotalTick = 0;
-	m_nSongSizeInTicks = 0;
-
 	std::vector<PatternList*> *pPatternColumns = pSong->get_pattern_group_vector();
 	int nColumns = pPatternColumns->size();
 
-	int nPatternSize;
-	for ( int i = 0; i < nColumns; ++i ) {
-		PatternList *pColumn = ( *pPatternColumns )[ i ];
-		if ( pColumn->size() != 0 ) {
-			// tengo in considerazione solo il primo pattern. I
-			// pattern nel gruppo devono avere la stessa lunghezza.
-			nPatternSize = pColumn->get( 0 )->get_length();
-		} else {
-			nPatternSize = MAX_NOTES;
+	if ( m_pSongTimeline
+		 && m_pSongTimeline->generation == pSong->get_pattern_generation() ) {
+		const std::vector<long>& timeline = m_pSongTimeline->start_ticks;
+		long nLoopTick = nTick;
+		if ( nLoopTick >= m_nSongSizeInTicks && bLoopMode && m_nSongSizeInTicks != 0 ) {
+			nLoopTick = nLoopTick % m_nSongSizeInTicks;
 		}
-
-		if ( ( nTick >= nTotalTick ) && ( nTick < nTotalTick + nPatternSize ) ) {
-			( *pPatternStartTick ) = nTotalTick;
-			return i;
+		if ( nLoopTick >= 0 && nLoopTick < m_nSongSizeInTicks ) {
+			// the last column starting at or before the tick,
+			// empty patterns start where the next column does
+			int nColumn = std::upper_bound( timeline.begin(), timeline.end(), nLoopTick )
+						  - timeline.begin() - 1;
+			( *pPatternStartTick ) = timeline[ nColumn ];
+			return nColumn;
 		}
-		nTotalTick += nPatternSize;
-	}
-
-	if ( bLoopMode ) {
-		m_nSongSizeInTicks = nTotalTick;
-		int nLoopTick = 0;
-		if ( m_nSongSizeInTicks != 0 ) {
-			nLoopTick = nTick % m_nSongSizeInTicks;
+	} else {
+		// the patterns changed since updateSongTimeline(), walk them
+		m_nSongSizeInTicks = 0;
+		for ( int i = 0; i < nColumns; ++i ) {
+			m_nSongSizeInTicks += columnSize( ( *pPatternColumns )[ i ] );
 		}
-		nTotalTick = 0;
+		long nLoopTick = nTick;
+		if ( nLoopTick >= m_nSongSizeInTicks && bLoopMode && m_nSongSizeInTicks != 0 ) {
+			nLoopTick = nLoopTick % m_nSongSizeInTicks;
+		}
+		long nTotalTick = 0;
 		for ( int i = 0; i < nColumns; ++i ) {
-			PatternList *pColumn = ( *pPatternColumns )[ i ];
-			if ( pColumn->size() != 0 ) {
-				// tengo in considerazione solo il primo
-				// pattern. I pattern nel gruppo devono avere la
-				// stessa lunghezza.
-				nPatternSize = pColumn->get( 0 )->get_length();
-			} else {
-				nPatternSize = MAX_NOTES;
-			}
-
-			if ( ( nLoopTick >= nTotalTick )
-				 && ( nLoopTick < nTotalTick + nPatternSize ) ) {
+			long nPatternSize = columnSize( ( *pPatternColumns )[ i ] );
+			if ( ( nLoopTick >= nTotalTick ) && ( nLoopTick < nTotalTick + nPatternSize ) ) {
 				( *pPatternStartTick ) = nTotalTick;
 				return i;
 			}
@@ -1433,11 +1560,49 @@ inline int findPatternInTick( int nTick, bool bLoopMode, int *pPatternStartTick
 		}
 	}
 
-	QString err = QString( "[findPatternInTick] tick = %1. No pattern found" ).arg( QString::number(nTick) );
-	___ERRORLOG( err );
+	___ERRORLOG_RT( "[findPatternInTick] tick = %1. No pattern found" ).arg( nTick );
 	return -1;
 }
 
+/// build the timeline of a song and hand it to the audio thread
+void audioEngine_updateSongTimeline( Song* pSong )
+{
+	std::vector<PatternList*> *pPatternColumns = pSong->get_pattern_group_vector();
+	int nColumns = pPatternColumns->size();
+
+	static unsigned nSerial = 0;
+	SongTimeline* pTimeline = new SongTimeline();
+	pTimeline->serial = ++nSerial;
+	pTimeline->generation = pSong->get_pattern_generation();
+	pTimeline->start_ticks.resize( nColumns + 1 );
+	pTimeline->playing_patterns.resize( nColumns );
+	long nTotalTick = 0;
+	for ( int i = 0; i < nColumns; ++i ) {
+		PatternList* pColumn = ( *pPatternColumns )[ i ];
+		pTimeline->start_ticks[ i ] = nTotalTick;
+		nTotalTick += columnSize( pColumn );
+
+		// PatternList drops the duplicates
+		PatternList playing;
+		for ( int j = 0; j < pColumn->size(); ++j ) {
+			Pattern* pPattern = pColumn->get( j );
+			playing.add( pPattern );
+			pPattern->extand_with_flattened_virtual_patterns( &playing );
+		}
+		std::vector<Pattern*>& patterns = pTimeline->playing_patterns[ i ];
+		for ( int j = 0; j < playing.size(); ++j ) {
+			patterns.push_back( playing.get( j ) );
+		}
+		playing.clear();	// the song owns the patterns
+	}
+	pTimeline->start_ticks[ nColumns ] = nTotalTick;
+
+	// a timeline not taken yet is simply replaced
+	m_pSongTimelines->lock();
+	while ( !m_pSongTimelines->publish( m_pSongTimelines->peek(), pTimeline ) ) {}
+	m_pSongTimelines->unlock();
+}
+
 void audioEngine_noteOn( Note *note )
 {
 	// check current state
@@ -1777,6 +1942,8 @@ Hydrogen::Hydrogen()
 	INFOLOG( "[Hydrogen]" );
 
 	__song = NULL;
+	m_pLoadingDrumkit = NULL;
+	m_pDrumkitLoader = NULL;
 	hydrogenInstance = this;
 	// 	__instance = this;
 	audioEngine_init();
@@ -1791,6 +1958,10 @@ Hydrogen::Hydrogen()
 Hydrogen::~Hydrogen()
 {
 	INFOLOG( "[~Hydrogen]" );
+	if ( m_pDrumkitLoader ) {
+		cancelDrumkitLoad();
+		finishDrumkitLoad();
+	}
 	if ( m_audioEngineState == STATE_PLAYING ) {
 		audioEngine_stop();
 	}
@@ -1809,6 +1980,8 @@ void Hydrogen::create_instance()
 	MidiMap::create_instance();
 	Preferences::create_instance();
 	EventQueue::create_instance();
+	SampleCache::create_instance();
+	SampleCache::get_instance()->set_disk_limit( Preferences::get_instance()->m_nSampleCacheSize * 1024LL * 1024LL );
 	MidiActionManager::create_instance();
 
 	if ( __instance == 0 ) {
@@ -1865,11 +2038,25 @@ void Hydrogen::setSong( Song *pSong )
 	EventQueue::get_instance()->push_event( EVENT_PATTERN_CHANGED, -1 );
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 
+	audioEngine_updateSongTimeline( pSong );
 	audioEngine_setSong ( pSong );
 
 	__song = pSong;
 }
 
+void Hydrogen::updateSongTimeline()
+{
+	Song* pSong = getSong();
+	if ( pSong ) {
+		audioEngine_updateSongTimeline( pSong );
+	}
+}
+
+long Hydrogen::getSongSizeInTicks()
+{
+	return m_nSongSizeInTicks;
+}
+
 /* Mean: remove current song from memory */
 void Hydrogen::removeSong()
 {
@@ -1890,6 +2077,33 @@ void Hydrogen::addRealtimeNote( int instrument,
 								bool noteOff,
 								bool forcePlay,
 								int msg1 )
+{
+	// the audio thread plays it at its next period, the realtime tick keeps
+	// the time it was played at within the period
+	RealtimeNote note;
+	note.instrument = instrument;
+	note.velocity = velocity;
+	note.pan_L = pan_L;
+	note.pan_R = pan_R;
+	note.pitch = pitch;
+	note.noteOff = noteOff;
+	note.forcePlay = forcePlay;
+	note.msg1 = msg1;
+	note.realtimeTick = getRealtimeTickPosition();
+	if ( !m_realtimeNotes.push( note ) ) {
+		WARNINGLOG( "Realtime note dropped, the queue is full" );
+	}
+}
+
+void Hydrogen::playRealtimeNote( int instrument,
+								 float velocity,
+								 float pan_L,
+								 float pan_R,
+								 float pitch,
+								 bool noteOff,
+								 bool forcePlay,
+								 int msg1,
+								 unsigned long realtimeTick )
 {
 	UNUSED( pitch );
 
@@ -1901,13 +2115,10 @@ void Hydrogen::addRealtimeNote( int instrument,
 	bool hearnote = forcePlay;
 	int currentPatternNumber;
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
-
 	Song *pSong = getSong();
 	if ( !pref->__playselectedinstrument ) {
 		if ( instrument >= ( int ) pSong->get_instrument_list()->size() ) {
 			// unused instrument
-			AudioEngine::get_instance()->unlock();
 			return;
 		}
 	}
@@ -1925,7 +2136,6 @@ void Hydrogen::addRealtimeNote( int instrument,
 		PatternList *pPatternList = pSong->get_pattern_list();
 		int ipattern = getPatternPos(); // playlist index
 		if ( ipattern < 0 || ipattern >= (int) pPatternList->size() ) {
-			AudioEngine::get_instance()->unlock(); // unlock the audio engine
 			return;
 		}
 		// Locate column -- may need to jump back in the pattern list
@@ -1933,7 +2143,6 @@ void Hydrogen::addRealtimeNote( int instrument,
 		while ( column < lookaheadTicks ) {
 			ipattern -= 1;
 			if ( ipattern < 0 || ipattern >= (int) pPatternList->size() ) {
-				AudioEngine::get_instance()->unlock(); // unlock the audio engine
 				return;
 			}
 
@@ -1967,15 +2176,15 @@ void Hydrogen::addRealtimeNote( int instrument,
 	} else { // Not song-record mode
 		PatternList *pPatternList = pSong->get_pattern_list();
 
-		if ( ( m_nSelectedPatternNumber != -1 )
-			 && ( m_nSelectedPatternNumber < ( int )pPatternList->size() ) )
+		int nSelected = m_nSelectedPatternNumber;
+		if ( ( nSelected >= 0 )
+			 && ( nSelected < ( int )pPatternList->size() ) )
 		{
-			currentPattern = pPatternList->get( m_nSelectedPatternNumber );
-			currentPatternNumber = m_nSelectedPatternNumber;
+			currentPattern = pPatternList->get( nSelected );
+			currentPatternNumber = nSelected;
 		}
 
 		if ( ! currentPattern ) {
-			AudioEngine::get_instance()->unlock(); // unlock the audio engine
 			return;
 		}
 
@@ -1990,7 +2199,7 @@ void Hydrogen::addRealtimeNote( int instrument,
 		}
 	}
 
-	realcolumn = getRealtimeTickPosition();
+	realcolumn = realtimeTick;
 
 	if ( pref->getQuantizeEvents() ) {
 		// quantize it to scale
@@ -2087,7 +2296,7 @@ void Hydrogen::addRealtimeNote( int instrument,
 							noteAction.b_isInstrumentMode = replaceExisting;
 							noteAction.b_isMidi = true;
 							noteAction.b_noteExist = replaceExisting;
-							EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+							EventQueue::get_instance()->push_note_edit( noteAction );
 							continue;
 						}
 						if ( ( pNote->get_just_recorded() == false )
@@ -2110,7 +2319,7 @@ void Hydrogen::addRealtimeNote( int instrument,
 							noteAction.b_isInstrumentMode = replaceExisting;
 							noteAction.b_isMidi = true;
 							noteAction.b_noteExist = replaceExisting;
-							EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+							EventQueue::get_instance()->push_note_edit( noteAction );
 						}
 					}
 					continue;
@@ -2140,7 +2349,7 @@ void Hydrogen::addRealtimeNote( int instrument,
 					noteAction.b_isInstrumentMode = false;
 					noteAction.b_isMidi = false;
 					noteAction.b_noteExist = replaceExisting;
-					EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+					EventQueue::get_instance()->push_note_edit( noteAction );
 					continue;
 				}
 
@@ -2163,7 +2372,7 @@ void Hydrogen::addRealtimeNote( int instrument,
 					noteAction.b_isInstrumentMode = false;
 					noteAction.b_isMidi = false;
 					noteAction.b_noteExist = replaceExisting;
-					EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+					EventQueue::get_instance()->push_note_edit( noteAction );
 				}
 			} /* FOREACH */
 		} /* if dorecord ... */
@@ -2200,7 +2409,7 @@ void Hydrogen::addRealtimeNote( int instrument,
 				noteAction.b_isInstrumentMode = false;
 				noteAction.b_isMidi = true;
 				noteAction.b_noteExist = bNoteAlreadyExist;
-				EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+				EventQueue::get_instance()->push_note_edit( noteAction );
 
 				// hear note if its not in the future
 				if ( pref->getHearNewNotes() && position <= getTickPosition() )
@@ -2221,7 +2430,7 @@ void Hydrogen::addRealtimeNote( int instrument,
 				noteAction.b_isInstrumentMode = true;
 				noteAction.b_isMidi = true;
 				noteAction.b_noteExist = bNoteAlreadyExist;
-				EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+				EventQueue::get_instance()->push_note_edit( noteAction );
 
 				// hear note if its not in the future
 				if ( pref->getHearNewNotes() && position <= getTickPosition() )
@@ -2234,12 +2443,12 @@ void Hydrogen::addRealtimeNote( int instrument,
 
 	if ( !pref->__playselectedinstrument ) {
 		if ( hearnote && instrRef ) {
-			Note *note2 = new Note( instrRef, realcolumn, velocity, pan_L, pan_R, -1, 0 );
+			Note *note2 = AudioEngine::get_instance()->get_note_pool()->acquire( instrRef, realcolumn, velocity, pan_L, pan_R, -1, 0 );
 			midi_noteOn( note2 );
 		}
 	} else if ( hearnote  ) {
 		Instrument* pInstr = pSong->get_instrument_list()->get( getSelectedInstrumentNumber() );
-		Note *note2 = new Note( pInstr, realcolumn, velocity, pan_L, pan_R, -1, 0 );
+		Note *note2 = AudioEngine::get_instance()->get_note_pool()->acquire( pInstr, realcolumn, velocity, pan_L, pan_R, -1, 0 );
 
 		int divider = msg1 / 12;
 		Note::Octave octave = (Note::Octave)(divider -3);
@@ -2249,8 +2458,6 @@ void Hydrogen::addRealtimeNote( int instrument,
 		note2->set_midi_info( notehigh, octave, msg1 );
 		midi_noteOn( note2 );
 	}
-
-	AudioEngine::get_instance()->unlock(); // unlock the audio engine
 }
 
 float Hydrogen::getMasterPeak_L()
@@ -2302,9 +2509,14 @@ PatternList* Hydrogen::getCurrentPatternList()
 	return m_pPlayingPatterns;
 }
 
-PatternList * Hydrogen::getNextPatterns()
+bool Hydrogen::isNextPattern( Pattern* pPattern )
 {
-	return m_pNextPatterns;
+	m_pNextPatterns->lock();
+	const NextPatterns* pNextPatterns = m_pNextPatterns->peek();
+	bool bNext = pNextPatterns
+				 && std::find( pNextPatterns->begin(), pNextPatterns->end(), pPattern ) != pNextPatterns->end();
+	m_pNextPatterns->unlock();
+	return bNext;
 }
 
 /// Set the next pattern (Pattern mode only)
@@ -2313,31 +2525,47 @@ void Hydrogen::sequencer_setNextPattern( int pos, bool appendPattern, bool delet
 	m_bAppendNextPattern = appendPattern;
 	m_bDeleteNextPattern = deletePattern;
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
-
+	Pattern * p = NULL;
 	Song* pSong = getSong();
 	if ( pSong && pSong->get_mode() == Song::PATTERN_MODE ) {
 		PatternList *patternList = pSong->get_pattern_list();
-		Pattern * p = patternList->get( pos );
 		if ( ( pos >= 0 ) && ( pos < ( int )patternList->size() ) ) {
-			// if p is already on the next pattern list, delete it.
-			if ( m_pNextPatterns->del( p ) == NULL ) {
-				// WARNINGLOG( "Adding to nextPatterns" );
-				m_pNextPatterns->add( p );
-			} /* else {
-				// WARNINGLOG( "Removing " + to_string(pos) );
-			}*/
+			p = patternList->get( pos );
 		} else {
 			ERRORLOG( QString( "pos not in patternList range. pos=%1 patternListSize=%2" )
 					  .arg( pos ).arg( patternList->size() ) );
-			m_pNextPatterns->clear();
 		}
 	} else {
 		ERRORLOG( "can't set next pattern in song mode" );
-		m_pNextPatterns->clear();
 	}
 
-	AudioEngine::get_instance()->unlock();
+	// the audio thread takes the list at the next pattern start, it never
+	// waits for this edit, nor the edit for the current period
+	m_pNextPatterns->lock();
+	for (;;) {
+		const NextPatterns* pCurrent = m_pNextPatterns->peek();
+		NextPatterns* pNext = NULL;
+		if ( p ) {
+			pNext = pCurrent ? new NextPatterns( *pCurrent ) : new NextPatterns();
+			// if p is already on the next pattern list, delete it.
+			NextPatterns::iterator it = std::find( pNext->begin(), pNext->end(), p );
+			if ( it == pNext->end() ) {
+				pNext->push_back( p );
+			} else {
+				pNext->erase( it );
+			}
+			if ( pNext->empty() ) {
+				delete pNext;
+				pNext = NULL;
+			}
+		}
+		if ( m_pNextPatterns->publish( pCurrent, pNext ) ) {
+			break;
+		}
+		// the audio thread just took the list, start from an empty one
+		delete pNext;
+	}
+	m_pNextPatterns->unlock();
 }
 
 int Hydrogen::getPatternPos()
@@ -2351,13 +2579,15 @@ void Hydrogen::restartDrivers()
 }
 
 /// Export a song to a wav file, returns the elapsed time in mSec
-void Hydrogen::startExportSong( const QString& filename, int rate, int depth )
+void Hydrogen::startExportSong( const QString& filename, int rate, int depth, const QStringList& trackFilenames )
 {
 	if ( getState() == STATE_PLAYING ) {
 		sequencer_stop();
 	}
 
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	AudioEngine::get_instance()->get_sampler()->stop_playing_notes();
+	AudioEngine::get_instance()->unlock();
 	Preferences *pPref = Preferences::get_instance();
 
 	Song* pSong = getSong();
@@ -2371,9 +2601,12 @@ void Hydrogen::startExportSong( const QString& filename, int rate, int depth )
 	// stop all audio drivers
 	audioEngine_stopAudioDrivers();
 
+	// no deadline to meet, the streamed samples wait for the disk reads
+	AudioEngine::get_instance()->get_sampler()->set_stream_wait( true );
+
 	/* FIXME: Questo codice fa davvero schifo.... */
 
-	m_pAudioDriver = new DiskWriterDriver( audioEngine_process, nSamplerate, filename, depth );
+	m_pAudioDriver = new DiskWriterDriver( audioEngine_renderOffline, nSamplerate, filename, depth, trackFilenames );
 
 	// reset
 	m_pAudioDriver->m_transport.m_nFrames = 0; // reset total frames
@@ -2382,8 +2615,11 @@ void Hydrogen::startExportSong( const QString& filename, int rate, int depth )
 	m_nPatternTickPosition = 0;
 	m_audioEngineState = STATE_PLAYING;
 	m_nPatternStartTick = -1;
+	audioEngine_seedRandom( pSong );
 
-	int res = m_pAudioDriver->init( pPref->m_nBufferSize );
+	// no latency to care about, render in the largest periods the engine
+	// buffers can hold
+	int res = m_pAudioDriver->init( MAX_BUFFER_SIZE );
 	if ( res != 0 ) {
 		ERRORLOG( "Error starting disk writer driver [DiskWriterDriver::init()]" );
 	}
@@ -2393,7 +2629,9 @@ void Hydrogen::startExportSong( const QString& filename, int rate, int depth )
 
 	audioEngine_setupLadspaFX( m_pAudioDriver->getBufferSize() );
 
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	audioEngine_seek( 0, false );
+	AudioEngine::get_instance()->unlock();
 
 	res = m_pAudioDriver->connect();
 	if ( res != 0 ) {
@@ -2417,6 +2655,10 @@ void Hydrogen::stopExportSong( bool reconnectOldDriver )
 	m_pMainBuffer_L = NULL;
 	m_pMainBuffer_R = NULL;
 
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->get_sampler()->set_stream_wait( false );
+	AudioEngine::get_instance()->unlock();
+
 	Song* pSong = getSong();
 	pSong->set_mode( m_oldEngineMode );
 	pSong->set_loop_enabled( m_bOldLoopEnabled );
@@ -2471,6 +2713,7 @@ void Hydrogen::setCurrentPatternList( PatternList *pPatternList )
 {
 	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	m_pPlayingPatterns = pPatternList;
+	m_nPlayingColumn = -1;
 	EventQueue::get_instance()->push_event( EVENT_PATTERN_CHANGED, -1 );
 	AudioEngine::get_instance()->unlock();
 }
@@ -2487,18 +2730,76 @@ float Hydrogen::getMaxProcessTime()
 
 int Hydrogen::loadDrumkit( Drumkit *drumkitInfo )
 {
-	assert ( drumkitInfo );
+	if ( startDrumkitLoad( drumkitInfo ) != 0 ) {
+		return -1;
+	}
+	return finishDrumkitLoad();
+}
 
-	int old_ae_state = m_audioEngineState;
-	if( m_audioEngineState >= STATE_READY ) {
-		m_audioEngineState = STATE_PREPARED;
+int Hydrogen::startDrumkitLoad( Drumkit *drumkitInfo )
+{
+	assert ( drumkitInfo );
+	if ( m_pDrumkitLoader ) {
+		ERRORLOG( QString( "%1 is still loading, %2 not loaded" )
+				  .arg( m_pLoadingDrumkit->get_name() ).arg( drumkitInfo->get_name() ) );
+		return -1;
 	}
 
 	INFOLOG( drumkitInfo->get_name() );
-	m_currentDrumkit = drumkitInfo->get_name();
-	LocalFileMng fileMng;
-	QString sDrumkitPath = Filesystem::drumkit_path_search( drumkitInfo->get_name() );
+	m_pLoadingDrumkit = drumkitInfo;
+	m_pDrumkitLoader = new SampleLoader( true );
+
+	// the samples are decoded aside, the song keeps playing the current drumkit meanwhile
+	InstrumentList *pDrumkitInstrList = drumkitInfo->get_instruments();
+	m_drumkitSamples.resize( pDrumkitInstrList->size() * MAX_LAYERS );
+	for ( unsigned nInstr = 0; nInstr < pDrumkitInstrList->size(); ++nInstr ) {
+		Instrument::queue_samples( drumkitInfo, pDrumkitInstrList->get( nInstr ),
+								   m_pDrumkitLoader, &m_drumkitSamples[ nInstr * MAX_LAYERS ] );
+	}
+	m_pDrumkitLoader->start();
+	return 0;
+}
+
+bool Hydrogen::isDrumkitLoading()
+{
+	return m_pDrumkitLoader && m_pDrumkitLoader->is_loading();
+}
+
+int Hydrogen::getDrumkitLoadProgress()
+{
+	return m_pDrumkitLoader ? m_pDrumkitLoader->get_progress() : 100;
+}
 
+void Hydrogen::cancelDrumkitLoad()
+{
+	if ( m_pDrumkitLoader ) {
+		m_pDrumkitLoader->cancel();
+	}
+}
+
+int Hydrogen::finishDrumkitLoad()
+{
+	if ( !m_pDrumkitLoader ) {
+		ERRORLOG( "no drumkit is loading" );
+		return -1;
+	}
+
+	Drumkit *drumkitInfo = m_pLoadingDrumkit;
+	bool bLoaded = m_pDrumkitLoader->wait();
+	delete m_pDrumkitLoader;
+	m_pDrumkitLoader = NULL;
+	m_pLoadingDrumkit = NULL;
+
+	if ( !bLoaded ) {
+		INFOLOG( QString( "%1 load cancelled" ).arg( drumkitInfo->get_name() ) );
+		for ( unsigned i = 0; i < m_drumkitSamples.size(); ++i ) {
+			delete m_drumkitSamples[ i ];
+		}
+		m_drumkitSamples.clear();
+		return -1;
+	}
+
+	m_currentDrumkit = drumkitInfo->get_name();
 
 	//current instrument list
 	InstrumentList *songInstrList = getSong()->get_instrument_list();
@@ -2531,6 +2832,10 @@ int Hydrogen::loadDrumkit( Drumkit *drumkitInfo )
 	//needed for the new delete function
 	int instrumentDiff =  songInstrList->size() - pDrumkitInstrList->size();
 
+	// every sample is decoded, the instruments are swapped in one go and
+	// the song keeps playing, the replaced layers are freed once unlocked
+	std::vector<InstrumentLayer*> oldLayers( pDrumkitInstrList->size() * MAX_LAYERS );
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	for ( unsigned nInstr = 0; nInstr < pDrumkitInstrList->size(); ++nInstr ) {
 		Instrument *pInstr = NULL;
 		if ( nInstr < songInstrList->size() ) {
@@ -2539,23 +2844,21 @@ int Hydrogen::loadDrumkit( Drumkit *drumkitInfo )
 			assert( pInstr );
 		} else {
 			pInstr = new Instrument();
-			// The instrument isn't playing yet; no need for locking
-			// :-) - Jakob Lund.  AudioEngine::get_instance()->lock(
-			// "Hydrogen::loadDrumkit" );
 			songInstrList->add( pInstr );
-			// AudioEngine::get_instance()->unlock();
 		}
 
 		Instrument *pNewInstr = pDrumkitInstrList->get( nInstr );
 		assert( pNewInstr );
-		INFOLOG( QString( "Loading instrument (%1 of %2) [%3]" )
-				 .arg( nInstr )
-				 .arg( pDrumkitInstrList->size() )
-				 .arg( pNewInstr->get_name() ) );
 
 		// creo i nuovi layer in base al nuovo strumento
 		// Moved code from here right into the Instrument class - Jakob Lund.
-		pInstr->load_from( drumkitInfo, pNewInstr );
+		pInstr->load_from( drumkitInfo, pNewInstr, &m_drumkitSamples[ nInstr * MAX_LAYERS ],
+						   &oldLayers[ nInstr * MAX_LAYERS ] );
+	}
+	AudioEngine::get_instance()->unlock();
+	m_drumkitSamples.clear();
+	for ( unsigned i = 0; i < oldLayers.size(); ++i ) {
+		delete oldLayers[ i ];
 	}
 
 
@@ -2575,8 +2878,6 @@ int Hydrogen::loadDrumkit( Drumkit *drumkitInfo )
 	AudioEngine::get_instance()->unlock();
 #endif
 
-	m_audioEngineState = old_ae_state;
-
 	return 0;	//ok
 }
 
@@ -2716,6 +3017,54 @@ long Hydrogen::getTickForPosition( int pos )
 	return totalTick;
 }
 
+int Hydrogen::getPosForTick( unsigned long nTick, bool bLoopMode, int* pPatternStartTick )
+{
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	audioEngine_takeSongTimeline();
+	int nPos = findPatternInTick( nTick, bLoopMode, pPatternStartTick );
+	AudioEngine::get_instance()->unlock();
+	return nPos;
+}
+
+void Hydrogen::sequenceSong( unsigned nFrames, unsigned nPeriod, std::vector<Note*>* pNotes )
+{
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	if ( m_audioEngineState != STATE_READY ) {
+		ERRORLOG( "Error the audio engine is not in READY state" );
+		AudioEngine::get_instance()->unlock();
+		return;
+	}
+
+	audioEngine_takeSongTimeline();
+	audioEngine_seedRandom( getSong() );
+	audioEngine_start( false, 0 );
+
+	// the periods of audioEngine_process_render, the notes are copied
+	// instead of played
+	Note* notes[ 64 ];
+	for ( unsigned nFrame = 0; nFrame < nFrames; nFrame += nPeriod ) {
+		if ( audioEngine_updateNoteQueue( nPeriod ) == -1 ) {
+			break;
+		}
+		int nNotes;
+		do {
+			nNotes = m_pSongNoteQueue->pop_due( ( long long )nFrame + nPeriod,
+												m_pAudioDriver->m_transport.m_nTickSize,
+												notes, 64 );
+			for ( int nNote = 0; nNote < nNotes; ++nNote ) {
+				pNotes->push_back( new Note( notes[ nNote ] ) );
+				notes[ nNote ]->get_instrument()->dequeue();
+				AudioEngine::get_instance()->get_note_pool()->release( notes[ nNote ] );
+			}
+		} while ( nNotes == 64 );
+		m_pAudioDriver->m_transport.m_nFrames += nPeriod;
+	}
+
+	audioEngine_stop( false );
+	m_pAudioDriver->locate( 0 );
+	AudioEngine::get_instance()->unlock();
+}
+
 /// Set the position in the song
 void Hydrogen::setPatternPos( int pos )
 {
@@ -2859,6 +3208,61 @@ void Hydrogen::setBPM( float fBPM )
 	}
 }
 
+void Hydrogen::recalculateRubberband( float fBpm )
+{
+	Song* pSong = getSong();
+	if ( !pSong ) {
+		return;
+	}
+	// Sample::load stretches to the jack time master tempo
+	m_nNewBpmJTM = fBpm;
+
+	InstrumentList* pInstrList = pSong->get_instrument_list();
+	for ( unsigned nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
+		Instrument* pInstr = pInstrList->get( nInstr );
+		for ( int nLayer = 0; nLayer < MAX_LAYERS; nLayer++ ) {
+			InstrumentLayer* pLayer = pInstr->get_layer( nLayer );
+			if ( !pLayer ) {
+				continue;
+			}
+			Sample* pSample = pLayer->get_sample();
+			if ( !pSample || !pSample->get_rubberband().use ) {
+				continue;
+			}
+			Sample* pNewSample = Sample::load( pSample->get_filepath(),
+											   pSample->get_loops(),
+											   pSample->get_rubberband(),
+											   *pSample->get_velocity_envelope(),
+											   *pSample->get_pan_envelope() );
+			if ( !pNewSample ) {
+				continue;
+			}
+			AudioEngine::get_instance()->lock( RIGHT_HERE );
+			pLayer->set_sample( pNewSample );
+			AudioEngine::get_instance()->unlock();
+			delete pSample;
+		}
+	}
+}
+
+void Hydrogen::setRandomSeed( unsigned nSeed )
+{
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	m_nRandomSeed = nSeed;
+	audioEngine_seedRandom( getSong() );
+	AudioEngine::get_instance()->unlock();
+}
+
+void Hydrogen::setMaxNotes( int nMaxNotes )
+{
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	AudioEngine::get_instance()->set_max_notes( nMaxNotes );
+	if ( m_pSongNoteQueue ) {
+		m_pSongNoteQueue->reserve( AudioEngine::get_instance()->get_note_pool()->get_capacity() );
+	}
+	AudioEngine::get_instance()->unlock();
+}
+
 void Hydrogen::restartLadspaFX()
 {
 	if ( m_pAudioDriver ) {
@@ -3214,9 +3618,11 @@ void Hydrogen::togglePlaysSelected()
 
 	if (isPlaysSelected) {
 		m_pPlayingPatterns->clear();
-		Pattern * pSelectedPattern =
-				pSong->get_pattern_list()->get(m_nSelectedPatternNumber);
-		m_pPlayingPatterns->add( pSelectedPattern );
+		int nSelected = m_nSelectedPatternNumber;
+		if ( nSelected >= 0
+			 && nSelected < ( int )pSong->get_pattern_list()->size() ) {
+			m_pPlayingPatterns->add( pSong->get_pattern_list()->get( nSelected ) );
+		}
 	}
 
 	pPref->setPatternModePlaysSelected( !isPlaysSelected );
@@ -3252,7 +3658,9 @@ void Hydrogen::__kill_instruments()
 void Hydrogen::__panic()
 {
 	sequencer_stop();
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	AudioEngine::get_instance()->get_sampler()->stop_playing_notes();
+	AudioEngine::get_instance()->unlock();
 }
 
 int Hydrogen::__get_selected_PatterNumber()
@@ -28,10 +28,12 @@
 
 #ifdef WIN32
 #include <windows.h>
-#define LOGGER_SLEEP Sleep( 100 )
+#define LOGGER_SLEEP( ms ) Sleep( ms )
+#define LOGGER_DRAIN_INTERVAL 100
 #else
 #include <unistd.h>
-#define LOGGER_SLEEP usleep( 1000000 )
+#define LOGGER_SLEEP( ms ) usleep( ( ms ) * 1000 )
+#define LOGGER_DRAIN_INTERVAL 1000
 #endif
 
 namespace H2Core {
@@ -66,9 +68,26 @@ void* loggerThread_func( void* param ) {
 	}
 	Logger::queue_t* queue = &logger->__msg_queue;
 	Logger::queue_t::iterator it, last;
+	Logger::record_t records[ 64 ];
+	int nrecords;
+	unsigned records_lost = 0;
 	//QString tmpString;
 	while ( logger->__running ) {
-		LOGGER_SLEEP;
+		LOGGER_SLEEP( logger->__drain_interval );
+		while( ( nrecords = logger->__records.pop( records, 64 ) ) > 0 ) {
+			for( int i = 0; i < nrecords; i++ ) {
+				QByteArray line = Logger::format( records[i] ).toLocal8Bit();
+				fprintf( stdout, "%s", line.data() );
+				if( log_file ) {
+					fprintf( log_file, "%s", line.data() );
+					fflush( log_file );
+				}
+			}
+		}
+		if( logger->records_lost() != records_lost ) {
+			records_lost = logger->records_lost();
+			fprintf( stderr, "Warning: %u realtime log records lost\n", records_lost );
+		}
 		if( !queue->empty() ) {
 			for( it = last = queue->begin() ; it != queue->end() ; ++it ) {
 				last = it;
@@ -93,7 +112,7 @@ void* loggerThread_func( void* param ) {
 #ifdef WIN32
 	::FreeConsole();
 #endif
-	LOGGER_SLEEP;
+	LOGGER_SLEEP( logger->__drain_interval );
 	pthread_exit( 0 );
 	return 0;
 }
@@ -108,7 +127,7 @@ Logger* Logger::create_instance() {
 	return __instance;
 }
 
-Logger::Logger() : __use_file( false ), __running( true ) {
+Logger::Logger() : __use_file( false ), __running( true ), __drain_interval( LOGGER_DRAIN_INTERVAL ) {
 	__instance = this;
 	pthread_attr_t attr;
 	pthread_attr_init( &attr );
@@ -123,6 +142,27 @@ Logger::~Logger() {
 
 void Logger::log( unsigned level, const QString& class_name, const char* func_name, const QString& msg ) {
 	if( level == None ) return;
+	QString tmp = format( level, class_name, func_name, msg );
+	pthread_mutex_lock( &__mutex );
+	__msg_queue.push_back( tmp );
+	pthread_mutex_unlock( &__mutex );
+}
+
+QString Logger::format( const record_t& record ) {
+	QString msg( record.format );
+	for( int i = 0; i < record.nargs; i++ ) {
+		double arg = record.args[i];
+		// integers are passed as doubles too, print them as such
+		if( arg == ( qlonglong )arg ) {
+			msg = msg.arg( ( qlonglong )arg );
+		} else {
+			msg = msg.arg( arg );
+		}
+	}
+	return format( record.level, record.class_name, record.func_name, msg );
+}
+
+QString Logger::format( unsigned level, const QString& class_name, const char* func_name, const QString& msg ) {
 	const char* prefix[] = { "", "(E) ", "(W) ", "(I) ", "(D) " };
 #ifdef WIN32
 	const char* color[] = { "", "", "", "", "" };
@@ -153,16 +193,12 @@ void Logger::log( unsigned level, const QString& class_name, const char* func_na
 		break;
 	}
 
-	QString tmp = QString( "%1%2%3::%4 %5\033[0m\n" )
-				  .arg( color[i] )
-				  .arg( prefix[i] )
-				  .arg( class_name )
-				  .arg( func_name )
-				  .arg( msg );
-
-	pthread_mutex_lock( &__mutex );
-	__msg_queue.push_back( tmp );
-	pthread_mutex_unlock( &__mutex );
+	return QString( "%1%2%3::%4 %5\033[0m\n" )
+		   .arg( color[i] )
+		   .arg( prefix[i] )
+		   .arg( class_name )
+		   .arg( func_name )
+		   .arg( msg );
 }
 
 unsigned Logger::parse_log_level( const char* level ) {
@@ -185,6 +185,12 @@ Preferences::Preferences()
 	m_bUseMetronome = false;
 	m_fMetronomeVolume = 0.5;
 	m_nMaxNotes = 256;
+	m_nRenderThreads = 1;
+	m_nExportSegments = 1;
+	m_nExportLeadIn = 10000;
+	m_bCompactSamples = false;
+	m_nSampleCacheSize = SAMPLE_CACHE_DISK_SIZE;
+	m_nLogDrainInterval = Logger::get_instance()->drain_interval();
 	m_nBufferSize = 1024;
 	m_nSampleRate = 44100;
 
@@ -473,6 +479,14 @@ void Preferences::loadPreferences( bool bGlobal )
 				m_bUseMetronome = LocalFileMng::readXmlBool( audioEngineNode, "use_metronome", m_bUseMetronome );
 				m_fMetronomeVolume = LocalFileMng::readXmlFloat( audioEngineNode, "metronome_volume", 0.5f );
 				m_nMaxNotes = LocalFileMng::readXmlInt( audioEngineNode, "maxNotes", m_nMaxNotes );
+				m_nRenderThreads = LocalFileMng::readXmlInt( audioEngineNode, "render_threads", m_nRenderThreads );
+				m_nExportSegments = LocalFileMng::readXmlInt( audioEngineNode, "export_segments", m_nExportSegments );
+				m_nExportLeadIn = LocalFileMng::readXmlInt( audioEngineNode, "export_lead_in", m_nExportLeadIn );
+				m_bCompactSamples = LocalFileMng::readXmlBool( audioEngineNode, "compact_samples", m_bCompactSamples );
+				m_nSampleCacheSize = LocalFileMng::readXmlInt( audioEngineNode, "sample_cache_size", m_nSampleCacheSize );
+				m_nLogDrainInterval = LocalFileMng::readXmlInt( audioEngineNode, "log_drain_interval", m_nLogDrainInterval );
+				Logger::get_instance()->set_drain_interval( m_nLogDrainInterval );
+				m_nLogDrainInterval = Logger::get_instance()->drain_interval();
 				m_nBufferSize = LocalFileMng::readXmlInt( audioEngineNode, "buffer_size", m_nBufferSize );
 				m_nSampleRate = LocalFileMng::readXmlInt( audioEngineNode, "samplerate", m_nSampleRate );
 
@@ -835,6 +849,12 @@ void Preferences::savePreferences()
 		LocalFileMng::writeXmlString( audioEngineNode, "use_metronome", m_bUseMetronome ? "true": "false" );
 		LocalFileMng::writeXmlString( audioEngineNode, "metronome_volume", QString("%1").arg( m_fMetronomeVolume ) );
 		LocalFileMng::writeXmlString( audioEngineNode, "maxNotes", QString("%1").arg( m_nMaxNotes ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "render_threads", QString("%1").arg( m_nRenderThreads ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "export_segments", QString("%1").arg( m_nExportSegments ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "export_lead_in", QString("%1").arg( m_nExportLeadIn ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "compact_samples", m_bCompactSamples ? "true": "false" );
+		LocalFileMng::writeXmlString( audioEngineNode, "sample_cache_size", QString("%1").arg( m_nSampleCacheSize ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "log_drain_interval", QString("%1").arg( m_nLogDrainInterval ) );
 		LocalFileMng::writeXmlString( audioEngineNode, "buffer_size", QString("%1").arg( m_nBufferSize ) );
 		LocalFileMng::writeXmlString( audioEngineNode, "samplerate", QString("%1").arg( m_nSampleRate ) );
 
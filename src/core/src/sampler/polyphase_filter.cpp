@@ -0,0 +1,87 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/sampler/polyphase_filter.h>
+
+#include <cmath>
+
+namespace H2Core
+{
+
+const char* PolyphaseFilter::__class_name = "PolyphaseFilter";
+
+/* the highest step each bank is built for, steps above the last one alias */
+static const float __bank_steps[ PolyphaseFilter::BANKS ] = { 1.0, 1.5, 2.0, 3.0 };
+
+/* passband edge relative to the nyquist frequency, leaves room for the transition band */
+static const double __rolloff = 0.95;
+
+PolyphaseFilter::PolyphaseFilter() : Object( __class_name )
+{
+	const int nBankSize = ( PHASES + 1 ) * TAPS;
+	const double fHalfWidth = TAPS / 2;
+	__banks = new float[ BANKS * nBankSize ];
+
+	for ( int nBank = 0; nBank < BANKS; nBank++ ) {
+		double fCutoff = __rolloff / __bank_steps[ nBank ];
+		for ( int nPhase = 0; nPhase <= PHASES; nPhase++ ) {
+			float* pKernel = __banks + nBank * nBankSize + nPhase * TAPS;
+			double fFraction = ( double )nPhase / PHASES;
+			double fSum = 0;
+			double kernel[ TAPS ];
+			for ( int i = 0; i < TAPS; i++ ) {
+				// distance between the tap and the interpolated position
+				double t = ( i - ( TAPS / 2 - 1 ) ) - fFraction;
+				double x = M_PI * fCutoff * t;
+				double fSinc = ( x == 0 ) ? 1.0 : sin( x ) / x;
+				double fWindow = 0;
+				if ( fabs( t ) < fHalfWidth ) {
+					fWindow = 0.42 + 0.5 * cos( M_PI * t / fHalfWidth ) + 0.08 * cos( 2 * M_PI * t / fHalfWidth );
+				}
+				kernel[ i ] = fSinc * fWindow;
+				fSum += kernel[ i ];
+			}
+			// unity gain at DC for every phase
+			for ( int i = 0; i < TAPS; i++ ) {
+				pKernel[ i ] = kernel[ i ] / fSum;
+			}
+		}
+	}
+}
+
+PolyphaseFilter::~PolyphaseFilter()
+{
+	delete[] __banks;
+}
+
+const float* PolyphaseFilter::get_bank( float step ) const
+{
+	int nBank = 0;
+	while ( nBank < BANKS - 1 && step > __bank_steps[ nBank ] ) {
+		nBank++;
+	}
+	return __banks + nBank * ( PHASES + 1 ) * TAPS;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,466 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/sampler/render_kernels.h>
+
+#include <hydrogen/globals.h>
+#include <cstddef>
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+#    define H2_KERNELS_X86
+#    include <immintrin.h>
+#    define H2_TARGET( isa ) __attribute__(( target( isa ) ))
+#endif
+
+// ARMv7 NEON flushes denormals to zero, only the AArch64 unit is IEEE compliant
+#if defined(__aarch64__) && ( defined(__ARM_NEON) || defined(__ARM_NEON__) )
+#    define H2_KERNELS_NEON
+#    include <arm_neon.h>
+#endif
+
+namespace H2Core
+{
+
+/*
+ * Peaks are tracked with ( v > peak ) ? v : peak, which is exactly what
+ * maxps( v, peak ) computes, NaN and signed zero included. As long as the
+ * running peak never goes negative (the mixer resets it to 0), the order in
+ * which lanes are reduced does not change the result.
+ * This file is compiled with -ffp-contract=off, see src/core/CMakeLists.txt.
+ */
+
+static void render_block_scalar( const float* src_l, const float* src_r, const float* env, int frames,
+                                 float cost_l, float cost_r, float cost_track_l, float cost_track_r,
+                                 float* track_l, float* track_r, float* out_l, float* out_r,
+                                 float* peak_l, float* peak_r )
+{
+	float fPeak_L = *peak_l;
+	float fPeak_R = *peak_r;
+	float fVal_L;
+	float fVal_R;
+
+	for ( int i = 0; i < frames; ++i ) {
+		if ( env ) {
+			fVal_L = src_l[ i ] * env[ i ];
+			fVal_R = src_r[ i ] * env[ i ];
+		} else {
+			fVal_L = src_l[ i ];
+			fVal_R = src_r[ i ];
+		}
+
+		if ( track_l ) {
+			track_l[ i ] += fVal_L * cost_track_l;
+		}
+		if ( track_r ) {
+			track_r[ i ] += fVal_R * cost_track_r;
+		}
+
+		fVal_L = fVal_L * cost_l;
+		fVal_R = fVal_R * cost_r;
+
+		if ( fVal_L > fPeak_L ) {
+			fPeak_L = fVal_L;
+		}
+		if ( fVal_R > fPeak_R ) {
+			fPeak_R = fVal_R;
+		}
+
+		out_l[ i ] += fVal_L;
+		out_r[ i ] += fVal_R;
+	}
+
+	*peak_l = fPeak_L;
+	*peak_r = fPeak_R;
+}
+
+static void mix_block_scalar( const float* src_l, const float* src_r, int frames,
+                              float gain_l, float gain_r, float* dst_l, float* dst_r )
+{
+	for ( int i = 0; i < frames; ++i ) {
+		dst_l[ i ] += src_l[ i ] * gain_l;
+		dst_r[ i ] += src_r[ i ] * gain_r;
+	}
+}
+
+/*
+ * Every 16 bit value converts exactly to a float, and the scale is a power of
+ * two, so the converted frames are exact whatever the instruction set.
+ */
+static void convert_block_scalar( const short* src_l, const short* src_r, int frames,
+                                  float* dst_l, float* dst_r )
+{
+	for ( int i = 0; i < frames; ++i ) {
+		dst_l[ i ] = src_l[ i ] * SAMPLE_PCM16_SCALE;
+		dst_r[ i ] = src_r[ i ] * SAMPLE_PCM16_SCALE;
+	}
+}
+
+/** reduce the lanes of a peak vector into a scalar peak, in lane order */
+static inline float reduce_peak( const float* lanes, int count, float peak )
+{
+	for ( int i = 0; i < count; ++i ) {
+		if ( lanes[ i ] > peak ) {
+			peak = lanes[ i ];
+		}
+	}
+	return peak;
+}
+
+#ifdef H2_KERNELS_X86
+
+H2_TARGET( "sse" )
+static void render_block_sse( const float* src_l, const float* src_r, const float* env, int frames,
+                              float cost_l, float cost_r, float cost_track_l, float cost_track_r,
+                              float* track_l, float* track_r, float* out_l, float* out_r,
+                              float* peak_l, float* peak_r )
+{
+	// a single track channel only happens with half registered jack ports
+	if ( ( track_l == NULL ) != ( track_r == NULL ) ) {
+		render_block_scalar( src_l, src_r, env, frames, cost_l, cost_r, cost_track_l, cost_track_r,
+		                     track_l, track_r, out_l, out_r, peak_l, peak_r );
+		return;
+	}
+
+	const __m128 vCost_L = _mm_set1_ps( cost_l );
+	const __m128 vCost_R = _mm_set1_ps( cost_r );
+	const __m128 vCostTrack_L = _mm_set1_ps( cost_track_l );
+	const __m128 vCostTrack_R = _mm_set1_ps( cost_track_r );
+	__m128 vPeak_L = _mm_set1_ps( *peak_l );
+	__m128 vPeak_R = _mm_set1_ps( *peak_r );
+
+	int i = 0;
+	for ( ; i + 4 <= frames; i += 4 ) {
+		__m128 vVal_L = _mm_loadu_ps( src_l + i );
+		__m128 vVal_R = _mm_loadu_ps( src_r + i );
+		if ( env ) {
+			__m128 vEnv = _mm_loadu_ps( env + i );
+			vVal_L = _mm_mul_ps( vVal_L, vEnv );
+			vVal_R = _mm_mul_ps( vVal_R, vEnv );
+		}
+		if ( track_l ) {
+			_mm_storeu_ps( track_l + i, _mm_add_ps( _mm_loadu_ps( track_l + i ), _mm_mul_ps( vVal_L, vCostTrack_L ) ) );
+			_mm_storeu_ps( track_r + i, _mm_add_ps( _mm_loadu_ps( track_r + i ), _mm_mul_ps( vVal_R, vCostTrack_R ) ) );
+		}
+		vVal_L = _mm_mul_ps( vVal_L, vCost_L );
+		vVal_R = _mm_mul_ps( vVal_R, vCost_R );
+		vPeak_L = _mm_max_ps( vVal_L, vPeak_L );
+		vPeak_R = _mm_max_ps( vVal_R, vPeak_R );
+		_mm_storeu_ps( out_l + i, _mm_add_ps( _mm_loadu_ps( out_l + i ), vVal_L ) );
+		_mm_storeu_ps( out_r + i, _mm_add_ps( _mm_loadu_ps( out_r + i ), vVal_R ) );
+	}
+
+	float lanes[ 4 ];
+	_mm_storeu_ps( lanes, vPeak_L );
+	*peak_l = reduce_peak( lanes, 4, *peak_l );
+	_mm_storeu_ps( lanes, vPeak_R );
+	*peak_r = reduce_peak( lanes, 4, *peak_r );
+
+	render_block_scalar( src_l + i, src_r + i, env ? env + i : NULL, frames - i,
+	                     cost_l, cost_r, cost_track_l, cost_track_r,
+	                     track_l ? track_l + i : NULL, track_r ? track_r + i : NULL,
+	                     out_l + i, out_r + i, peak_l, peak_r );
+}
+
+H2_TARGET( "sse" )
+static void mix_block_sse( const float* src_l, const float* src_r, int frames,
+                           float gain_l, float gain_r, float* dst_l, float* dst_r )
+{
+	const __m128 vGain_L = _mm_set1_ps( gain_l );
+	const __m128 vGain_R = _mm_set1_ps( gain_r );
+
+	int i = 0;
+	for ( ; i + 4 <= frames; i += 4 ) {
+		_mm_storeu_ps( dst_l + i, _mm_add_ps( _mm_loadu_ps( dst_l + i ), _mm_mul_ps( _mm_loadu_ps( src_l + i ), vGain_L ) ) );
+		_mm_storeu_ps( dst_r + i, _mm_add_ps( _mm_loadu_ps( dst_r + i ), _mm_mul_ps( _mm_loadu_ps( src_r + i ), vGain_R ) ) );
+	}
+	mix_block_scalar( src_l + i, src_r + i, frames - i, gain_l, gain_r, dst_l + i, dst_r + i );
+}
+
+/* the integer conversions need SSE2, which the cpu check of the SSE kernels asks for */
+H2_TARGET( "sse2" )
+static inline __m128 convert_4_sse2( __m128i vShorts, const __m128 vScale )
+{
+	// sign extended by the arithmetic shift of the value put in the high half
+	return _mm_mul_ps( _mm_cvtepi32_ps( _mm_srai_epi32( vShorts, 16 ) ), vScale );
+}
+
+H2_TARGET( "sse2" )
+static void convert_block_sse( const short* src_l, const short* src_r, int frames,
+                               float* dst_l, float* dst_r )
+{
+	const __m128 vScale = _mm_set1_ps( SAMPLE_PCM16_SCALE );
+
+	int i = 0;
+	for ( ; i + 8 <= frames; i += 8 ) {
+		__m128i vSrc_L = _mm_loadu_si128( ( const __m128i* )( src_l + i ) );
+		__m128i vSrc_R = _mm_loadu_si128( ( const __m128i* )( src_r + i ) );
+		_mm_storeu_ps( dst_l + i, convert_4_sse2( _mm_unpacklo_epi16( vSrc_L, vSrc_L ), vScale ) );
+		_mm_storeu_ps( dst_l + i + 4, convert_4_sse2( _mm_unpackhi_epi16( vSrc_L, vSrc_L ), vScale ) );
+		_mm_storeu_ps( dst_r + i, convert_4_sse2( _mm_unpacklo_epi16( vSrc_R, vSrc_R ), vScale ) );
+		_mm_storeu_ps( dst_r + i + 4, convert_4_sse2( _mm_unpackhi_epi16( vSrc_R, vSrc_R ), vScale ) );
+	}
+	convert_block_scalar( src_l + i, src_r + i, frames - i, dst_l + i, dst_r + i );
+}
+
+H2_TARGET( "avx" )
+static void render_block_avx( const float* src_l, const float* src_r, const float* env, int frames,
+                              float cost_l, float cost_r, float cost_track_l, float cost_track_r,
+                              float* track_l, float* track_r, float* out_l, float* out_r,
+                              float* peak_l, float* peak_r )
+{
+	if ( ( track_l == NULL ) != ( track_r == NULL ) ) {
+		render_block_scalar( src_l, src_r, env, frames, cost_l, cost_r, cost_track_l, cost_track_r,
+		                     track_l, track_r, out_l, out_r, peak_l, peak_r );
+		return;
+	}
+
+	const __m256 vCost_L = _mm256_set1_ps( cost_l );
+	const __m256 vCost_R = _mm256_set1_ps( cost_r );
+	const __m256 vCostTrack_L = _mm256_set1_ps( cost_track_l );
+	const __m256 vCostTrack_R = _mm256_set1_ps( cost_track_r );
+	__m256 vPeak_L = _mm256_set1_ps( *peak_l );
+	__m256 vPeak_R = _mm256_set1_ps( *peak_r );
+
+	int i = 0;
+	for ( ; i + 8 <= frames; i += 8 ) {
+		__m256 vVal_L = _mm256_loadu_ps( src_l + i );
+		__m256 vVal_R = _mm256_loadu_ps( src_r + i );
+		if ( env ) {
+			__m256 vEnv = _mm256_loadu_ps( env + i );
+			vVal_L = _mm256_mul_ps( vVal_L, vEnv );
+			vVal_R = _mm256_mul_ps( vVal_R, vEnv );
+		}
+		if ( track_l ) {
+			_mm256_storeu_ps( track_l + i, _mm256_add_ps( _mm256_loadu_ps( track_l + i ), _mm256_mul_ps( vVal_L, vCostTrack_L ) ) );
+			_mm256_storeu_ps( track_r + i, _mm256_add_ps( _mm256_loadu_ps( track_r + i ), _mm256_mul_ps( vVal_R, vCostTrack_R ) ) );
+		}
+		vVal_L = _mm256_mul_ps( vVal_L, vCost_L );
+		vVal_R = _mm256_mul_ps( vVal_R, vCost_R );
+		vPeak_L = _mm256_max_ps( vVal_L, vPeak_L );
+		vPeak_R = _mm256_max_ps( vVal_R, vPeak_R );
+		_mm256_storeu_ps( out_l + i, _mm256_add_ps( _mm256_loadu_ps( out_l + i ), vVal_L ) );
+		_mm256_storeu_ps( out_r + i, _mm256_add_ps( _mm256_loadu_ps( out_r + i ), vVal_R ) );
+	}
+
+	float lanes[ 8 ];
+	_mm256_storeu_ps( lanes, vPeak_L );
+	*peak_l = reduce_peak( lanes, 8, *peak_l );
+	_mm256_storeu_ps( lanes, vPeak_R );
+	*peak_r = reduce_peak( lanes, 8, *peak_r );
+	_mm256_zeroupper();
+
+	render_block_sse( src_l + i, src_r + i, env ? env + i : NULL, frames - i,
+	                  cost_l, cost_r, cost_track_l, cost_track_r,
+	                  track_l ? track_l + i : NULL, track_r ? track_r + i : NULL,
+	                  out_l + i, out_r + i, peak_l, peak_r );
+}
+
+H2_TARGET( "avx" )
+static void mix_block_avx( const float* src_l, const float* src_r, int frames,
+                           float gain_l, float gain_r, float* dst_l, float* dst_r )
+{
+	const __m256 vGain_L = _mm256_set1_ps( gain_l );
+	const __m256 vGain_R = _mm256_set1_ps( gain_r );
+
+	int i = 0;
+	for ( ; i + 8 <= frames; i += 8 ) {
+		_mm256_storeu_ps( dst_l + i, _mm256_add_ps( _mm256_loadu_ps( dst_l + i ), _mm256_mul_ps( _mm256_loadu_ps( src_l + i ), vGain_L ) ) );
+		_mm256_storeu_ps( dst_r + i, _mm256_add_ps( _mm256_loadu_ps( dst_r + i ), _mm256_mul_ps( _mm256_loadu_ps( src_r + i ), vGain_R ) ) );
+	}
+	_mm256_zeroupper();
+	mix_block_sse( src_l + i, src_r + i, frames - i, gain_l, gain_r, dst_l + i, dst_r + i );
+}
+
+/* AVX has no 256 bit integer instructions, the shorts are widened 128 bits at a time */
+H2_TARGET( "avx" )
+static void convert_block_avx( const short* src_l, const short* src_r, int frames,
+                               float* dst_l, float* dst_r )
+{
+	const __m256 vScale = _mm256_set1_ps( SAMPLE_PCM16_SCALE );
+
+	int i = 0;
+	for ( ; i + 8 <= frames; i += 8 ) {
+		__m128i vSrc_L = _mm_loadu_si128( ( const __m128i* )( src_l + i ) );
+		__m128i vSrc_R = _mm_loadu_si128( ( const __m128i* )( src_r + i ) );
+		__m256i vInt_L = _mm256_insertf128_si256( _mm256_castsi128_si256( _mm_srai_epi32( _mm_unpacklo_epi16( vSrc_L, vSrc_L ), 16 ) ),
+		                                          _mm_srai_epi32( _mm_unpackhi_epi16( vSrc_L, vSrc_L ), 16 ), 1 );
+		__m256i vInt_R = _mm256_insertf128_si256( _mm256_castsi128_si256( _mm_srai_epi32( _mm_unpacklo_epi16( vSrc_R, vSrc_R ), 16 ) ),
+		                                          _mm_srai_epi32( _mm_unpackhi_epi16( vSrc_R, vSrc_R ), 16 ), 1 );
+		_mm256_storeu_ps( dst_l + i, _mm256_mul_ps( _mm256_cvtepi32_ps( vInt_L ), vScale ) );
+		_mm256_storeu_ps( dst_r + i, _mm256_mul_ps( _mm256_cvtepi32_ps( vInt_R ), vScale ) );
+	}
+	_mm256_zeroupper();
+	convert_block_scalar( src_l + i, src_r + i, frames - i, dst_l + i, dst_r + i );
+}
+
+#endif // H2_KERNELS_X86
+
+#ifdef H2_KERNELS_NEON
+
+static void render_block_neon( const float* src_l, const float* src_r, const float* env, int frames,
+                               float cost_l, float cost_r, float cost_track_l, float cost_track_r,
+                               float* track_l, float* track_r, float* out_l, float* out_r,
+                               float* peak_l, float* peak_r )
+{
+	if ( ( track_l == NULL ) != ( track_r == NULL ) ) {
+		render_block_scalar( src_l, src_r, env, frames, cost_l, cost_r, cost_track_l, cost_track_r,
+		                     track_l, track_r, out_l, out_r, peak_l, peak_r );
+		return;
+	}
+
+	const float32x4_t vCost_L = vdupq_n_f32( cost_l );
+	const float32x4_t vCost_R = vdupq_n_f32( cost_r );
+	const float32x4_t vCostTrack_L = vdupq_n_f32( cost_track_l );
+	const float32x4_t vCostTrack_R = vdupq_n_f32( cost_track_r );
+	float32x4_t vPeak_L = vdupq_n_f32( *peak_l );
+	float32x4_t vPeak_R = vdupq_n_f32( *peak_r );
+
+	int i = 0;
+	for ( ; i + 4 <= frames; i += 4 ) {
+		float32x4_t vVal_L = vld1q_f32( src_l + i );
+		float32x4_t vVal_R = vld1q_f32( src_r + i );
+		if ( env ) {
+			float32x4_t vEnv = vld1q_f32( env + i );
+			vVal_L = vmulq_f32( vVal_L, vEnv );
+			vVal_R = vmulq_f32( vVal_R, vEnv );
+		}
+		if ( track_l ) {
+			vst1q_f32( track_l + i, vaddq_f32( vld1q_f32( track_l + i ), vmulq_f32( vVal_L, vCostTrack_L ) ) );
+			vst1q_f32( track_r + i, vaddq_f32( vld1q_f32( track_r + i ), vmulq_f32( vVal_R, vCostTrack_R ) ) );
+		}
+		vVal_L = vmulq_f32( vVal_L, vCost_L );
+		vVal_R = vmulq_f32( vVal_R, vCost_R );
+		// vmaxq_f32 propagates NaN, select explicitly to match the scalar code
+		vPeak_L = vbslq_f32( vcgtq_f32( vVal_L, vPeak_L ), vVal_L, vPeak_L );
+		vPeak_R = vbslq_f32( vcgtq_f32( vVal_R, vPeak_R ), vVal_R, vPeak_R );
+		vst1q_f32( out_l + i, vaddq_f32( vld1q_f32( out_l + i ), vVal_L ) );
+		vst1q_f32( out_r + i, vaddq_f32( vld1q_f32( out_r + i ), vVal_R ) );
+	}
+
+	float lanes[ 4 ];
+	vst1q_f32( lanes, vPeak_L );
+	*peak_l = reduce_peak( lanes, 4, *peak_l );
+	vst1q_f32( lanes, vPeak_R );
+	*peak_r = reduce_peak( lanes, 4, *peak_r );
+
+	render_block_scalar( src_l + i, src_r + i, env ? env + i : NULL, frames - i,
+	                     cost_l, cost_r, cost_track_l, cost_track_r,
+	                     track_l ? track_l + i : NULL, track_r ? track_r + i : NULL,
+	                     out_l + i, out_r + i, peak_l, peak_r );
+}
+
+static void mix_block_neon( const float* src_l, const float* src_r, int frames,
+                            float gain_l, float gain_r, float* dst_l, float* dst_r )
+{
+	const float32x4_t vGain_L = vdupq_n_f32( gain_l );
+	const float32x4_t vGain_R = vdupq_n_f32( gain_r );
+
+	int i = 0;
+	for ( ; i + 4 <= frames; i += 4 ) {
+		vst1q_f32( dst_l + i, vaddq_f32( vld1q_f32( dst_l + i ), vmulq_f32( vld1q_f32( src_l + i ), vGain_L ) ) );
+		vst1q_f32( dst_r + i, vaddq_f32( vld1q_f32( dst_r + i ), vmulq_f32( vld1q_f32( src_r + i ), vGain_R ) ) );
+	}
+	mix_block_scalar( src_l + i, src_r + i, frames - i, gain_l, gain_r, dst_l + i, dst_r + i );
+}
+
+static void convert_block_neon( const short* src_l, const short* src_r, int frames,
+                                float* dst_l, float* dst_r )
+{
+	const float32x4_t vScale = vdupq_n_f32( SAMPLE_PCM16_SCALE );
+
+	int i = 0;
+	for ( ; i + 8 <= frames; i += 8 ) {
+		int16x8_t vSrc_L = vld1q_s16( src_l + i );
+		int16x8_t vSrc_R = vld1q_s16( src_r + i );
+		vst1q_f32( dst_l + i, vmulq_f32( vcvtq_f32_s32( vmovl_s16( vget_low_s16( vSrc_L ) ) ), vScale ) );
+		vst1q_f32( dst_l + i + 4, vmulq_f32( vcvtq_f32_s32( vmovl_s16( vget_high_s16( vSrc_L ) ) ), vScale ) );
+		vst1q_f32( dst_r + i, vmulq_f32( vcvtq_f32_s32( vmovl_s16( vget_low_s16( vSrc_R ) ) ), vScale ) );
+		vst1q_f32( dst_r + i + 4, vmulq_f32( vcvtq_f32_s32( vmovl_s16( vget_high_s16( vSrc_R ) ) ), vScale ) );
+	}
+	convert_block_scalar( src_l + i, src_r + i, frames - i, dst_l + i, dst_r + i );
+}
+
+#endif // H2_KERNELS_NEON
+
+static const RenderKernels::Table __tables[ RenderKernels::ISA_COUNT ] = {
+	{ RenderKernels::SCALAR, "scalar", render_block_scalar, mix_block_scalar, convert_block_scalar },
+#ifdef H2_KERNELS_X86
+	{ RenderKernels::SSE, "sse", render_block_sse, mix_block_sse, convert_block_sse },
+	{ RenderKernels::AVX, "avx", render_block_avx, mix_block_avx, convert_block_avx },
+#else
+	{ RenderKernels::SSE, "sse", 0, 0, 0 },
+	{ RenderKernels::AVX, "avx", 0, 0, 0 },
+#endif
+#ifdef H2_KERNELS_NEON
+	{ RenderKernels::NEON, "neon", render_block_neon, mix_block_neon, convert_block_neon },
+#else
+	{ RenderKernels::NEON, "neon", 0, 0, 0 },
+#endif
+};
+
+static bool cpu_supports( RenderKernels::Isa isa )
+{
+	switch ( isa ) {
+	case RenderKernels::SCALAR:
+		return true;
+#ifdef H2_KERNELS_X86
+	case RenderKernels::SSE:
+		return __builtin_cpu_supports( "sse2" );
+	case RenderKernels::AVX:
+		return __builtin_cpu_supports( "avx" );
+#endif
+#ifdef H2_KERNELS_NEON
+	case RenderKernels::NEON:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+const RenderKernels::Table* RenderKernels::table( Isa isa )
+{
+	if ( isa < SCALAR || isa >= ISA_COUNT ) return 0;
+	const Table* t = &__tables[ isa ];
+	if ( t->render_block == 0 || !cpu_supports( isa ) ) return 0;
+	return t;
+}
+
+const RenderKernels::Table* RenderKernels::best()
+{
+	static const Table* best = 0;
+	if ( best ) return best;
+	const Isa order[] = { AVX, SSE, NEON };
+	for ( unsigned i = 0; i < sizeof( order ) / sizeof( order[0] ); ++i ) {
+		const Table* t = table( order[i] );
+		if ( t ) {
+			best = t;
+			return best;
+		}
+	}
+	best = table( SCALAR );
+	return best;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
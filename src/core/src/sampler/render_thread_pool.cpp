@@ -0,0 +1,143 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/sampler/render_thread_pool.h>
+
+#include <sched.h>
+
+namespace H2Core
+{
+
+const char* RenderThreadPool::__class_name = "RenderThreadPool";
+
+/* added to __pending once the caller sleeps, the last worker then wakes it */
+static const int WAITING = 1 << 16;
+/* how many times the caller polls __pending before sleeping, some tens of microseconds */
+static const int SPIN_COUNT = 20000;
+
+static inline void cpu_relax()
+{
+#if defined(__i386__) || defined(__x86_64__)
+	__asm__ __volatile__( "pause" );
+#endif
+}
+
+RenderThreadPool::RenderThreadPool( int threads ) : Object( __class_name ),
+	__threads( threads < 1 ? 1 : threads ),
+	__workers( 0 ),
+	__pending( 0 ),
+	__quit( false ),
+	__job( 0 ),
+	__arg( 0 )
+{
+	sem_init( &__done, 0, 0 );
+
+	__workers = new Worker[ __threads - 1 ];
+	for ( int i = 0; i < __threads - 1; i++ ) {
+		__workers[ i ].pool = this;
+		__workers[ i ].thread = i + 1;
+		sem_init( &__workers[ i ].start, 0, 0 );
+		pthread_create( &__workers[ i ].id, 0, __worker_main, &__workers[ i ] );
+	}
+	INFOLOG( QString( "%1 render threads" ).arg( __threads ) );
+}
+
+RenderThreadPool::~RenderThreadPool()
+{
+	__quit = true;
+	for ( int i = 0; i < __threads - 1; i++ ) {
+		sem_post( &__workers[ i ].start );
+	}
+	for ( int i = 0; i < __threads - 1; i++ ) {
+		pthread_join( __workers[ i ].id, 0 );
+		sem_destroy( &__workers[ i ].start );
+	}
+	delete[] __workers;
+
+	sem_destroy( &__done );
+}
+
+void RenderThreadPool::run( Job job, void* arg )
+{
+	if ( __threads == 1 ) {
+		job( arg, 0 );
+		return;
+	}
+
+	// sem_post() is a barrier, the workers see the job
+	__job = job;
+	__arg = arg;
+	__pending = __threads - 1;
+	for ( int i = 0; i < __threads - 1; i++ ) {
+		sem_post( &__workers[ i ].start );
+	}
+
+	job( arg, 0 );
+
+	for ( int i = 0; i < SPIN_COUNT; i++ ) {
+		if ( __sync_fetch_and_add( &__pending, 0 ) == 0 ) {
+			return;
+		}
+		cpu_relax();
+	}
+	// a worker is late, sleep unless it was done in the meantime
+	if ( __sync_add_and_fetch( &__pending, WAITING ) != WAITING ) {
+		while ( sem_wait( &__done ) != 0 ) {
+			// interrupted by a signal
+		}
+	}
+}
+
+void* RenderThreadPool::__worker_main( void* param )
+{
+	Worker* pWorker = ( Worker* )param;
+	RenderThreadPool* pPool = pWorker->pool;
+	Object* __object = pPool;
+
+	// same priority as the drivers audio threads
+	struct sched_param sched;
+	sched.sched_priority = 50;
+	if ( pthread_setschedparam( pthread_self(), SCHED_FIFO, &sched ) != 0 ) {
+		__WARNINGLOG( QString( "Can't set realtime scheduling for render thread %1" ).arg( pWorker->thread ) );
+	}
+
+	while ( true ) {
+		if ( sem_wait( &pWorker->start ) != 0 ) {
+			continue;	// interrupted by a signal
+		}
+		if ( pPool->__quit ) {
+			break;
+		}
+
+		pPool->__job( pPool->__arg, pWorker->thread );
+
+		// the last worker wakes the caller if it went to sleep
+		if ( __sync_sub_and_fetch( &pPool->__pending, 1 ) == WAITING ) {
+			sem_post( &pPool->__done );
+		}
+	}
+	return 0;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
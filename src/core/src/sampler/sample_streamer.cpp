@@ -0,0 +1,258 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+
+#include <hydrogen/sampler/sample_streamer.h>
+
+#include <hydrogen/basics/sample.h>
+
+#include <time.h>
+
+namespace H2Core
+{
+
+const char* SampleStreamer::__class_name = "SampleStreamer";
+
+/* frames read from a file at once */
+static const int READ_FRAMES = 4096;
+/* how long the reader sleeps when nobody wakes it, in nanoseconds */
+static const long READER_POLL = 5000000;
+
+SampleStreamer::SampleStreamer() : Object( __class_name ),
+	__quit( false ),
+	__wait( false ),
+	__underruns( 0 )
+{
+	pthread_mutex_init( &__mutex, 0 );
+	pthread_cond_init( &__wake, 0 );
+	pthread_create( &__reader, 0, __reader_main, this );
+}
+
+SampleStreamer::~SampleStreamer()
+{
+	pthread_mutex_lock( &__mutex );
+	__quit = true;
+	pthread_cond_signal( &__wake );
+	pthread_mutex_unlock( &__mutex );
+	pthread_join( __reader, 0 );
+
+	for ( unsigned i = 0; i < __streams.size(); i++ ) {
+		Stream* stream = __streams[ i ];
+		if ( stream->file ) sf_close( stream->file );
+		delete[] stream->ring_l;
+		delete[] stream->ring_r;
+		delete stream;
+	}
+
+	pthread_cond_destroy( &__wake );
+	pthread_mutex_destroy( &__mutex );
+}
+
+void SampleStreamer::reserve( int streams )
+{
+	pthread_mutex_lock( &__mutex );
+	while ( ( int )__streams.size() < streams ) {
+		Stream* stream = new Stream;
+		stream->state = Stream::FREE;
+		stream->frames = 0;
+		stream->written = 0;
+		stream->needed = 0;
+		stream->failed = false;
+		stream->file = 0;
+		stream->channels = 0;
+		stream->ring_l = 0;
+		stream->ring_r = 0;
+		__streams.push_back( stream );
+	}
+	pthread_mutex_unlock( &__mutex );
+}
+
+SampleStreamer::Stream* SampleStreamer::open( Sample* sample )
+{
+	for ( unsigned i = 0; i < __streams.size(); i++ ) {
+		Stream* stream = __streams[ i ];
+		// the reader leaves TAKEN streams alone while they are set up
+		if ( __sync_bool_compare_and_swap( &stream->state, Stream::FREE, Stream::TAKEN ) ) {
+			stream->filepath = sample->get_filepath();
+			stream->frames = sample->get_frames();
+			stream->written = sample->get_data_frames();
+			stream->needed = stream->written;
+			stream->failed = false;
+			__sync_synchronize();
+			stream->state = Stream::OPENING;
+			wake();
+			return stream;
+		}
+	}
+	__sync_fetch_and_add( &__underruns, 1 );
+	return 0;
+}
+
+void SampleStreamer::close( Stream* stream )
+{
+	__sync_synchronize();
+	stream->state = Stream::CLOSING;
+}
+
+void SampleStreamer::read( Stream* stream, int frame, int count, float* out_l, float* out_r )
+{
+	stream->needed = frame;
+	__sync_synchronize();
+
+	// the ring can't hold more, nor the file
+	int end = frame + count;
+	if ( end > frame + RING_FRAMES ) end = frame + RING_FRAMES;
+	if ( end > stream->frames ) end = stream->frames;
+
+	int written = stream->written;
+	if ( written < end && __wait ) {
+		while ( ( written = stream->written ) < end && !stream->failed ) {
+			wake();
+			usleep( 100 );
+		}
+	}
+	__sync_synchronize();
+
+	int avail = ( written < end ? written : end ) - frame;
+	if ( avail < 0 ) avail = 0;
+	if ( avail > 0 ) {
+		int start = frame & ( RING_FRAMES - 1 );
+		int first = ( avail < RING_FRAMES - start ) ? avail : RING_FRAMES - start;
+		memcpy( out_l, stream->ring_l + start, first * sizeof( float ) );
+		memcpy( out_r, stream->ring_r + start, first * sizeof( float ) );
+		memcpy( out_l + first, stream->ring_l, ( avail - first ) * sizeof( float ) );
+		memcpy( out_r + first, stream->ring_r, ( avail - first ) * sizeof( float ) );
+	}
+	memset( out_l + avail, 0, ( count - avail ) * sizeof( float ) );
+	memset( out_r + avail, 0, ( count - avail ) * sizeof( float ) );
+
+	// the frames past the sample end are not missing
+	if ( frame + avail < end ) {
+		__sync_fetch_and_add( &__underruns, 1 );
+	}
+}
+
+void SampleStreamer::wake()
+{
+	// never wait for the reader, it polls anyway
+	if ( pthread_mutex_trylock( &__mutex ) == 0 ) {
+		pthread_cond_signal( &__wake );
+		pthread_mutex_unlock( &__mutex );
+	}
+}
+
+bool SampleStreamer::__service( Stream* stream, std::vector<float>& buffer )
+{
+	switch ( stream->state ) {
+	case Stream::OPENING: {
+		if ( !stream->ring_l ) {
+			stream->ring_l = new float[ RING_FRAMES ];
+			stream->ring_r = new float[ RING_FRAMES ];
+		}
+		SF_INFO sound_info;
+		memset( &sound_info, 0, sizeof( sound_info ) );
+		stream->file = sf_open( stream->filepath.toLocal8Bit(), SFM_READ, &sound_info );
+		if ( stream->file && sf_seek( stream->file, stream->written, SEEK_SET ) < 0 ) {
+			sf_close( stream->file );
+			stream->file = 0;
+		}
+		if ( stream->file ) {
+			stream->channels = sound_info.channels;
+		} else {
+			ERRORLOG( QString( "Unable to stream %1" ).arg( stream->filepath ) );
+			stream->failed = true;
+		}
+		// unless the voice released it meanwhile
+		__sync_bool_compare_and_swap( &stream->state, Stream::OPENING, Stream::STREAMING );
+		return stream->file != 0;
+	}
+	case Stream::STREAMING: {
+		if ( !stream->file || stream->failed ) return false;
+		int written = stream->written;
+		int room = stream->needed + RING_FRAMES - written;
+		int left = stream->frames - written;
+		// wait for a whole read unless the file ends first
+		if ( left <= 0 || ( room < READ_FRAMES && room < left ) ) return false;
+		int frames = READ_FRAMES;
+		if ( frames > room ) frames = room;
+		if ( frames > left ) frames = left;
+
+		buffer.resize( frames * stream->channels );
+		sf_count_t count = sf_readf_float( stream->file, &buffer[ 0 ], frames );
+		if ( count <= 0 ) {
+			ERRORLOG( QString( "Unable to read %1 at frame %2" ).arg( stream->filepath ).arg( written ) );
+			stream->failed = true;
+			return false;
+		}
+		int right = stream->channels > 1 ? 1 : 0;
+		for ( int i = 0; i < count; i++ ) {
+			int n = ( written + i ) & ( RING_FRAMES - 1 );
+			stream->ring_l[ n ] = buffer[ i * stream->channels ];
+			stream->ring_r[ n ] = buffer[ i * stream->channels + right ];
+		}
+		__sync_synchronize();
+		stream->written = written + count;
+		return true;
+	}
+	case Stream::CLOSING:
+		if ( stream->file ) {
+			sf_close( stream->file );
+			stream->file = 0;
+		}
+		// released here so that the render threads never free it
+		stream->filepath = QString();
+		__sync_synchronize();
+		stream->state = Stream::FREE;
+		return false;
+	}
+	return false;
+}
+
+void* SampleStreamer::__reader_main( void* param )
+{
+	SampleStreamer* streamer = ( SampleStreamer* )param;
+	std::vector<float> buffer;
+
+	pthread_mutex_lock( &streamer->__mutex );
+	while ( !streamer->__quit ) {
+		bool busy = false;
+		for ( unsigned i = 0; i < streamer->__streams.size(); i++ ) {
+			if ( streamer->__service( streamer->__streams[ i ], buffer ) ) busy = true;
+		}
+		if ( busy ) continue;
+		// wake() can't always take the mutex, poll as well
+		struct timespec timeout;
+		clock_gettime( CLOCK_REALTIME, &timeout );
+		timeout.tv_nsec += READER_POLL;
+		if ( timeout.tv_nsec >= 1000000000 ) {
+			timeout.tv_sec++;
+			timeout.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait( &streamer->__wake, &streamer->__mutex, &timeout );
+	}
+	pthread_mutex_unlock( &streamer->__mutex );
+	return 0;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -34,6 +34,7 @@
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
 #include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_pool.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/basics/song.h>
@@ -44,6 +45,9 @@
 
 #include <hydrogen/fx/Effects.h>
 #include <hydrogen/sampler/Sampler.h>
+#include <hydrogen/sampler/polyphase_filter.h>
+#include <hydrogen/sampler/render_thread_pool.h>
+#include <hydrogen/sampler/segment_renderer.h>
 
 #include <iostream>
 #include <QDebug>
@@ -53,16 +57,61 @@ namespace H2Core
 
 const char* Sampler::__class_name = "Sampler";
 
-Sampler::Sampler()
+/* frames a stolen voice takes to fade out */
+static const float STOLEN_VOICE_FADE_OUT = 256;
+/* frames of a streamed or compact sample a voice can read in a process cycle, the pitched notes read more than they render */
+static const int STREAM_WINDOW_FRAMES = 8 * MAX_BUFFER_SIZE;
+/* frames read around a streamed sample position for the interpolation */
+static const int STREAM_WINDOW_MARGIN = PolyphaseFilter::TAPS / 2 + 2;
+
+Sampler::Sampler( NotePool* pNotePool )
 		: Object( __class_name )
 		, __main_out_L( NULL )
 		, __main_out_R( NULL )
 		, __preview_instrument( NULL )
+		, __kernels( RenderKernels::best() )
+		, __render_pool( NULL )
+		, __render_threads( 1 )
+		, __render_frames( 0 )
+		, __render_song( NULL )
+		, __streamer( NULL )
+		, __stream_underruns( 0 )
+		, __output( NULL )
+		, __capture( NULL )
+		, __voices( NULL )
+		, __voice_count( 0 )
+		, __voice_capacity( 0 )
+		, __max_notes( 0 )
+		, __active_voices( 0 )
+		, __voice_serial( 0 )
+		, __note_offs( NULL )
+		, __note_off_count( 0 )
+		, __note_pool( pNotePool )
 {
 	INFOLOG( "INIT" );
 		__interpolateMode = LINEAR;
 	__main_out_L = new float[ MAX_BUFFER_SIZE ];
 	__main_out_R = new float[ MAX_BUFFER_SIZE ];
+	__polyphase = new PolyphaseFilter();
+	// the interpolators read around the sample position without bounds checks
+	assert( PolyphaseFilter::TAPS / 2 <= SAMPLE_GUARD_FRAMES );
+	for ( int nGroup = 0; nGroup < RENDER_GROUPS; ++nGroup ) {
+		RenderGroup* pGroup = &__groups[ nGroup ];
+		// the first group mixes straight into the sampler and effects outputs
+		pGroup->main_out_L = nGroup ? Sample::alloc_data( MAX_BUFFER_SIZE ) : __main_out_L;
+		pGroup->main_out_R = nGroup ? Sample::alloc_data( MAX_BUFFER_SIZE ) : __main_out_R;
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			pGroup->fx_L[ nFX ] = nGroup ? Sample::alloc_data( MAX_BUFFER_SIZE ) : NULL;
+			pGroup->fx_R[ nFX ] = nGroup ? Sample::alloc_data( MAX_BUFFER_SIZE ) : NULL;
+			pGroup->fx_used[ nFX ] = false;
+		}
+		pGroup->notes = 0;
+	}
+	__contexts.push_back( __create_context() );
+	__streamer = new SampleStreamer();
+	set_max_notes( Preferences::get_instance()->m_nMaxNotes );
+	INFOLOG( QString( "using %1 render kernels" ).arg( __kernels->name ) );
+	set_render_threads( Preferences::get_instance()->m_nRenderThreads );
 
 	// instrument used in file preview
 	QString sEmptySampleFilename = Filesystem::empty_sample();
@@ -77,66 +126,346 @@ Sampler::~Sampler()
 {
 	INFOLOG( "DESTROY" );
 
+	for ( int i = 0; i < __voice_count; ++i ) {
+		delete __voices[ i ].note;
+	}
+	delete[] __voices;
+	delete[] __note_offs;
+	delete __streamer;
+	set_render_threads( 1 );
+	__delete_context( __contexts[ 0 ] );
+	for ( int nGroup = 1; nGroup < RENDER_GROUPS; ++nGroup ) {
+		Sample::free_data( __groups[ nGroup ].main_out_L );
+		Sample::free_data( __groups[ nGroup ].main_out_R );
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			Sample::free_data( __groups[ nGroup ].fx_L[ nFX ] );
+			Sample::free_data( __groups[ nGroup ].fx_R[ nFX ] );
+		}
+	}
 	delete[] __main_out_L;
 	delete[] __main_out_R;
+	delete __polyphase;
 
 	delete __preview_instrument;
 	__preview_instrument = NULL;
 }
 
+Sampler::RenderContext* Sampler::__create_context()
+{
+	RenderContext* pContext = new RenderContext;
+	pContext->group = NULL;
+	// aligned for the render kernels, the stream windows are read past their ends like samples
+	pContext->envelope = Sample::alloc_data( MAX_BUFFER_SIZE );
+	pContext->scratch_L = Sample::alloc_data( MAX_BUFFER_SIZE );
+	pContext->scratch_R = Sample::alloc_data( MAX_BUFFER_SIZE );
+	pContext->resampled_L = Sample::alloc_data( MAX_BUFFER_SIZE );
+	pContext->resampled_R = Sample::alloc_data( MAX_BUFFER_SIZE );
+	pContext->stream_L = Sample::alloc_data( STREAM_WINDOW_FRAMES );
+	pContext->stream_R = Sample::alloc_data( STREAM_WINDOW_FRAMES );
+	return pContext;
+}
+
+void Sampler::__delete_context( RenderContext* pContext )
+{
+	Sample::free_data( pContext->envelope );
+	Sample::free_data( pContext->scratch_L );
+	Sample::free_data( pContext->scratch_R );
+	Sample::free_data( pContext->resampled_L );
+	Sample::free_data( pContext->resampled_R );
+	Sample::free_data( pContext->stream_L );
+	Sample::free_data( pContext->stream_R );
+	delete pContext;
+}
+
+void Sampler::set_render_threads( int nThreads )
+{
+	if ( nThreads < 1 ) {
+		nThreads = 1;
+	}
+	if ( nThreads > RENDER_GROUPS ) {
+		// a thread renders one group at least
+		nThreads = RENDER_GROUPS;
+	}
+	if ( nThreads == get_render_threads() ) {
+		return;
+	}
+
+	delete __render_pool;
+	__render_pool = NULL;
+	while ( __contexts.size() > 1 ) {
+		__delete_context( __contexts.back() );
+		__contexts.pop_back();
+	}
+
+	if ( nThreads > 1 ) {
+		while ( ( int )__contexts.size() < nThreads ) {
+			__contexts.push_back( __create_context() );
+		}
+		__render_pool = new RenderThreadPool( nThreads );
+	}
+}
+
+int Sampler::get_render_threads() const
+{
+	return __render_pool ? __render_pool->get_threads() : 1;
+}
+
+void Sampler::set_stream_wait( bool bWait )
+{
+	__streamer->set_wait( bWait );
+}
+
+unsigned Sampler::get_stream_underruns() const
+{
+	return __streamer->get_underruns();
+}
+
+void Sampler::set_output( AudioOutput* pOutput )
+{
+	__output = pOutput;
+}
+
+void Sampler::set_capture( SegmentRenderer* pCapture )
+{
+	__capture = pCapture;
+}
+
+AudioOutput* Sampler::__audio_output() const
+{
+	return __output ? __output : Hydrogen::get_instance()->getAudioOutput();
+}
+
+void Sampler::set_max_notes( int nMaxNotes )
+{
+	if ( nMaxNotes < 1 ) {
+		nMaxNotes = 1;
+	}
+	__max_notes = nMaxNotes;
+	if ( 2 * nMaxNotes <= __voice_capacity ) {
+		// surplus voices are faded out by process()
+		return;
+	}
+
+	Voice* pVoices = new Voice[ 2 * nMaxNotes ];
+	for ( int i = 0; i < __voice_count; ++i ) {
+		pVoices[ i ] = __voices[ i ];
+	}
+	delete[] __voices;
+	__voices = pVoices;
+	__voice_capacity = 2 * nMaxNotes;
+
+	delete[] __note_offs;
+	__note_offs = new Note*[ __voice_capacity ];
+	__streamer->reserve( __voice_capacity );
+
+	for ( int nGroup = 0; nGroup < RENDER_GROUPS; ++nGroup ) {
+		__groups[ nGroup ].midi_notes.reserve( __voice_capacity );
+	}
+}
+
+void Sampler::__steal_voice()
+{
+	int nOldest = -1;
+	for ( int i = 0; i < __voice_count; ++i ) {
+		if ( !__voices[ i ].stolen && ( nOldest == -1 || __voices[ i ].serial < __voices[ nOldest ].serial ) ) {
+			nOldest = i;
+		}
+	}
+	if ( nOldest == -1 ) {
+		return;
+	}
+	// a short fade instead of cutting the note, which would click
+	__voices[ nOldest ].note->get_adsr()->fade_out( STOLEN_VOICE_FADE_OUT );
+	__voices[ nOldest ].stolen = true;
+	__active_voices--;
+}
+
+void Sampler::__remove_voice( int nVoice )
+{
+	Voice* pVoice = &__voices[ nVoice ];
+	pVoice->note->get_instrument()->dequeue();
+	__note_pool->release( pVoice->note );
+	if ( pVoice->stream ) {
+		__streamer->close( pVoice->stream );
+	}
+	if ( !pVoice->stolen ) {
+		__active_voices--;
+	}
+	*pVoice = __voices[ --__voice_count ];
+}
+
+void Sampler::__render_job( void* arg, int nThread )
+{
+	Sampler* pSampler = ( Sampler* )arg;
+	RenderContext* pContext = pSampler->__contexts[ nThread ];
+	uint32_t nFrames = pSampler->__render_frames;
+
+	for ( int nGroup = nThread; nGroup < RENDER_GROUPS; nGroup += pSampler->__render_threads ) {
+		RenderGroup* pGroup = &pSampler->__groups[ nGroup ];
+		if ( pGroup->notes == 0 ) {
+			continue;
+		}
+		if ( pGroup->main_out_L != pSampler->__main_out_L ) {
+			memset( pGroup->main_out_L, 0, nFrames * sizeof( float ) );
+			memset( pGroup->main_out_R, 0, nFrames * sizeof( float ) );
+		}
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			pGroup->fx_used[ nFX ] = false;
+		}
+		pGroup->midi_notes.clear();
+		pContext->group = pGroup;
+
+		// in voice order whichever thread renders the group
+		for ( int i = 0; i < pSampler->__voice_count; ++i ) {
+			Voice* pVoice = &pSampler->__voices[ i ];
+			if ( pVoice->group == nGroup ) {
+				pVoice->result = pSampler->__render_note( pVoice, nFrames, pSampler->__render_song, pContext );
+				// a stolen voice is over once faded out
+				if ( pVoice->stolen && pVoice->note->get_adsr()->is_idle() ) {
+					pVoice->result = 1;
+				}
+			}
+		}
+	}
+}
+
+void Sampler::__fx_buffers( RenderContext* pContext, int nFX, float* pFX_L, float* pFX_R, float** pBuf_L, float** pBuf_R )
+{
+	RenderGroup* pGroup = pContext->group;
+	if ( pGroup->fx_L[ nFX ] == NULL ) {
+		*pBuf_L = pFX_L;
+		*pBuf_R = pFX_R;
+		return;
+	}
+	if ( !pGroup->fx_used[ nFX ] ) {
+		memset( pGroup->fx_L[ nFX ], 0, __render_frames * sizeof( float ) );
+		memset( pGroup->fx_R[ nFX ], 0, __render_frames * sizeof( float ) );
+		pGroup->fx_used[ nFX ] = true;
+	}
+	*pBuf_L = pGroup->fx_L[ nFX ];
+	*pBuf_R = pGroup->fx_R[ nFX ];
+}
+
 // perche' viene passata anche la canzone? E' davvero necessaria?
 void Sampler::process( uint32_t nFrames, Song* pSong )
 {
 	//infoLog( "[process]" );
-	AudioOutput* audio_output = Hydrogen::get_instance()->getAudioOutput();
+	AudioOutput* audio_output = __audio_output();
 	assert( audio_output );
 
 	memset( __main_out_L, 0, nFrames * sizeof( float ) );
 	memset( __main_out_R, 0, nFrames * sizeof( float ) );
 
+	if ( __capture ) {
+		// rendered later by the segments, see SegmentRenderer
+		__capture->capture_period( nFrames );
+		return;
+	}
+
 	// Track output queues are zeroed by
 	// audioEngine_process_clearAudioBuffers()
 
-	// Max notes limit
-	int m_nMaxNotes = Preferences::get_instance()->m_nMaxNotes;
-	while ( ( int )__playing_notes_queue.size() > m_nMaxNotes ) {
-		Note *oldNote = __playing_notes_queue[ 0 ];
-		__playing_notes_queue.erase( __playing_notes_queue.begin() );
-		oldNote->get_instrument()->dequeue();
-		delete oldNote;	// FIXME: send note-off instead of removing the note from the list?
+	// Max notes limit, lowered since the voices were started
+	while ( __active_voices > __max_notes ) {
+		__steal_voice();
 	}
 
 
 	// eseguo tutte le note nella lista di note in esecuzione
-	unsigned i = 0;
-	Note* pNote;
-	while ( i < __playing_notes_queue.size() ) {
-		pNote = __playing_notes_queue[ i ];		// recupero una nuova nota
-		unsigned res = __render_note( pNote, nFrames, pSong );
-		if ( res == 1 ) {	// la nota e' finita
-			__playing_notes_queue.erase( __playing_notes_queue.begin() + i );
-			pNote->get_instrument()->dequeue();
-			__queuedNoteOffs.push_back( pNote );
-//			delete pNote;
-//			pNote = NULL;
-		} else {
-			++i; // carico la prox nota
+	int nNotes = __voice_count;
+	__render_frames = nFrames;
+	__render_song = pSong;
+
+	// the notes of an instrument share its peaks and track outputs, they are
+	// rendered in the same group. The groups do not depend on the threads,
+	// neither does the order the notes are summed in.
+	InstrumentList* pInstrList = pSong->get_instrument_list();
+	for ( int nGroup = 0; nGroup < RENDER_GROUPS; ++nGroup ) {
+		__groups[ nGroup ].notes = 0;
+	}
+	for ( int i = 0; i < nNotes; ++i ) {
+		int nInstrument = pInstrList->index( __voices[ i ].note->get_instrument() );
+		__voices[ i ].group = ( nInstrument < 0 ? 0 : nInstrument ) % RENDER_GROUPS;
+		__groups[ __voices[ i ].group ].notes++;
+	}
+
+	__render_threads = ( __render_pool && nNotes > 1 ) ? __render_pool->get_threads() : 1;
+	if ( __render_threads > 1 ) {
+		__render_pool->run( __render_job, this );
+	} else {
+		__render_job( this, 0 );
+	}
+
+	// mix the other groups in a fixed order, so the result depends neither
+	// on scheduling nor on the number of threads
+	for ( int nGroup = 1; nGroup < RENDER_GROUPS; ++nGroup ) {
+		RenderGroup* pGroup = &__groups[ nGroup ];
+		if ( pGroup->notes == 0 ) {
+			continue;
+		}
+		__kernels->mix_block( pGroup->main_out_L, pGroup->main_out_R, nFrames, 1.0, 1.0, __main_out_L, __main_out_R );
+#ifdef H2CORE_HAVE_LADSPA
+		for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+			LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
+			if ( pFX && pGroup->fx_used[ nFX ] ) {
+				__kernels->mix_block( pGroup->fx_L[ nFX ], pGroup->fx_R[ nFX ], nFrames, 1.0, 1.0, pFX->m_pBuffer_L, pFX->m_pBuffer_R );
+			}
 		}
+#endif
 	}
 
-	//Queue midi note off messages for notes that have a length specified for them
+	MidiOutput* pMidiOut = __output ? NULL : Hydrogen::get_instance()->getMidiOutput();
+	for ( int nGroup = 0; pMidiOut && nGroup < RENDER_GROUPS; ++nGroup ) {
+		RenderGroup* pGroup = &__groups[ nGroup ];
+		for ( unsigned i = 0; pGroup->notes && i < pGroup->midi_notes.size(); ++i ) {
+			pMidiOut->handleQueueNote( pGroup->midi_notes[ i ] );
+		}
+	}
+
+	// the reader refills the streams the voices read from
+	for ( int i = 0; i < nNotes; ++i ) {
+		if ( __voices[ i ].stream ) {
+			__streamer->wake();
+			break;
+		}
+	}
+	unsigned nUnderruns = __streamer->get_underruns();
+	if ( nUnderruns != __stream_underruns ) {
+		WARNINGLOG_RT( "%1 sample stream underruns, the drumkit stream head may be too short" ).arg( nUnderruns - __stream_underruns );
+		__stream_underruns = nUnderruns;
+	}
 
-	while ( !__queuedNoteOffs.empty() ) {
-		pNote =  __queuedNoteOffs[0];
-		MidiOutput* midiOut = Hydrogen::get_instance()->getMidiOutput();
-		if( midiOut != NULL ){
-			midiOut->handleQueueNoteOff( pNote->get_instrument()->get_midi_out_channel(), pNote->get_midi_key(),  pNote->get_midi_velocity() );
+	// collect the ended notes in voice order, then swap-remove them backwards
+	// so that the voices moved into the holes have already been checked
+	__note_off_count = 0;
+	for ( int i = 0; i < nNotes; ++i ) {
+		if ( __voices[ i ].result == 1 ) {	// la nota e' finita
+			__note_offs[ __note_off_count++ ] = __voices[ i ].note;
+		}
+	}
+	for ( int i = nNotes - 1; i >= 0; --i ) {
+		if ( __voices[ i ].result == 1 ) {
+			Voice* pVoice = &__voices[ i ];
+			pVoice->note->get_instrument()->dequeue();
+			if ( pVoice->stream ) {
+				__streamer->close( pVoice->stream );
+			}
+			if ( !pVoice->stolen ) {
+				__active_voices--;
+			}
+			*pVoice = __voices[ --__voice_count ];
+		}
+	}
 
+	//Queue midi note off messages for notes that have a length specified for them
+	for ( int i = 0; i < __note_off_count; ++i ) {
+		Note* pNote = __note_offs[ i ];
+		if( pMidiOut != NULL ){
+			pMidiOut->handleQueueNoteOff( pNote->get_instrument()->get_midi_out_channel(), pNote->get_midi_key(),  pNote->get_midi_velocity() );
 		}
-		__queuedNoteOffs.erase( __queuedNoteOffs.begin() );
-		if( pNote != NULL) delete pNote;
-		pNote = NULL;
-	}//while
+		__note_pool->release( pNote );
+	}
+	__note_off_count = 0;
 
 }
 
@@ -147,6 +476,15 @@ void Sampler::note_on( Note *note )
 	//infoLog( "[noteOn]" );
 	assert( note );
 
+	if ( __capture ) {
+		// timed from the frame __render_note would start it at
+		Hydrogen* pEngine = Hydrogen::get_instance();
+		AudioOutput* audio_output = __audio_output();
+		long long nFramepos = pEngine->getState() == STATE_PLAYING ? audio_output->m_transport.m_nFrames : pEngine->getRealtimeFrames();
+		__capture->capture_note( note, nFramepos, audio_output->m_transport.m_nTickSize );
+		return;
+	}
+
 	note->get_adsr()->attack();
 	Instrument *pInstr = note->get_instrument();
 
@@ -154,8 +492,8 @@ void Sampler::note_on( Note *note )
 	int mute_grp = pInstr->get_mute_group();
 	if ( mute_grp != -1 ) {
 		// remove all notes using the same mute group
-		for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {	// delete older note
-			Note *pNote = __playing_notes_queue[ j ];
+		for ( int j = 0; j < __voice_count; j++ ) {	// delete older note
+			Note *pNote = __voices[ j ].note;
 			if ( ( pNote->get_instrument() != pInstr )  && ( pNote->get_instrument()->get_mute_group() == mute_grp ) ) {
 				pNote->get_adsr()->release();
 			}
@@ -164,8 +502,8 @@ void Sampler::note_on( Note *note )
 
 	//note off notes
 	if( note->get_note_off() ){
-		for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {
-			Note *pNote = __playing_notes_queue[ j ];
+		for ( int j = 0; j < __voice_count; j++ ) {
+			Note *pNote = __voices[ j ].note;
 
 			if ( ( pNote->get_instrument() == pInstr ) ) {
 				//ERRORLOG("note_off");
@@ -175,15 +513,39 @@ void Sampler::note_on( Note *note )
 	}
 
 	pInstr->enqueue();
-	if( !note->get_note_off() ){
-		__playing_notes_queue.push_back( note );
+	if( note->get_note_off() ){
+		__note_pool->release( note );
+		return;
 	}
+
+	if ( __active_voices >= __max_notes ) {
+		__steal_voice();
+	}
+	if ( __voice_count == __voice_capacity ) {
+		// no room left to fade out, cut the oldest stolen voice
+		int nOldest = 0;
+		for ( int i = 1; i < __voice_count; ++i ) {
+			if ( __voices[ i ].serial < __voices[ nOldest ].serial ) {
+				nOldest = i;
+			}
+		}
+		__remove_voice( nOldest );
+	}
+
+	Voice* pVoice = &__voices[ __voice_count++ ];
+	pVoice->note = note;
+	pVoice->serial = __voice_serial++;
+	pVoice->stolen = false;
+	pVoice->group = 0;
+	pVoice->result = 0;
+	pVoice->stream = NULL;
+	__active_voices++;
 }
 
 void Sampler::midi_keyboard_note_off( int key )
 {
-	for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {
-		Note *pNote = __playing_notes_queue[ j ];
+	for ( int j = 0; j < __voice_count; j++ ) {
+		Note *pNote = __voices[ j ].note;
 
 		if ( ( pNote->get_midi_msg() == key) ) {
 			pNote->get_adsr()->release();
@@ -202,28 +564,29 @@ void Sampler::note_off( Note* note )
 
 	Instrument *pInstr = note->get_instrument();
 	// find the notes using the same instrument, and release them
-	for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {
-		Note *pNote = __playing_notes_queue[ j ];
+	for ( int j = 0; j < __voice_count; j++ ) {
+		Note *pNote = __voices[ j ].note;
 		if ( pNote->get_instrument() == pInstr ) {
 			pNote->get_adsr()->release();
 		}
 	}
-	delete note;
+	__note_pool->release( note );
 }
 
 
 /// Render a note
 /// Return 0: the note is not ended
 /// Return 1: the note is ended
-unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
+unsigned Sampler::__render_note( Voice* pVoice, unsigned nBufferSize, Song* pSong, RenderContext* pContext )
 {
 	//infoLog( "[renderNote] instr: " + pNote->getInstrument()->m_sName );
 	assert( pSong );
+	Note* pNote = pVoice->note;
 
 	unsigned int nFramepos;
 	Hydrogen* pEngine = Hydrogen::get_instance();
-	AudioOutput* audio_output = pEngine->getAudioOutput();
-	if (  pEngine->getState() == STATE_PLAYING ) {
+	AudioOutput* audio_output = __audio_output();
+	if ( __output || pEngine->getState() == STATE_PLAYING ) {
 		nFramepos = audio_output->m_transport.m_nFrames;
 	} else {
 		// use this to support realtime events when not playing
@@ -232,7 +595,7 @@ unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong
 
 	Instrument *pInstr = pNote->get_instrument();
 	if ( !pInstr ) {
-		ERRORLOG( "NULL instrument" );
+		ERRORLOG_RT( "NULL instrument" );
 		return 1;
 	}
 
@@ -253,13 +616,12 @@ unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong
 		}
 	}
 	if ( !pSample ) {
-		QString dummy = QString( "NULL sample for instrument %1. Note velocity: %2" ).arg( pInstr->get_name() ).arg( pNote->get_velocity() );
-		WARNINGLOG( dummy );
+		WARNINGLOG_RT( "NULL sample for instrument %1. Note velocity: %2" ).arg( pInstr->get_id() ).arg( pNote->get_velocity() );
 		return 1;
 	}
 
 	if ( pNote->get_sample_position() >= pSample->get_frames() ) {
-		WARNINGLOG( "sample position out of bounds. The layer has been resized during note play?" );
+		WARNINGLOG_RT( "sample position out of bounds. The layer has been resized during note play?" );
 		return 1;
 	}
 
@@ -273,7 +635,7 @@ unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong
 			int noteStartInFramesNoHumanize = ( int )pNote->get_position() * audio_output->m_transport.m_nTickSize;
 			if ( noteStartInFramesNoHumanize > ( int )( nFramepos + nBufferSize ) ) {
 				// this note is not valid. it's in the future...let's skip it....
-				ERRORLOG( QString( "Note pos in the future?? Current frames: %1, note frame pos: %2" ).arg( nFramepos ).arg(noteStartInFramesNoHumanize ) );
+				ERRORLOG_RT( "Note pos in the future?? Current frames: %1, note frame pos: %2" ).arg( nFramepos ).arg( noteStartInFramesNoHumanize );
 				//pNote->dumpInfo();
 				return 1;
 			}
@@ -345,20 +707,69 @@ unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong
 	//_INFOLOG( "total pitch: " + to_string( fTotalPitch ) );
 	if( ( int )pNote->get_sample_position() == 0 )
 	{
-		if( Hydrogen::get_instance()->getMidiOutput() != NULL ){
-			Hydrogen::get_instance()->getMidiOutput()->handleQueueNote( pNote );
+		if( !__output && Hydrogen::get_instance()->getMidiOutput() != NULL ){
+			// sent by process() once every thread is done
+			pContext->group->midi_notes.push_back( pNote );
 		}
 	}
 
+	// the reader starts filling the stream while the head plays
+	if ( pSample->is_streamed() && !pVoice->stream ) {
+		pVoice->stream = __streamer->open( pSample );
+	}
+
 	if ( fTotalPitch == 0.0 && pSample->get_sample_rate() == audio_output->getSampleRate() ) {	// NO RESAMPLE
-				return __render_note_no_resample( pSample, pNote, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, pSong );
+				return __render_note_no_resample( pSample, pVoice->stream, pNote, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, pSong, pContext );
 	} else {	// RESAMPLE
-				return __render_note_resample( pSample, pNote, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, fLayerPitch, pSong );
+				return __render_note_resample( pSample, pVoice->stream, pNote, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, fLayerPitch, pSong, pContext );
+	}
+}
+
+int Sampler::__read_sample( Sample* pSample, SampleStreamer::Stream* pStream, int nFirst, int nLast, RenderContext* pContext, const float** ppData_L, const float** ppData_R )
+{
+	int nHead = pSample->get_data_frames();
+	if ( nLast <= nHead && !pSample->is_compact() ) {
+		*ppData_L = pSample->get_data_l();
+		*ppData_R = pSample->get_data_r();
+		return 0;
+	}
+
+	if ( nFirst < 0 ) {
+		nFirst = 0;
+	}
+	int nFrames = nLast - nFirst;
+	assert( nFrames <= STREAM_WINDOW_FRAMES );
+	int nPos = 0;
+	if ( nFirst < nHead ) {
+		nPos = ( nLast < nHead ? nLast : nHead ) - nFirst;
+		if ( pSample->is_compact() ) {
+			// only the frames the block reads are converted
+			__kernels->convert_block( pSample->get_pcm_l() + nFirst, pSample->get_pcm_r() + nFirst, nPos, pContext->stream_L, pContext->stream_R );
+		} else {
+			memcpy( pContext->stream_L, pSample->get_data_l() + nFirst, nPos * sizeof( float ) );
+			memcpy( pContext->stream_R, pSample->get_data_r() + nFirst, nPos * sizeof( float ) );
+		}
+	}
+	if ( nPos < nFrames ) {
+		if ( pStream ) {
+			__streamer->read( pStream, nFirst + nPos, nFrames - nPos, pContext->stream_L + nPos, pContext->stream_R + nPos );
+		} else {
+			// no stream was left, counted as an underrun by SampleStreamer::open
+			memset( pContext->stream_L + nPos, 0, ( nFrames - nPos ) * sizeof( float ) );
+			memset( pContext->stream_R + nPos, 0, ( nFrames - nPos ) * sizeof( float ) );
+		}
 	}
+	// silent past the window, as the guard frames of a sample
+	memset( pContext->stream_L + nFrames, 0, SAMPLE_GUARD_FRAMES * sizeof( float ) );
+	memset( pContext->stream_R + nFrames, 0, SAMPLE_GUARD_FRAMES * sizeof( float ) );
+	*ppData_L = pContext->stream_L;
+	*ppData_R = pContext->stream_R;
+	return nFirst;
 }
 
 int Sampler::__render_note_no_resample(
 	Sample *pSample,
+	SampleStreamer::Stream* pStream,
 	Note *pNote,
 	int nBufferSize,
 	int nInitialSilence,
@@ -366,10 +777,11 @@ int Sampler::__render_note_no_resample(
 	float cost_R,
 	float cost_track_L,
 	float cost_track_R,
-	Song* pSong
+	Song* pSong,
+	RenderContext* pContext
 )
 {
-	AudioOutput* audio_output = Hydrogen::get_instance()->getAudioOutput();
+	AudioOutput* audio_output = __audio_output();
 	int retValue = 1; // the note is ended
 
 	int nNoteLength = -1;
@@ -386,24 +798,17 @@ int Sampler::__render_note_no_resample(
 	}
 
 
-	//ADSR *pADSR = pNote->m_pADSR;
-
 	int nInitialBufferPos = nInitialSilence;
 	int nInitialSamplePos = ( int )pNote->get_sample_position();
-	int nSamplePos = nInitialSamplePos;
-	int nTimes = nInitialBufferPos + nAvail_bytes;
 	int nInstrument = pSong->get_instrument_list()->index( pNote->get_instrument() );
 
-	float *pSample_data_L = pSample->get_data_l();
-	float *pSample_data_R = pSample->get_data_r();
+	const float *pSample_data_L;
+	const float *pSample_data_R;
+	int nDataOffset = __read_sample( pSample, pStream, nInitialSamplePos, nInitialSamplePos + nAvail_bytes, pContext, &pSample_data_L, &pSample_data_R );
 
 	float fInstrPeak_L = pNote->get_instrument()->get_peak_l(); // this value will be reset to 0 by the mixer..
 	float fInstrPeak_R = pNote->get_instrument()->get_peak_r(); // this value will be reset to 0 by the mixer..
 
-	float fADSRValue;
-	float fVal_L;
-	float fVal_R;
-
 	/*
 	 * nInstrument could be -1 if the instrument is not found in the current drumset.
 	 * This happens when someone is using the prelistening function of the soundlibrary.
@@ -413,60 +818,52 @@ int Sampler::__render_note_no_resample(
 		nInstrument = 0;
 	}
 
-#ifdef H2CORE_HAVE_JACK
-	JackOutput* jao = 0;
 	float *track_out_L = 0;
 	float *track_out_R = 0;
-	if( audio_output->has_track_outs()
-	&& (jao = dynamic_cast<JackOutput*>(audio_output)) ) {
-		track_out_L = jao->getTrackOut_L( nInstrument );
-		track_out_R = jao->getTrackOut_R( nInstrument );
+	if( audio_output->has_track_outs() ) {
+		track_out_L = audio_output->getTrackOut_L( nInstrument );
+		track_out_R = audio_output->getTrackOut_R( nInstrument );
 	}
-#endif
-
-	for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
-		if ( ( nNoteLength != -1 ) && ( nNoteLength <= pNote->get_sample_position() )  ) {
-						if ( pNote->get_adsr()->release() == 0 ) {
-				retValue = 1;	// the note is ended
-			}
-		}
-
-		fADSRValue = pNote->get_adsr()->get_value( 1 );
-		fVal_L = pSample_data_L[ nSamplePos ] * fADSRValue;
-		fVal_R = pSample_data_R[ nSamplePos ] * fADSRValue;
 
-		// Low pass resonant filter
-		if ( pNote->get_instrument()->is_filter_active() ) {
-			pNote->compute_lr_values( &fVal_L, &fVal_R );
-		}
-
-#ifdef H2CORE_HAVE_JACK
-		if( track_out_L ) {
-			track_out_L[nBufferPos] += fVal_L * cost_track_L;
-		}
-		if( track_out_R ) {
-			track_out_R[nBufferPos] += fVal_R * cost_track_R;
-		}
-#endif
+	// the sample position is only updated after the block, so is the note length test
+	ADSR *pADSR = pNote->get_adsr();
+	bool bNoteLengthReached = ( nNoteLength != -1 ) && ( nNoteLength <= pNote->get_sample_position() );
+	if ( bNoteLengthReached && pADSR->release() == 0 ) {
+		retValue = 1;	// the note is ended
+	}
+	pADSR->get_values( pContext->envelope, nAvail_bytes, 1 );
+	if ( bNoteLengthReached && pADSR->is_idle() ) {
+		retValue = 1;	// the release ended within the block
+	}
 
-		fVal_L = fVal_L * cost_L;
-		fVal_R = fVal_R * cost_R;
+	const float *pSrc_L = pSample_data_L + nInitialSamplePos - nDataOffset;
+	const float *pSrc_R = pSample_data_R + nInitialSamplePos - nDataOffset;
+	const float *pEnvelope = pContext->envelope;
 
-		// update instr peak
-		if ( fVal_L > fInstrPeak_L ) {
-			fInstrPeak_L = fVal_L;
-		}
-		if ( fVal_R > fInstrPeak_R ) {
-			fInstrPeak_R = fVal_R;
+	// Low pass resonant filter, recursive so it has to run frame by frame
+	if ( pNote->get_instrument()->is_filter_active() ) {
+		for ( int i = 0; i < nAvail_bytes; ++i ) {
+			pContext->scratch_L[ i ] = pSrc_L[ i ] * pContext->envelope[ i ];
+			pContext->scratch_R[ i ] = pSrc_R[ i ] * pContext->envelope[ i ];
+			pNote->compute_lr_values( &pContext->scratch_L[ i ], &pContext->scratch_R[ i ] );
 		}
+		pSrc_L = pContext->scratch_L;
+		pSrc_R = pContext->scratch_R;
+		pEnvelope = NULL;
+	}
 
-		// to main mix
-		__main_out_L[nBufferPos] += fVal_L;
-		__main_out_R[nBufferPos] += fVal_R;
+	__kernels->render_block( pSrc_L, pSrc_R, pEnvelope, nAvail_bytes,
+				 cost_L, cost_R, cost_track_L, cost_track_R,
+				 track_out_L ? track_out_L + nInitialBufferPos : NULL,
+				 track_out_R ? track_out_R + nInitialBufferPos : NULL,
+				 pContext->group->main_out_L + nInitialBufferPos, pContext->group->main_out_R + nInitialBufferPos,
+				 &fInstrPeak_L, &fInstrPeak_R );
 
-		++nSamplePos;
-	}
 	pNote->update_sample_position( nAvail_bytes );
+	if ( __output ) {
+		// the segments of an export render side by side, the effects are off
+		return retValue;
+	}
 	pNote->get_instrument()->set_peak_l( fInstrPeak_L );
 	pNote->get_instrument()->set_peak_r( fInstrPeak_R );
 
@@ -481,22 +878,17 @@ int Sampler::__render_note_no_resample(
 
 		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
 			fLevel = fLevel * pFX->getVolume();
-			float *pBuf_L = pFX->m_pBuffer_L;
-			float *pBuf_R = pFX->m_pBuffer_R;
+			float *pBuf_L;
+			float *pBuf_R;
+			__fx_buffers( pContext, nFX, pFX->m_pBuffer_L, pFX->m_pBuffer_R, &pBuf_L, &pBuf_R );
 
 //			float fFXCost_L = cost_L * fLevel;
 //			float fFXCost_R = cost_R * fLevel;
 			float fFXCost_L = fLevel * masterVol;
 			float fFXCost_R = fLevel * masterVol;
 
-			int nBufferPos = nInitialBufferPos;
-			int nSamplePos = nInitialSamplePos;
-			for ( int i = 0; i < nAvail_bytes; ++i ) {
-				pBuf_L[ nBufferPos ] += pSample_data_L[ nSamplePos ] * fFXCost_L;
-				pBuf_R[ nBufferPos ] += pSample_data_R[ nSamplePos ] * fFXCost_R;
-				++nSamplePos;
-				++nBufferPos;
-			}
+			__kernels->mix_block( pSample_data_L + nInitialSamplePos - nDataOffset, pSample_data_R + nInitialSamplePos - nDataOffset, nAvail_bytes,
+					      fFXCost_L, fFXCost_R, pBuf_L + nInitialBufferPos, pBuf_R + nInitialBufferPos );
 		}
 	}
 	// ~LADSPA
@@ -509,6 +901,7 @@ int Sampler::__render_note_no_resample(
 
 int Sampler::__render_note_resample(
 	Sample *pSample,
+	SampleStreamer::Stream* pStream,
 	Note *pNote,
 	int nBufferSize,
 	int nInitialSilence,
@@ -517,17 +910,18 @@ int Sampler::__render_note_resample(
 	float cost_track_L,
 	float cost_track_R,
 	float fLayerPitch,
-	Song* pSong
+	Song* pSong,
+	RenderContext* pContext
 )
 {
-	AudioOutput* audio_output = Hydrogen::get_instance()->getAudioOutput();
+	AudioOutput* audio_output = __audio_output();
 	int nNoteLength = -1;
 	if ( pNote->get_length() != -1 ) {
 		nNoteLength = ( int )( pNote->get_length() * audio_output->m_transport.m_nTickSize );
 	}
 	float fNotePitch = pNote->get_total_pitch() + fLayerPitch;
 
-	float fStep = pow( 1.0594630943593, ( double )fNotePitch );
+	float fStep = pNote->get_pitch_ratio( fNotePitch );
 //	_ERRORLOG( QString("pitch: %1, step: %2" ).arg(fNotePitch).arg( fStep) );
 	fStep *= ( float )pSample->get_sample_rate() / audio_output->getSampleRate(); // Adjust for audio driver sample rate
 
@@ -545,22 +939,25 @@ int Sampler::__render_note_resample(
 	//	ADSR *pADSR = pNote->m_pADSR;
 
 	int nInitialBufferPos = nInitialSilence;
-	float fInitialSamplePos = pNote->get_sample_position();
 	double fSamplePos = pNote->get_sample_position();
-	int nTimes = nInitialBufferPos + nAvail_bytes;
 	int nInstrument = pSong->get_instrument_list()->index( pNote->get_instrument() );
 
-	float *pSample_data_L = pSample->get_data_l();
-	float *pSample_data_R = pSample->get_data_r();
+	// the frames the interpolation reads, with the filter taps around them
+	int nFirst = ( int )fSamplePos - STREAM_WINDOW_MARGIN;
+	int nLast = ( int )( fSamplePos + nAvail_bytes * fStep ) + STREAM_WINDOW_MARGIN;
+	if ( nLast > pSample->get_frames() ) {
+		nLast = pSample->get_frames();
+	}
+	if ( ( pSample->is_streamed() || pSample->is_compact() ) && nLast - nFirst > STREAM_WINDOW_FRAMES ) {
+		// pitched that high the rest of the block stays silent
+		nAvail_bytes = ( int )( ( STREAM_WINDOW_FRAMES - 2 * STREAM_WINDOW_MARGIN - 2 ) / fStep );
+		nLast = ( int )( fSamplePos + nAvail_bytes * fStep ) + STREAM_WINDOW_MARGIN;
+		retValue = 0;
+	}
 
 	float fInstrPeak_L = pNote->get_instrument()->get_peak_l(); // this value will be reset to 0 by the mixer..
 	float fInstrPeak_R = pNote->get_instrument()->get_peak_r(); // this value will be reset to 0 by the mixer..
 
-	float fADSRValue = 1.0;
-	float fVal_L;
-	float fVal_R;
-	int nSampleFrames = pSample->get_frames();
-
 	/*
 	 * nInstrument could be -1 if the instrument is not found in the current drumset.
 	 * This happens when someone is using the prelistening function of the soundlibrary.
@@ -570,108 +967,80 @@ int Sampler::__render_note_resample(
 		nInstrument = 0;
 	}
 
-#ifdef H2CORE_HAVE_JACK
-	JackOutput* jao = 0;
 	float *track_out_L = 0;
 	float *track_out_R = 0;
-	if( audio_output->has_track_outs()
-	&& (jao = dynamic_cast<JackOutput*>(audio_output)) ) {
-		track_out_L = jao->getTrackOut_L( nInstrument );
-		track_out_R = jao->getTrackOut_R( nInstrument );
+	if( audio_output->has_track_outs() ) {
+		track_out_L = audio_output->getTrackOut_L( nInstrument );
+		track_out_R = audio_output->getTrackOut_R( nInstrument );
 	}
-#endif
-
-	for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
-		if ( ( nNoteLength != -1 ) && ( nNoteLength <= pNote->get_sample_position() )  ) {
-						if ( pNote->get_adsr()->release() == 0 ) {
-				retValue = 1;	// the note is ended
-			}
-		}
-
-		int nSamplePos = ( int )fSamplePos;
-		double fDiff = fSamplePos - nSamplePos;
-		if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
-			//we reach the last audioframe.
-			//set this last frame to zero do nothin wrong.
-						fVal_L = 0.0;
-						fVal_R = 0.0;
-		} else {
-			// some interpolation methods need 4 frames data.
-				float last_l;
-				float last_r;
-				if ( ( nSamplePos + 2 ) >= nSampleFrames ) {
-					last_l = 0.0;
-					last_r = 0.0;
-				} else {
-					last_l =  pSample_data_L[nSamplePos + 2];
-					last_r =  pSample_data_R[nSamplePos + 2];
-				}
-
-				switch( __interpolateMode ){
-
-						case LINEAR:
-								fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
-								fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
-								//fVal_L = linear_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-								//fVal_R = linear_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-								break;
-						case COSINE:
-								fVal_L = cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-								fVal_R = cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-								break;
-						case THIRD:
-								fVal_L = third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-						case CUBIC:
-								fVal_L = cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-						case HERMITE:
-								fVal_L = hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-								fVal_R = hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-								break;
-				}
-		}
-
-		// ADSR envelope
-		fADSRValue = pNote->get_adsr()->get_value( fStep );
-		fVal_L = fVal_L * fADSRValue;
-		fVal_R = fVal_R * fADSRValue;
-		// Low pass resonant filter
-		if ( pNote->get_instrument()->is_filter_active() ) {
-			pNote->compute_lr_values( &fVal_L, &fVal_R );
-		}
-
 
+	// the sample position is only updated after the block, so is the note length test
+	ADSR *pADSR = pNote->get_adsr();
+	bool bNoteLengthReached = ( nNoteLength != -1 ) && ( nNoteLength <= pNote->get_sample_position() );
+	if ( bNoteLengthReached && pADSR->release() == 0 ) {
+		retValue = 1;	// the note is ended
+	}
+	pADSR->get_values( pContext->envelope, nAvail_bytes, fStep );
+	if ( bNoteLengthReached && pADSR->is_idle() ) {
+		retValue = 1;	// the release ended within the block
+	}
 
-#ifdef H2CORE_HAVE_JACK
-		if( track_out_L ) {
-			track_out_L[nBufferPos] += fVal_L * cost_track_L;
-		}
-		if( track_out_R ) {
-			track_out_R[nBufferPos] += fVal_R * cost_track_R;
-		}
-#endif
+	const float *pSample_data_L;
+	const float *pSample_data_R;
+	int nDataOffset = __read_sample( pSample, pStream, nFirst, nLast, pContext, &pSample_data_L, &pSample_data_R );
+	int nDataFrames = pSample->get_frames() - nDataOffset;
+	fSamplePos -= nDataOffset;
+
+	// the interpolation mode is chosen once for the whole block
+	switch( __interpolateMode ){
+	case LINEAR:
+		__resample<LINEAR>( pSample_data_L, pSample_data_R, nDataFrames, fSamplePos, fStep, nAvail_bytes, pContext->resampled_L, pContext->resampled_R );
+		break;
+	case COSINE:
+		__resample<COSINE>( pSample_data_L, pSample_data_R, nDataFrames, fSamplePos, fStep, nAvail_bytes, pContext->resampled_L, pContext->resampled_R );
+		break;
+	case THIRD:
+		__resample<THIRD>( pSample_data_L, pSample_data_R, nDataFrames, fSamplePos, fStep, nAvail_bytes, pContext->resampled_L, pContext->resampled_R );
+		break;
+	case CUBIC:
+		__resample<CUBIC>( pSample_data_L, pSample_data_R, nDataFrames, fSamplePos, fStep, nAvail_bytes, pContext->resampled_L, pContext->resampled_R );
+		break;
+	case HERMITE:
+		__resample<HERMITE>( pSample_data_L, pSample_data_R, nDataFrames, fSamplePos, fStep, nAvail_bytes, pContext->resampled_L, pContext->resampled_R );
+		break;
+	case SINC:
+		__resample<SINC>( pSample_data_L, pSample_data_R, nDataFrames, fSamplePos, fStep, nAvail_bytes, pContext->resampled_L, pContext->resampled_R );
+		break;
+	}
 
-		fVal_L = fVal_L * cost_L;
-		fVal_R = fVal_R * cost_R;
+	const float *pSrc_L = pContext->resampled_L;
+	const float *pSrc_R = pContext->resampled_R;
+	const float *pEnvelope = pContext->envelope;
 
-		// update instr peak
-		if ( fVal_L > fInstrPeak_L ) {
-			fInstrPeak_L = fVal_L;
-		}
-		if ( fVal_R > fInstrPeak_R ) {
-			fInstrPeak_R = fVal_R;
+	// Low pass resonant filter, recursive so it has to run frame by frame
+	if ( pNote->get_instrument()->is_filter_active() ) {
+		for ( int i = 0; i < nAvail_bytes; ++i ) {
+			pContext->scratch_L[ i ] = pSrc_L[ i ] * pContext->envelope[ i ];
+			pContext->scratch_R[ i ] = pSrc_R[ i ] * pContext->envelope[ i ];
+			pNote->compute_lr_values( &pContext->scratch_L[ i ], &pContext->scratch_R[ i ] );
 		}
+		pSrc_L = pContext->scratch_L;
+		pSrc_R = pContext->scratch_R;
+		pEnvelope = NULL;
+	}
 
-		// to main mix
-		__main_out_L[nBufferPos] += fVal_L;
-		__main_out_R[nBufferPos] += fVal_R;
+	__kernels->render_block( pSrc_L, pSrc_R, pEnvelope, nAvail_bytes,
+				 cost_L, cost_R, cost_track_L, cost_track_R,
+				 track_out_L ? track_out_L + nInitialBufferPos : NULL,
+				 track_out_R ? track_out_R + nInitialBufferPos : NULL,
+				 pContext->group->main_out_L + nInitialBufferPos, pContext->group->main_out_R + nInitialBufferPos,
+				 &fInstrPeak_L, &fInstrPeak_R );
 
-		fSamplePos += fStep;
-	}
 	pNote->update_sample_position( nAvail_bytes * fStep );
+	if ( __output ) {
+		// the segments of an export render side by side, the effects are off
+		return retValue;
+	}
 	pNote->get_instrument()->set_peak_l( fInstrPeak_L );
 	pNote->get_instrument()->set_peak_r( fInstrPeak_R );
 
@@ -686,74 +1055,18 @@ int Sampler::__render_note_resample(
 		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
 			fLevel = fLevel * pFX->getVolume();
 
-			float *pBuf_L = pFX->m_pBuffer_L;
-			float *pBuf_R = pFX->m_pBuffer_R;
+			float *pBuf_L;
+			float *pBuf_R;
+			__fx_buffers( pContext, nFX, pFX->m_pBuffer_L, pFX->m_pBuffer_R, &pBuf_L, &pBuf_R );
 
 //			float fFXCost_L = cost_L * fLevel;
 //			float fFXCost_R = cost_R * fLevel;
 			float fFXCost_L = fLevel * masterVol;
 			float fFXCost_R = fLevel * masterVol;
 
-			int nBufferPos = nInitialBufferPos;
-			float fSamplePos = fInitialSamplePos;
-			for ( int i = 0; i < nAvail_bytes; ++i ) {
-				int nSamplePos = ( int )fSamplePos;
-				double fDiff = fSamplePos - nSamplePos;
-
-				if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
-					//we reach the last audioframe.
-					//set this last frame to zero do nothin wrong.
-					fVal_L = 0.0;
-					fVal_R = 0.0;
-				} else {
-					// some interpolation methods need 4 frames data.
-					float last_l;
-					float last_r;
-					if ( ( nSamplePos + 2 ) >= nSampleFrames ) {
-						last_l = 0.0;
-						last_r = 0.0;
-					}else
-					{
-						last_l =  pSample_data_L[nSamplePos + 2];
-						last_r =  pSample_data_R[nSamplePos + 2];
-					}
-
-					switch( __interpolateMode ){
-
-					case LINEAR:
-						fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
-						fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
-						//fVal_L = linear_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-						//fVal_R = linear_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-						break;
-					case COSINE:
-						fVal_L = cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-						fVal_R = cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-						break;
-					case THIRD:
-						fVal_L = third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					case CUBIC:
-						fVal_L = cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					case HERMITE:
-						fVal_L = hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-						fVal_R = hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-						break;
-					}
-					// methode Interpolate produce an extra function call and eat much more time here.
-					// so i deside to code the switch direct in the resampler methode
-					//fVal_L = Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], pSample_data_L[nSamplePos + 2] ,fDiff);
-					//fVal_L = Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], pSample_data_R[nSamplePos + 2] ,fDiff);
-				}
-
-				pBuf_L[ nBufferPos ] += fVal_L * fFXCost_L;
-								pBuf_R[ nBufferPos ] += fVal_R * fFXCost_R;
-				fSamplePos += fStep;
-				++nBufferPos;
-			}
+			// the send uses the interpolated frames, before envelope and filter
+			__kernels->mix_block( pContext->resampled_L, pContext->resampled_R, nAvail_bytes,
+					      fFXCost_L, fFXCost_R, pBuf_L + nInitialBufferPos, pBuf_R + nInitialBufferPos );
 		}
 	}
 #endif
@@ -761,36 +1074,79 @@ int Sampler::__render_note_resample(
 	return retValue;
 }
 
+template<Sampler::InterpolateMode mode>
+void Sampler::__resample( const float* pSample_data_L, const float* pSample_data_R, int nSampleFrames, double fSamplePos, float fStep, int nFrames, float* pOut_L, float* pOut_R )
+{
+	const float *pSincBank = ( mode == SINC ) ? __polyphase->get_bank( fStep ) : NULL;
+	float fVal_L = 0.0;
+	float fVal_R = 0.0;
+
+	for ( int i = 0; i < nFrames; ++i ) {
+		int nSamplePos = ( int )fSamplePos;
+		double fDiff = fSamplePos - nSamplePos;
+		// the frames around the sample are silent guard frames, see Sample::alloc_data
+		if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
+			//we reach the last audioframe.
+			//set this last frame to zero do nothin wrong.
+			fVal_L = 0.0;
+			fVal_R = 0.0;
+		} else if ( mode == SINC ) {
+			PolyphaseFilter::interpolate( pSincBank, pSample_data_L, pSample_data_R, nSamplePos, fDiff, &fVal_L, &fVal_R );
+		} else {
+			// some interpolation methods need 4 frames data.
+			float last_l = pSample_data_L[nSamplePos + 2];
+			float last_r = pSample_data_R[nSamplePos + 2];
+
+			// mode is a template parameter, only one case is compiled in
+			switch( mode ){
+			case LINEAR:
+				fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
+				fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
+				break;
+			case COSINE:
+				fVal_L = cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
+				fVal_R = cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
+				break;
+			case THIRD:
+				fVal_L = third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
+				fVal_R = third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
+				break;
+			case CUBIC:
+				fVal_L = cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
+				fVal_R = cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
+				break;
+			case HERMITE:
+				fVal_L = hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
+				fVal_R = hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
+				break;
+			default:
+				break;
+			}
+		}
+
+		pOut_L[ i ] = fVal_L;
+		pOut_R[ i ] = fVal_R;
+		fSamplePos += fStep;
+	}
+}
+
 
 void Sampler::stop_playing_notes( Instrument* instrument )
 {
 	/*
 	// send a note-off event to all notes present in the playing note queue
-	for ( int i = 0; i < __playing_notes_queue.size(); ++i ) {
-		Note *pNote = __playing_notes_queue[ i ];
+	for ( int i = 0; i < __voice_count; ++i ) {
+		Note *pNote = __voices[ i ].note;
 		pNote->m_pADSR->release();
 	}
 	*/
 
-	if ( instrument ) { // stop all notes using this instrument
-		for ( unsigned i = 0; i < __playing_notes_queue.size(); ) {
-			Note *pNote = __playing_notes_queue[ i ];
-			assert( pNote );
-			if ( pNote->get_instrument() == instrument ) {
-				delete pNote;
-				instrument->dequeue();
-				__playing_notes_queue.erase( __playing_notes_queue.begin() + i );
-			}
-			++i;
-		}
-	} else { // stop all notes
-		// delete all copied notes in the playing notes queue
-		for ( unsigned i = 0; i < __playing_notes_queue.size(); ++i ) {
-			Note *pNote = __playing_notes_queue[i];
-			pNote->get_instrument()->dequeue();
-			delete pNote;
+	// backwards, the swap-remove only moves voices already checked
+	for ( int i = __voice_count - 1; i >= 0; --i ) {
+		assert( __voices[ i ].note );
+		if ( !instrument || __voices[ i ].note->get_instrument() == instrument ) {
+			__remove_voice( i );
 		}
-		__playing_notes_queue.clear();
 	}
 }
 
@@ -806,7 +1162,7 @@ void Sampler::preview_sample( Sample* sample, int length )
 	Sample *pOldSample = pLayer->get_sample();
 	pLayer->set_sample( sample );
 
-	Note *previewNote = new Note( __preview_instrument, 0, 1.0, 0.5, 0.5, length, 0 );
+	Note *previewNote = __note_pool->acquire( __preview_instrument, 0, 1.0, 0.5, 0.5, length, 0 );
 
 	stop_playing_notes( __preview_instrument );
 	note_on( previewNote );
@@ -827,7 +1183,7 @@ void Sampler::preview_instrument( Instrument* instr )
 	old_preview = __preview_instrument;
 	__preview_instrument = instr;
 
-	Note *previewNote = new Note( __preview_instrument, 0, 1.0, 0.5, 0.5, MAX_NOTES, 0 );
+	Note *previewNote = __note_pool->acquire( __preview_instrument, 0, 1.0, 0.5, 0.5, MAX_NOTES, 0 );
 
 	note_on( previewNote );	// exclusive note
 	AudioEngine::get_instance()->unlock();
@@ -906,8 +1262,8 @@ void Sampler::setPlayingNotelength( Instrument* instrument, unsigned long ticks,
 bool Sampler::is_instrument_playing( Instrument* instrument )
 {
 	if ( instrument ) { // stop all notes using this instrument
-		for ( unsigned j = 0; j < __playing_notes_queue.size(); j++ ) {
-			if ( instrument->get_name() == __playing_notes_queue[ j ]->get_instrument()->get_name()){
+		for ( int j = 0; j < __voice_count; j++ ) {
+			if ( instrument->get_name() == __voices[ j ].note->get_instrument()->get_name()){
 				return true;
 			}
 		}
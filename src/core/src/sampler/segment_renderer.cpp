@@ -0,0 +1,282 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/sampler/segment_renderer.h>
+
+#include <hydrogen/globals.h>
+#include <hydrogen/Preferences.h>
+#include <hydrogen/IO/AudioOutput.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_pool.h>
+#include <hydrogen/basics/song.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace H2Core
+{
+
+/**
+ * The output a segment sampler renders for: its transport counts the
+ * frames of the export, a tick being a frame since the captured notes
+ * are timed in frames.
+ */
+class SegmentOutput : public AudioOutput
+{
+	H2_OBJECT
+public:
+	SegmentOutput( unsigned nSampleRate, const std::vector<bool>& stems )
+			: AudioOutput( __class_name )
+			, m_nSampleRate( nSampleRate )
+	{
+		m_transport.m_status = TransportInfo::ROLLING;
+		m_transport.m_nTickSize = 1.0;
+		for ( unsigned nTrack = 0; nTrack < stems.size(); ++nTrack ) {
+			m_trackOut_L.push_back( stems[ nTrack ] ? new float[ MAX_BUFFER_SIZE ] : NULL );
+			m_trackOut_R.push_back( stems[ nTrack ] ? new float[ MAX_BUFFER_SIZE ] : NULL );
+			__track_out_enabled = __track_out_enabled || stems[ nTrack ];
+		}
+	}
+
+	~SegmentOutput() {
+		for ( unsigned nTrack = 0; nTrack < m_trackOut_L.size(); ++nTrack ) {
+			delete[] m_trackOut_L[ nTrack ];
+			delete[] m_trackOut_R[ nTrack ];
+		}
+	}
+
+	/// zero the track outputs before a period, the sampler mixes into them
+	void clearTrackOuts( uint32_t nFrames ) {
+		for ( unsigned nTrack = 0; nTrack < m_trackOut_L.size(); ++nTrack ) {
+			if ( m_trackOut_L[ nTrack ] ) {
+				memset( m_trackOut_L[ nTrack ], 0, nFrames * sizeof( float ) );
+				memset( m_trackOut_R[ nTrack ], 0, nFrames * sizeof( float ) );
+			}
+		}
+	}
+
+	int init( unsigned /*nBufferSize*/ ) {
+		return 0;
+	}
+	int connect() {
+		return 0;
+	}
+	void disconnect() {}
+	unsigned getBufferSize() {
+		return MAX_BUFFER_SIZE;
+	}
+	unsigned getSampleRate() {
+		return m_nSampleRate;
+	}
+	/// the sampler mixes into its own main outputs
+	float* getOut_L() {
+		return NULL;
+	}
+	float* getOut_R() {
+		return NULL;
+	}
+	int getNumTracks() {
+		return m_trackOut_L.size();
+	}
+	float* getTrackOut_L( unsigned nTrack ) {
+		return nTrack < m_trackOut_L.size() ? m_trackOut_L[ nTrack ] : NULL;
+	}
+	float* getTrackOut_R( unsigned nTrack ) {
+		return nTrack < m_trackOut_R.size() ? m_trackOut_R[ nTrack ] : NULL;
+	}
+
+	void updateTransportInfo() {}
+	void play() {}
+	void stop() {}
+	void locate( unsigned long nFrame ) {
+		m_transport.m_nFrames = nFrame;
+	}
+	void setBpm( float /*fBPM*/ ) {}
+
+private:
+	unsigned m_nSampleRate;
+	std::vector<float*> m_trackOut_L;
+	std::vector<float*> m_trackOut_R;
+};
+
+const char* SegmentOutput::__class_name = "SegmentOutput";
+
+const char* SegmentRenderer::__class_name = "SegmentRenderer";
+
+SegmentRenderer::SegmentRenderer( unsigned sample_rate, const std::vector<bool>& stems ) : Object( __class_name ),
+	__sample_rate( sample_rate ),
+	__stems( stems ),
+	__frames( 0 ),
+	__out_l( 0 ),
+	__out_r( 0 ),
+	__song( 0 ),
+	__mode( Sampler::LINEAR ),
+	__running( 0 ),
+	__rendered( 0 )
+{
+}
+
+SegmentRenderer::~SegmentRenderer()
+{
+	wait();
+	for ( unsigned i = 0; i < __notes.size(); i++ ) {
+		delete __notes[ i ].note;
+	}
+	delete[] __out_l;
+	delete[] __out_r;
+	for ( unsigned nTrack = 0; nTrack < __track_out_l.size(); nTrack++ ) {
+		delete[] __track_out_l[ nTrack ];
+		delete[] __track_out_r[ nTrack ];
+	}
+}
+
+void SegmentRenderer::capture_note( Note* note, long long frame_pos, float tick_size )
+{
+	assert( __segments.empty() );
+	// the start and the length in frames, as Sampler::__render_note computes
+	// them, the humanize delay being kept apart
+	int nStart = ( int )( note->get_position() * tick_size );
+	note->set_position( ( int )( __frames + nStart - frame_pos ) );
+	if ( note->get_length() != -1 ) {
+		note->set_length( ( int )( note->get_length() * tick_size ) );
+	}
+
+	CapturedNote captured;
+	captured.note = note;
+	captured.period = __periods.size();
+	__notes.push_back( captured );
+}
+
+void SegmentRenderer::capture_period( uint32_t frames )
+{
+	assert( __segments.empty() );
+	__periods.push_back( frames );
+	__period_starts.push_back( __frames );
+	__frames += frames;
+}
+
+void SegmentRenderer::start( int segments, unsigned lead_in, Song* song, Sampler::InterpolateMode mode )
+{
+	assert( __segments.empty() );
+	__song = song;
+	__mode = mode;
+	__rendered = 0;
+
+	__out_l = new float[ __frames ];
+	__out_r = new float[ __frames ];
+	for ( unsigned nTrack = 0; nTrack < __stems.size(); nTrack++ ) {
+		__track_out_l.push_back( __stems[ nTrack ] ? new float[ __frames ] : 0 );
+		__track_out_r.push_back( __stems[ nTrack ] ? new float[ __frames ] : 0 );
+	}
+
+	// the segments start on periods, as close as possible to equal shares
+	if ( segments < 1 ) segments = 1;
+	unsigned nPeriod = 0;
+	for ( int i = 0; i < segments && nPeriod < __periods.size(); i++ ) {
+		long long nEnd = __frames * ( i + 1 ) / segments;
+		Segment segment;
+		segment.renderer = this;
+		segment.first_period = nPeriod;
+		segment.end_period = std::lower_bound( __period_starts.begin(), __period_starts.end(), nEnd ) - __period_starts.begin();
+		if ( segment.end_period <= nPeriod ) {
+			continue;
+		}
+		// the last period starting lead_in frames before the segment, at least
+		long long nLeadIn = __period_starts[ nPeriod ] - lead_in;
+		segment.lead_in_period = std::upper_bound( __period_starts.begin(), __period_starts.end(), nLeadIn ) - __period_starts.begin();
+		segment.lead_in_period = segment.lead_in_period > 0 ? segment.lead_in_period - 1 : 0;
+		__segments.push_back( segment );
+		nPeriod = segment.end_period;
+	}
+	INFOLOG( QString( "rendering %1 frames in %2 segments, %3 frames of lead-in" )
+			 .arg( __frames ).arg( __segments.size() ).arg( lead_in ) );
+
+	__running = __segments.size();
+	for ( unsigned i = 0; i < __segments.size(); i++ ) {
+		pthread_create( &__segments[ i ].thread, 0, __segment_main, &__segments[ i ] );
+	}
+}
+
+void SegmentRenderer::wait()
+{
+	for ( unsigned i = 0; i < __segments.size(); i++ ) {
+		pthread_join( __segments[ i ].thread, 0 );
+	}
+	__segments.clear();
+}
+
+void* SegmentRenderer::__segment_main( void* param )
+{
+	Segment* pSegment = ( Segment* )param;
+	pSegment->renderer->__render( pSegment );
+	__sync_sub_and_fetch( &pSegment->renderer->__running, 1 );
+	return 0;
+}
+
+void SegmentRenderer::__render( Segment* segment )
+{
+	int nMaxNotes = Preferences::get_instance()->m_nMaxNotes;
+	NotePool notePool( 2 * nMaxNotes );
+	SegmentOutput output( __sample_rate, __stems );
+	Sampler* pSampler = new Sampler( &notePool );
+	pSampler->set_output( &output );
+	// the segments already take the cores
+	pSampler->set_render_threads( 1 );
+	pSampler->set_stream_wait( true );
+	pSampler->setInterpolateMode( __mode );
+
+	CapturedNote first;
+	first.period = segment->lead_in_period;
+	std::vector<CapturedNote>::const_iterator it = std::lower_bound( __notes.begin(), __notes.end(), first, CapturedNote::before );
+	output.m_transport.m_nFrames = __period_starts[ segment->lead_in_period ];
+	for ( unsigned nPeriod = segment->lead_in_period; nPeriod < segment->end_period; nPeriod++ ) {
+		uint32_t nFrames = __periods[ nPeriod ];
+		// a copy, the lead-in of the next segment replays the note as well
+		for ( ; it != __notes.end() && it->period == nPeriod; ++it ) {
+			pSampler->note_on( notePool.acquire( it->note ) );
+		}
+		output.clearTrackOuts( nFrames );
+		pSampler->process( nFrames, __song );
+
+		if ( nPeriod >= segment->first_period ) {
+			long long nFrame = __period_starts[ nPeriod ];
+			memcpy( __out_l + nFrame, pSampler->__main_out_L, nFrames * sizeof( float ) );
+			memcpy( __out_r + nFrame, pSampler->__main_out_R, nFrames * sizeof( float ) );
+			for ( unsigned nTrack = 0; nTrack < __track_out_l.size(); nTrack++ ) {
+				if ( __track_out_l[ nTrack ] ) {
+					memcpy( __track_out_l[ nTrack ] + nFrame, output.getTrackOut_L( nTrack ), nFrames * sizeof( float ) );
+					memcpy( __track_out_r[ nTrack ] + nFrame, output.getTrackOut_R( nTrack ), nFrames * sizeof( float ) );
+				}
+			}
+			__sync_add_and_fetch( &__rendered, ( long )nFrames );
+		}
+		output.m_transport.m_nFrames += nFrames;
+	}
+
+	// the notes still playing go with it
+	delete pSampler;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -207,6 +207,10 @@ void AudioEngineInfoForm::updateInfo()
 	// SAMPLER
 	Sampler *pSampler = AudioEngine::get_instance()->get_sampler();
 	sampler_playingNotesLbl->setText(QString( "%1 / %2" ).arg(pSampler->get_playing_notes_number()).arg(Preferences::get_instance()->m_nMaxNotes));
+	// note pool misses and overflows, the notes copied with new elsewhere are not
+	// counted. The misses should not move while playing
+	NotePool *pNotePool = AudioEngine::get_instance()->get_note_pool();
+	sampler_noteAllocationsLbl->setText(QString( "%1 / %2" ).arg(pNotePool->get_allocations()).arg(pNotePool->get_deletions()));
 
 	// Synth
 	Synth *pSynth = AudioEngine::get_instance()->get_synth();
@@ -28,7 +28,6 @@
 #include "ExportSongDialog.h"
 #include "Skin.h"
 #include "HydrogenApp.h"
-#include "Mixer/Mixer.h"
 
 #include <hydrogen/basics/note.h>
 #include <hydrogen/basics/pattern.h>
@@ -81,8 +80,6 @@ ExportSongDialog::ExportSongDialog(QWidget* parent)
 	defaultFilename += ".wav";
 	exportNameTxt->setText(defaultFilename);
 	b_QfileDialog = false;
-	m_bExportTrackouts = false;
-	m_nInstrument = 0;
 	m_sExtension = ".wav";
 	m_bOverwriteFiles = false;
 
@@ -207,10 +204,9 @@ void ExportSongDialog::on_okBtn_clicked()
 		*  2: Export to both
 		*/
 
+	QString filename;
 	if( exportTypeCombo->currentIndex() == 0 || exportTypeCombo->currentIndex() == 2 ){
-		m_bExportTrackouts = false;
-
-		QString filename = exportNameTxt->text();
+		filename = exportNameTxt->text();
 		if ( QFile( filename ).exists() == true && b_QfileDialog == false ) {
 
 			int res;
@@ -224,85 +220,63 @@ void ExportSongDialog::on_okBtn_clicked()
 			if (res == QMessageBox::No ) return;
 
 		}
-
-		if( exportTypeCombo->currentIndex() == 2 ) m_bExportTrackouts = true;
-		Hydrogen::get_instance()->startExportSong( filename, sampleRateCombo->currentText().toInt(), sampleDepthCombo->currentText().toInt() );
-
-		return;
 	}
 
-	if( exportTypeCombo->currentIndex() == 1 ){
-		m_bExportTrackouts = true;
-		exportTracks();
-		return;
+	// the stems are rendered in the same pass as the song
+	QStringList trackFilenames;
+	if( exportTypeCombo->currentIndex() == 1 || exportTypeCombo->currentIndex() == 2 ){
+		if( !exportTracks( trackFilenames ) ) return;
 	}
 
+	Hydrogen::get_instance()->startExportSong( filename, sampleRateCombo->currentText().toInt(), sampleDepthCombo->currentText().toInt(), trackFilenames );
 }
 
-void ExportSongDialog::exportTracks()
+bool ExportSongDialog::exportTracks( QStringList& trackFilenames )
 {
 	Song *pSong = Hydrogen::get_instance()->getSong();
-	if( m_nInstrument <= pSong->get_instrument_list()->size() -1 ){
+	InstrumentList *pInstrList = pSong->get_instrument_list();
+
+	QStringList filenameList =  exportNameTxt->text().split( m_sExtension );
+	QString firstItem;
+	if( !filenameList.isEmpty() ){
+		firstItem = filenameList.first();
+	}
+
+	for ( unsigned nInstr = 0; nInstr < pInstrList->size(); nInstr++ ) {
+		Instrument *pInstr = pInstrList->get( nInstr );
 
 		bool instrumentexists = false;
-		//if a instrument contains no notes we jump to the next instrument
+		//if a instrument contains no notes it gets no stem
 		unsigned nPatterns = pSong->get_pattern_list()->size();
-		for ( unsigned i = 0; i < nPatterns; i++ ) {
+		for ( unsigned i = 0; i < nPatterns && !instrumentexists; i++ ) {
 			Pattern *pat = pSong->get_pattern_list()->get( i );
 			const Pattern::notes_t* notes = pat->get_notes();
 			FOREACH_NOTE_CST_IT_BEGIN_END(notes,it) {
 				Note *pNote = it->second;
 				assert( pNote );
 
-				if( pNote->get_instrument()->get_name() == Hydrogen::get_instance()->getSong()->get_instrument_list()->get(m_nInstrument)->get_name() ){
+				if( pNote->get_instrument()->get_name() == pInstr->get_name() ){
 					instrumentexists = true;
 					break;
 				}
-
 			}
 		}
 
 		if( !instrumentexists ){
-			if( m_nInstrument == Hydrogen::get_instance()->getSong()->get_instrument_list()->size() -1 ){
-				m_bExportTrackouts = false;
-				HydrogenApp::get_instance()->getMixer()->unmuteAll( true );
-				m_nInstrument = 0;
-				return;
-			}else {
-				m_nInstrument++;
-				exportTracks();
-				return;
-			}
+			trackFilenames << QString();
+			continue;
 		}
 
-		QStringList filenameList =  exportNameTxt->text().split( m_sExtension );
-
-		QString firstItem;
-		if( !filenameList.isEmpty() ){
-			firstItem = filenameList.first();
-		}
-		QString newItem =  firstItem + "-" + Hydrogen::get_instance()->getSong()->get_instrument_list()->get(m_nInstrument)->get_name();
-
-		QString filename =  newItem.append(m_sExtension);
+		QString filename = firstItem + "-" + pInstr->get_name() + m_sExtension;
 
 		if ( QFile( filename ).exists() == true && b_QfileDialog == false && !m_bOverwriteFiles) {
 			int res = QMessageBox::information( this, "Hydrogen", tr( "The file %1 exists. \nOverwrite the existing file?").arg(filename), QMessageBox::Yes | QMessageBox::No | QMessageBox::YesToAll );
-			if (res == QMessageBox::No ) return;
+			if (res == QMessageBox::No ) return false;
 			if (res == QMessageBox::YesToAll ) m_bOverwriteFiles = true;
 		}
-
-		//Hydrogen::get_instance()->stopExportSong();
-		Hydrogen::get_instance()->stopExportSong( false );
-		m_bExporting = false;
-		HydrogenApp::get_instance()->getMixer()->soloClicked( m_nInstrument );
-
-		Hydrogen::get_instance()->startExportSong( filename, sampleRateCombo->currentText().toInt(), sampleDepthCombo->currentText().toInt() );
-
-		if(! (m_nInstrument == Hydrogen::get_instance()->getSong()->get_instrument_list()->size() -1 )){
-			m_nInstrument++;
-		}
+		trackFilenames << filename;
 	}
-
+	return true;
 }
 
 void ExportSongDialog::on_closeBtn_clicked()
@@ -483,19 +457,7 @@ void ExportSongDialog::progressEvent( int nValue )
 {
 	m_pProgressBar->setValue( nValue );
 	if ( nValue == 100 ) {
-
 		m_bExporting = false;
-
-		if( m_nInstrument == Hydrogen::get_instance()->getSong()->get_instrument_list()->size() -1 ){
-			HydrogenApp::get_instance()->getMixer()->unmuteAll( false );
-			m_nInstrument = 0;
-			m_bExportTrackouts = false;
-
-		}
-
-		if( m_bExportTrackouts ){
-			exportTracks();
-		}
 	}
 
 	if ( nValue < 100 ) {
@@ -545,6 +507,9 @@ void ExportSongDialog::setResamplerMode(int index)
 	case 4:
 		AudioEngine::get_instance()->get_sampler()->setInterpolateMode( Sampler::HERMITE );
 		break;
+	case 5:
+		AudioEngine::get_instance()->get_sampler()->setInterpolateMode( Sampler::SINC );
+		break;
 	}
 }
 
@@ -63,10 +63,8 @@ private:
 	bool checkUseOfRubberband();
 
 	bool m_bExporting;
-	void exportTracks();
-	bool m_bExportTrackouts;
+	bool exportTracks( QStringList& trackFilenames );
 	bool m_bOverwriteFiles;
-	uint m_nInstrument;
 	QString m_sExtension;
 	bool b_oldRubberbandBatchMode;
 	bool b_oldTimeLineBPMMode;
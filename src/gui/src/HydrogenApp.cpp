@@ -24,6 +24,8 @@
 #include <hydrogen/version.h>
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/event_queue.h>
+#include <hydrogen/audio_engine.h>
+#include <hydrogen/sampler/Sampler.h>
 #include <hydrogen/fx/LadspaFX.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/helpers/filesystem.h>
@@ -74,6 +76,9 @@ HydrogenApp::HydrogenApp( MainForm *pMainForm, Song *pFirstSong )
  , m_pPlaylistDialog( NULL )
  , m_pSampleEditor( NULL )
  , m_pDirector( NULL )
+ , m_nEventQueueOverflows( 0 )
+ , m_nNoteEditOverflows( 0 )
+ , m_nStreamUnderruns( 0 )
 
 {
 	m_pInstance = this;
@@ -491,105 +496,129 @@ void HydrogenApp::onEventQueueTimer()
 	// use the timer to do schedule instrument slaughter;
 	EventQueue *pQueue = EventQueue::get_instance();
 
-	Event event;
-	while ( ( event = pQueue->pop_event() ).type != EVENT_NONE ) {
-		for (int i = 0; i < (int)m_eventListeners.size(); i++ ) {
-			EventListener *pListener = m_eventListeners[ i ];
+	if ( pQueue->get_overflows() != m_nEventQueueOverflows ) {
+		m_nEventQueueOverflows = pQueue->get_overflows();
+		WARNINGLOG( QString( "%1 events lost, the event queue was full" ).arg( m_nEventQueueOverflows ) );
+	}
 
-			switch ( event.type ) {
-			case EVENT_STATE:
-				pListener->stateChangedEvent( event.value );
-				break;
+	Event events[ 64 ];
+	int nEvents;
+	while ( ( nEvents = pQueue->pop_events( events, 64 ) ) > 0 ) {
+		for ( int nEvent = 0; nEvent < nEvents; nEvent++ ) {
+			const Event& event = events[ nEvent ];
+			for (int i = 0; i < (int)m_eventListeners.size(); i++ ) {
+				EventListener *pListener = m_eventListeners[ i ];
 
-			case EVENT_PATTERN_CHANGED:
-				pListener->patternChangedEvent();
-				break;
+				switch ( event.type ) {
+				case EVENT_STATE:
+					pListener->stateChangedEvent( event.value );
+					break;
 
-			case EVENT_PATTERN_MODIFIED:
-				pListener->patternModifiedEvent();
-				break;
+				case EVENT_PATTERN_CHANGED:
+					pListener->patternChangedEvent();
+					break;
 
-			case EVENT_SELECTED_PATTERN_CHANGED:
-				pListener->selectedPatternChangedEvent();
-				break;
+				case EVENT_PATTERN_MODIFIED:
+					pListener->patternModifiedEvent();
+					break;
 
-			case EVENT_SELECTED_INSTRUMENT_CHANGED:
-				pListener->selectedInstrumentChangedEvent();
-				break;
+				case EVENT_SELECTED_PATTERN_CHANGED:
+					pListener->selectedPatternChangedEvent();
+					break;
 
-			case EVENT_MIDI_ACTIVITY:
-				pListener->midiActivityEvent();
-				break;
+				case EVENT_SELECTED_INSTRUMENT_CHANGED:
+					pListener->selectedInstrumentChangedEvent();
+					break;
 
-			case EVENT_NOTEON:
-				pListener->noteOnEvent( event.value );
-				break;
+				case EVENT_MIDI_ACTIVITY:
+					pListener->midiActivityEvent();
+					break;
 
-			case EVENT_ERROR:
-				pListener->errorEvent( event.value );
-				break;
+				case EVENT_NOTEON:
+					pListener->noteOnEvent( event.value );
+					break;
 
-			case EVENT_XRUN:
-				pListener->XRunEvent();
-				break;
+				case EVENT_ERROR:
+					pListener->errorEvent( event.value );
+					break;
 
-			case EVENT_METRONOME:
-				pListener->metronomeEvent( event.value );
-				break;
+				case EVENT_XRUN:
+					pListener->XRunEvent();
+					break;
 
-			case EVENT_RECALCULATERUBBERBAND:
-				pListener->rubberbandbpmchangeEvent();
-				break;
+				case EVENT_METRONOME:
+					pListener->metronomeEvent( event.value );
+					break;
 
-			case EVENT_PROGRESS:
-				pListener->progressEvent( event.value );
-				break;
+				case EVENT_RECALCULATERUBBERBAND:
+					pListener->rubberbandbpmchangeEvent();
+					break;
 
-			case EVENT_JACK_SESSION:
-				pListener->jacksessionEvent( event.value );
-				break;
+				case EVENT_PROGRESS:
+					pListener->progressEvent( event.value );
+					break;
 
-			case EVENT_PLAYLIST_LOADSONG:
-				pListener->playlistLoadSongEvent( event.value );
-				break;
+				case EVENT_JACK_SESSION:
+					pListener->jacksessionEvent( event.value );
+					break;
 
-			case EVENT_UNDO_REDO:
-				pListener->undoRedoActionEvent( event.value );
-				break;
+				case EVENT_PLAYLIST_LOADSONG:
+					pListener->playlistLoadSongEvent( event.value );
+					break;
 
-			default:
-				ERRORLOG( QString("[onEventQueueTimer] Unhandled event: %1").arg( event.type ) );
-			}
+				case EVENT_UNDO_REDO:
+					pListener->undoRedoActionEvent( event.value );
+					break;
+
+				default:
+					ERRORLOG( QString("[onEventQueueTimer] Unhandled event: %1").arg( event.type ) );
+				}
 
+			}
 		}
 	}
 
 	// midi notes
-	while(!pQueue->m_addMidiNoteVector.empty()){
-
-		int rounds = 1;
-		if(pQueue->m_addMidiNoteVector[0].b_noteExist)// runn twice, delete old note and add new note. this let the undo stack consistent
-			rounds = 2;
-		for(int i = 0; i<rounds; i++){
-			SE_addNoteAction *action = new SE_addNoteAction( pQueue->m_addMidiNoteVector[0].m_column,
-															 pQueue->m_addMidiNoteVector[0].m_row,
-															 pQueue->m_addMidiNoteVector[0].m_pattern,
-															 pQueue->m_addMidiNoteVector[0].m_length,
-															 pQueue->m_addMidiNoteVector[0].f_velocity,
-															 pQueue->m_addMidiNoteVector[0].f_pan_L,
-															 pQueue->m_addMidiNoteVector[0].f_pan_R,
-															 0.0,
-															 pQueue->m_addMidiNoteVector[0].nk_noteKeyVal,
-															 pQueue->m_addMidiNoteVector[0].no_octaveKeyVal,
-															 false,
-															 false,
-															 pQueue->m_addMidiNoteVector[0].b_isMidi,
-															 pQueue->m_addMidiNoteVector[0].b_isInstrumentMode);
-
-			HydrogenApp::get_instance()->m_undoStack->push( action );
-		}
-		pQueue->m_addMidiNoteVector.erase(pQueue->m_addMidiNoteVector.begin());
+	if ( pQueue->get_note_edit_overflows() != m_nNoteEditOverflows ) {
+		m_nNoteEditOverflows = pQueue->get_note_edit_overflows();
+		WARNINGLOG( QString( "%1 recorded notes lost, the note edit queue was full" ).arg( m_nNoteEditOverflows ) );
+	}
+
+	// streamed samples
+	unsigned nStreamUnderruns = AudioEngine::get_instance()->get_sampler()->get_stream_underruns();
+	if ( nStreamUnderruns != m_nStreamUnderruns ) {
+		m_nStreamUnderruns = nStreamUnderruns;
+		setStatusBarMessage( trUtf8( "The disk could not keep up with the streamed samples, raise the drumkit stream head" ), 5000 );
+	}
 
+	EventQueue::AddMidiNoteVector noteEdits[ 64 ];
+	int nNoteEdits;
+	while ( ( nNoteEdits = pQueue->pop_note_edits( noteEdits, 64 ) ) > 0 ) {
+		for ( int nNoteEdit = 0; nNoteEdit < nNoteEdits; nNoteEdit++ ) {
+			const EventQueue::AddMidiNoteVector& noteEdit = noteEdits[ nNoteEdit ];
+
+			int rounds = 1;
+			if(noteEdit.b_noteExist)// runn twice, delete old note and add new note. this let the undo stack consistent
+				rounds = 2;
+			for(int i = 0; i<rounds; i++){
+				SE_addNoteAction *action = new SE_addNoteAction( noteEdit.m_column,
+																 noteEdit.m_row,
+																 noteEdit.m_pattern,
+																 noteEdit.m_length,
+																 noteEdit.f_velocity,
+																 noteEdit.f_pan_L,
+																 noteEdit.f_pan_R,
+																 0.0,
+																 noteEdit.nk_noteKeyVal,
+																 noteEdit.no_octaveKeyVal,
+																 false,
+																 false,
+																 noteEdit.b_isMidi,
+																 noteEdit.b_isInstrumentMode);
+
+				HydrogenApp::get_instance()->m_undoStack->push( action );
+			}
+		}
 	}
 }
 
@@ -136,6 +136,9 @@ class HydrogenApp : public QObject, public H2Core::Object
 		SampleEditor *m_pSampleEditor;
 		Director *m_pDirector;
 		QTimer *m_pEventQueueTimer;
+		unsigned m_nEventQueueOverflows;	///< events dropped by the event queue, as last reported
+		unsigned m_nNoteEditOverflows;		///< note edits dropped by the event queue, as last reported
+		unsigned m_nStreamUnderruns;		///< streamed sample frames played as silence, as last reported
 		std::vector<EventListener*> m_eventListeners;
 		QStringList temporaryFileList;
 
@@ -232,7 +232,9 @@ void LayerPreview::mousePressEvent(QMouseEvent *ev)
 		float fVelocity = (float)ev->x() / (float)width();
 
 		Note *note = new Note( m_pInstrument, nPosition, fVelocity, fPan_L, fPan_R, nLength, fPitch );
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
 		AudioEngine::get_instance()->get_sampler()->note_on(note);
+		AudioEngine::get_instance()->unlock();
 
 		for ( int i = 0; i < MAX_LAYERS; i++ ) {
 			InstrumentLayer *pLayer = m_pInstrument->get_layer( i );
@@ -257,7 +259,9 @@ void LayerPreview::mousePressEvent(QMouseEvent *ev)
 
 		if ( m_pInstrument->get_layer( m_nSelectedLayer ) ) {
 			Note *note = new Note( m_pInstrument , nPosition, m_pInstrument->get_layer( m_nSelectedLayer )->get_end_velocity() - 0.01, fPan_L, fPan_R, nLength, fPitch );
+			AudioEngine::get_instance()->lock( RIGHT_HERE );
 			AudioEngine::get_instance()->get_sampler()->note_on(note);
+			AudioEngine::get_instance()->unlock();
 		}
 
 		if ( pLayer ) {
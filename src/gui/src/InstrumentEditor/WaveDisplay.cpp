@@ -98,15 +98,18 @@ void WaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 
 		float fGain = height() / 2.0 * pLayer->get_gain();
 
-		float *pSampleData = pLayer->get_sample()->get_data_l();
+		// float or compact frames
+		H2Core::Sample *pSample = pLayer->get_sample();
+		// only the head of a streamed sample is in memory
+		int nDataLength = pLayer->get_sample()->get_data_frames();
 
 		int nSamplePos =0;
 		int nVal;
 		for ( int i = 0; i < width(); ++i ){
 			nVal = 0;
 			for ( int j = 0; j < nScaleFactor; ++j ) {
-				if ( j < nSampleLength ) {
-					int newVal = (int)( pSampleData[ nSamplePos ] * fGain );
+				if ( j < nSampleLength && nSamplePos < nDataLength ) {
+					int newVal = (int)( pSample->get_frame_l( nSamplePos ) * fGain );
 					if ( newVal > nVal ) {
 						nVal = newVal;
 					}
@@ -319,7 +319,9 @@ void Mixer::noteOnClicked( MixerLine* ref )
 
 	const float fPitch = 0.0f;
 	Note *note = new Note( instrList->get(nLine), 0, 1.0, 0.5f, 0.5f, -1, fPitch );
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	AudioEngine::get_instance()->get_sampler()->note_on(note);
+	AudioEngine::get_instance()->unlock();
 
 	Hydrogen::get_instance()->setSelectedInstrumentNumber(nLine);
 }
@@ -338,7 +340,9 @@ void Mixer::noteOnClicked( MixerLine* ref )
 
 	const float fPitch = 0.0f;
 	Note *note = new Note( instrList->get( nLine ), 0, 1.0, 0.5, 0.5, -1, fPitch );
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	AudioEngine::get_instance()->get_sampler()->note_off(note);
+	AudioEngine::get_instance()->unlock();
 
 	Hydrogen::get_instance()->setSelectedInstrumentNumber(nLine);
 }
@@ -843,6 +843,8 @@ void PatternEditorPanel::patternSizeChanged( QString str )
 
 	if ( nSelected > 0 && nSelected <= 32 ) {
 		m_pPattern->set_length( nEighth * nSelected );
+		Hydrogen::get_instance()->getSong()->patterns_changed();
+		Hydrogen::get_instance()->updateSongTimeline();
 	}
 	else {
 		ERRORLOG( QString("[patternSizeChanged] Unhandled case %1").arg( nSelected ) );
@@ -40,6 +40,7 @@
 #include <hydrogen/LashClient.h>
 #include <hydrogen/audio_engine.h>
 #include <hydrogen/sampler/Sampler.h>
+#include <hydrogen/basics/sample_cache.h>
 #include "SongEditor/SongEditor.h"
 #include "SongEditor/SongEditorPanel.h"
 
@@ -130,6 +131,19 @@ PreferencesDialog::PreferencesDialog(QWidget* parent)
 	// max voices
 	maxVoicesTxt->setValue( pPref->m_nMaxNotes );
 
+	// render threads
+	renderThreadsSpinBox->setValue( pPref->m_nRenderThreads );
+
+	// compact samples
+	compactSamplesCheckBox->setChecked( pPref->m_bCompactSamples );
+
+	// sample disk cache
+	sampleCacheSpinBox->setValue( pPref->m_nSampleCacheSize );
+
+	// segmented export
+	exportSegmentsSpinBox->setValue( pPref->m_nExportSegments );
+	exportLeadInSpinBox->setValue( pPref->m_nExportLeadIn );
+
 	// JACK
 	trackOutsCheckBox->setChecked( pPref->m_bJackTrackOuts );
 	connect(trackOutsCheckBox, SIGNAL(toggled(bool)), this, SLOT(toggleTrackOutsCheckBox( bool )));
@@ -385,7 +399,31 @@ void PreferencesDialog::on_okBtn_clicked()
 	pPref->m_fMetronomeVolume = (metronomeVolumeSpinBox->value()) / 100.0;
 
 	// maxVoices
-	pPref->m_nMaxNotes = maxVoicesTxt->value();
+	if ( pPref->m_nMaxNotes != maxVoicesTxt->value() ) {
+		pPref->m_nMaxNotes = maxVoicesTxt->value();
+		Hydrogen::get_instance()->setMaxNotes( pPref->m_nMaxNotes );
+	}
+
+	// render threads
+	if ( pPref->m_nRenderThreads != (unsigned) renderThreadsSpinBox->value() ) {
+		pPref->m_nRenderThreads = renderThreadsSpinBox->value();
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		AudioEngine::get_instance()->get_sampler()->set_render_threads( pPref->m_nRenderThreads );
+		AudioEngine::get_instance()->unlock();
+	}
+
+	// compact samples, the loaded drumkit keeps its samples until it is loaded again
+	pPref->m_bCompactSamples = compactSamplesCheckBox->isChecked();
+
+	// sample disk cache, shrinking it evicts the least recently used files at once
+	if ( pPref->m_nSampleCacheSize != (unsigned) sampleCacheSpinBox->value() ) {
+		pPref->m_nSampleCacheSize = sampleCacheSpinBox->value();
+		SampleCache::get_instance()->set_disk_limit( pPref->m_nSampleCacheSize * 1024LL * 1024LL );
+	}
+
+	// segmented export, read by the next export
+	pPref->m_nExportSegments = exportSegmentsSpinBox->value();
+	pPref->m_nExportLeadIn = exportLeadInSpinBox->value();
 
 	if ( m_pMidiDriverComboBox->currentText() == "ALSA" ) {
 		pPref->m_sMidiDriver = "ALSA";
@@ -783,6 +821,9 @@ void PreferencesDialog::on_resampleComboBox_currentIndexChanged ( int index )
 	case 4:
 		AudioEngine::get_instance()->get_sampler()->setInterpolateMode( Sampler::HERMITE );
 		break;
+	case 5:
+		AudioEngine::get_instance()->get_sampler()->setInterpolateMode( Sampler::SINC );
+		break;
 	}
 
 }
@@ -518,7 +518,9 @@ void SampleEditor::on_PlayPushButton_clicked()
 	Song *pSong = Hydrogen::get_instance()->getSong();
 	Instrument *pInstr = pSong->get_instrument_list()->get( Hydrogen::get_instance()->getSelectedInstrumentNumber() );
 	Note *pNote = new Note( pInstr, 0, pInstr->get_layer( selectedLayer )->get_end_velocity() - 0.01, pan_L, pan_R, nLength, fPitch);
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
 	AudioEngine::get_instance()->get_sampler()->note_on(pNote);
+	AudioEngine::get_instance()->unlock();
 
 	setSamplelengthFrames();
 	createPositionsRulerPath();
@@ -738,7 +740,9 @@ void SampleEditor::valueChangedLoopCountSpinBox( int )
 {
 	testpTimer();
 	if ( m_pslframes > Hydrogen::get_instance()->getAudioOutput()->getSampleRate() * 60 ){
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
 		AudioEngine::get_instance()->get_sampler()->stop_playing_notes();
+		AudioEngine::get_instance()->unlock();
 		m_pMainSampleWaveDisplay->paintLocatorEvent( -1 , false);
 		m_pTimer->stop();
 		m_pPlayButton = false;
@@ -905,7 +909,9 @@ void SampleEditor::testpTimer()
 		m_pTargetDisplayTimer->stop();
 		PlayPushButton->setText( QString( "&Play" ) );
 		PlayOrigPushButton->setText( QString( "P&lay original sample") ); 
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
 		AudioEngine::get_instance()->get_sampler()->stop_playing_notes();
+		AudioEngine::get_instance()->unlock();
 		m_pPlayButton = false;
 	}
 }
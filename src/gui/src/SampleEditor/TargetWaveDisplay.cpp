@@ -197,8 +197,10 @@ void TargetWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 
 		float fGain = (height() - 8) / 2.0 * pLayer->get_gain();
 
-		float *pSampleDatal = pLayer->get_sample()->get_data_l();
-		float *pSampleDatar = pLayer->get_sample()->get_data_r();
+		// float or compact frames
+		H2Core::Sample *pSample = pLayer->get_sample();
+		// only the head of a streamed sample is in memory
+		int nDataLength = pLayer->get_sample()->get_data_frames();
 		int nSamplePos = 0;
 		int nVall;
 		int nValr;
@@ -206,21 +208,23 @@ void TargetWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 			nVall = 0;
 			nValr = 0;
 			for ( int j = 0; j < nScaleFactor; ++j ) {
-				if ( j < nSampleLength ) {
-					if ( pSampleDatal[ nSamplePos ] < 0 ){
-						int newVal = static_cast<int>( pSampleDatal[ nSamplePos ] * -fGain );
+				if ( j < nSampleLength && nSamplePos < nDataLength ) {
+					float fVall = pSample->get_frame_l( nSamplePos );
+					float fValr = pSample->get_frame_r( nSamplePos );
+					if ( fVall < 0 ){
+						int newVal = static_cast<int>( fVall * -fGain );
 						nVall = newVal;
 					}else
 					{
-						int newVal = static_cast<int>( pSampleDatal[ nSamplePos ] * fGain );
+						int newVal = static_cast<int>( fVall * fGain );
 						nVall = newVal;
 					}
-					if ( pSampleDatar[ nSamplePos ] > 0 ){
-						int newVal = static_cast<int>( pSampleDatar[ nSamplePos ] * -fGain );
+					if ( fValr > 0 ){
+						int newVal = static_cast<int>( fValr * -fGain );
 						nValr = newVal;
 					}else
 					{
-						int newVal = static_cast<int>( pSampleDatar[ nSamplePos ] * fGain );
+						int newVal = static_cast<int>( fValr * fGain );
 						nValr = newVal;
 					}
 				}
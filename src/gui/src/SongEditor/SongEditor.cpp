@@ -136,6 +136,8 @@ void SongEditor::keyPressEvent ( QKeyEvent * ev )
 				PatternList* pColumn = (*pColumns)[ cell.x() ];
 				pColumn->del(pPatternList->get( cell.y() ) );
 			}
+			pEngine->getSong()->patterns_changed();
+			pEngine->updateSongTimeline();
 			AudioEngine::get_instance()->unlock();
 
 			m_selectedCells.clear();
@@ -278,6 +280,8 @@ void SongEditor::addPattern( int nColumn , int nRow )
 		pColumn->add( pPattern );
 	}
 	pSong->__is_modified = true;
+	pEngine->getSong()->patterns_changed();
+	pEngine->updateSongTimeline();
 	AudioEngine::get_instance()->unlock();
 	m_bSequenceChanged = true;
 	update();
@@ -309,6 +313,8 @@ void SongEditor::deletePattern( int nColumn , int nRow, unsigned nColumnIndex )
 		}
 	}
 	pSong->__is_modified = true;
+	pEngine->getSong()->patterns_changed();
+	pEngine->updateSongTimeline();
 	AudioEngine::get_instance()->unlock();
 	m_bSequenceChanged = true;
 	update();
@@ -591,6 +597,8 @@ void SongEditor::movePatternCellAction( std::vector<QPoint> movingCells, std::ve
 	}
 
 	pEngine->getSong()->__is_modified = true;
+	pEngine->getSong()->patterns_changed();
+	pEngine->updateSongTimeline();
 	AudioEngine::get_instance()->unlock();
 
 	m_bIsMoving = false;
@@ -903,6 +911,8 @@ void SongEditor::clearThePatternSequenseVector( QString filename )
 	pPatternGroupsVect->clear();
 
 	song->__is_modified = true;
+	engine->getSong()->patterns_changed();
+	engine->updateSongTimeline();
 	AudioEngine::get_instance()->unlock();
 	m_bSequenceChanged = true;
 	update();
@@ -1158,7 +1168,7 @@ void SongEditorPatternList::createBackground()
 			}
 		}*/
 		if ( pCurrentPatternList->index( pPattern ) != -1 ) bActive = true;
-		if ( pEngine->getNextPatterns()->index( pPattern ) != -1 ) bNext = true;
+		if ( pEngine->isNextPattern( pPattern ) ) bNext = true;
 
 		if ( i == nSelectedPattern ) {
 			p.setPen( QColor( 0,0,0 ) );
@@ -1223,6 +1233,8 @@ void SongEditorPatternList::patternPopup_virtualPattern()
 	}//for
 
 	if ( dialog->exec() == QDialog::Accepted ) {
+		// the audio thread flattens the virtual patterns as it plays
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
 		selectedPattern->virtual_patterns_clear();
 		for (unsigned int index = 0; index < listsize-1; ++index) {
 			QListWidgetItem *listItem = dialog->patternList->item(index);
@@ -1233,11 +1245,14 @@ void SongEditorPatternList::patternPopup_virtualPattern()
 			}//if
 		}//for
 
+		pPatternList->flattened_virtual_patterns_compute();
+		song->patterns_changed();
+		pEngine->updateSongTimeline();
+		AudioEngine::get_instance()->unlock();
+
 		pSEPanel->updateAll();
 	}//if
 
-	pPatternList->flattened_virtual_patterns_compute();
-
 	delete dialog;
 }//patternPopup_virtualPattern
 
@@ -1466,6 +1481,9 @@ void SongEditorPatternList::deletePatternFromList( QString patternFilename, QStr
 #endif
 	//~save pattern end
 
+	// the audio thread must not play the pattern while it is deleted
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+
 	H2Core::Pattern *pattern = pSongPatternList->get( patternPosition );
 	INFOLOG( QString("[patternPopup_delete] Delete pattern: %1 @%2").arg(pattern->get_name()).arg( (long)pattern ) );
 	pSongPatternList->del(pattern);
@@ -1523,6 +1541,9 @@ void SongEditorPatternList::deletePatternFromList( QString patternFilename, QStr
 
 	delete pattern;
 	song->__is_modified = true;
+	pEngine->getSong()->patterns_changed();
+	pEngine->updateSongTimeline();
+	AudioEngine::get_instance()->unlock();
 	HydrogenApp::get_instance()->getSongEditorPanel()->updateAll();
 
 }
@@ -1717,6 +1738,8 @@ void SongEditorPatternList::fillRangeWithPattern( FillRange* pRange, int nPatter
 				break;
 			}
 		}
+	pEngine->getSong()->patterns_changed();
+	pEngine->updateSongTimeline();
 	AudioEngine::get_instance()->unlock();
 
 
@@ -468,6 +468,8 @@ void SongEditorPanel::restoreGroupVector( QString filename )
 	pPatternGroupsVect->clear();
 
 	Hydrogen::get_instance()->getSong()->readTempPatternList( filename );
+	Hydrogen::get_instance()->getSong()->patterns_changed();
+	Hydrogen::get_instance()->updateSongTimeline();
 	m_pSongEditor->updateEditorandSetTrue();
 	updateAll();
 }
@@ -77,6 +77,9 @@ SoundLibraryPanel::SoundLibraryPanel( QWidget *pParent )
  , __song_item( NULL )
  , __pattern_item( NULL )
  , __pattern_item_list( NULL )
+ , __drumkit_load_dialog( NULL )
+ , __drumkit_load_timer( NULL )
+ , __loading_drumkit( NULL )
 {
 
 	//INFOLOG( "INIT" );
@@ -104,6 +107,9 @@ SoundLibraryPanel::SoundLibraryPanel( QWidget *pParent )
 	__pattern_menu_list->addSeparator();
 	__pattern_menu_list->addAction( trUtf8( "Load" ), this, SLOT( on_patternLoadAction() ) );
 
+	__drumkit_load_timer = new QTimer( this );
+	connect( __drumkit_load_timer, SIGNAL( timeout() ), this, SLOT( on_drumkitLoadTimer() ) );
+
 // DRUMKIT LIST
 	__sound_library_tree = new SoundLibraryTree( NULL );
 	connect( __sound_library_tree, SIGNAL( currentItemChanged ( QTreeWidgetItem*, QTreeWidgetItem* ) ), this, SLOT( on_DrumkitList_ItemChanged( QTreeWidgetItem*, QTreeWidgetItem* ) ) );
@@ -133,6 +139,12 @@ SoundLibraryPanel::SoundLibraryPanel( QWidget *pParent )
 
 SoundLibraryPanel::~SoundLibraryPanel()
 {
+	if ( __loading_drumkit ) {
+		Hydrogen::get_instance()->cancelDrumkitLoad();
+		Hydrogen::get_instance()->finishDrumkitLoad();
+		delete __loading_drumkit;
+	}
+
 	for (uint i = 0; i < __system_drumkit_info_list.size(); ++i ) {
 		delete __system_drumkit_info_list[i];
 	}
@@ -461,6 +473,9 @@ void SoundLibraryPanel::on_DrumkitList_mouseMove( QMouseEvent *event)
 
 void SoundLibraryPanel::on_drumkitLoadAction()
 {
+	if ( __loading_drumkit ) {
+		return;
+	}
 	restore_background_color();
 
 	QString sDrumkitName = __sound_library_tree->currentItem()->text(0);
@@ -484,19 +499,63 @@ void SoundLibraryPanel::on_drumkitLoadAction()
 	}
 	assert( drumkitInfo );
 
+	// the list may be rebuilt before the load ends, the engine gets a copy
+	Drumkit *pLoadingDrumkit = new Drumkit( drumkitInfo );
+	if ( Hydrogen::get_instance()->startDrumkitLoad( pLoadingDrumkit ) != 0 ) {
+		delete pLoadingDrumkit;
+		change_background_color();
+		return;
+	}
+	__loading_drumkit = pLoadingDrumkit;
+
 	QApplication::setOverrideCursor(Qt::WaitCursor);
 
-	Hydrogen::get_instance()->loadDrumkit( drumkitInfo );
-	Hydrogen::get_instance()->getSong()->__is_modified = true;
-	HydrogenApp::get_instance()->onDrumkitLoad( drumkitInfo->get_name() );
-	HydrogenApp::get_instance()->getPatternEditorPanel()->getDrumPatternEditor()->updateEditor();
-	HydrogenApp::get_instance()->getPatternEditorPanel()->updatePianorollEditor();
+	// shown and modal at once, nothing else is loaded or edited meanwhile
+	__drumkit_load_dialog = new QProgressDialog( trUtf8( "Loading drumkit %1" ).arg( sDrumkitName ), trUtf8( "Cancel" ), 0, 100, this );
+	__drumkit_load_dialog->setWindowModality( Qt::ApplicationModal );
+	__drumkit_load_dialog->setMinimumDuration( 0 );
+	__drumkit_load_dialog->setAutoClose( false );
+	__drumkit_load_dialog->setAutoReset( false );
+	__drumkit_load_dialog->setValue( 0 );
+	__drumkit_load_dialog->show();
+
+	// the samples are decoded by the engine, the timer follows them
+	__drumkit_load_timer->start( 50 );
+}
 
-	InstrumentEditorPanel::get_instance()->updateInstrumentEditor();
 
-	__sound_library_tree->currentItem()->setBackgroundColor ( 0, QColor( 50, 50, 50) );
-	QApplication::restoreOverrideCursor();
 
+void SoundLibraryPanel::on_drumkitLoadTimer()
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	if ( __drumkit_load_dialog->wasCanceled() ) {
+		pHydrogen->cancelDrumkitLoad();
+	}
+	if ( pHydrogen->isDrumkitLoading() ) {
+		__drumkit_load_dialog->setValue( pHydrogen->getDrumkitLoadProgress() );
+		return;
+	}
+
+	__drumkit_load_timer->stop();
+	__drumkit_load_dialog->hide();
+	__drumkit_load_dialog->deleteLater();
+	__drumkit_load_dialog = NULL;
+
+	int nResult = pHydrogen->finishDrumkitLoad();
+	delete __loading_drumkit;
+	__loading_drumkit = NULL;
+
+	if ( nResult == 0 ) {
+		pHydrogen->getSong()->__is_modified = true;
+		HydrogenApp::get_instance()->onDrumkitLoad( pHydrogen->getCurrentDrumkitname() );
+		HydrogenApp::get_instance()->getPatternEditorPanel()->getDrumPatternEditor()->updateEditor();
+		HydrogenApp::get_instance()->getPatternEditorPanel()->updatePianorollEditor();
+
+		InstrumentEditorPanel::get_instance()->updateInstrumentEditor();
+	}
+
+	update_background_color();
+	QApplication::restoreOverrideCursor();
 }
 
 
@@ -60,6 +60,7 @@ private slots:
 	void on_DrumkitList_mouseMove( QMouseEvent* event );
 
 	void on_drumkitLoadAction();
+	void on_drumkitLoadTimer();
 	void on_drumkitDeleteAction();
 	void on_drumkitPropertiesAction();
 	void on_drumkitExportAction();
@@ -87,6 +88,9 @@ private:
 
 	std::vector<H2Core::Drumkit*> __system_drumkit_info_list;
 	std::vector<H2Core::Drumkit*> __user_drumkit_info_list;
+	QProgressDialog* __drumkit_load_dialog;	///< shown while a drumkit loads, NULL otherwise
+	QTimer* __drumkit_load_timer;			///< follows the drumkit being loaded
+	H2Core::Drumkit* __loading_drumkit;		///< copy of the drumkit being loaded, NULL otherwise
 	bool __expand_pattern_list;
 	bool __expand_songs_list;
 	void restore_background_color();
@@ -453,6 +453,7 @@ int main(int argc, char *argv[])
 		delete pPref;
 		delete H2Core::EventQueue::get_instance();
 		delete H2Core::AudioEngine::get_instance();
+		delete H2Core::SampleCache::get_instance();
 
 		delete MidiMap::get_instance();
 		delete MidiActionManager::get_instance();
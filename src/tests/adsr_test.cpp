@@ -55,3 +55,51 @@ void ADSRTest::testRelease()
 	/* Idle */
 	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, m_adsr->get_value( 2.0 ), delta );
 }
+
+
+void ADSRTest::testBlockValues()
+{
+	/* values of the former per frame envelope, ticks divided by the segment length */
+	const int nChecks = 22;
+	const int checkFrames[ nChecks ] = {
+		0, 1, 100, 428,         // attack
+		429, 430, 431, 600, 1000, 1141, // decay, from the first frame past the attack
+		1142, 1300, 1336,       // sustain
+		1337, 1338, 1339, 1800, 2000, 2335, 2336, // release, from frame 1337 on
+		2337, 2399              // idle
+	};
+	const float checkValues[ nChecks ] = {
+		0.0, 0.104544982, 0.585349441, 0.999437928,
+		1.0, 0.998602509, 0.997041106, 0.790173113, 0.605080485, 0.600000083,
+		0.6, 0.6, 0.6,
+		0.6, 0.598394573, 0.596791863, 0.110738024, 0.031222036, 0.000000032, 0.000000006,
+		0.0, 0.0
+	};
+
+	ADSR adsr( 300.0, 500.0, 0.6, 700.0 );
+	const int nFrames = 2400;
+	const int nBlock = 100;
+	const int nRelease = 1337;
+	const float fStep = 0.7;
+	float values[ nFrames ];
+
+	/* released within a block */
+	for ( int nFrame = 0; nFrame < nFrames; nFrame += nBlock ) {
+		if ( nFrame < nRelease && nRelease < nFrame + nBlock ) {
+			adsr.get_values( values + nFrame, nRelease - nFrame, fStep );
+			adsr.release();
+			adsr.get_values( values + nRelease, nFrame + nBlock - nRelease, fStep );
+		} else {
+			adsr.get_values( values + nFrame, nBlock, fStep );
+		}
+	}
+	CPPUNIT_ASSERT( adsr.is_idle() );
+
+	for ( int i = 0; i < nChecks; i++ ) {
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( checkValues[ i ], values[ checkFrames[ i ] ], delta );
+	}
+	/* the sustain holds until the release */
+	for ( int nFrame = 1142; nFrame <= nRelease; nFrame++ ) {
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.6, values[ nFrame ], delta );
+	}
+}
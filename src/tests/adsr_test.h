@@ -11,6 +11,7 @@ class ADSRTest : public CppUnit::TestCase {
 	CPPUNIT_TEST_SUITE( ADSRTest );
 	CPPUNIT_TEST( testAttack );
 	CPPUNIT_TEST( testRelease );
+	CPPUNIT_TEST( testBlockValues );
 	CPPUNIT_TEST_SUITE_END();
 
 	private:
@@ -22,6 +23,7 @@ class ADSRTest : public CppUnit::TestCase {
 	
 	void testAttack();
 	void testRelease();
+	void testBlockValues();
 };
 
 #endif
@@ -0,0 +1,116 @@
+#include "event_queue_test.h"
+
+#include <hydrogen/event_queue.h>
+#include <pthread.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( EventQueueTest );
+
+using namespace H2Core;
+
+static const int nProducers = 4;
+static const int nProducerEvents = 100000;
+
+void EventQueueTest::setUp()
+{
+	EventQueue::create_instance();
+	/* drop the events left by the previous tests */
+	while ( EventQueue::get_instance()->pop_event().type != EVENT_NONE ) {}
+}
+
+void EventQueueTest::testOverflow()
+{
+	EventQueue* pQueue = EventQueue::get_instance();
+	unsigned nOverflows = pQueue->get_overflows();
+
+	for ( int i = 0; i < MAX_EVENTS + 10; ++i ) {
+		pQueue->push_event( EVENT_NOTEON, i );
+	}
+	CPPUNIT_ASSERT_EQUAL( nOverflows + 10, pQueue->get_overflows() );
+	CPPUNIT_ASSERT( pQueue->wait_event( 0 ) );
+
+	/* the newest events are the dropped ones */
+	Event events[ 100 ];
+	int nValue = 0;
+	int nEvents;
+	while ( ( nEvents = pQueue->pop_events( events, 100 ) ) > 0 ) {
+		for ( int i = 0; i < nEvents; ++i ) {
+			CPPUNIT_ASSERT_EQUAL( EVENT_NOTEON, events[ i ].type );
+			CPPUNIT_ASSERT_EQUAL( nValue++, events[ i ].value );
+		}
+	}
+	CPPUNIT_ASSERT_EQUAL( MAX_EVENTS, nValue );
+	CPPUNIT_ASSERT_EQUAL( EVENT_NONE, pQueue->pop_event().type );
+	CPPUNIT_ASSERT( !pQueue->wait_event( 1 ) );
+}
+
+static void* produce( void* arg )
+{
+	long nProducer = ( long )arg;
+	for ( int i = 0; i < nProducerEvents; ++i ) {
+		EventQueue::get_instance()->push_event( ( EventType )( EVENT_STATE + nProducer ), i );
+	}
+	return NULL;
+}
+
+void EventQueueTest::testProducers()
+{
+	EventQueue* pQueue = EventQueue::get_instance();
+	unsigned nOverflows = pQueue->get_overflows();
+
+	pthread_t threads[ nProducers ];
+	for ( long i = 0; i < nProducers; ++i ) {
+		pthread_create( &threads[ i ], NULL, produce, ( void* )i );
+	}
+
+	/* each producer events come in order, none is torn or lost unless counted */
+	int next[ nProducers ] = { 0 };
+	int nReceived = 0;
+	Event events[ 64 ];
+	while ( nReceived + ( int )( pQueue->get_overflows() - nOverflows ) < nProducers * nProducerEvents ) {
+		pQueue->wait_event( 10 );
+		int nEvents = pQueue->pop_events( events, 64 );
+		for ( int i = 0; i < nEvents; ++i ) {
+			int nProducer = events[ i ].type - EVENT_STATE;
+			CPPUNIT_ASSERT( nProducer >= 0 && nProducer < nProducers );
+			CPPUNIT_ASSERT( events[ i ].value >= next[ nProducer ] );
+			next[ nProducer ] = events[ i ].value + 1;
+		}
+		nReceived += nEvents;
+	}
+
+	for ( int i = 0; i < nProducers; ++i ) {
+		pthread_join( threads[ i ], NULL );
+	}
+	CPPUNIT_ASSERT_EQUAL( EVENT_NONE, pQueue->pop_event().type );
+}
+
+void EventQueueTest::testNoteEdits()
+{
+	EventQueue* pQueue = EventQueue::get_instance();
+	unsigned nOverflows = pQueue->get_note_edit_overflows();
+
+	EventQueue::AddMidiNoteVector noteEdit;
+	noteEdit.m_row = 3;
+	noteEdit.m_pattern = 1;
+	noteEdit.m_length = -1;
+	noteEdit.f_velocity = 0.8;
+	noteEdit.b_noteExist = false;
+	for ( int i = 0; i < MAX_NOTE_EDITS + 1; ++i ) {
+		noteEdit.m_column = i;
+		pQueue->push_note_edit( noteEdit );
+	}
+	CPPUNIT_ASSERT_EQUAL( nOverflows + 1, pQueue->get_note_edit_overflows() );
+	/* note edits do not show up as events */
+	CPPUNIT_ASSERT( !pQueue->wait_event( 0 ) );
+
+	EventQueue::AddMidiNoteVector noteEdits[ 100 ];
+	int nColumn = 0;
+	int nNoteEdits;
+	while ( ( nNoteEdits = pQueue->pop_note_edits( noteEdits, 100 ) ) > 0 ) {
+		for ( int i = 0; i < nNoteEdits; ++i ) {
+			CPPUNIT_ASSERT_EQUAL( nColumn++, noteEdits[ i ].m_column );
+			CPPUNIT_ASSERT_EQUAL( 3, noteEdits[ i ].m_row );
+		}
+	}
+	CPPUNIT_ASSERT_EQUAL( MAX_NOTE_EDITS, nColumn );
+}
@@ -0,0 +1,21 @@
+#ifndef EVENT_QUEUE_TEST_H
+#define EVENT_QUEUE_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class EventQueueTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( EventQueueTest );
+	CPPUNIT_TEST( testOverflow );
+	CPPUNIT_TEST( testProducers );
+	CPPUNIT_TEST( testNoteEdits );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	virtual void setUp();
+
+	void testOverflow();
+	void testProducers();
+	void testNoteEdits();
+};
+
+#endif
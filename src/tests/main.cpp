@@ -2,6 +2,7 @@
 #include <cppunit/ui/text/TestRunner.h>
 
 #include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/basics/sample_cache.h>
 
 void setupEnvironment()
 {
@@ -14,6 +15,8 @@ void setupEnvironment()
     H2Core::Filesystem::bootstrap( logger, "./data" );
     H2Core::Filesystem::info();
     H2Core::Filesystem::rm( H2Core::Filesystem::tmp_dir(), true );
+    /* SampleCache */
+    H2Core::SampleCache::create_instance();
 }
 
 
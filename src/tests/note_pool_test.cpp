@@ -0,0 +1,91 @@
+#include "note_pool_test.h"
+
+#include <hydrogen/basics/adsr.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_pool.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( NotePoolTest );
+
+using namespace H2Core;
+
+void NotePoolTest::testRecycle()
+{
+	Instrument* pInstr = new Instrument( 1, "pool", new ADSR( 100, 200, 0.5, 300 ) );
+	NotePool pool( 2 );
+	CPPUNIT_ASSERT_EQUAL( 2, pool.get_free() );
+
+	Note* pNote = pool.acquire( pInstr, 10, 0.8, 0.5, 0.5, 48, 0.0 );
+	CPPUNIT_ASSERT_EQUAL( 1, pool.get_free() );
+	CPPUNIT_ASSERT( pNote->get_instrument() == pInstr );
+	CPPUNIT_ASSERT_EQUAL( 10, pNote->get_position() );
+	CPPUNIT_ASSERT_EQUAL( 48, pNote->get_length() );
+	CPPUNIT_ASSERT_EQUAL( 300.0f, pNote->get_adsr()->get_release() );
+
+	/* the envelope of a recycled note starts over from the instrument one */
+	ADSR* pADSR = pNote->get_adsr();
+	pADSR->release();
+	pool.release( pNote );
+	CPPUNIT_ASSERT_EQUAL( 2, pool.get_free() );
+	Note* pCopy = new Note( pInstr, 20, 0.5, 0.5, 0.5, 12, 0.0 );
+	Note* pRecycled = pool.acquire( pCopy, 0 );
+	CPPUNIT_ASSERT( pRecycled == pNote );
+	CPPUNIT_ASSERT( pRecycled->get_adsr() == pADSR );
+	CPPUNIT_ASSERT_EQUAL( 20, pRecycled->get_position() );
+	CPPUNIT_ASSERT( !pRecycled->get_adsr()->is_idle() );
+
+	pool.release( pRecycled );
+	delete pCopy;
+	delete pInstr;
+}
+
+void NotePoolTest::testOverflow()
+{
+	Instrument* pInstr = new Instrument();
+	NotePool pool( 1 );
+	Note* pFirst = pool.acquire( pInstr, 0, 1.0, 0.5, 0.5, -1, 0.0 );
+	/* empty pool, falls back to the heap */
+	Note* pSecond = pool.acquire( pInstr, 0, 1.0, 0.5, 0.5, -1, 0.0 );
+	CPPUNIT_ASSERT( pSecond != pFirst );
+	CPPUNIT_ASSERT_EQUAL( 0, pool.get_free() );
+	CPPUNIT_ASSERT_EQUAL( 1, pool.get_allocations() );
+
+	pool.release( pFirst );
+	/* full pool, deleted */
+	pool.release( pSecond );
+	CPPUNIT_ASSERT_EQUAL( 1, pool.get_free() );
+	CPPUNIT_ASSERT_EQUAL( 1, pool.get_deletions() );
+	pool.release( NULL );
+	CPPUNIT_ASSERT_EQUAL( 1, pool.get_free() );
+	delete pInstr;
+}
+
+void NotePoolTest::testResize()
+{
+	Instrument* pInstr = new Instrument();
+	NotePool pool( 2 );
+	Note* pNote = pool.acquire( pInstr, 0, 1.0, 0.5, 0.5, -1, 0.0 );
+
+	/* the added room is preallocated, the note in use is not counted */
+	pool.set_capacity( 4 );
+	CPPUNIT_ASSERT_EQUAL( 4, pool.get_capacity() );
+	CPPUNIT_ASSERT_EQUAL( 3, pool.get_free() );
+	pool.release( pNote );
+	CPPUNIT_ASSERT_EQUAL( 4, pool.get_free() );
+	Note* notes[ 4 ];
+	for ( int i = 0; i < 4; i++ ) {
+		notes[ i ] = pool.acquire( pInstr, 0, 1.0, 0.5, 0.5, -1, 0.0 );
+	}
+	CPPUNIT_ASSERT_EQUAL( 0, pool.get_allocations() );
+	for ( int i = 0; i < 4; i++ ) {
+		pool.release( notes[ i ] );
+	}
+
+	/* the surplus released notes go back to the heap */
+	NotePool full( 4 );
+	full.set_capacity( 1 );
+	CPPUNIT_ASSERT_EQUAL( 1, full.get_capacity() );
+	CPPUNIT_ASSERT_EQUAL( 1, full.get_free() );
+	CPPUNIT_ASSERT_EQUAL( 0, full.get_deletions() );
+	delete pInstr;
+}
@@ -0,0 +1,19 @@
+#ifndef NOTE_POOL_TEST_H
+#define NOTE_POOL_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class NotePoolTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( NotePoolTest );
+	CPPUNIT_TEST( testRecycle );
+	CPPUNIT_TEST( testOverflow );
+	CPPUNIT_TEST( testResize );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testRecycle();
+	void testOverflow();
+	void testResize();
+};
+
+#endif
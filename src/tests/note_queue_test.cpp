@@ -0,0 +1,125 @@
+#include "note_queue_test.h"
+
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_pool.h>
+#include <hydrogen/basics/note_queue.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( NoteQueueTest );
+
+using namespace H2Core;
+
+static const float fTickSize = 100.0;
+
+static Note* note( Instrument* pInstr, int nPosition, int nHumanizeDelay )
+{
+	Note* pNote = new Note( pInstr, nPosition, 1.0, 0.5, 0.5, -1, 0.0 );
+	pNote->set_humanize_delay( nHumanizeDelay );
+	pInstr->enqueue();
+	return pNote;
+}
+
+void NoteQueueTest::testOrder()
+{
+	Instrument* pInstr = new Instrument();
+	NoteQueue queue( 2 );
+	Note* pLate = note( pInstr, 12, 20 );
+	Note* pEarly = note( pInstr, 12, -20 );
+	Note* pFirst = note( pInstr, 10, 0 );
+	/* its negative delay brings it in the first period */
+	Note* pAhead = note( pInstr, 20, -1050 );
+	queue.push( pLate );
+	queue.push( pEarly );
+	queue.push( pFirst );
+	queue.push( pAhead );
+	CPPUNIT_ASSERT_EQUAL( 4, queue.size() );
+
+	Note* notes[ 4 ];
+	CPPUNIT_ASSERT_EQUAL( 0, queue.pop_due( 950, fTickSize, notes, 4 ) );
+	CPPUNIT_ASSERT_EQUAL( 2, queue.pop_due( 1001, fTickSize, notes, 4 ) );
+	CPPUNIT_ASSERT( notes[ 0 ] == pFirst );
+	CPPUNIT_ASSERT( notes[ 1 ] == pAhead );
+
+	/* a positive delay does not hold the note back, the sampler applies it */
+	CPPUNIT_ASSERT_EQUAL( 1, queue.pop_due( 1201, fTickSize, notes, 1 ) );
+	CPPUNIT_ASSERT( notes[ 0 ] == pEarly );
+	CPPUNIT_ASSERT_EQUAL( 1, queue.pop_due( 1201, fTickSize, notes, 1 ) );
+	CPPUNIT_ASSERT( notes[ 0 ] == pLate );
+	CPPUNIT_ASSERT( queue.empty() );
+
+	/* a note queued behind the wheel is due at once */
+	Note* pPlayed = note( pInstr, 30, 0 );
+	Note* pWaiting = note( pInstr, 40, 0 );
+	queue.push( pPlayed );
+	queue.push( pWaiting );
+	CPPUNIT_ASSERT_EQUAL( 1, queue.pop_due( 3100, fTickSize, notes, 4 ) );
+	Note* pBehind = note( pInstr, 5, 0 );
+	queue.push( pBehind );
+	CPPUNIT_ASSERT_EQUAL( 1, queue.pop_due( 600, fTickSize, notes, 4 ) );
+	CPPUNIT_ASSERT( notes[ 0 ] == pBehind );
+	CPPUNIT_ASSERT_EQUAL( 1, queue.size() );
+
+	delete pLate;
+	delete pEarly;
+	delete pFirst;
+	delete pAhead;
+	delete pPlayed;
+	delete pBehind;
+	/* releases pWaiting, to the heap */
+	NotePool pool( 0 );
+	queue.clear( &pool );
+	CPPUNIT_ASSERT( queue.empty() );
+	delete pInstr;
+}
+
+void NoteQueueTest::testFarAhead()
+{
+	Instrument* pInstr = new Instrument();
+	NoteQueue queue( 4 );
+	Note* pNear = note( pInstr, 0, 0 );
+	Note* pFar = note( pInstr, 3 * NOTE_QUEUE_BUCKETS, 0 );
+	queue.push( pFar );
+	queue.push( pNear );
+
+	Note* notes[ 2 ];
+	CPPUNIT_ASSERT_EQUAL( 1, queue.pop_due( 100, fTickSize, notes, 2 ) );
+	CPPUNIT_ASSERT( notes[ 0 ] == pNear );
+	CPPUNIT_ASSERT_EQUAL( 0, queue.pop_due( 3 * NOTE_QUEUE_BUCKETS * fTickSize, fTickSize, notes, 2 ) );
+	CPPUNIT_ASSERT_EQUAL( 1, queue.pop_due( 3 * NOTE_QUEUE_BUCKETS * fTickSize + 1, fTickSize, notes, 2 ) );
+	CPPUNIT_ASSERT( notes[ 0 ] == pFar );
+	CPPUNIT_ASSERT( queue.empty() );
+
+	delete pNear;
+	delete pFar;
+	delete pInstr;
+}
+
+void NoteQueueTest::testClear()
+{
+	Instrument* pInstr = new Instrument();
+	NotePool pool( 8 );
+	NoteQueue queue( 1 );
+	/* more notes than the capacity, the queue grows */
+	for ( int i = 0; i < 4; i++ ) {
+		queue.push( pool.acquire( pInstr, i * 2 * NOTE_QUEUE_BUCKETS / 4, 1.0, 0.5, 0.5, -1, 0.0 ) );
+		pInstr->enqueue();
+	}
+	CPPUNIT_ASSERT_EQUAL( 4, queue.size() );
+	CPPUNIT_ASSERT_EQUAL( 4, pool.get_free() );
+	CPPUNIT_ASSERT( pInstr->is_queued() );
+
+	/* room made while notes are queued keeps them */
+	queue.reserve( 16 );
+	for ( int i = 0; i < 4; i++ ) {
+		queue.push( pool.acquire( pInstr, i * 3, 1.0, 0.5, 0.5, -1, 0.0 ) );
+		pInstr->enqueue();
+	}
+	CPPUNIT_ASSERT_EQUAL( 8, queue.size() );
+	CPPUNIT_ASSERT_EQUAL( 0, pool.get_free() );
+
+	queue.clear( &pool );
+	CPPUNIT_ASSERT( queue.empty() );
+	CPPUNIT_ASSERT( !pInstr->is_queued() );
+	CPPUNIT_ASSERT_EQUAL( 8, pool.get_free() );
+	delete pInstr;
+}
@@ -0,0 +1,19 @@
+#ifndef NOTE_QUEUE_TEST_H
+#define NOTE_QUEUE_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class NoteQueueTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( NoteQueueTest );
+	CPPUNIT_TEST( testOrder );
+	CPPUNIT_TEST( testFarAhead );
+	CPPUNIT_TEST( testClear );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testOrder();
+	void testFarAhead();
+	void testClear();
+};
+
+#endif
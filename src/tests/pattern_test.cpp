@@ -27,3 +27,41 @@ void PatternTest::testPurgeInstrument()
 
 	delete pat;
 }
+
+void PatternTest::testNotesAt()
+{
+	Instrument *i = new Instrument();
+	Note *a = new Note( i, 4, 1.0, 1.0, 1.0, 1, 1.0 );
+	Note *b = new Note( i, 4, 0.5, 1.0, 1.0, 1, 1.0 );
+	Note *c = new Note( i, 8, 1.0, 1.0, 1.0, 1, 1.0 );
+
+	Pattern *pat = new Pattern();
+	pat->insert_note( c );
+	pat->insert_note( a );
+	pat->insert_note( b );
+
+	int nNotes;
+	CPPUNIT_ASSERT( pat->get_notes_at( 0, &nNotes ) == NULL );
+	CPPUNIT_ASSERT_EQUAL( 0, nNotes );
+	Note* const* notes = pat->get_notes_at( 4, &nNotes );
+	CPPUNIT_ASSERT_EQUAL( 2, nNotes );
+	CPPUNIT_ASSERT( ( notes[0] == a && notes[1] == b ) || ( notes[0] == b && notes[1] == a ) );
+	notes = pat->get_notes_at( 8, &nNotes );
+	CPPUNIT_ASSERT_EQUAL( 1, nNotes );
+	CPPUNIT_ASSERT( notes[0] == c );
+
+	/* the editors also erase notes straight from the multimap */
+	Pattern::notes_t* all = (Pattern::notes_t*)pat->get_notes();
+	all->erase( all->find( 8 ) );
+	delete c;
+	pat->get_notes_at( 8, &nNotes );
+	CPPUNIT_ASSERT_EQUAL( 0, nNotes );
+
+	pat->remove_note( a );
+	delete a;
+	notes = pat->get_notes_at( 4, &nNotes );
+	CPPUNIT_ASSERT_EQUAL( 1, nNotes );
+	CPPUNIT_ASSERT( notes[0] == b );
+
+	delete pat;
+}
@@ -6,11 +6,13 @@
 class PatternTest : public CppUnit::TestCase {
 	CPPUNIT_TEST_SUITE(PatternTest);
 	CPPUNIT_TEST(testPurgeInstrument);
+	CPPUNIT_TEST(testNotesAt);
 	CPPUNIT_TEST_SUITE_END();
 
 	public:
 	virtual void setUp();
 	void testPurgeInstrument();
+	void testNotesAt();
 };
 
 
@@ -0,0 +1,52 @@
+#include "polyphase_filter_test.h"
+
+#include <hydrogen/sampler/polyphase_filter.h>
+#include <cmath>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( PolyphaseFilterTest );
+
+using namespace H2Core;
+
+static const int nFrames = 2048;
+
+void PolyphaseFilterTest::testUnityGain()
+{
+	PolyphaseFilter filter;
+	float ones[ PolyphaseFilter::TAPS ];
+	for ( int i = 0; i < PolyphaseFilter::TAPS; ++i ) {
+		ones[ i ] = 1.0;
+	}
+
+	float steps[] = { 0.5, 1.0, 1.7, 4.0 };
+	for ( int s = 0; s < 4; ++s ) {
+		const float* bank = filter.get_bank( steps[ s ] );
+		for ( double fraction = 0.0; fraction < 1.0; fraction += 0.01 ) {
+			float l, r;
+			PolyphaseFilter::interpolate( bank, ones, ones, PolyphaseFilter::TAPS / 2 - 1, fraction, &l, &r );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, l, 0.00001 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, r, 0.00001 );
+		}
+	}
+}
+
+void PolyphaseFilterTest::testSine()
+{
+	PolyphaseFilter filter;
+	float data_l[ nFrames ], data_r[ nFrames ];
+	/* a tenth of the sample rate, well inside the passband */
+	const double fFreq = 0.1;
+	for ( int i = 0; i < nFrames; ++i ) {
+		data_l[ i ] = sin( 2 * M_PI * fFreq * i );
+		data_r[ i ] = cos( 2 * M_PI * fFreq * i );
+	}
+
+	const float fStep = 0.73;
+	const float* bank = filter.get_bank( fStep );
+	for ( double fPos = PolyphaseFilter::TAPS; fPos < nFrames - PolyphaseFilter::TAPS; fPos += fStep ) {
+		int nPos = ( int )fPos;
+		float l, r;
+		PolyphaseFilter::interpolate( bank, data_l, data_r, nPos, fPos - nPos, &l, &r );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( sin( 2 * M_PI * fFreq * fPos ), l, 0.001 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( cos( 2 * M_PI * fFreq * fPos ), r, 0.001 );
+	}
+}
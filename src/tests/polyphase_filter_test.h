@@ -0,0 +1,17 @@
+#ifndef POLYPHASE_FILTER_TEST_H
+#define POLYPHASE_FILTER_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class PolyphaseFilterTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( PolyphaseFilterTest );
+	CPPUNIT_TEST( testUnityGain );
+	CPPUNIT_TEST( testSine );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testUnityGain();
+	void testSine();
+};
+
+#endif
@@ -0,0 +1,67 @@
+#include "random_test.h"
+
+#include <hydrogen/helpers/random.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( RandomTest );
+
+using namespace H2Core;
+
+void RandomTest::testSeed()
+{
+	Random a( 1234 );
+	Random b( 1234 );
+	Random c( 1235 );
+	int nSame = 0;
+	for ( int i = 0; i < 100; ++i ) {
+		uint32_t n = a.next();
+		CPPUNIT_ASSERT_EQUAL( n, b.next() );
+		if ( n == c.next() ) ++nSame;
+	}
+	CPPUNIT_ASSERT( nSame < 2 );
+
+	/* seeding again restarts the sequence, whatever the batch size */
+	a.seed( 1234 );
+	b.seed( 1234 );
+	c.seed( 1234 );
+	float values[ 7 ], prefix[ 6 ];
+	a.gaussians( values, 7, 1.0 );
+	b.gaussians( prefix, 6, 1.0 );
+	for ( int i = 0; i < 6; ++i ) {
+		CPPUNIT_ASSERT_EQUAL( values[ i ], prefix[ i ] );
+	}
+	CPPUNIT_ASSERT_EQUAL( values[ 0 ], c.gaussian( 1.0 ) );
+}
+
+void RandomTest::testUniform()
+{
+	Random random( 42 );
+	double fSum = 0;
+	const int nCount = 100000;
+	for ( int i = 0; i < nCount; ++i ) {
+		float u = random.uniform();
+		CPPUNIT_ASSERT( u > 0.0 && u <= 1.0 );
+		fSum += u;
+	}
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, fSum / nCount, 0.01 );
+}
+
+void RandomTest::testGaussians()
+{
+	Random random( 7 );
+	/* an odd count over several blocks */
+	const int nCount = 20001;
+	float* values = new float[ nCount + 1 ];
+	values[ nCount ] = 12345.0;
+	random.gaussians( values, nCount, 0.2 );
+	CPPUNIT_ASSERT_EQUAL( 12345.0f, values[ nCount ] );
+
+	double fSum = 0, fSquares = 0;
+	for ( int i = 0; i < nCount; ++i ) {
+		fSum += values[ i ];
+		fSquares += values[ i ] * values[ i ];
+	}
+	double fMean = fSum / nCount;
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, fMean, 0.01 );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.2, sqrt( fSquares / nCount - fMean * fMean ), 0.01 );
+	delete[] values;
+}
@@ -0,0 +1,19 @@
+#ifndef RANDOM_TEST_H
+#define RANDOM_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class RandomTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( RandomTest );
+	CPPUNIT_TEST( testSeed );
+	CPPUNIT_TEST( testUniform );
+	CPPUNIT_TEST( testGaussians );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testSeed();
+	void testUniform();
+	void testGaussians();
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "render_kernels_test.h"
+
+#include <hydrogen/sampler/render_kernels.h>
+#include <hydrogen/globals.h>
+#include <cstdlib>
+#include <cstring>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( RenderKernelsTest );
+
+using namespace H2Core;
+
+/* odd size, so that every kernel also runs its tail loop */
+static const int nFrames = 1021;
+
+static void fill( float* buf, int n, float min, float max )
+{
+	for ( int i = 0; i < n; ++i ) {
+		buf[i] = min + ( max - min ) * ( ( float )rand() / RAND_MAX );
+	}
+}
+
+void RenderKernelsTest::testRenderBlock()
+{
+	float src_l[nFrames], src_r[nFrames], env[nFrames];
+	float ref[4][nFrames], out[4][nFrames];
+	srand( 42 );
+	fill( src_l, nFrames, -1.0, 1.0 );
+	fill( src_r, nFrames, -1.0, 1.0 );
+	fill( env, nFrames, 0.0, 1.0 );
+
+	const RenderKernels::Table* scalar = RenderKernels::table( RenderKernels::SCALAR );
+	CPPUNIT_ASSERT( scalar != NULL );
+	CPPUNIT_ASSERT( RenderKernels::best() != NULL );
+
+	for ( int isa = RenderKernels::SCALAR + 1; isa < RenderKernels::ISA_COUNT; ++isa ) {
+		const RenderKernels::Table* kernels = RenderKernels::table( ( RenderKernels::Isa )isa );
+		if ( kernels == NULL ) continue;
+		for ( int with_env = 0; with_env < 2; ++with_env ) {
+			fill( ref[0], 4 * nFrames, -0.5, 0.5 );
+			memcpy( out, ref, sizeof( ref ) );
+			float ref_peak_l = 0.0, ref_peak_r = 0.0, peak_l = 0.0, peak_r = 0.0;
+			scalar->render_block( src_l, src_r, with_env ? env : NULL, nFrames, 0.7, 0.3, 1.3, 0.9,
+			                      ref[0], ref[1], ref[2], ref[3], &ref_peak_l, &ref_peak_r );
+			kernels->render_block( src_l, src_r, with_env ? env : NULL, nFrames, 0.7, 0.3, 1.3, 0.9,
+			                       out[0], out[1], out[2], out[3], &peak_l, &peak_r );
+			/* bit-identical, not just close */
+			CPPUNIT_ASSERT( memcmp( ref, out, sizeof( ref ) ) == 0 );
+			CPPUNIT_ASSERT( memcmp( &ref_peak_l, &peak_l, sizeof( float ) ) == 0 );
+			CPPUNIT_ASSERT( memcmp( &ref_peak_r, &peak_r, sizeof( float ) ) == 0 );
+		}
+	}
+}
+
+void RenderKernelsTest::testMixBlock()
+{
+	float src_l[nFrames], src_r[nFrames];
+	float ref[2][nFrames], out[2][nFrames];
+	srand( 7 );
+	fill( src_l, nFrames, -1.0, 1.0 );
+	fill( src_r, nFrames, -1.0, 1.0 );
+
+	const RenderKernels::Table* scalar = RenderKernels::table( RenderKernels::SCALAR );
+	for ( int isa = RenderKernels::SCALAR + 1; isa < RenderKernels::ISA_COUNT; ++isa ) {
+		const RenderKernels::Table* kernels = RenderKernels::table( ( RenderKernels::Isa )isa );
+		if ( kernels == NULL ) continue;
+		fill( ref[0], 2 * nFrames, -0.5, 0.5 );
+		memcpy( out, ref, sizeof( ref ) );
+		scalar->mix_block( src_l, src_r, nFrames, 0.25, 0.75, ref[0], ref[1] );
+		kernels->mix_block( src_l, src_r, nFrames, 0.25, 0.75, out[0], out[1] );
+		CPPUNIT_ASSERT( memcmp( ref, out, sizeof( ref ) ) == 0 );
+	}
+}
+
+void RenderKernelsTest::testConvertBlock()
+{
+	short src_l[nFrames], src_r[nFrames];
+	float ref[2][nFrames], out[2][nFrames];
+	srand( 3 );
+	for ( int i = 0; i < nFrames; ++i ) {
+		src_l[i] = ( short )( rand() % 65536 - 32768 );
+		src_r[i] = ( short )( rand() % 65536 - 32768 );
+	}
+	src_l[0] = -32768;
+	src_l[1] = 32767;
+
+	const RenderKernels::Table* scalar = RenderKernels::table( RenderKernels::SCALAR );
+	scalar->convert_block( src_l, src_r, nFrames, ref[0], ref[1] );
+	CPPUNIT_ASSERT_EQUAL( -1.0f, ref[0][0] );
+	CPPUNIT_ASSERT_EQUAL( 32767 * SAMPLE_PCM16_SCALE, ref[0][1] );
+	for ( int isa = RenderKernels::SCALAR + 1; isa < RenderKernels::ISA_COUNT; ++isa ) {
+		const RenderKernels::Table* kernels = RenderKernels::table( ( RenderKernels::Isa )isa );
+		if ( kernels == NULL ) continue;
+		kernels->convert_block( src_l, src_r, nFrames, out[0], out[1] );
+		CPPUNIT_ASSERT( memcmp( ref, out, sizeof( ref ) ) == 0 );
+	}
+}
@@ -0,0 +1,19 @@
+#ifndef RENDER_KERNELS_TEST_H
+#define RENDER_KERNELS_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class RenderKernelsTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( RenderKernelsTest );
+	CPPUNIT_TEST( testRenderBlock );
+	CPPUNIT_TEST( testMixBlock );
+	CPPUNIT_TEST( testConvertBlock );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testRenderBlock();
+	void testMixBlock();
+	void testConvertBlock();
+};
+
+#endif
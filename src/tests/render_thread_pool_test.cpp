@@ -0,0 +1,161 @@
+#include "render_thread_pool_test.h"
+
+#include <hydrogen/sampler/render_thread_pool.h>
+#include <hydrogen/sampler/render_kernels.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <sys/time.h>
+#include <unistd.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( RenderThreadPoolTest );
+
+using namespace H2Core;
+
+static const int nMaxThreads = 8;
+
+struct Counters {
+	int runs[ nMaxThreads ];
+};
+
+static void count_job( void* arg, int thread )
+{
+	( ( Counters* )arg )->runs[ thread ]++;
+}
+
+void RenderThreadPoolTest::testRun()
+{
+	for ( int threads = 1; threads <= 4; threads++ ) {
+		RenderThreadPool pool( threads );
+		CPPUNIT_ASSERT_EQUAL( threads, pool.get_threads() );
+		Counters counters;
+		memset( &counters, 0, sizeof( counters ) );
+		for ( int i = 0; i < 1000; i++ ) {
+			pool.run( count_job, &counters );
+		}
+		for ( int t = 0; t < nMaxThreads; t++ ) {
+			CPPUNIT_ASSERT_EQUAL( t < threads ? 1000 : 0, counters.runs[ t ] );
+		}
+	}
+}
+
+static void late_job( void* arg, int thread )
+{
+	if ( thread != 0 ) {
+		// longer than the caller spins, it has to sleep until the workers are done
+		usleep( 2000 );
+	}
+	__sync_fetch_and_add( &( ( Counters* )arg )->runs[ thread ], 1 );
+}
+
+void RenderThreadPoolTest::testLateWorkers()
+{
+	RenderThreadPool pool( 4 );
+	Counters counters;
+	memset( &counters, 0, sizeof( counters ) );
+	for ( int i = 0; i < 50; i++ ) {
+		pool.run( late_job, &counters );
+		/* every worker is done once run() returns */
+		for ( int t = 0; t < 4; t++ ) {
+			CPPUNIT_ASSERT_EQUAL( 2 * i + 1, counters.runs[ t ] );
+		}
+		/* and the next run can follow at once, without waiting */
+		pool.run( count_job, &counters );
+	}
+	for ( int t = 0; t < 4; t++ ) {
+		CPPUNIT_ASSERT_EQUAL( 100, counters.runs[ t ] );
+	}
+}
+
+/* voices rendered the way the sampler does, each thread mixing its share in its own buffers */
+static const int nVoices = 192;
+static const int nFrames = 1024;
+static const int nSampleFrames = 1 << 16;
+
+struct Voices {
+	const RenderKernels::Table* kernels;
+	int threads;
+	float* sample_l;
+	float* sample_r;
+	float* env;
+	float* out_l[ nMaxThreads ];
+	float* out_r[ nMaxThreads ];
+	float peak[ nMaxThreads ];
+	int cycle;
+};
+
+static void voices_job( void* arg, int thread )
+{
+	Voices* v = ( Voices* )arg;
+	memset( v->out_l[ thread ], 0, nFrames * sizeof( float ) );
+	memset( v->out_r[ thread ], 0, nFrames * sizeof( float ) );
+	float peak_l = 0, peak_r = 0;
+	for ( int voice = thread; voice < nVoices; voice += v->threads ) {
+		int pos = ( voice * 977 + v->cycle * nFrames ) % ( nSampleFrames - nFrames );
+		float gain = 0.5 + voice * 0.001;
+		v->kernels->render_block( v->sample_l + pos, v->sample_r + pos, v->env, nFrames,
+		                          gain, gain, 0, 0, NULL, NULL,
+		                          v->out_l[ thread ], v->out_r[ thread ], &peak_l, &peak_r );
+	}
+	v->peak[ thread ] = peak_l;
+}
+
+static double render( int threads, int cycles, float* out_l, float* out_r )
+{
+	Voices v;
+	v.kernels = RenderKernels::best();
+	v.threads = threads;
+	std::vector<float> sample_l( nSampleFrames ), sample_r( nSampleFrames ), env( nFrames );
+	srand( 42 );
+	for ( int i = 0; i < nSampleFrames; i++ ) {
+		sample_l[ i ] = ( float )rand() / RAND_MAX - 0.5;
+		sample_r[ i ] = ( float )rand() / RAND_MAX - 0.5;
+	}
+	for ( int i = 0; i < nFrames; i++ ) {
+		env[ i ] = ( float )i / nFrames;
+	}
+	v.sample_l = &sample_l[ 0 ];
+	v.sample_r = &sample_r[ 0 ];
+	v.env = &env[ 0 ];
+	for ( int t = 0; t < threads; t++ ) {
+		v.out_l[ t ] = new float[ nFrames ];
+		v.out_r[ t ] = new float[ nFrames ];
+	}
+
+	RenderThreadPool pool( threads );
+	timeval start, end;
+	gettimeofday( &start, NULL );
+	for ( v.cycle = 0; v.cycle < cycles; v.cycle++ ) {
+		memset( out_l, 0, nFrames * sizeof( float ) );
+		memset( out_r, 0, nFrames * sizeof( float ) );
+		pool.run( voices_job, &v );
+		for ( int t = 0; t < threads; t++ ) {
+			v.kernels->mix_block( v.out_l[ t ], v.out_r[ t ], nFrames, 1.0, 1.0, out_l, out_r );
+		}
+	}
+	gettimeofday( &end, NULL );
+
+	for ( int t = 0; t < threads; t++ ) {
+		delete[] v.out_l[ t ];
+		delete[] v.out_r[ t ];
+	}
+	return ( end.tv_sec - start.tv_sec ) * 1000.0 + ( end.tv_usec - start.tv_usec ) / 1000.0;
+}
+
+/* the time per cycle is only logged, a machine running the tests may have a single core */
+void RenderThreadPoolTest::testRepeat()
+{
+	const int nCycles = 200;
+	float ref_l[ nFrames ], ref_r[ nFrames ], out_l[ nFrames ], out_r[ nFrames ];
+
+	for ( int threads = 1; threads <= nMaxThreads; threads *= 2 ) {
+		double fMs = render( threads, nCycles, ref_l, ref_r );
+		___INFOLOG( QString( "%1 voices, %2 threads : %3 ms per cycle" )
+		            .arg( nVoices ).arg( threads ).arg( fMs / nCycles ) );
+
+		/* the reduction order is fixed, another run gives the very same output */
+		render( threads, nCycles, out_l, out_r );
+		CPPUNIT_ASSERT( memcmp( ref_l, out_l, sizeof( ref_l ) ) == 0 );
+		CPPUNIT_ASSERT( memcmp( ref_r, out_r, sizeof( ref_r ) ) == 0 );
+	}
+}
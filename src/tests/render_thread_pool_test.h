@@ -0,0 +1,19 @@
+#ifndef RENDER_THREAD_POOL_TEST_H
+#define RENDER_THREAD_POOL_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class RenderThreadPoolTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( RenderThreadPoolTest );
+	CPPUNIT_TEST( testRun );
+	CPPUNIT_TEST( testLateWorkers );
+	CPPUNIT_TEST( testRepeat );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testRun();
+	void testLateWorkers();
+	void testRepeat();
+};
+
+#endif
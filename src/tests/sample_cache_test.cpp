@@ -0,0 +1,172 @@
+#include "sample_cache_test.h"
+
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_cache.h>
+#include <hydrogen/helpers/filesystem.h>
+
+#include <QFile>
+
+#include <stdint.h>
+#include <utime.h>
+
+#define BASE_DIR    "./src/tests/data"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SampleCacheTest );
+
+using namespace H2Core;
+
+void SampleCacheTest::testShare()
+{
+	SampleCache* pCache = SampleCache::get_instance();
+	int nSize = pCache->get_size();
+
+	Sample* pSample = Sample::load( BASE_DIR"/drumkit/kick.wav" );
+	Sample* pSame = Sample::load( BASE_DIR"/drumkit/kick.wav" );
+	Sample* pCopy = new Sample( pSample );
+	CPPUNIT_ASSERT( pSample != 0 && pSame != 0 );
+	CPPUNIT_ASSERT( pSample->get_data_l() == pSame->get_data_l() );
+	CPPUNIT_ASSERT( pSample->get_data_l() == pCopy->get_data_l() );
+	CPPUNIT_ASSERT_EQUAL( nSize + 1, pCache->get_size() );
+
+	/* a head of the same file is another entry */
+	Sample* pHead = Sample::load( BASE_DIR"/drumkit/kick.wav", 100 );
+	CPPUNIT_ASSERT( pHead->get_data_l() != pSample->get_data_l() );
+	CPPUNIT_ASSERT_EQUAL( nSize + 2, pCache->get_size() );
+	delete pHead;
+
+	delete pSample;
+	delete pSame;
+	CPPUNIT_ASSERT_EQUAL( nSize + 1, pCache->get_size() );
+	delete pCopy;
+	CPPUNIT_ASSERT_EQUAL( nSize, pCache->get_size() );
+}
+
+void SampleCacheTest::testCopyOnWrite()
+{
+	Sample* pSample = Sample::load( BASE_DIR"/drumkit/snare.wav" );
+	Sample* pModified = Sample::load( BASE_DIR"/drumkit/snare.wav" );
+	CPPUNIT_ASSERT( pSample->get_data_l() == pModified->get_data_l() );
+	float fFirst = pSample->get_data_l()[ 0 ];
+
+	/* silence the whole sample */
+	Sample::VelocityEnvelope velocity;
+	velocity.push_back( Sample::EnvelopePoint( 0, 91 ) );
+	velocity.push_back( Sample::EnvelopePoint( 841, 91 ) );
+	pModified->apply_velocity( velocity );
+
+	/* the modified sample got its own data, the shared one is untouched */
+	CPPUNIT_ASSERT( pSample->get_data_l() != pModified->get_data_l() );
+	CPPUNIT_ASSERT_EQUAL( fFirst, pSample->get_data_l()[ 0 ] );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, pModified->get_data_l()[ 0 ] );
+
+	delete pSample;
+	delete pModified;
+}
+
+void SampleCacheTest::testLayout()
+{
+	Sample* pMono = Sample::load( BASE_DIR"/drumkit/kick.wav" );
+	Sample* pStereo = Sample::load( BASE_DIR"/drumkit/snare.wav" );
+	CPPUNIT_ASSERT( pMono->is_mono() );
+	CPPUNIT_ASSERT( !pStereo->is_mono() );
+
+	/* aligned frames, silent guard frames on both sides */
+	const float* pData = pStereo->get_data_r();
+	int nFrames = pStereo->get_frames();
+	CPPUNIT_ASSERT_EQUAL( ( uintptr_t )0, ( uintptr_t )pData % SAMPLE_ALIGNMENT );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, pData[ -1 ] );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, pData[ -SAMPLE_GUARD_FRAMES ] );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, pData[ nFrames ] );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, pData[ nFrames + SAMPLE_GUARD_FRAMES - 1 ] );
+
+	/* panning a mono sample gives it two channels */
+	Sample::PanEnvelope pan;
+	pan.push_back( Sample::EnvelopePoint( 0, 0 ) );
+	pan.push_back( Sample::EnvelopePoint( 841, 0 ) );
+	pMono->apply_pan( pan );
+	CPPUNIT_ASSERT( !pMono->is_mono() );
+	CPPUNIT_ASSERT( pMono->get_data_l() != pMono->get_data_r() );
+
+	delete pMono;
+	delete pStereo;
+}
+
+void SampleCacheTest::testCompact()
+{
+	Sample* pFloat = Sample::load( BASE_DIR"/drumkit/snare.wav" );
+	Sample* pCompact = Sample::load( BASE_DIR"/drumkit/snare.wav", 0, true );
+	CPPUNIT_ASSERT( !pFloat->is_compact() );
+	CPPUNIT_ASSERT( pCompact->is_compact() );
+	CPPUNIT_ASSERT( pCompact->get_data_l() == 0 );
+	CPPUNIT_ASSERT_EQUAL( pFloat->get_size() / 2, pCompact->get_size() );
+
+	/* a 16 bit file loses nothing */
+	CPPUNIT_ASSERT_EQUAL( pFloat->get_frames(), pCompact->get_frames() );
+	for ( int i = 0; i < pFloat->get_frames(); i++ ) {
+		CPPUNIT_ASSERT_EQUAL( pFloat->get_frame_l( i ), pCompact->get_frame_l( i ) );
+		CPPUNIT_ASSERT_EQUAL( pFloat->get_frame_r( i ), pCompact->get_frame_r( i ) );
+	}
+
+	/* modified, it goes back to floats */
+	Sample::VelocityEnvelope velocity;
+	velocity.push_back( Sample::EnvelopePoint( 0, 91 ) );
+	velocity.push_back( Sample::EnvelopePoint( 841, 91 ) );
+	pCompact->apply_velocity( velocity );
+	CPPUNIT_ASSERT( !pCompact->is_compact() );
+	CPPUNIT_ASSERT( pCompact->get_data_l() != 0 );
+
+	delete pFloat;
+	delete pCompact;
+}
+
+void SampleCacheTest::testRewrite()
+{
+	QString sPath = Filesystem::tmp_dir() + "rewritten.wav";
+	QFile::remove( sPath );
+	CPPUNIT_ASSERT( QFile::copy( BASE_DIR"/drumkit/kick.wav", sPath ) );
+	Sample* pOld = Sample::load( sPath );
+
+	/* rewritten within the same second, the size tells the versions apart */
+	QFile::remove( sPath );
+	CPPUNIT_ASSERT( QFile::copy( BASE_DIR"/drumkit/snare.wav", sPath ) );
+	Sample* pNew = Sample::load( sPath );
+	CPPUNIT_ASSERT( pOld->get_data_l() != pNew->get_data_l() );
+	CPPUNIT_ASSERT( pOld->get_frames() != pNew->get_frames() );
+
+	delete pOld;
+	delete pNew;
+	QFile::remove( sPath );
+}
+
+void SampleCacheTest::testDiskLimit()
+{
+	SampleCache* pCache = SampleCache::get_instance();
+	long long nLimit = pCache->get_disk_limit();
+	pCache->set_disk_limit( 0 );
+	CPPUNIT_ASSERT_EQUAL( 0LL, SampleCache::get_disk_bytes() );
+
+	/* three cache files of 1000 bytes, used one after the other */
+	QByteArray bytes( 1000, 0 );
+	for ( int i = 0; i < 3; i++ ) {
+		QFile file( Filesystem::samples_cache_dir() + QString( "/%1.h2sc" ).arg( i ) );
+		CPPUNIT_ASSERT( file.open( QIODevice::WriteOnly ) );
+		file.write( bytes );
+		file.close();
+		struct utimbuf times;
+		times.actime = times.modtime = 1000000000 + i * 60;
+		utime( file.fileName().toLocal8Bit(), &times );
+	}
+	CPPUNIT_ASSERT_EQUAL( 3000LL, SampleCache::get_disk_bytes() );
+
+	/* the least recently used goes first */
+	pCache->set_disk_limit( 2500 );
+	CPPUNIT_ASSERT_EQUAL( 2000LL, SampleCache::get_disk_bytes() );
+	CPPUNIT_ASSERT( !QFile::exists( Filesystem::samples_cache_dir() + "/0.h2sc" ) );
+	CPPUNIT_ASSERT( QFile::exists( Filesystem::samples_cache_dir() + "/2.h2sc" ) );
+
+	/* turned off, it is cleared */
+	pCache->set_disk_limit( 0 );
+	CPPUNIT_ASSERT_EQUAL( 0LL, SampleCache::get_disk_bytes() );
+
+	pCache->set_disk_limit( nLimit );
+}
@@ -0,0 +1,25 @@
+#ifndef SAMPLE_CACHE_TEST_H
+#define SAMPLE_CACHE_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SampleCacheTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SampleCacheTest );
+	CPPUNIT_TEST( testShare );
+	CPPUNIT_TEST( testCopyOnWrite );
+	CPPUNIT_TEST( testLayout );
+	CPPUNIT_TEST( testCompact );
+	CPPUNIT_TEST( testRewrite );
+	CPPUNIT_TEST( testDiskLimit );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testShare();
+	void testCopyOnWrite();
+	void testLayout();
+	void testCompact();
+	void testRewrite();
+	void testDiskLimit();
+};
+
+#endif
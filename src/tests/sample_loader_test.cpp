@@ -0,0 +1,56 @@
+#include "sample_loader_test.h"
+
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_loader.h>
+
+#define BASE_DIR    "./src/tests/data"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SampleLoaderTest );
+
+using namespace H2Core;
+
+static const char* sampleNames[] = { "crash.wav", "hh.wav", "kick.wav", "snare.wav" };
+static const int nSamples = 4;
+
+void SampleLoaderTest::testLoad()
+{
+	Sample* samples[ nSamples + 1 ];
+	SampleLoader loader;
+	for ( int i = 0; i < nSamples; ++i ) {
+		samples[ i ] = new Sample( QString( BASE_DIR"/drumkit/" ) + sampleNames[ i ] );
+		loader.add( samples[ i ] );
+	}
+	samples[ nSamples ] = new Sample( BASE_DIR"/drumkit/missing.wav" );
+	loader.add( samples[ nSamples ] );
+	CPPUNIT_ASSERT_EQUAL( nSamples + 1, loader.get_size() );
+
+	CPPUNIT_ASSERT( loader.run() );
+	CPPUNIT_ASSERT( !loader.is_loading() );
+	CPPUNIT_ASSERT_EQUAL( 100, loader.get_progress() );
+	for ( int i = 0; i < nSamples; ++i ) {
+		CPPUNIT_ASSERT( !samples[ i ]->is_empty() );
+		CPPUNIT_ASSERT( samples[ i ]->get_frames() > 0 );
+		delete samples[ i ];
+	}
+	/* a sample which can't be decoded is left empty */
+	CPPUNIT_ASSERT( samples[ nSamples ]->is_empty() );
+	delete samples[ nSamples ];
+}
+
+void SampleLoaderTest::testCancel()
+{
+	Sample* samples[ nSamples ];
+	SampleLoader loader;
+	for ( int i = 0; i < nSamples; ++i ) {
+		samples[ i ] = new Sample( QString( BASE_DIR"/drumkit/" ) + sampleNames[ i ] );
+		loader.add( samples[ i ] );
+	}
+	loader.start();
+	loader.cancel();
+	CPPUNIT_ASSERT( !loader.wait() );
+	CPPUNIT_ASSERT( loader.is_cancelled() );
+	CPPUNIT_ASSERT( !loader.is_loading() );
+	for ( int i = 0; i < nSamples; ++i ) {
+		delete samples[ i ];
+	}
+}
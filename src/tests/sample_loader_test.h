@@ -0,0 +1,17 @@
+#ifndef SAMPLE_LOADER_TEST_H
+#define SAMPLE_LOADER_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SampleLoaderTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SampleLoaderTest );
+	CPPUNIT_TEST( testLoad );
+	CPPUNIT_TEST( testCancel );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testLoad();
+	void testCancel();
+};
+
+#endif
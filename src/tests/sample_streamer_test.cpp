@@ -0,0 +1,79 @@
+#include "sample_streamer_test.h"
+
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/sampler/sample_streamer.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SampleStreamerTest );
+
+using namespace H2Core;
+
+static const int nFrames = 3 * SampleStreamer::RING_FRAMES;
+static const int nHead = 1000;
+
+static QString streamedPath()
+{
+	return Filesystem::tmp_dir() + "streamed.wav";
+}
+
+void SampleStreamerTest::setUp()
+{
+	float* pData_L = Sample::alloc_data( nFrames );
+	float* pData_R = Sample::alloc_data( nFrames );
+	for ( int i = 0; i < nFrames; ++i ) {
+		pData_L[ i ] = ( float )( i % 1000 ) / 1000.0;
+		pData_R[ i ] = -pData_L[ i ];
+	}
+	Sample sample( streamedPath(), nFrames, 44100, pData_L, pData_R );
+	sample.write( streamedPath(), SF_FORMAT_WAV | SF_FORMAT_FLOAT );
+}
+
+void SampleStreamerTest::tearDown()
+{
+	Filesystem::rm( streamedPath() );
+}
+
+void SampleStreamerTest::testHead()
+{
+	Sample* pSample = Sample::load( streamedPath(), nHead );
+	CPPUNIT_ASSERT( pSample != 0 );
+	CPPUNIT_ASSERT( pSample->is_streamed() );
+	CPPUNIT_ASSERT_EQUAL( nFrames, pSample->get_frames() );
+	CPPUNIT_ASSERT_EQUAL( nHead, pSample->get_data_frames() );
+	CPPUNIT_ASSERT_EQUAL( 0.5f, pSample->get_data_l()[ 500 ] );
+	delete pSample;
+
+	/* a head longer than the sample keeps it in memory */
+	pSample = Sample::load( streamedPath(), 2 * nFrames );
+	CPPUNIT_ASSERT( pSample != 0 );
+	CPPUNIT_ASSERT( !pSample->is_streamed() );
+	delete pSample;
+}
+
+void SampleStreamerTest::testStream()
+{
+	Sample* pSample = Sample::load( streamedPath(), nHead );
+	SampleStreamer streamer;
+	streamer.reserve( 1 );
+	streamer.set_wait( true );
+
+	SampleStreamer::Stream* pStream = streamer.open( pSample );
+	CPPUNIT_ASSERT( pStream != 0 );
+	/* the only stream is taken */
+	CPPUNIT_ASSERT( streamer.open( pSample ) == 0 );
+
+	const int nCount = 4096;
+	float out_L[ nCount ], out_R[ nCount ];
+	for ( int nFrame = nHead; nFrame < nFrames; nFrame += nCount ) {
+		streamer.read( pStream, nFrame, nCount, out_L, out_R );
+		for ( int i = 0; i < nCount; ++i ) {
+			float fExpected = ( nFrame + i < nFrames ) ? ( float )( ( nFrame + i ) % 1000 ) / 1000.0 : 0.0;
+			CPPUNIT_ASSERT_EQUAL( fExpected, out_L[ i ] );
+			CPPUNIT_ASSERT_EQUAL( -fExpected, out_R[ i ] );
+		}
+	}
+	CPPUNIT_ASSERT_EQUAL( 0u, streamer.get_underruns() );
+
+	streamer.close( pStream );
+	delete pSample;
+}
@@ -0,0 +1,19 @@
+#ifndef SAMPLE_STREAMER_TEST_H
+#define SAMPLE_STREAMER_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SampleStreamerTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SampleStreamerTest );
+	CPPUNIT_TEST( testHead );
+	CPPUNIT_TEST( testStream );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void setUp();
+	void tearDown();
+	void testHead();
+	void testStream();
+};
+
+#endif
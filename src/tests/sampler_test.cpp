@@ -0,0 +1,102 @@
+#include "sampler_test.h"
+
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/audio_engine.h>
+#include <hydrogen/Preferences.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/sampler/Sampler.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#define BASE_DIR    "./src/tests/data"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SamplerTest );
+
+using namespace H2Core;
+
+/* more instruments than render groups, a group mixes several of them */
+static const int nInstruments = RENDER_GROUPS + 5;
+static const unsigned nFrames = 512;
+static const int nCycles = 48;
+
+static Song* createSong()
+{
+	static const char* samples[] = { "kick.wav", "snare.wav", "hh.wav", "crash.wav" };
+	Song* pSong = new Song( "sampler", "test", 120, 0.5 );
+	InstrumentList* pInstruments = new InstrumentList();
+	for ( int i = 0; i < nInstruments; i++ ) {
+		Instrument* pInstr = new Instrument( i, QString( "instrument %1" ).arg( i ) );
+		pInstr->set_layer( new InstrumentLayer( Sample::load( QString( BASE_DIR"/drumkit/%1" ).arg( samples[ i % 4 ] ) ) ), 0 );
+		pInstr->set_volume( 0.5 + i * 0.01 );
+		pInstruments->add( pInstr );
+	}
+	pSong->set_instrument_list( pInstruments );
+	return pSong;
+}
+
+/* notes started on every cycle, pitched ones included, rendered with a number of threads */
+static std::vector<float> render( int nThreads )
+{
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	Sampler* pSampler = AudioEngine::get_instance()->get_sampler();
+	Song* pSong = Hydrogen::get_instance()->getSong();
+	InstrumentList* pInstruments = pSong->get_instrument_list();
+	pSampler->stop_playing_notes();
+	pSampler->set_render_threads( nThreads );
+	CPPUNIT_ASSERT_EQUAL( nThreads, pSampler->get_render_threads() );
+
+	std::vector<float> out;
+	for ( int nCycle = 0; nCycle < nCycles; nCycle++ ) {
+		for ( int i = 0; i < 3; i++ ) {
+			int nInstrument = ( nCycle * 7 + i * 5 ) % nInstruments;
+			float fPitch = ( nCycle + i ) % 3 - 1;
+			pSampler->note_on( new Note( pInstruments->get( nInstrument ), 0, 0.8, 0.5, 0.5, -1, fPitch ) );
+		}
+		pSampler->process( nFrames, pSong );
+		out.insert( out.end(), pSampler->__main_out_L, pSampler->__main_out_L + nFrames );
+		out.insert( out.end(), pSampler->__main_out_R, pSampler->__main_out_R + nFrames );
+	}
+
+	pSampler->stop_playing_notes();
+	pSampler->set_render_threads( Preferences::get_instance()->m_nRenderThreads );
+	AudioEngine::get_instance()->unlock();
+	return out;
+}
+
+void SamplerTest::setUp()
+{
+	/* the fake driver never plays, the sampler is run by the tests */
+	Preferences::create_instance();
+	Preferences* pPref = Preferences::get_instance();
+	pPref->m_sAudioDriver = "Fake";
+	pPref->m_sMidiDriver = "None";
+	Hydrogen::create_instance();
+	Hydrogen::get_instance()->setSong( createSong() );
+}
+
+void SamplerTest::testRenderThreads()
+{
+	std::vector<float> reference = render( 1 );
+	float fPeak = 0;
+	for ( unsigned i = 0; i < reference.size(); i++ ) {
+		if ( fabs( reference[ i ] ) > fPeak ) {
+			fPeak = fabs( reference[ i ] );
+		}
+	}
+	CPPUNIT_ASSERT( fPeak > 0.01 );
+
+	/* the groups are summed in the same order whatever the threads, the output is the very same */
+	int threads[] = { 2, 3, 5, RENDER_GROUPS };
+	for ( int i = 0; i < 4; i++ ) {
+		std::vector<float> out = render( threads[ i ] );
+		CPPUNIT_ASSERT_EQUAL( reference.size(), out.size() );
+		CPPUNIT_ASSERT( memcmp( &reference[ 0 ], &out[ 0 ], reference.size() * sizeof( float ) ) == 0 );
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef SAMPLER_TEST_H
+#define SAMPLER_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SamplerTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SamplerTest );
+	CPPUNIT_TEST( testRenderThreads );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	virtual void setUp();
+
+	void testRenderThreads();
+};
+
+#endif
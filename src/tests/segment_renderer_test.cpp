@@ -0,0 +1,157 @@
+#include "segment_renderer_test.h"
+
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/event_queue.h>
+#include <hydrogen/Preferences.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/helpers/filesystem.h>
+
+#include <algorithm>
+#include <cmath>
+
+#define BASE_DIR    "./src/tests/data"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SegmentRendererTest );
+
+using namespace H2Core;
+
+/* 120 bpm, a 192 ticks pattern lasts 2 seconds, the crash 3 */
+static const int nColumns = 8;
+
+/*
+ * the kit on a pattern played on every column, the crash ringing over the
+ * next ones, with humanized velocity and time and random pitch
+ */
+static Song* createSong()
+{
+	static const char* samples[] = { "kick.wav", "snare.wav", "hh.wav", "crash.wav" };
+	Song* pSong = new Song( "segments", "test", 120, 0.5 );
+	pSong->set_humanize_time_value( 0.3 );
+	pSong->set_humanize_velocity_value( 0.3 );
+	pSong->set_random_seed( 1234 );
+
+	InstrumentList* pInstruments = new InstrumentList();
+	for ( int i = 0; i < 4; i++ ) {
+		Instrument* pInstr = new Instrument( i, QString( "instrument %1" ).arg( i ) );
+		pInstr->set_layer( new InstrumentLayer( Sample::load( QString( BASE_DIR"/drumkit/%1" ).arg( samples[ i ] ) ) ), 0 );
+		pInstr->set_random_pitch_factor( 0.5 );
+		pInstruments->add( pInstr );
+	}
+	pSong->set_instrument_list( pInstruments );
+
+	Pattern* pPattern = new Pattern( "A", "", "not_categorized", 192 );
+	for ( int nTick = 0; nTick < 192; nTick += 24 ) {
+		pPattern->insert_note( new Note( pInstruments->get( 2 ), nTick, 0.6, 0.5, 0.5, -1, 0.0 ) );
+	}
+	pPattern->insert_note( new Note( pInstruments->get( 0 ), 0, 0.9, 0.5, 0.5, -1, 0.0 ) );
+	pPattern->insert_note( new Note( pInstruments->get( 0 ), 96, 0.9, 0.5, 0.5, -1, 0.0 ) );
+	pPattern->insert_note( new Note( pInstruments->get( 1 ), 48, 0.8, 0.5, 0.5, -1, 0.0 ) );
+	pPattern->insert_note( new Note( pInstruments->get( 1 ), 144, 0.8, 0.3, 0.7, 24, 0.0 ) );
+	pPattern->insert_note( new Note( pInstruments->get( 3 ), 180, 0.7, 0.5, 0.5, -1, 0.0 ) );
+
+	PatternList* pPatterns = new PatternList();
+	pPatterns->add( pPattern );
+	pSong->set_pattern_list( pPatterns );
+
+	std::vector<PatternList*>* pColumns = new std::vector<PatternList*>;
+	for ( int i = 0; i < nColumns; i++ ) {
+		pColumns->push_back( new PatternList() );
+		( *pColumns )[ i ]->add( pPattern );
+	}
+	pSong->set_pattern_group_vector( pColumns );
+	pSong->set_mode( Song::SONG_MODE );
+	return pSong;
+}
+
+/* export the song as the export dialog does, and load the file back */
+static Sample* exportSong( unsigned nSegments, unsigned nLeadIn )
+{
+	Preferences* pPref = Preferences::get_instance();
+	pPref->m_nExportSegments = nSegments;
+	pPref->m_nExportLeadIn = nLeadIn;
+
+	QString sFilename = Filesystem::tmp_file( "segments" ) + ".wav";
+	EventQueue* pQueue = EventQueue::get_instance();
+	while ( pQueue->pop_event().type != EVENT_NONE ) {}
+	Hydrogen::get_instance()->startExportSong( sFilename, 44100, 32, QStringList() );
+
+	/* a minute at most */
+	bool bDone = false;
+	for ( int i = 0; i < 600 && !bDone; i++ ) {
+		pQueue->wait_event( 100 );
+		for ( Event event = pQueue->pop_event(); event.type != EVENT_NONE; event = pQueue->pop_event() ) {
+			if ( event.type == EVENT_PROGRESS && event.value == 100 ) {
+				bDone = true;
+			}
+		}
+	}
+	Hydrogen::get_instance()->stopExportSong( true );
+	CPPUNIT_ASSERT( bDone );
+
+	Sample* pSample = Sample::load( sFilename );
+	CPPUNIT_ASSERT( pSample && !pSample->is_empty() );
+	return pSample;
+}
+
+/* the largest difference between two renders over their first frames */
+static float difference( Sample* pA, Sample* pB, int nFrames )
+{
+	float fDiff = 0;
+	for ( int i = 0; i < nFrames; i++ ) {
+		fDiff = std::max( fDiff, ( float )fabs( pA->get_data_l()[ i ] - pB->get_data_l()[ i ] ) );
+		fDiff = std::max( fDiff, ( float )fabs( pA->get_data_r()[ i ] - pB->get_data_r()[ i ] ) );
+	}
+	return fDiff;
+}
+
+void SegmentRendererTest::setUp()
+{
+	Preferences::create_instance();
+	Preferences* pPref = Preferences::get_instance();
+	pPref->m_sAudioDriver = "Fake";
+	pPref->m_sMidiDriver = "None";
+	Hydrogen::create_instance();
+	Hydrogen::get_instance()->setSong( createSong() );
+}
+
+void SegmentRendererTest::tearDown()
+{
+	Preferences::get_instance()->m_nExportSegments = 1;
+}
+
+void SegmentRendererTest::testSegments()
+{
+	Sample* pSerial = exportSong( 1, 0 );
+	CPPUNIT_ASSERT_EQUAL( ( int )( nColumns * 2 * 44100 ), pSerial->get_frames() );
+
+	/* the lead-in is longer than the crash, each segment starts with the voices of the serial render */
+	int segments[] = { 2, 3, 5 };
+	for ( int i = 0; i < 3; i++ ) {
+		Sample* pSegments = exportSong( segments[ i ], 4000 );
+		CPPUNIT_ASSERT_EQUAL( pSerial->get_frames(), pSegments->get_frames() );
+		/* only the order the voices are summed in may differ */
+		CPPUNIT_ASSERT( difference( pSerial, pSegments, pSerial->get_frames() ) < 1e-5 );
+		delete pSegments;
+	}
+	delete pSerial;
+}
+
+void SegmentRendererTest::testJoin()
+{
+	Sample* pSerial = exportSong( 1, 0 );
+	/* without a lead-in the tails crossing the joins are lost, the joins themselves add or drop no frame */
+	Sample* pSegments = exportSong( 4, 0 );
+	CPPUNIT_ASSERT_EQUAL( pSerial->get_frames(), pSegments->get_frames() );
+	/* the first segment is the serial render */
+	CPPUNIT_ASSERT( difference( pSerial, pSegments, pSerial->get_frames() / 4 ) < 1e-5 );
+	CPPUNIT_ASSERT( difference( pSerial, pSegments, pSerial->get_frames() ) > 1e-3 );
+	delete pSerial;
+	delete pSegments;
+}
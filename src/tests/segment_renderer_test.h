@@ -0,0 +1,20 @@
+#ifndef SEGMENT_RENDERER_TEST_H
+#define SEGMENT_RENDERER_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SegmentRendererTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SegmentRendererTest );
+	CPPUNIT_TEST( testSegments );
+	CPPUNIT_TEST( testJoin );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	virtual void setUp();
+	virtual void tearDown();
+
+	void testSegments();
+	void testJoin();
+};
+
+#endif
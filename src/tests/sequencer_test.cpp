@@ -0,0 +1,376 @@
+#include "sequencer_test.h"
+
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/Preferences.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/helpers/random.h>
+
+#include <algorithm>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SequencerTest );
+
+using namespace H2Core;
+
+/* 120 bpm, 48 ticks a beat, 44100 frames a second */
+static const float fTickSize = 459.375;
+
+static Note* note( Instrument* pInstr, int nPosition, float fLeadLag = 0.0 )
+{
+	Note* pNote = new Note( pInstr, nPosition, 0.8, 0.5, 0.5, -1, 0.0 );
+	pNote->set_lead_lag( fLeadLag );
+	return pNote;
+}
+
+/*
+ * columns [A], [B], [], [B,A], [A] of 192, 96, 192, 96 and 192 ticks,
+ * A plays the virtual pattern C, the notes land on swung and lead or
+ * lagged positions
+ */
+static Song* createSong()
+{
+	Song* pSong = new Song( "sequencer", "test", 120, 0.5 );
+	pSong->set_humanize_time_value( 0.4 );
+	pSong->set_swing_factor( 0.5 );
+	pSong->set_random_seed( 1234 );
+
+	InstrumentList* pInstruments = new InstrumentList();
+	for ( int i = 0; i < 3; i++ ) {
+		pInstruments->add( new Instrument( i, QString( "instrument %1" ).arg( i ) ) );
+	}
+	pSong->set_instrument_list( pInstruments );
+
+	Pattern* pA = new Pattern( "A", "", "not_categorized", 192 );
+	pA->insert_note( note( pInstruments->get( 0 ), 0 ) );
+	pA->insert_note( note( pInstruments->get( 1 ), 12, 0.3 ) );
+	pA->insert_note( note( pInstruments->get( 0 ), 50 ) );
+	pA->insert_note( note( pInstruments->get( 2 ), 50, -0.2 ) );
+	pA->insert_note( note( pInstruments->get( 1 ), 191 ) );
+	Pattern* pB = new Pattern( "B", "", "not_categorized", 96 );
+	pB->insert_note( note( pInstruments->get( 2 ), 0 ) );
+	pB->insert_note( note( pInstruments->get( 0 ), 36 ) );
+	pB->insert_note( note( pInstruments->get( 1 ), 95, 0.5 ) );
+	Pattern* pC = new Pattern( "C", "", "not_categorized", 192 );
+	pC->insert_note( note( pInstruments->get( 2 ), 30 ) );
+	pC->insert_note( note( pInstruments->get( 2 ), 150, -0.4 ) );
+	pA->virtual_patterns_add( pC );
+
+	PatternList* pPatterns = new PatternList();
+	pPatterns->add( pA );
+	pPatterns->add( pB );
+	pPatterns->add( pC );
+	pPatterns->flattened_virtual_patterns_compute();
+	pSong->set_pattern_list( pPatterns );
+
+	std::vector<PatternList*>* pColumns = new std::vector<PatternList*>;
+	for ( int i = 0; i < 5; i++ ) {
+		pColumns->push_back( new PatternList() );
+	}
+	( *pColumns )[ 0 ]->add( pA );
+	( *pColumns )[ 1 ]->add( pB );
+	( *pColumns )[ 3 ]->add( pB );
+	( *pColumns )[ 3 ]->add( pA );
+	( *pColumns )[ 4 ]->add( pA );
+	pSong->set_pattern_group_vector( pColumns );
+	pSong->set_mode( Song::SONG_MODE );
+	return pSong;
+}
+
+/* the column of a tick, walking the columns */
+static int walkColumns( Song* pSong, long nTick, bool bLoopMode, int* pStartTick )
+{
+	std::vector<PatternList*>* pColumns = pSong->get_pattern_group_vector();
+	long nSongSize = 0;
+	for ( unsigned i = 0; i < pColumns->size(); i++ ) {
+		nSongSize += ( *pColumns )[ i ]->size() ? ( *pColumns )[ i ]->get( 0 )->get_length() : MAX_NOTES;
+	}
+	if ( bLoopMode && nTick >= nSongSize ) {
+		nTick %= nSongSize;
+	}
+	long nStart = 0;
+	for ( unsigned i = 0; i < pColumns->size(); i++ ) {
+		long nSize = ( *pColumns )[ i ]->size() ? ( *pColumns )[ i ]->get( 0 )->get_length() : MAX_NOTES;
+		if ( nTick >= nStart && nTick < nStart + nSize ) {
+			*pStartTick = nStart;
+			return i;
+		}
+		nStart += nSize;
+	}
+	return -1;
+}
+
+/* midi notes queued for the next run, in position order: instrument, position */
+static const int midiNotes[][ 2 ] = { { 1, 5 }, { 0, 200 }, { 2, 200 }, { 1, 777 } };
+static const int nMidiNotes = 4;
+
+static void queueMidiNotes( Song* pSong )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	InstrumentList* pInstruments = pSong->get_instrument_list();
+	for ( int i = 0; i < nMidiNotes; i++ ) {
+		pHydrogen->midi_noteOn( note( pInstruments->get( midiNotes[ i ][ 0 ] ), midiNotes[ i ][ 1 ] ) );
+	}
+}
+
+/* a queued note, as the tests compare them */
+struct QueuedNote {
+	long long nStart;	///< frame it starts at, a negative humanize delay included
+	int nPosition;
+	int nHumanizeDelay;
+	int nInstrument;
+	float fVelocity;
+	float fPitch;
+};
+
+static QueuedNote queuedNote( int nPosition, int nHumanizeDelay, int nInstrument, float fVelocity, float fPitch )
+{
+	QueuedNote note;
+	note.nStart = ( long long )( nPosition * fTickSize ) + std::min( 0, nHumanizeDelay );
+	note.nPosition = nPosition;
+	note.nHumanizeDelay = nHumanizeDelay;
+	note.nInstrument = nInstrument;
+	note.fVelocity = fVelocity;
+	note.fPitch = fPitch;
+	return note;
+}
+
+/* the notes starting at the same frame may be played in any order */
+static bool queuedBefore( const QueuedNote& a, const QueuedNote& b )
+{
+	if ( a.nStart != b.nStart ) return a.nStart < b.nStart;
+	if ( a.nPosition != b.nPosition ) return a.nPosition < b.nPosition;
+	if ( a.nInstrument != b.nInstrument ) return a.nInstrument < b.nInstrument;
+	if ( a.nHumanizeDelay != b.nHumanizeDelay ) return a.nHumanizeDelay < b.nHumanizeDelay;
+	if ( a.fVelocity != b.fVelocity ) return a.fVelocity < b.fVelocity;
+	return a.fPitch < b.fPitch;
+}
+
+/*
+ * The notes the sequencer queued when it still walked the song tick by
+ * tick: the column of every tick looked up again, its patterns and their
+ * virtual patterns flattened again, the notes of the tick found in the
+ * pattern note maps. Only the notes sequenceSong() would have handed out
+ * are kept: the ones starting before the end of the last period it ran,
+ * or of the period before the end of the song.
+ */
+static void walkSong( unsigned nFrames, unsigned nPeriod, std::vector<QueuedNote>* pNotes )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Song* pSong = pHydrogen->getSong();
+	const int nMaxTimeHumanize = 2000;
+	const int nLeadLagFactor = fTickSize * 5;
+	const int nLookahead = nLeadLagFactor + nMaxTimeHumanize + 1;
+	const bool bSongMode = pSong->get_mode() == Song::SONG_MODE;
+	const bool bLoopMode = pSong->is_loop_enabled();
+
+	int nStart = 0;
+	long nSongSize = 0;
+	while ( walkColumns( pSong, nSongSize, false, &nStart ) != -1 ) {
+		nSongSize++;
+	}
+
+	long long nEndFrame = 0;
+	int nLastTick = 0;
+	for ( unsigned nFrame = 0; nFrame < nFrames; nFrame += nPeriod ) {
+		int nEndTick = ( int )( ( nFrame + nPeriod + nLookahead ) / fTickSize );
+		if ( bSongMode && !bLoopMode && nEndTick >= nSongSize ) {
+			nLastTick = nSongSize - 1;	// the period is never handed out
+			break;
+		}
+		nEndFrame = nFrame + nPeriod;
+		nLastTick = nEndTick;
+	}
+
+	Random random( pSong->get_random_seed() );
+	std::vector<QueuedNote> notes;
+	for ( int nTick = 0; nTick <= nLastTick; nTick++ ) {
+		for ( int i = 0; i < nMidiNotes; i++ ) {
+			if ( midiNotes[ i ][ 1 ] == nTick ) {
+				notes.push_back( queuedNote( nTick, 0, midiNotes[ i ][ 0 ], 0.8, 0.0 ) );
+			}
+		}
+
+		PatternList playing;
+		int nPosition;
+		if ( bSongMode ) {
+			int nColumn = walkColumns( pSong, nTick, bLoopMode, &nStart );
+			CPPUNIT_ASSERT( nColumn != -1 );
+			nPosition = ( nTick - nStart ) % nSongSize;
+			PatternList* pColumn = ( *pSong->get_pattern_group_vector() )[ nColumn ];
+			for ( int i = 0; i < pColumn->size(); i++ ) {
+				playing.add( pColumn->get( i ) );
+				pColumn->get( i )->extand_with_flattened_virtual_patterns( &playing );
+			}
+		} else {
+			Pattern* pPattern = pSong->get_pattern_list()->get( pHydrogen->getSelectedPatternNumber() );
+			playing.add( pPattern );
+			pPattern->extand_with_flattened_virtual_patterns( &playing );
+			nPosition = nTick % pPattern->get_length();
+		}
+
+		if ( nPosition % 48 == 0 && Preferences::get_instance()->m_bUseMetronome ) {
+			notes.push_back( queuedNote( nTick, 0, METRONOME_INSTR_ID,
+										 nPosition == 0 ? 1.0 : 0.8, nPosition == 0 ? 3 : 0 ) );
+		}
+
+		for ( int nPat = 0; nPat < playing.size(); nPat++ ) {
+			const Pattern::notes_t* pPatternNotes = playing.get( nPat )->get_notes();
+			FOREACH_NOTE_CST_IT_BOUND( pPatternNotes, it, nPosition ) {
+				Note* pNote = it->second;
+				int nOffset = 0;
+				if ( ( nPosition % 12 ) == 0 && ( nPosition % 24 ) != 0 ) {
+					nOffset += ( int )( 6.0 * fTickSize * pSong->get_swing_factor() );
+				}
+				if ( pSong->get_humanize_time_value() != 0 ) {
+					nOffset += ( int )( random.gaussian( 0.3 ) * pSong->get_humanize_time_value() * nMaxTimeHumanize );
+				}
+				nOffset += ( int )( pNote->get_lead_lag() * nLeadLagFactor );
+				if ( nTick == 0 && nOffset < 0 ) {
+					nOffset = 0;
+				}
+				notes.push_back( queuedNote( nTick, nOffset, pNote->get_instrument()->get_id(),
+											 pNote->get_velocity(), pNote->get_pitch() ) );
+			}
+		}
+		playing.clear();	// the song owns the patterns
+	}
+
+	for ( unsigned i = 0; i < notes.size(); i++ ) {
+		if ( notes[ i ].nStart < nEndFrame ) {
+			pNotes->push_back( notes[ i ] );
+		}
+	}
+	std::stable_sort( pNotes->begin(), pNotes->end(), queuedBefore );
+}
+
+/* sequence the song with a few midi notes, and compare the queued notes with the walked ones */
+static void checkSequence( unsigned nFrames, unsigned nPeriod )
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Song* pSong = pHydrogen->getSong();
+	std::vector<QueuedNote> reference;
+	std::vector<Note*> played;
+	std::vector<QueuedNote> notes;
+
+	walkSong( nFrames, nPeriod, &reference );
+	queueMidiNotes( pSong );
+	pHydrogen->sequenceSong( nFrames, nPeriod, &played );
+	for ( unsigned i = 0; i < played.size(); i++ ) {
+		Note* pNote = played[ i ];
+		notes.push_back( queuedNote( pNote->get_position(), pNote->get_humanize_delay(),
+									 pNote->get_instrument()->get_id(), pNote->get_velocity(), pNote->get_pitch() ) );
+		delete pNote;
+	}
+	std::stable_sort( notes.begin(), notes.end(), queuedBefore );
+
+	CPPUNIT_ASSERT( reference.size() > 0 );
+	CPPUNIT_ASSERT_EQUAL( reference.size(), notes.size() );
+	int nMetronome = 0;
+	for ( unsigned i = 0; i < notes.size(); i++ ) {
+		CPPUNIT_ASSERT_EQUAL( reference[ i ].nPosition, notes[ i ].nPosition );
+		CPPUNIT_ASSERT_EQUAL( reference[ i ].nHumanizeDelay, notes[ i ].nHumanizeDelay );
+		CPPUNIT_ASSERT_EQUAL( reference[ i ].nInstrument, notes[ i ].nInstrument );
+		CPPUNIT_ASSERT_EQUAL( reference[ i ].fVelocity, notes[ i ].fVelocity );
+		CPPUNIT_ASSERT_EQUAL( reference[ i ].fPitch, notes[ i ].fPitch );
+		if ( notes[ i ].nInstrument == METRONOME_INSTR_ID ) {
+			nMetronome++;
+		}
+	}
+	CPPUNIT_ASSERT( nMetronome > 0 );
+}
+
+void SequencerTest::setUp()
+{
+	/* the fake driver never plays, the sequencer is run by the tests */
+	Preferences::create_instance();
+	Preferences* pPref = Preferences::get_instance();
+	pPref->m_sAudioDriver = "Fake";
+	pPref->m_sMidiDriver = "None";
+	pPref->m_bUseMetronome = true;
+	Hydrogen::create_instance();
+	Hydrogen::get_instance()->setSong( createSong() );
+}
+
+void SequencerTest::testPosForTick()
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Song* pSong = pHydrogen->getSong();
+	const long nSongSize = 192 + 96 + 192 + 96 + 192;
+
+	/* indexed first, then walked once the columns changed */
+	for ( int nRound = 0; nRound < 2; nRound++ ) {
+		for ( long nTick = 0; nTick < 2 * nSongSize; nTick++ ) {
+			for ( int nLoop = 0; nLoop < 2; nLoop++ ) {
+				int nStart = -1, nExpectedStart = -1;
+				int nPos = pHydrogen->getPosForTick( nTick, nLoop, &nStart );
+				int nExpectedPos = walkColumns( pSong, nTick, nLoop, &nExpectedStart );
+				CPPUNIT_ASSERT_EQUAL( nExpectedPos, nPos );
+				if ( nPos != -1 ) {
+					CPPUNIT_ASSERT_EQUAL( nExpectedStart, nStart );
+				}
+			}
+		}
+		if ( nRound == 0 ) {
+			CPPUNIT_ASSERT_EQUAL( nSongSize, pHydrogen->getSongSizeInTicks() );
+		}
+		/* a column added without indexing the song again is still found */
+		PatternList* pColumn = new PatternList();
+		pColumn->add( pSong->get_pattern_list()->get( 1 ) );
+		pSong->get_pattern_group_vector()->push_back( pColumn );
+		pSong->patterns_changed();
+	}
+
+	pHydrogen->updateSongTimeline();
+	int nStart = -1;
+	CPPUNIT_ASSERT_EQUAL( 6, pHydrogen->getPosForTick( nSongSize + 96, false, &nStart ) );
+	CPPUNIT_ASSERT_EQUAL( ( int )nSongSize + 96, nStart );
+	CPPUNIT_ASSERT_EQUAL( nSongSize + 2 * 96, pHydrogen->getSongSizeInTicks() );
+}
+
+void SequencerTest::testSongMode()
+{
+	/* up to the end of the song, in periods of a few ticks or less than one */
+	unsigned nSongFrames = ( unsigned )( 768 * fTickSize );
+	checkSequence( 2 * nSongFrames, 512 );
+	checkSequence( 2 * nSongFrames, 4096 );
+	checkSequence( 2 * nSongFrames, 100 );
+}
+
+void SequencerTest::testSongLoop()
+{
+	Hydrogen::get_instance()->getSong()->set_loop_enabled( true );
+	unsigned nSongFrames = ( unsigned )( 768 * fTickSize );
+	checkSequence( 5 * nSongFrames / 2, 1000 );
+}
+
+void SequencerTest::testColumnEdit()
+{
+	/* the last column plays B too, as many columns as before and not indexed again */
+	Song* pSong = Hydrogen::get_instance()->getSong();
+	( *pSong->get_pattern_group_vector() )[ 4 ]->add( pSong->get_pattern_list()->get( 1 ) );
+	pSong->patterns_changed();
+	unsigned nSongFrames = ( unsigned )( 768 * fTickSize );
+	checkSequence( 2 * nSongFrames, 512 );
+}
+
+void SequencerTest::testPatternMode()
+{
+	Hydrogen* pHydrogen = Hydrogen::get_instance();
+	Preferences* pPref = Preferences::get_instance();
+	pHydrogen->getSong()->set_mode( Song::PATTERN_MODE );
+	bool bPlaysSelected = pPref->patternModePlaysSelected();
+	pPref->setPatternModePlaysSelected( true );
+
+	/* A and its virtual pattern C */
+	pHydrogen->setSelectedPatternNumber( 0 );
+	checkSequence( ( unsigned )( 1000 * fTickSize ), 512 );
+	/* B alone, shorter than C */
+	pHydrogen->setSelectedPatternNumber( 1 );
+	checkSequence( ( unsigned )( 1000 * fTickSize ), 333 );
+
+	pPref->setPatternModePlaysSelected( bPlaysSelected );
+}
@@ -0,0 +1,25 @@
+#ifndef SEQUENCER_TEST_H
+#define SEQUENCER_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SequencerTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SequencerTest );
+	CPPUNIT_TEST( testPosForTick );
+	CPPUNIT_TEST( testSongMode );
+	CPPUNIT_TEST( testSongLoop );
+	CPPUNIT_TEST( testColumnEdit );
+	CPPUNIT_TEST( testPatternMode );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	virtual void setUp();
+
+	void testPosForTick();
+	void testSongMode();
+	void testSongLoop();
+	void testColumnEdit();
+	void testPatternMode();
+};
+
+#endif
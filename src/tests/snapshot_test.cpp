@@ -0,0 +1,69 @@
+#include "snapshot_test.h"
+
+#include <hydrogen/helpers/snapshot.h>
+
+CPPUNIT_TEST_SUITE_REGISTRATION( SnapshotTest );
+
+using namespace H2Core;
+
+/* counts the live values, to check the snapshot frees every one of them */
+struct Value {
+	static int alive;
+	int n;
+	Value( int v ) : n( v ) { alive++; }
+	~Value() { alive--; }
+};
+int Value::alive = 0;
+
+void SnapshotTest::testPublish()
+{
+	{
+		Snapshot<Value> snapshot;
+		CPPUNIT_ASSERT( snapshot.take() == NULL );
+
+		snapshot.lock();
+		CPPUNIT_ASSERT( snapshot.publish( snapshot.peek(), new Value( 1 ) ) );
+		CPPUNIT_ASSERT( snapshot.publish( snapshot.peek(), new Value( 2 ) ) );
+		CPPUNIT_ASSERT_EQUAL( 2, snapshot.peek()->n );
+		snapshot.unlock();
+		/* the replaced value is freed right away */
+		CPPUNIT_ASSERT_EQUAL( 1, Value::alive );
+
+		Value* pValue = snapshot.take();
+		CPPUNIT_ASSERT( pValue != NULL );
+		CPPUNIT_ASSERT_EQUAL( 2, pValue->n );
+		CPPUNIT_ASSERT( snapshot.take() == NULL );
+		snapshot.retire( pValue );
+
+		/* the retired value waits for the next writer */
+		CPPUNIT_ASSERT_EQUAL( 1, Value::alive );
+		snapshot.lock();
+		CPPUNIT_ASSERT( snapshot.publish( snapshot.peek(), new Value( 3 ) ) );
+		snapshot.unlock();
+		CPPUNIT_ASSERT_EQUAL( 1, Value::alive );
+	}
+	CPPUNIT_ASSERT_EQUAL( 0, Value::alive );
+}
+
+void SnapshotTest::testTakenWhilePublishing()
+{
+	Snapshot<Value> snapshot;
+	snapshot.lock();
+	CPPUNIT_ASSERT( snapshot.publish( NULL, new Value( 1 ) ) );
+	const Value* pExpected = snapshot.peek();
+
+	/* the audio thread takes the value between peek() and publish() */
+	Value* pTaken = snapshot.take();
+	CPPUNIT_ASSERT( pTaken == pExpected );
+
+	Value* pValue = new Value( 2 );
+	CPPUNIT_ASSERT( !snapshot.publish( pExpected, pValue ) );
+	CPPUNIT_ASSERT( snapshot.peek() == NULL );
+	CPPUNIT_ASSERT( snapshot.publish( snapshot.peek(), pValue ) );
+	snapshot.unlock();
+
+	snapshot.retire( pTaken );
+	pTaken = snapshot.take();
+	CPPUNIT_ASSERT_EQUAL( 2, pTaken->n );
+	snapshot.retire( pTaken );
+}
@@ -0,0 +1,17 @@
+#ifndef SNAPSHOT_TEST_H
+#define SNAPSHOT_TEST_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SnapshotTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SnapshotTest );
+	CPPUNIT_TEST( testPublish );
+	CPPUNIT_TEST( testTakenWhilePublishing );
+	CPPUNIT_TEST_SUITE_END();
+
+	public:
+	void testPublish();
+	void testTakenWhilePublishing();
+};
+
+#endif